@@ -6,5 +6,5 @@
 #cmakedefine TARGET_LINUX 1
 #cmakedefine PROJECT_CPP_FILESYSTEM 1
 #cmakedefine PROJECT_DEVICE_GL 1
-#cmakedefine PROJECT_DEVICE_NULL 1
+#cmakedefine PROJECT_DEVICE_SOFT 1
 #cmakedefine PROJECT_DEVICE_DX12 1
\ No newline at end of file
@@ -3,7 +3,7 @@ option (PROJECT_CPP_FILESYSTEM "Use CPP 14 Filesystem - experimental" ON)
 
 option (PROJECT_DEVICE_GL "Support OpenGL" ON)
 option (PROJECT_DEVICE_DX12 "Support DX12" ON)
-option (PROJECT_DEVICE_NULL "Support Null Device (for profiling, testing)" OFF)
+option (PROJECT_DEVICE_SOFT "Support the Software Device (for profiling, testing without a GPU)" ON)
 
 IF (NOT TARGET_PC)
 SET(PROJECT_DEVICE_DX12 OFF)
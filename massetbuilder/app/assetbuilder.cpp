@@ -4,6 +4,8 @@
 #include "file/fileutils.h"
 
 #include "assetbuilder.h"
+#include "fontbuilder.h"
+#include "texturebuilder.h"
 
 #include <queue>
 #include <set>
@@ -195,13 +197,32 @@ bool AssetBuilder::CompileAssets()
         LOG(INFO) << "Target Dir: " << targetBasePath.string();
     }
 
+    m_builders[".ttf"] = std::make_shared<FontBuilder>();
+
+    auto spTextureBuilder = std::make_shared<TextureBuilder>();
+    m_builders[".png"] = spTextureBuilder;
+    m_builders[".jpg"] = spTextureBuilder;
+    m_builders[".tga"] = spTextureBuilder;
+    m_builders[".bmp"] = spTextureBuilder;
+
 #if PROJECT_DEVICE_DX12
     auto spBuilder = std::make_shared<DXCompiler>();
     m_builders[".mhlsl"] = spBuilder;
 #endif
 
+    // Builds which can run side by side are held back, and run across the cores once the rest are done.
+    // Their records keep their place, so the record file is in asset order
+    struct ParallelBuild
+    {
+        size_t record;
+        BuildArtifact artifact;
+        IBuilder* pBuilder;
+        std::string error;
+    };
+    std::vector<ParallelBuild> parallelBuilds;
+    std::vector<json> records;
+
     bool allOK = true;
-    json buildRecord;
     for (auto& asset : m_assets)
     {
         try
@@ -226,7 +247,7 @@ bool AssetBuilder::CompileAssets()
                     if (t1 == t2)
                     {
                         // Use the old record - it hasn't changed
-                        buildRecord["artifacts"].push_back(*itrFound->second);
+                        records.push_back(json(*itrFound->second));
                         if (!itrFound->second->success)
                         {
                             allOK = false;
@@ -236,20 +257,26 @@ bool AssetBuilder::CompileAssets()
                 }
             }
 
+            IBuilder* pBuilder = this;
             auto itrBuilder = m_builders.find(asset.sourcePath.extension().string());
-            if (itrBuilder == m_builders.end())
+            if (itrBuilder != m_builders.end())
             {
-                Build(artifact);
+                pBuilder = itrBuilder->second.get();
             }
-            else
+
+            if (pBuilder->CanBuildInParallel())
             {
-                itrBuilder->second->Build(artifact);
+                parallelBuilds.push_back(ParallelBuild{ records.size(), artifact, pBuilder, std::string() });
+                records.push_back(json());
+                continue;
             }
+
+            pBuilder->Build(artifact);
             if (!artifact.success)
             {
                 allOK = false;
             }
-            buildRecord["artifacts"].push_back(artifact);
+            records.push_back(json(artifact));
         }
         catch (fs::filesystem_error& err)
         {
@@ -260,6 +287,46 @@ bool AssetBuilder::CompileAssets()
             LOG(ERROR) << err.what();
         }
     }
+
+    ParallelFor(uint32_t(parallelBuilds.size()), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t index = begin; index < end; index++)
+        {
+            auto& build = parallelBuilds[index];
+            try
+            {
+                build.pBuilder->Build(build.artifact);
+            }
+            catch (std::exception& err)
+            {
+                build.error = err.what();
+            }
+        }
+    });
+
+    for (auto& build : parallelBuilds)
+    {
+        if (!build.error.empty())
+        {
+            LOG(ERROR) << build.error;
+            continue;
+        }
+
+        if (!build.artifact.success)
+        {
+            allOK = false;
+        }
+        records[build.record] = json(build.artifact);
+    }
+
+    json buildRecord;
+    for (auto& record : records)
+    {
+        if (!record.is_null())
+        {
+            buildRecord["artifacts"].push_back(record);
+        }
+    }
     std::string recordString = buildRecord.dump();
     FileUtils::WriteFile(targetRecordFile, recordString.c_str(), recordString.size());
 
@@ -21,6 +21,9 @@ struct BuildArtifact
 struct IBuilder
 {
     virtual void Build(BuildArtifact& artifact) = 0;
+
+    // If Build can run on several assets at once, across the cores; it mustn't start parallel work of its own
+    virtual bool CanBuildInParallel() const { return false; }
 };
 
 class AssetBuilder : public IBuilder
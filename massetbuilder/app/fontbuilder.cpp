@@ -0,0 +1,267 @@
+#include "massetbuilder_app.h"
+#include "fontbuilder.h"
+#include "file/fileutils.h"
+#include "graphics/fontatlas.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+using namespace nlohmann;
+using namespace MCommon;
+
+namespace MAssetBuilder
+{
+
+namespace
+{
+
+struct FontOptions
+{
+    uint32_t pixelSize = 48;    // Size of the baked glyphs
+    uint32_t spread = 6;        // Distance range either side of the edge, in baked pixels
+    uint32_t supersample = 4;   // The outlines are rendered this much larger, for accurate distances
+    uint32_t first = 32;        // Character range
+    uint32_t last = 126;
+
+    FontOptions() {}
+};
+
+// A glyph's coverage at the supersampled size, and then its distance field at the baked size
+struct BakedGlyph
+{
+    FontGlyph glyph;
+    std::vector<uint8_t> coverage;
+    glm::uvec2 coverageSize = glm::uvec2(0);
+    std::vector<uint8_t> field;
+    glm::uvec2 fieldSize = glm::uvec2(0);
+    glm::uvec2 atlasPos = glm::uvec2(0);
+
+    BakedGlyph() {}
+};
+
+FontOptions ReadOptions(const BuildArtifact& artifact)
+{
+    FontOptions options;
+    if (artifact.sourceFileMeta.empty())
+    {
+        return options;
+    }
+
+    auto meta = json::parse(FileUtils::ReadFile(artifact.sourceFileMeta));
+    auto read = [&](const char* name, uint32_t& value)
+    {
+        if (meta.find(name) != meta.end())
+        {
+            value = meta[name].get<uint32_t>();
+        }
+    };
+    read("pixelSize", options.pixelSize);
+    read("spread", options.spread);
+    read("supersample", options.supersample);
+    read("first", options.first);
+    read("last", options.last);
+
+    options.supersample = std::max(options.supersample, 1u);
+    return options;
+}
+
+// Rows of glyphs, tallest first; the atlas height grows in powers of 2
+glm::uvec2 PackGlyphs(std::vector<BakedGlyph>& glyphs, uint32_t width)
+{
+    std::vector<BakedGlyph*> sorted;
+    for (auto& glyph : glyphs)
+    {
+        if (glyph.fieldSize.x != 0)
+        {
+            sorted.push_back(&glyph);
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](BakedGlyph* a, BakedGlyph* b) { return a->fieldSize.y > b->fieldSize.y; });
+
+    // A pixel gap, so bilinear filtering doesn't bleed between glyphs
+    const uint32_t Gap = 1;
+    glm::uvec2 pen(Gap);
+    uint32_t rowHeight = 0;
+    for (auto pGlyph : sorted)
+    {
+        if (pen.x + pGlyph->fieldSize.x + Gap > width)
+        {
+            pen = glm::uvec2(Gap, pen.y + rowHeight + Gap);
+            rowHeight = 0;
+        }
+        pGlyph->atlasPos = pen;
+        pen.x += pGlyph->fieldSize.x + Gap;
+        rowHeight = std::max(rowHeight, pGlyph->fieldSize.y);
+    }
+
+    uint32_t height = 1;
+    while (height < pen.y + rowHeight + Gap)
+    {
+        height *= 2;
+    }
+    return glm::uvec2(width, height);
+}
+
+} // namespace
+
+void FontBuilder::Build(BuildArtifact& artifact)
+{
+    LOG(INFO) << "Baking font: " << artifact.sourceFile.string() << "...";
+
+    auto options = ReadOptions(artifact);
+    auto ss = options.supersample;
+
+    FT_Library library;
+    if (FT_Init_FreeType(&library) != 0)
+    {
+        LOG(ERROR) << "Could not initialize FreeType";
+        return;
+    }
+
+    FT_Face face;
+    if (FT_New_Face(library, artifact.sourceFile.string().c_str(), 0, &face) != 0)
+    {
+        LOG(ERROR) << "Could not load font: " << artifact.sourceFile.string();
+        FT_Done_FreeType(library);
+        return;
+    }
+    FT_Set_Pixel_Sizes(face, 0, options.pixelSize * ss);
+
+    FontAtlas atlas;
+    atlas.pixelSize = float(options.pixelSize);
+    atlas.spread = float(options.spread);
+    atlas.ascender = face->size->metrics.ascender / 64.0f / ss;
+    atlas.lineHeight = face->size->metrics.height / 64.0f / ss;
+
+    // Render the outlines; FreeType isn't thread safe, so this part is serial.
+    // Each glyph is padded by the spread, and rounded to whole baked pixels
+    uint32_t pad = options.spread * ss;
+    std::vector<BakedGlyph> baked;
+    for (uint32_t codepoint = options.first; codepoint <= options.last; codepoint++)
+    {
+        if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER) != 0)
+        {
+            continue;
+        }
+
+        auto slot = face->glyph;
+        auto& bitmap = slot->bitmap;
+
+        BakedGlyph bake;
+        bake.glyph.codepoint = codepoint;
+        bake.glyph.advance = slot->advance.x / 64.0f / ss;
+
+        if (bitmap.width > 0 && bitmap.rows > 0)
+        {
+            bake.fieldSize = (glm::uvec2(bitmap.width, bitmap.rows) + glm::uvec2(pad * 2 + ss - 1)) / ss;
+            bake.coverageSize = bake.fieldSize * ss;
+            bake.coverage.resize(bake.coverageSize.x * bake.coverageSize.y, 0);
+            for (uint32_t y = 0; y < uint32_t(bitmap.rows); y++)
+            {
+                auto pSource = bitmap.buffer + y * bitmap.pitch;
+                std::copy(pSource, pSource + bitmap.width, &bake.coverage[(y + pad) * bake.coverageSize.x + pad]);
+            }
+
+            bake.glyph.offset = glm::vec2(float(slot->bitmap_left) - pad, -float(slot->bitmap_top) - pad) / float(ss);
+            bake.glyph.size = glm::vec2(bake.fieldSize);
+        }
+        baked.push_back(bake);
+    }
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+
+    // Distance fields, averaged down to the baked size, with the edge at 0.5
+    ParallelFor(uint32_t(baked.size()), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t index = begin; index < end; index++)
+        {
+            auto& bake = baked[index];
+            if (bake.coverage.empty())
+            {
+                continue;
+            }
+
+            auto distances = SignedDistanceField(bake.coverage.data(), bake.coverageSize.x, bake.coverageSize.y, bake.coverageSize.x);
+            bake.field.resize(bake.fieldSize.x * bake.fieldSize.y);
+            for (uint32_t y = 0; y < bake.fieldSize.y; y++)
+            {
+                for (uint32_t x = 0; x < bake.fieldSize.x; x++)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t sy = 0; sy < ss; sy++)
+                    {
+                        auto pRow = &distances[(y * ss + sy) * bake.coverageSize.x + x * ss];
+                        for (uint32_t sx = 0; sx < ss; sx++)
+                        {
+                            sum += pRow[sx];
+                        }
+                    }
+                    float distance = sum / float(ss * ss * ss);
+                    float value = glm::clamp(.5f + distance / (2.0f * options.spread), 0.0f, 1.0f);
+                    bake.field[y * bake.fieldSize.x + x] = uint8_t(value * 255.0f + .5f);
+                }
+            }
+            bake.coverage.clear();
+        }
+    });
+
+    // Wide enough for a square-ish atlas
+    uint32_t area = 0;
+    for (auto& bake : baked)
+    {
+        area += (bake.fieldSize.x + 1) * (bake.fieldSize.y + 1);
+    }
+    uint32_t width = 64;
+    while (width * width < area)
+    {
+        width *= 2;
+    }
+    atlas.atlasSize = PackGlyphs(baked, width);
+
+    // White, with the distance in alpha
+    std::vector<glm::u8vec4> pixels(atlas.atlasSize.x * atlas.atlasSize.y, glm::u8vec4(255, 255, 255, 0));
+    for (auto& bake : baked)
+    {
+        for (uint32_t y = 0; y < bake.fieldSize.y; y++)
+        {
+            auto pTarget = &pixels[(bake.atlasPos.y + y) * atlas.atlasSize.x + bake.atlasPos.x];
+            for (uint32_t x = 0; x < bake.fieldSize.x; x++)
+            {
+                pTarget[x].w = bake.field[y * bake.fieldSize.x + x];
+            }
+        }
+
+        auto topLeft = glm::vec2(bake.atlasPos) / glm::vec2(atlas.atlasSize);
+        auto bottomRight = glm::vec2(bake.atlasPos + bake.fieldSize) / glm::vec2(atlas.atlasSize);
+        bake.glyph.texRect = glm::vec4(topLeft, bottomRight);
+        atlas.glyphs.push_back(bake.glyph);
+    }
+
+    fs::create_directories(artifact.outputDir);
+    auto stem = artifact.outputDir / artifact.sourceFile.stem();
+    auto imagePath = fs::path(stem.string() + ".png");
+    auto metricsPath = fs::path(stem.string() + ".font");
+    artifact.outputs.push_back(imagePath);
+    artifact.outputs.push_back(metricsPath);
+
+    if (!stbi_write_png(imagePath.string().c_str(), atlas.atlasSize.x, atlas.atlasSize.y, 4, pixels.data(), atlas.atlasSize.x * sizeof(glm::u8vec4)))
+    {
+        LOG(ERROR) << "Could not write: " << imagePath.string();
+        return;
+    }
+
+    auto metrics = atlas.Save();
+    if (!FileUtils::WriteFile(metricsPath, metrics.data(), metrics.size()))
+    {
+        LOG(ERROR) << "Could not write: " << metricsPath.string();
+        return;
+    }
+
+    LOG(INFO) << "Font atlas: " << atlas.glyphs.size() << " glyphs, " << atlas.atlasSize.x << "x" << atlas.atlasSize.y;
+    artifact.success = true;
+}
+
+} // MAssetBuilder namespace
@@ -0,0 +1,16 @@
+#pragma once
+#include "assetbuilder.h"
+
+namespace MAssetBuilder
+{
+
+// Bakes a TrueType font into a signed distance field atlas (.png) and its metrics (.font).
+// Options come from an optional .meta next to the font:
+// { "pixelSize": 48, "spread": 6, "supersample": 4, "first": 32, "last": 126 }
+class FontBuilder : public IBuilder
+{
+public:
+    virtual void Build(BuildArtifact& artifact) override;
+};
+
+}
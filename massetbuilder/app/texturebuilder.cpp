@@ -0,0 +1,280 @@
+#include "massetbuilder_app.h"
+#include "texturebuilder.h"
+#include "file/fileutils.h"
+#include "graphics/blockencode.h"
+#include "gli/gli.hpp"
+
+#include <stb/stb_image.h>
+#include <mutex>
+
+using namespace nlohmann;
+using namespace MCommon;
+
+namespace MAssetBuilder
+{
+
+namespace
+{
+
+struct TextureOptions
+{
+    std::string format = "auto";
+    bool srgb = true;
+    bool normalMap = false;
+
+    TextureOptions() {}
+};
+
+// A level of the mip chain, filtered in float; linear color, or normals in [-1, 1]
+struct MipLevel
+{
+    glm::uvec2 size = glm::uvec2(0);
+    std::vector<glm::vec4> texels;
+};
+
+// Textures are built side by side, and the log isn't thread safe
+std::mutex LogMutex;
+
+void LogInfo(const std::string& text)
+{
+    std::lock_guard<std::mutex> lock(LogMutex);
+    LOG(INFO) << text;
+}
+
+void LogError(const std::string& text)
+{
+    std::lock_guard<std::mutex> lock(LogMutex);
+    LOG(ERROR) << text;
+}
+
+TextureOptions ReadOptions(const BuildArtifact& artifact)
+{
+    TextureOptions options;
+    auto name = StringUtils::toLower(artifact.sourceFile.stem().string());
+    const char* normalSuffixes[] = { "_normal", "_nrm", "_ddn" };
+    for (auto pSuffix : normalSuffixes)
+    {
+        if (name.find(pSuffix) != std::string::npos)
+        {
+            options.normalMap = true;
+        }
+    }
+
+    json meta;
+    if (!artifact.sourceFileMeta.empty())
+    {
+        meta = json::parse(FileUtils::ReadFile(artifact.sourceFileMeta));
+        if (meta.find("format") != meta.end())
+        {
+            options.format = StringUtils::toLower(meta["format"].get<std::string>());
+        }
+        if (meta.find("normalMap") != meta.end())
+        {
+            options.normalMap = meta["normalMap"].get<bool>();
+        }
+    }
+
+    options.srgb = !options.normalMap;
+    if (meta.find("srgb") != meta.end())
+    {
+        options.srgb = meta["srgb"].get<bool>();
+    }
+    return options;
+}
+
+float SRGBToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+MipLevel ToLevel(const std::vector<glm::u8vec4>& pixels, const glm::uvec2& size, const TextureOptions& options)
+{
+    float toLinear[256];
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        toLinear[i] = options.srgb ? SRGBToLinear(i / 255.0f) : i / 255.0f;
+    }
+
+    MipLevel level;
+    level.size = size;
+    level.texels.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        auto& pixel = pixels[i];
+        if (options.normalMap)
+        {
+            level.texels[i] = glm::vec4(glm::vec3(pixel) / 127.5f - 1.0f, pixel.w / 255.0f);
+        }
+        else
+        {
+            level.texels[i] = glm::vec4(toLinear[pixel.x], toLinear[pixel.y], toLinear[pixel.z], pixel.w / 255.0f);
+        }
+    }
+    return level;
+}
+
+// Average 2x2 texels; an odd last row or column is clamped
+MipLevel Downsample(const MipLevel& source, const TextureOptions& options)
+{
+    MipLevel target;
+    target.size = glm::max(source.size / 2u, glm::uvec2(1));
+    target.texels.resize(target.size.x * target.size.y);
+    for (uint32_t y = 0; y < target.size.y; y++)
+    {
+        auto pRow0 = &source.texels[std::min(y * 2, source.size.y - 1) * source.size.x];
+        auto pRow1 = &source.texels[std::min(y * 2 + 1, source.size.y - 1) * source.size.x];
+        auto pTarget = &target.texels[y * target.size.x];
+        for (uint32_t x = 0; x < target.size.x; x++)
+        {
+            auto x0 = std::min(x * 2, source.size.x - 1);
+            auto x1 = std::min(x * 2 + 1, source.size.x - 1);
+            auto texel = (pRow0[x0] + pRow0[x1] + pRow1[x0] + pRow1[x1]) * .25f;
+            if (options.normalMap)
+            {
+                auto length = glm::length(glm::vec3(texel));
+                if (length > 0.0f)
+                {
+                    texel = glm::vec4(glm::vec3(texel) / length, texel.w);
+                }
+            }
+            pTarget[x] = texel;
+        }
+    }
+    return target;
+}
+
+std::vector<glm::u8vec4> Quantize(const MipLevel& level, const TextureOptions& options)
+{
+    std::vector<glm::u8vec4> pixels(level.texels.size());
+    for (size_t i = 0; i < level.texels.size(); i++)
+    {
+        auto texel = glm::clamp(level.texels[i], glm::vec4(options.normalMap ? -1.0f : 0.0f), glm::vec4(1.0f));
+        glm::vec3 color;
+        if (options.normalMap)
+        {
+            color = glm::vec3(texel) * .5f + .5f;
+        }
+        else if (options.srgb)
+        {
+            color = glm::vec3(LinearToSRGB(texel.x), LinearToSRGB(texel.y), LinearToSRGB(texel.z));
+        }
+        else
+        {
+            color = glm::vec3(texel);
+        }
+        pixels[i] = glm::u8vec4(glm::vec4(color, texel.w) * 255.0f + .5f);
+    }
+    return pixels;
+}
+
+bool PickFormat(const TextureOptions& options, const std::vector<glm::u8vec4>& pixels, BlockFormat& blockFormat, gli::format& format)
+{
+    auto name = options.format;
+    if (name == "auto")
+    {
+        bool transparent = std::any_of(pixels.begin(), pixels.end(), [](const glm::u8vec4& pixel) { return pixel.w != 255; });
+        name = options.normalMap ? "bc5" : transparent ? "bc3" : "bc1";
+    }
+
+    if (name == "bc1")
+    {
+        blockFormat = BlockFormat::BC1;
+        format = options.srgb ? gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8 : gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8;
+    }
+    else if (name == "bc3")
+    {
+        blockFormat = BlockFormat::BC3;
+        format = options.srgb ? gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16 : gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+    }
+    else if (name == "bc5")
+    {
+        blockFormat = BlockFormat::BC5;
+        format = gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void TextureBuilder::Build(BuildArtifact& artifact)
+{
+    fs::create_directories(artifact.outputDir);
+
+    // The source is kept, for anything which loads it by name
+    auto copyPath = artifact.outputDir / artifact.sourceFile.filename();
+    artifact.outputs.push_back(copyPath);
+    if (!fs::copy_file(artifact.sourceFile, copyPath, fs::copy_options::overwrite_existing))
+    {
+        LogError("Could not copy: " + artifact.sourceFile.string());
+        return;
+    }
+
+    auto options = ReadOptions(artifact);
+    if (options.format == "none")
+    {
+        artifact.success = true;
+        return;
+    }
+
+    int w, h, comp;
+    auto pImage = stbi_load(artifact.sourceFile.string().c_str(), &w, &h, &comp, STBI_rgb_alpha);
+    if (pImage == nullptr)
+    {
+        LogError("Could not load image: " + artifact.sourceFile.string());
+        return;
+    }
+    std::vector<glm::u8vec4> pixels((glm::u8vec4*)pImage, (glm::u8vec4*)pImage + w * h);
+    stbi_image_free(pImage);
+
+    BlockFormat blockFormat;
+    gli::format format;
+    if (!PickFormat(options, pixels, blockFormat, format))
+    {
+        LogError("Unknown texture format '" + options.format + "': " + artifact.sourceFile.string());
+        return;
+    }
+
+    auto size = glm::uvec2(w, h);
+    uint32_t levels = 1;
+    while ((std::max(size.x, size.y) >> levels) != 0)
+    {
+        levels++;
+    }
+
+    // The top level is encoded as loaded; each mip is filtered from the float level above it, so rounding doesn't build up
+    gli::texture2d texture(format, gli::extent2d(size.x, size.y), levels);
+    MipLevel level = ToLevel(pixels, size, options);
+    for (uint32_t mip = 0; mip < levels; mip++)
+    {
+        if (mip != 0)
+        {
+            level = Downsample(level, options);
+            pixels = Quantize(level, options);
+        }
+        assert(texture.size(mip) == BlockImageBytes(blockFormat, level.size.x, level.size.y));
+        EncodeBlocks(blockFormat, (const uint8_t*)pixels.data(), level.size.x, level.size.y, level.size.x * sizeof(glm::u8vec4), (uint8_t*)texture.data(0, 0, mip));
+    }
+
+    auto ddsPath = artifact.outputDir / (artifact.sourceFile.stem().string() + ".dds");
+    artifact.outputs.push_back(ddsPath);
+    if (!gli::save_dds(texture, ddsPath.string()))
+    {
+        LogError("Could not write: " + ddsPath.string());
+        return;
+    }
+
+    const char* formatNames[] = { "BC1", "BC2", "BC3", "BC4", "BC5" };
+    LogInfo("Compressed: " + ddsPath.string() + ", " + formatNames[int(blockFormat)] + ", " + std::to_string(levels) + " levels");
+    artifact.success = true;
+}
+
+} // MAssetBuilder namespace
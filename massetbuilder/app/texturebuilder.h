@@ -0,0 +1,21 @@
+#pragma once
+#include "assetbuilder.h"
+
+namespace MAssetBuilder
+{
+
+// Compresses an image (.png, .jpg, .tga, .bmp) to a block compressed .dds with a full chain of mips, and copies the source beside it.
+// Mips are box filtered in linear space; normal maps are renormalized at each level.
+// Options come from an optional .meta next to the image:
+// { "format": "auto", "srgb": true, "normalMap": false }
+// The format is one of "bc1", "bc3", "bc5", or "none" to only copy the image. "auto" picks BC5 for normal maps
+// (marked in the meta, or named *_normal, *_nrm or *_ddn), BC3 if any pixel is transparent, and BC1 otherwise.
+// Normal maps are linear; everything else is sRGB unless the meta says otherwise
+class TextureBuilder : public IBuilder
+{
+public:
+    virtual void Build(BuildArtifact& artifact) override;
+    virtual bool CanBuildInParallel() const override { return true; }
+};
+
+}
@@ -5,6 +5,10 @@ LIST(APPEND MASSETBUILDER_APP_SOURCE
     massetbuilder/app/massetbuilder_settings.cpp
     massetbuilder/app/massetbuilder_settings.h
     massetbuilder/app/massetbuilder_app.h
+    massetbuilder/app/fontbuilder.cpp
+    massetbuilder/app/fontbuilder.h
+    massetbuilder/app/texturebuilder.cpp
+    massetbuilder/app/texturebuilder.h
     massetbuilder/list.cmake
 )
 
@@ -20,6 +24,21 @@ LIST(APPEND TEST_SOURCES
     massetbuilder/app/massetbuilder_settings.h
 )
 
+# FreeType, for baking font atlases
+include (ExternalProject)
+ExternalProject_Add(
+  freetype2
+  PREFIX "m3rdparty"
+  CMAKE_ARGS ""
+  SOURCE_DIR "${M3RDPARTY_DIR}/freetype"
+  TEST_COMMAND ""
+  INSTALL_COMMAND ""
+  INSTALL_DIR ""
+)
+LINK_DIRECTORIES(${CMAKE_BINARY_DIR}/m3rdparty/src/freetype2-build)
+SET(MASSETBUILDER_INCLUDE ${M3RDPARTY_DIR}/freetype/include)
+SET(MASSETBUILDER_LINKLIBS freetype)
+
 IF (PROJECT_SHADERTOOLS)
 include (ExternalProject)
 ExternalProject_Add(
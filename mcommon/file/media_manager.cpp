@@ -166,7 +166,14 @@ fs::path MediaManager::FindAssetInternal(const char* pszPath, uint32_t mediaType
 
     if (mediaType & MediaType::Texture)
     {
+        // The asset builder compresses source images to a .dds beside them; prefer it, unless the source is asked for
         std::vector<fs::path> testFiles;
+        auto extension = StringUtils::toLower(fs::path(searchPath).extension().string());
+        bool sourceImage = extension == ".png" || extension == ".jpg" || extension == ".tga" || extension == ".bmp";
+        if (sourceImage && !(mediaType & MediaType::Source))
+        {
+            testFiles.push_back(fs::path(searchPath).replace_extension(".dds"));
+        }
         testFiles.push_back(searchPath);
 
         for (auto& extension : m_textureExtensions)
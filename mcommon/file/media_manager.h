@@ -11,7 +11,8 @@ enum : uint32_t
     Local   = (1 << 3),
     Document = (1 << 4),
     Project =  (1 << 5),
-    Font = (1 << 6)
+    Font = (1 << 6),
+    Source = (1 << 7)   // With Texture; the image as named, not the .dds the asset builder compiles from it
 };
 }
 
@@ -0,0 +1,251 @@
+#include "mcommon.h"
+#include "blockdecode.h"
+
+namespace MCommon
+{
+
+namespace
+{
+
+inline uint32_t Read16(const uint8_t* pData)
+{
+    return uint32_t(pData[0]) | (uint32_t(pData[1]) << 8);
+}
+
+inline uint32_t Read32(const uint8_t* pData)
+{
+    return Read16(pData) | (Read16(pData + 2) << 16);
+}
+
+// 565 to 888, replicating the top bits into the bottom
+inline glm::u8vec4 Expand565(uint32_t color)
+{
+    uint32_t r = (color >> 11) & 0x1f;
+    uint32_t g = (color >> 5) & 0x3f;
+    uint32_t b = color & 0x1f;
+    return glm::u8vec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+}
+
+inline glm::u8vec4 Mix(const glm::u8vec4& a, const glm::u8vec4& b, uint32_t wa, uint32_t wb)
+{
+    auto total = wa + wb;
+    return glm::u8vec4((glm::uvec4(a) * wa + glm::uvec4(b) * wb + glm::uvec4(total / 2)) / total);
+}
+
+// BC2 and BC3 always use the 4 color palette; BC1 uses 3 colors and transparent black when color0 <= color1
+void DecodeColors(const uint8_t* pBlock, bool allowAlpha, glm::u8vec4* pPixels)
+{
+    auto c0 = Read16(pBlock);
+    auto c1 = Read16(pBlock + 2);
+    auto indices = Read32(pBlock + 4);
+
+    glm::u8vec4 palette[4];
+    palette[0] = Expand565(c0);
+    palette[1] = Expand565(c1);
+    if (c0 > c1 || !allowAlpha)
+    {
+        palette[2] = Mix(palette[0], palette[1], 2, 1);
+        palette[3] = Mix(palette[0], palette[1], 1, 2);
+    }
+    else
+    {
+        palette[2] = Mix(palette[0], palette[1], 1, 1);
+        palette[3] = glm::u8vec4(0);
+    }
+
+    for (uint32_t pixel = 0; pixel < 16; pixel++)
+    {
+        pPixels[pixel] = palette[(indices >> (pixel * 2)) & 0x3];
+    }
+}
+
+// 2 endpoints, then 16 3 bit indices; 8 steps if the first is larger, else 6 steps plus 0 and 255
+void DecodeChannel(const uint8_t* pBlock, glm::u8vec4* pPixels, int channel)
+{
+    uint32_t a0 = pBlock[0];
+    uint32_t a1 = pBlock[1];
+
+    uint8_t palette[8];
+    palette[0] = uint8_t(a0);
+    palette[1] = uint8_t(a1);
+    if (a0 > a1)
+    {
+        for (uint32_t i = 1; i < 7; i++)
+        {
+            palette[i + 1] = uint8_t(((7 - i) * a0 + i * a1 + 3) / 7);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; i++)
+        {
+            palette[i + 1] = uint8_t(((5 - i) * a0 + i * a1 + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= uint64_t(pBlock[2 + i]) << (8 * i);
+    }
+
+    for (uint32_t pixel = 0; pixel < 16; pixel++)
+    {
+        pPixels[pixel][channel] = palette[(indices >> (pixel * 3)) & 0x7];
+    }
+}
+
+// BC1 colors have a byte of indices for each row, after the endpoints
+void FlipColorRows(uint8_t* pColors, uint32_t rows)
+{
+    std::reverse(pColors + 4, pColors + 4 + rows);
+}
+
+// BC2 alpha is 2 bytes a row
+void FlipExplicitAlphaRows(uint8_t* pAlpha, uint32_t rows)
+{
+    for (uint32_t row = 0; row < rows / 2; row++)
+    {
+        std::swap_ranges(pAlpha + row * 2, pAlpha + row * 2 + 2, pAlpha + (rows - 1 - row) * 2);
+    }
+}
+
+// Interpolated channels have 12 bits of indices a row, after the endpoints
+void FlipChannelRows(uint8_t* pChannel, uint32_t rows)
+{
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= uint64_t(pChannel[2 + i]) << (8 * i);
+    }
+
+    uint64_t flipped = indices & ~((uint64_t(1) << (rows * 12)) - 1);
+    for (uint32_t row = 0; row < rows; row++)
+    {
+        flipped |= ((indices >> (row * 12)) & 0xfff) << ((rows - 1 - row) * 12);
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        pChannel[2 + i] = uint8_t(flipped >> (8 * i));
+    }
+}
+
+void FlipBlockRows(BlockFormat format, uint8_t* pBlock, uint32_t rows)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        FlipColorRows(pBlock, rows);
+        break;
+    case BlockFormat::BC2:
+        FlipExplicitAlphaRows(pBlock, rows);
+        FlipColorRows(pBlock + 8, rows);
+        break;
+    case BlockFormat::BC3:
+        FlipChannelRows(pBlock, rows);
+        FlipColorRows(pBlock + 8, rows);
+        break;
+    case BlockFormat::BC4:
+        FlipChannelRows(pBlock, rows);
+        break;
+    case BlockFormat::BC5:
+        FlipChannelRows(pBlock, rows);
+        FlipChannelRows(pBlock + 8, rows);
+        break;
+    }
+}
+
+} // namespace
+
+uint32_t BlockImageBytes(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+uint32_t BlockBytes(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+    case BlockFormat::BC4:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+void DecodeBlock(BlockFormat format, const uint8_t* pBlock, glm::u8vec4* pPixels)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        DecodeColors(pBlock, true, pPixels);
+        break;
+    case BlockFormat::BC2:
+        DecodeColors(pBlock + 8, false, pPixels);
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            uint32_t alpha = (pBlock[pixel / 2] >> ((pixel & 1) * 4)) & 0xf;
+            pPixels[pixel].w = uint8_t(alpha * 17);
+        }
+        break;
+    case BlockFormat::BC3:
+        DecodeColors(pBlock + 8, false, pPixels);
+        DecodeChannel(pBlock, pPixels, 3);
+        break;
+    case BlockFormat::BC4:
+        std::fill(pPixels, pPixels + 16, glm::u8vec4(0, 0, 0, 255));
+        DecodeChannel(pBlock, pPixels, 0);
+        break;
+    case BlockFormat::BC5:
+        std::fill(pPixels, pPixels + 16, glm::u8vec4(0, 0, 0, 255));
+        DecodeChannel(pBlock, pPixels, 0);
+        DecodeChannel(pBlock + 8, pPixels, 1);
+        break;
+    }
+}
+
+void DecodeBlocks(BlockFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTarget, uint32_t pitch)
+{
+    auto blockBytes = BlockBytes(format);
+    glm::u8vec4 pixels[16];
+    for (uint32_t by = 0; by < height; by += 4)
+    {
+        for (uint32_t bx = 0; bx < width; bx += 4)
+        {
+            DecodeBlock(format, pBlocks, pixels);
+            pBlocks += blockBytes;
+
+            auto rows = std::min(4u, height - by);
+            auto columns = std::min(4u, width - bx);
+            for (uint32_t y = 0; y < rows; y++)
+            {
+                memcpy(pTarget + (by + y) * pitch + bx * sizeof(glm::u8vec4), &pixels[y * 4], columns * sizeof(glm::u8vec4));
+            }
+        }
+    }
+}
+
+void FlipBlocks(BlockFormat format, uint8_t* pBlocks, uint32_t width, uint32_t height)
+{
+    auto blockBytes = BlockBytes(format);
+    auto rowBytes = ((width + 3) / 4) * blockBytes;
+    auto blockRows = (height + 3) / 4;
+
+    auto rows = std::min(4u, height);
+    for (uint32_t offset = 0; offset < rowBytes * blockRows; offset += blockBytes)
+    {
+        FlipBlockRows(format, pBlocks + offset, rows);
+    }
+
+    for (uint32_t row = 0; row < blockRows / 2; row++)
+    {
+        auto pRow = pBlocks + row * rowBytes;
+        std::swap_ranges(pRow, pRow + rowBytes, pBlocks + (blockRows - 1 - row) * rowBytes);
+    }
+}
+
+} // MCommon
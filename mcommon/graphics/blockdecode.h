@@ -0,0 +1,33 @@
+#pragma once
+
+namespace MCommon
+{
+
+// The block compressed (DXT/BCn) texture formats; each block is 4x4 pixels
+enum class BlockFormat
+{
+    BC1,    // DXT1; 565 colors, with optional 1 bit alpha
+    BC2,    // DXT3; BC1 colors, with 4 bit explicit alpha
+    BC3,    // DXT5; BC1 colors, with interpolated alpha
+    BC4,    // One interpolated channel, decoded to red
+    BC5     // Two interpolated channels, decoded to red and green
+};
+
+// Bytes in one 4x4 block
+uint32_t BlockBytes(BlockFormat format);
+
+// Bytes in an image of width x height pixels, rounded up to whole blocks
+uint32_t BlockImageBytes(BlockFormat format, uint32_t width, uint32_t height);
+
+// Decode one block into 16 pixels, a row of 4 at a time
+void DecodeBlock(BlockFormat format, const uint8_t* pBlock, glm::u8vec4* pPixels);
+
+// Decode an image of width x height pixels to RGBA, with the rows 'pitch' bytes apart.
+// The blocks are in rows, left to right; partial blocks at the edges are cropped
+void DecodeBlocks(BlockFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTarget, uint32_t pitch);
+
+// Flip an image of blocks upside down, in place, by swapping the rows of blocks and the rows of pixels inside them.
+// Exact when the height is a multiple of 4, or less than 4, as it is for the mips of power of 2 textures
+void FlipBlocks(BlockFormat format, uint8_t* pBlocks, uint32_t width, uint32_t height);
+
+} // MCommon
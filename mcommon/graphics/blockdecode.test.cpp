@@ -0,0 +1,96 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "graphics/blockdecode.h"
+
+using namespace MCommon;
+
+// Red and blue endpoints, each pixel using the next palette entry in turn
+TEST(BlockDecode, BC1)
+{
+    uint8_t block[8] = { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0xe4, 0xe4, 0xe4 };
+    glm::u8vec4 pixels[16];
+    DecodeBlock(BlockFormat::BC1, block, pixels);
+
+    EXPECT_EQ(pixels[0], glm::u8vec4(255, 0, 0, 255));
+    EXPECT_EQ(pixels[1], glm::u8vec4(0, 0, 255, 255));
+    EXPECT_EQ(pixels[2], glm::u8vec4(170, 0, 85, 255));
+    EXPECT_EQ(pixels[3], glm::u8vec4(85, 0, 170, 255));
+    EXPECT_EQ(pixels[12], pixels[0]);
+}
+
+// With the endpoints swapped, the last entry is transparent black
+TEST(BlockDecode, BC1Alpha)
+{
+    uint8_t block[8] = { 0x1f, 0x00, 0x00, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4 };
+    glm::u8vec4 pixels[16];
+    DecodeBlock(BlockFormat::BC1, block, pixels);
+
+    EXPECT_EQ(pixels[2], glm::u8vec4(128, 0, 128, 255));
+    EXPECT_EQ(pixels[3], glm::u8vec4(0));
+}
+
+TEST(BlockDecode, BC3Alpha)
+{
+    // Alpha from 255 to 0 in 8 steps; pixel n uses index n & 7
+    uint8_t block[16] = { 255, 0, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0 };
+    glm::u8vec4 pixels[16];
+    DecodeBlock(BlockFormat::BC3, block, pixels);
+
+    EXPECT_EQ(pixels[0].w, 255);
+    EXPECT_EQ(pixels[1].w, 0);
+    EXPECT_EQ(pixels[2].w, 219);
+    EXPECT_EQ(pixels[7].w, 36);
+    EXPECT_EQ(pixels[8].w, 255);
+    EXPECT_EQ(glm::u8vec3(pixels[0]), glm::u8vec3(255));
+}
+
+// A 6x5 image is 2x2 blocks, cropped
+TEST(BlockDecode, Crop)
+{
+    std::vector<uint8_t> blocks(4 * 8);
+    for (int block = 0; block < 4; block++)
+    {
+        // Solid, with the color as the block index
+        blocks[block * 8] = uint8_t(block);
+    }
+
+    std::vector<glm::u8vec4> image(6 * 5);
+    DecodeBlocks(BlockFormat::BC1, blocks.data(), 6, 5, (uint8_t*)image.data(), 6 * sizeof(glm::u8vec4));
+
+    EXPECT_EQ(image[0].z, 0);
+    EXPECT_EQ(image[5].z, 8);
+    EXPECT_EQ(image[4 * 6 + 1].z, 16);
+    EXPECT_EQ(image[4 * 6 + 5].z, 24);
+}
+
+// Any bytes are a valid image, so flipping random blocks must match flipping the decoded pixels
+TEST(BlockDecode, Flip)
+{
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC2, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5 };
+    const glm::uvec2 sizes[] = { glm::uvec2(8, 12), glm::uvec2(8, 2), glm::uvec2(4, 1) };
+    for (auto format : formats)
+    {
+        for (auto size : sizes)
+        {
+            std::vector<uint8_t> blocks(BlockImageBytes(format, size.x, size.y));
+            for (size_t i = 0; i < blocks.size(); i++)
+            {
+                blocks[i] = uint8_t((i * 7919 + 13) ^ (i >> 3));
+            }
+
+            std::vector<glm::u8vec4> image(size.x * size.y);
+            std::vector<glm::u8vec4> flipped(size.x * size.y);
+            DecodeBlocks(format, blocks.data(), size.x, size.y, (uint8_t*)image.data(), size.x * sizeof(glm::u8vec4));
+            FlipBlocks(format, blocks.data(), size.x, size.y);
+            DecodeBlocks(format, blocks.data(), size.x, size.y, (uint8_t*)flipped.data(), size.x * sizeof(glm::u8vec4));
+
+            for (uint32_t y = 0; y < size.y; y++)
+            {
+                for (uint32_t x = 0; x < size.x; x++)
+                {
+                    ASSERT_EQ(flipped[y * size.x + x], image[(size.y - 1 - y) * size.x + x]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "mcommon.h"
+#include "blockencode.h"
+
+#include <mutex>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+namespace MCommon
+{
+
+namespace
+{
+
+// stb_dxt builds its tables on the first call, which isn't thread safe
+void EncodeColors(const glm::u8vec4* pPixels, bool alpha, uint8_t* pBlock)
+{
+    static std::once_flag init;
+    std::call_once(init, [&]() { stb_compress_dxt_block(pBlock, (const unsigned char*)pPixels, 0, STB_DXT_NORMAL); });
+
+    stb_compress_dxt_block(pBlock, (const unsigned char*)pPixels, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+}
+
+// The nearest entries of the palette the endpoints make, as DecodeChannel; returns the squared error
+uint32_t FitChannel(const uint8_t* pValues, int a0, int a1, uint64_t& indices)
+{
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint32_t error = 0;
+    indices = 0;
+    for (uint32_t pixel = 0; pixel < 16; pixel++)
+    {
+        uint32_t best = 0;
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint32_t entry = 0; entry < 8; entry++)
+        {
+            int diff = palette[entry] - pValues[pixel];
+            uint32_t entryError = uint32_t(diff * diff);
+            if (entryError < bestError)
+            {
+                best = entry;
+                bestError = entryError;
+            }
+        }
+        indices |= uint64_t(best) << (pixel * 3);
+        error += bestError;
+    }
+    return error;
+}
+
+// 2 endpoints, then 16 3 bit indices.
+// The 8 step palette is tried around the range of the block; the 6 step one, which has 0 and 255 as well,
+// around the range of the values between them
+void EncodeChannel(const glm::u8vec4* pPixels, int channel, uint8_t* pBlock)
+{
+    uint8_t values[16];
+    int low = 255, high = 0;
+    int innerLow = 255, innerHigh = 0;
+    for (uint32_t pixel = 0; pixel < 16; pixel++)
+    {
+        int value = pPixels[pixel][channel];
+        values[pixel] = uint8_t(value);
+        low = std::min(low, value);
+        high = std::max(high, value);
+        if (value != 0 && value != 255)
+        {
+            innerLow = std::min(innerLow, value);
+            innerHigh = std::max(innerHigh, value);
+        }
+    }
+
+    const int Search = 2;
+    int best0 = high, best1 = low;
+    uint64_t bestIndices = 0;
+    uint32_t bestError = FitChannel(values, best0, best1, bestIndices);
+    auto tryEndpoints = [&](int a0, int a1)
+    {
+        uint64_t indices;
+        auto error = FitChannel(values, a0, a1, indices);
+        if (error < bestError)
+        {
+            best0 = a0;
+            best1 = a1;
+            bestIndices = indices;
+            bestError = error;
+        }
+    };
+
+    for (int d0 = -Search; d0 <= Search && bestError != 0; d0++)
+    {
+        for (int d1 = -Search; d1 <= Search; d1++)
+        {
+            int a0 = glm::clamp(high + d0, 0, 255);
+            int a1 = glm::clamp(low + d1, 0, 255);
+            if (a0 > a1)
+            {
+                tryEndpoints(a0, a1);
+            }
+        }
+    }
+
+    if (bestError != 0 && innerLow <= innerHigh)
+    {
+        tryEndpoints(innerLow, innerHigh);
+    }
+
+    pBlock[0] = uint8_t(best0);
+    pBlock[1] = uint8_t(best1);
+    for (int i = 0; i < 6; i++)
+    {
+        pBlock[2 + i] = uint8_t(bestIndices >> (8 * i));
+    }
+}
+
+} // namespace
+
+void EncodeBlock(BlockFormat format, const glm::u8vec4* pPixels, uint8_t* pBlock)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        EncodeColors(pPixels, false, pBlock);
+        break;
+    case BlockFormat::BC2:
+        for (uint32_t pixel = 0; pixel < 16; pixel += 2)
+        {
+            auto alpha0 = (pPixels[pixel].w * 15 + 127) / 255;
+            auto alpha1 = (pPixels[pixel + 1].w * 15 + 127) / 255;
+            pBlock[pixel / 2] = uint8_t(alpha0 | (alpha1 << 4));
+        }
+        EncodeColors(pPixels, false, pBlock + 8);
+        break;
+    case BlockFormat::BC3:
+        EncodeColors(pPixels, true, pBlock);
+        EncodeChannel(pPixels, 3, pBlock);
+        break;
+    case BlockFormat::BC4:
+        EncodeChannel(pPixels, 0, pBlock);
+        break;
+    case BlockFormat::BC5:
+        EncodeChannel(pPixels, 0, pBlock);
+        EncodeChannel(pPixels, 1, pBlock + 8);
+        break;
+    }
+}
+
+void EncodeBlocks(BlockFormat format, const uint8_t* pSource, uint32_t width, uint32_t height, uint32_t pitch, uint8_t* pBlocks)
+{
+    auto blockBytes = BlockBytes(format);
+    glm::u8vec4 pixels[16];
+    for (uint32_t by = 0; by < height; by += 4)
+    {
+        for (uint32_t bx = 0; bx < width; bx += 4)
+        {
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                auto pRow = (const glm::u8vec4*)(pSource + std::min(by + y, height - 1) * pitch);
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    pixels[y * 4 + x] = pRow[std::min(bx + x, width - 1)];
+                }
+            }
+
+            EncodeBlock(format, pixels, pBlocks);
+            pBlocks += blockBytes;
+        }
+    }
+}
+
+} // MCommon
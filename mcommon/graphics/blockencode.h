@@ -0,0 +1,20 @@
+#pragma once
+
+#include "blockdecode.h"
+
+namespace MCommon
+{
+
+// Block compression of RGBA pixels, into the formats that blockdecode.h reads.
+// Colors are fitted by stb_dxt in its high quality mode; the interpolated channels (BC3 alpha, BC4, BC5)
+// search a few endpoints around the range of each block, in both palette modes.
+// BC4 stores red, and BC5 red and green; BC1 stores no alpha
+
+// Encode 16 pixels, a row of 4 at a time, into one block
+void EncodeBlock(BlockFormat format, const glm::u8vec4* pPixels, uint8_t* pBlock);
+
+// Encode an image of width x height pixels, with the rows 'pitch' bytes apart, into BlockImageBytes of blocks.
+// Partial blocks at the edges repeat the last row and column. Thread safe, so images can be encoded side by side
+void EncodeBlocks(BlockFormat format, const uint8_t* pSource, uint32_t width, uint32_t height, uint32_t pitch, uint8_t* pBlocks);
+
+} // MCommon
@@ -0,0 +1,127 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "graphics/blockencode.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+// Largest difference in the given channels
+int MaxError(const glm::u8vec4* pA, const glm::u8vec4* pB, uint32_t count, int channels)
+{
+    int error = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            error = std::max(error, std::abs(int(pA[i][c]) - int(pB[i][c])));
+        }
+    }
+    return error;
+}
+
+}
+
+TEST(BlockEncode, BC1Solid)
+{
+    glm::u8vec4 pixels[16];
+    std::fill(pixels, pixels + 16, glm::u8vec4(200, 100, 50, 255));
+
+    uint8_t block[8];
+    EncodeBlock(BlockFormat::BC1, pixels, block);
+
+    glm::u8vec4 decoded[16];
+    DecodeBlock(BlockFormat::BC1, block, decoded);
+    EXPECT_LE(MaxError(pixels, decoded, 16, 4), 2);
+}
+
+// A ramp between 2 colors is on the palette line, so only quantization is lost
+TEST(BlockEncode, BC1Ramp)
+{
+    glm::u8vec4 pixels[16];
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i] = glm::u8vec4(i * 16, 255 - i * 16, 64, 255);
+    }
+
+    uint8_t block[8];
+    EncodeBlock(BlockFormat::BC1, pixels, block);
+
+    glm::u8vec4 decoded[16];
+    DecodeBlock(BlockFormat::BC1, block, decoded);
+    EXPECT_LE(MaxError(pixels, decoded, 16, 3), 40);
+}
+
+TEST(BlockEncode, BC3Alpha)
+{
+    glm::u8vec4 pixels[16];
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i] = glm::u8vec4(255, 255, 255, (i & 7) * 36);
+    }
+
+    uint8_t block[16];
+    EncodeBlock(BlockFormat::BC3, pixels, block);
+
+    glm::u8vec4 decoded[16];
+    DecodeBlock(BlockFormat::BC3, block, decoded);
+    EXPECT_LE(MaxError(pixels, decoded, 16, 4), 2);
+}
+
+// Values at 0 and 255 with a few between them fit the 6 step palette better
+TEST(BlockEncode, BC4Extremes)
+{
+    glm::u8vec4 pixels[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int values[4] = { 0, 255, 100, 110 };
+        pixels[i] = glm::u8vec4(values[i & 3], 0, 0, 255);
+    }
+
+    uint8_t block[8];
+    EncodeBlock(BlockFormat::BC4, pixels, block);
+    EXPECT_LE(block[0], block[1]);
+
+    glm::u8vec4 decoded[16];
+    DecodeBlock(BlockFormat::BC4, block, decoded);
+    EXPECT_LE(MaxError(pixels, decoded, 16, 1), 2);
+}
+
+// Each channel is within half a step of its 8 step palette
+TEST(BlockEncode, BC5)
+{
+    glm::u8vec4 pixels[16];
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i] = glm::u8vec4(128 + i * 5, 200 - i * 9, 0, 255);
+    }
+
+    uint8_t block[16];
+    EncodeBlock(BlockFormat::BC5, pixels, block);
+
+    glm::u8vec4 decoded[16];
+    DecodeBlock(BlockFormat::BC5, block, decoded);
+    EXPECT_LE(MaxError(pixels, decoded, 16, 2), 10);
+}
+
+// A 6x5 image is 2x2 blocks; the padding repeats the edges, so solid areas stay exact
+TEST(BlockEncode, Image)
+{
+    std::vector<glm::u8vec4> image(6 * 5);
+    for (uint32_t y = 0; y < 5; y++)
+    {
+        for (uint32_t x = 0; x < 6; x++)
+        {
+            image[y * 6 + x] = glm::u8vec4(x < 4 ? 255 : 0, 0, y < 4 ? 255 : 0, 255);
+        }
+    }
+
+    std::vector<uint8_t> blocks(BlockImageBytes(BlockFormat::BC1, 6, 5));
+    ASSERT_EQ(blocks.size(), 4u * 8);
+    EncodeBlocks(BlockFormat::BC1, (const uint8_t*)image.data(), 6, 5, 6 * sizeof(glm::u8vec4), blocks.data());
+
+    std::vector<glm::u8vec4> decoded(6 * 5);
+    DecodeBlocks(BlockFormat::BC1, blocks.data(), 6, 5, (uint8_t*)decoded.data(), 6 * sizeof(glm::u8vec4));
+    EXPECT_EQ(MaxError(image.data(), decoded.data(), uint32_t(image.size()), 4), 0);
+}
@@ -0,0 +1,213 @@
+#include "mcommon.h"
+#include "commandlist2d.h"
+#include "threadpool/ThreadPool.hpp"
+
+#include <atomic>
+
+namespace MCommon
+{
+
+CommandList2D::CommandList2D(int tileSize)
+    : m_tileSize(std::max(tileSize, 8))
+{
+}
+
+void CommandList2D::Add(CommandType type, const glm::ivec4& bounds, const glm::u8vec4& color, const glm::ivec2& p0, const glm::ivec2& p1, const glm::ivec2& p2, int value)
+{
+    if (bounds.x >= bounds.z || bounds.y >= bounds.w)
+    {
+        return;
+    }
+
+    Command command;
+    command.type = type;
+    command.color = color;
+    command.bounds = bounds;
+    command.points[0] = p0;
+    command.points[1] = p1;
+    command.points[2] = p2;
+    command.value = value;
+    m_commands.push_back(command);
+}
+
+void CommandList2D::DrawBlock(int x, int y, int xx, int yy, const glm::u8vec4& col)
+{
+    Add(CommandType::Block, glm::ivec4(x, y, xx, yy), col, glm::ivec2(x, y), glm::ivec2(xx, yy));
+}
+
+void CommandList2D::DrawLine(int x1, int y1, int x2, int y2, const glm::u8vec4& col)
+{
+    auto bounds = glm::ivec4(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2) + 1, std::max(y1, y2) + 1);
+    Add(CommandType::Line, bounds, col, glm::ivec2(x1, y1), glm::ivec2(x2, y2));
+}
+
+void CommandList2D::DrawCircle(int x, int y, int radius, const glm::u8vec4& col)
+{
+    auto bounds = glm::ivec4(x - radius, y - radius, x + radius + 1, y + radius + 1);
+    Add(CommandType::Circle, bounds, col, glm::ivec2(x, y), glm::ivec2(0), glm::ivec2(0), radius);
+}
+
+void CommandList2D::DrawTriangle(const glm::ivec2& p0, const glm::ivec2& p1, const glm::ivec2& p2, const glm::u8vec4& col)
+{
+    auto minPoint = glm::min(glm::min(p0, p1), p2);
+    auto maxPoint = glm::max(glm::max(p0, p1), p2) + glm::ivec2(1);
+    Add(CommandType::Triangle, glm::ivec4(minPoint, maxPoint), col, p0, p1, p2);
+}
+
+void CommandList2D::Blit(const Bitmap& source, int x, int y)
+{
+    auto bounds = glm::ivec4(x, y, x + int(source.size.x), y + int(source.size.y));
+    Add(CommandType::Blit, bounds, glm::u8vec4(0), glm::ivec2(x, y), glm::ivec2(0), glm::ivec2(0), int(m_sources.size()));
+    m_sources.push_back(source);
+}
+
+void CommandList2D::Clear()
+{
+    m_commands.clear();
+    m_sources.clear();
+}
+
+void CommandList2D::Bin(const glm::uvec2& targetSize)
+{
+    m_tileCount = (glm::ivec2(targetSize) + glm::ivec2(m_tileSize - 1)) / m_tileSize;
+    auto numTiles = uint32_t(m_tileCount.x * m_tileCount.y);
+
+    // Tiles touched by the command, clipped to the target; empty if it is off screen
+    auto tileRange = [&](const Command& command)
+    {
+        auto bounds = glm::clamp(command.bounds, glm::ivec4(0), glm::ivec4(glm::ivec2(targetSize), glm::ivec2(targetSize)));
+        if (bounds.x >= bounds.z || bounds.y >= bounds.w)
+        {
+            return glm::ivec4(0, 0, -1, -1);
+        }
+        return glm::ivec4(bounds.x, bounds.y, bounds.z - 1, bounds.w - 1) / m_tileSize;
+    };
+
+    // Count the commands in each tile
+    m_tileStart.assign(numTiles + 1, 0);
+    for (auto& command : m_commands)
+    {
+        auto range = tileRange(command);
+        for (int y = range.y; y <= range.w; y++)
+        {
+            for (int x = range.x; x <= range.z; x++)
+            {
+                m_tileStart[y * m_tileCount.x + x + 1]++;
+            }
+        }
+    }
+
+    for (uint32_t tile = 0; tile < numTiles; tile++)
+    {
+        m_tileStart[tile + 1] += m_tileStart[tile];
+    }
+
+    // Scatter in recorded order, using the tile start as a cursor, then shift the cursors back
+    m_tileCommands.resize(m_tileStart[numTiles]);
+    for (uint32_t index = 0; index < m_commands.size(); index++)
+    {
+        auto range = tileRange(m_commands[index]);
+        for (int y = range.y; y <= range.w; y++)
+        {
+            for (int x = range.x; x <= range.z; x++)
+            {
+                m_tileCommands[m_tileStart[y * m_tileCount.x + x]++] = index;
+            }
+        }
+    }
+    for (uint32_t tile = numTiles; tile > 0; tile--)
+    {
+        m_tileStart[tile] = m_tileStart[tile - 1];
+    }
+    m_tileStart[0] = 0;
+}
+
+// Draw through a view of the bitmap covering just this tile.
+// The primitives clip to the view, and draw the same pixels they would on the whole bitmap
+void CommandList2D::DrawTile(Bitmap& target, uint32_t tile)
+{
+    auto origin = glm::ivec2(tile % m_tileCount.x, tile / m_tileCount.x) * m_tileSize;
+
+    Bitmap view;
+    view.bits = target.bits + target.stride * origin.y + origin.x * sizeof(glm::u8vec4);
+    view.stride = target.stride;
+    view.size = glm::min(glm::uvec2(m_tileSize), target.size - glm::uvec2(origin));
+
+    for (uint32_t entry = m_tileStart[tile]; entry < m_tileStart[tile + 1]; entry++)
+    {
+        auto& command = m_commands[m_tileCommands[entry]];
+        auto p0 = command.points[0] - origin;
+        auto p1 = command.points[1] - origin;
+        auto p2 = command.points[2] - origin;
+        switch (command.type)
+        {
+        case CommandType::Block:
+            MCommon::DrawBlock(view, p0.x, p0.y, p1.x, p1.y, command.color);
+            break;
+        case CommandType::Line:
+            MCommon::DrawLine(view, p0.x, p0.y, p1.x, p1.y, command.color);
+            break;
+        case CommandType::Circle:
+            MCommon::DrawCircle(view, p0.x, p0.y, command.value, command.color);
+            break;
+        case CommandType::Triangle:
+            MCommon::DrawTriangle(view, p0, p1, p2, command.color);
+            break;
+        case CommandType::Blit:
+            MCommon::Blit(view, m_sources[command.value], p0.x, p0.y);
+            break;
+        }
+    }
+}
+
+void CommandList2D::Flush(Bitmap& target, uint32_t threads)
+{
+    if (m_commands.empty() || target.size.x == 0 || target.size.y == 0)
+    {
+        Clear();
+        return;
+    }
+
+    Bin(target.size);
+
+    std::vector<uint32_t> tiles;
+    for (uint32_t tile = 0; tile < uint32_t(m_tileCount.x * m_tileCount.y); tile++)
+    {
+        if (m_tileStart[tile] != m_tileStart[tile + 1])
+        {
+            tiles.push_back(tile);
+        }
+    }
+
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(threads, uint32_t(tiles.size()));
+
+    // Threads take the next undrawn tile until there are none left; the flushing thread draws tiles too
+    std::atomic<uint32_t> nextTile(0);
+    auto drawTiles = [&]()
+    {
+        for (auto index = nextTile++; index < tiles.size(); index = nextTile++)
+        {
+            DrawTile(target, tiles[index]);
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (uint32_t thread = 1; thread < threads; thread++)
+    {
+        workers.push_back(GetWorkerPool().enqueue(drawTiles));
+    }
+    drawTiles();
+
+    for (auto& worker : workers)
+    {
+        worker.wait();
+    }
+
+    Clear();
+}
+
+} // MCommon
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "primitives2d.h"
+
+namespace MCommon
+{
+
+// Records primitives2d drawing, and plays it back later into a bitmap.
+// At flush the commands are binned into screen tiles, and the tiles are drawn in parallel.
+// Each tile is owned by one thread, so there is no locking on the bitmap, and the commands in a tile
+// are drawn in the order they were recorded; the result matches drawing them immediately.
+class CommandList2D
+{
+public:
+    explicit CommandList2D(int tileSize = 64);
+
+    void DrawBlock(int x, int y, int xx, int yy, const glm::u8vec4& col);
+    void DrawLine(int x1, int y1, int x2, int y2, const glm::u8vec4& col);
+    void DrawCircle(int x, int y, int radius, const glm::u8vec4& col);
+    void DrawTriangle(const glm::ivec2& p0, const glm::ivec2& p1, const glm::ivec2& p2, const glm::u8vec4& col);
+
+    // The source bits must stay valid until the flush
+    void Blit(const Bitmap& source, int x, int y);
+
+    // Draw everything into the target, and empty the list.
+    // threads = 0 uses all the cores
+    void Flush(Bitmap& target, uint32_t threads = 0);
+
+    void Clear();
+    uint32_t Size() const { return uint32_t(m_commands.size()); }
+
+private:
+    enum class CommandType : uint8_t
+    {
+        Block,
+        Line,
+        Circle,
+        Triangle,
+        Blit
+    };
+
+    struct Command
+    {
+        CommandType type;
+        glm::u8vec4 color;
+        glm::ivec4 bounds; // Pixels covered; left, top, right, bottom (exclusive)
+        glm::ivec2 points[3];
+        int value; // Circle radius, or blit source
+    };
+
+    void Add(CommandType type, const glm::ivec4& bounds, const glm::u8vec4& color, const glm::ivec2& p0, const glm::ivec2& p1 = glm::ivec2(0), const glm::ivec2& p2 = glm::ivec2(0), int value = 0);
+    void Bin(const glm::uvec2& targetSize);
+    void DrawTile(Bitmap& target, uint32_t tile);
+
+private:
+    int m_tileSize;
+    std::vector<Command> m_commands;
+    std::vector<Bitmap> m_sources;
+
+    // Command indices, sorted by tile with a counting sort, so each tile keeps its drawing order
+    glm::ivec2 m_tileCount = glm::ivec2(0);
+    std::vector<uint32_t> m_tileStart;
+    std::vector<uint32_t> m_tileCommands;
+};
+
+} // MCommon
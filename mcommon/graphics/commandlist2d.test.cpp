@@ -0,0 +1,94 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include <random>
+#include "graphics/commandlist2d.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+struct TestBitmap
+{
+    TestBitmap(int width, int height)
+        : pixels(width * height, glm::u8vec4(0))
+    {
+        bitmap.bits = (uint8_t*)pixels.data();
+        bitmap.stride = width * sizeof(glm::u8vec4);
+        bitmap.size = glm::uvec2(width, height);
+    }
+    std::vector<glm::u8vec4> pixels;
+    Bitmap bitmap;
+};
+
+}
+
+// Overlapping primitives of every kind, which only match if each tile keeps the drawing order
+TEST(CommandList2D, MatchesImmediate)
+{
+    TestBitmap sprite(5, 7);
+    for (auto& pixel : sprite.pixels)
+    {
+        pixel = glm::u8vec4(9, 8, 7, 6);
+    }
+
+    TestBitmap deferred(203, 117);
+    TestBitmap immediate(203, 117);
+
+    CommandList2D commands(16);
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> coord(-40, 240);
+    for (int i = 0; i < 2000; i++)
+    {
+        glm::u8vec4 color(i & 0xFF, (i >> 8) & 0xFF, 1, 255);
+        int x1 = coord(random);
+        int y1 = coord(random);
+        int x2 = coord(random);
+        int y2 = coord(random);
+        int x3 = coord(random);
+        int y3 = coord(random);
+        switch (i % 5)
+        {
+        case 0:
+            commands.DrawBlock(x1, y1, x1 + (x2 & 31), y1 + (y2 & 31), color);
+            DrawBlock(immediate.bitmap, x1, y1, x1 + (x2 & 31), y1 + (y2 & 31), color);
+            break;
+        case 1:
+            commands.DrawLine(x1, y1, x2, y2, color);
+            DrawLine(immediate.bitmap, x1, y1, x2, y2, color);
+            break;
+        case 2:
+            commands.DrawCircle(x1, y1, x2 & 63, color);
+            DrawCircle(immediate.bitmap, x1, y1, x2 & 63, color);
+            break;
+        case 3:
+            commands.DrawTriangle(glm::ivec2(x1, y1), glm::ivec2(x2, y2), glm::ivec2(x3, y3), color);
+            DrawTriangle(immediate.bitmap, glm::ivec2(x1, y1), glm::ivec2(x2, y2), glm::ivec2(x3, y3), color);
+            break;
+        case 4:
+            commands.Blit(sprite.bitmap, x1, y1);
+            Blit(immediate.bitmap, sprite.bitmap, x1, y1);
+            break;
+        }
+    }
+
+    ASSERT_GT(commands.Size(), 0u);
+    commands.Flush(deferred.bitmap, 4);
+    ASSERT_EQ(commands.Size(), 0u);
+    ASSERT_TRUE(deferred.pixels == immediate.pixels);
+}
+
+TEST(CommandList2D, TriangleSharedEdge)
+{
+    // Two triangles making a square cover every pixel exactly once
+    TestBitmap test(8, 8);
+    DrawTriangle(test.bitmap, glm::ivec2(0, 0), glm::ivec2(8, 0), glm::ivec2(0, 8), glm::u8vec4(1, 0, 0, 0));
+    DrawTriangle(test.bitmap, glm::ivec2(8, 0), glm::ivec2(8, 8), glm::ivec2(0, 8), glm::u8vec4(2, 0, 0, 0));
+    int first = 0;
+    for (auto& pixel : test.pixels)
+    {
+        ASSERT_NE(pixel.x, 0);
+        first += pixel.x == 1 ? 1 : 0;
+    }
+    ASSERT_EQ(first, 36);
+}
@@ -0,0 +1,224 @@
+#include "mcommon.h"
+#include "composite2d.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COMPOSITE_SSE 1
+#endif
+
+namespace MCommon
+{
+
+namespace
+{
+
+// x / 255, rounded to nearest, exact for any product of two bytes
+inline uint32_t Div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline uint8_t Mul255(uint32_t a, uint32_t b)
+{
+    return uint8_t(Div255(a * b));
+}
+
+inline glm::u8vec4 BlendPixel(BlendMode mode, const glm::u8vec4& dest, const glm::u8vec4& source)
+{
+    switch (mode)
+    {
+    default:
+    case BlendMode::Replace:
+        return source;
+    case BlendMode::SourceOver:
+    {
+        uint32_t inverse = 255 - source.w;
+        glm::u8vec4 result;
+        for (int i = 0; i < 4; i++)
+        {
+            result[i] = uint8_t(std::min(255u, uint32_t(source[i]) + Mul255(dest[i], inverse)));
+        }
+        return result;
+    }
+    case BlendMode::Additive:
+        return glm::u8vec4(glm::min(glm::uvec4(source) + glm::uvec4(dest), glm::uvec4(255)));
+    case BlendMode::Multiply:
+        return glm::u8vec4(Mul255(source.x, dest.x), Mul255(source.y, dest.y), Mul255(source.z, dest.z), Mul255(source.w, dest.w));
+    }
+}
+
+inline glm::u8vec4 PremultiplyPixel(const glm::u8vec4& pixel)
+{
+    return glm::u8vec4(Mul255(pixel.x, pixel.w), Mul255(pixel.y, pixel.w), Mul255(pixel.z, pixel.w), pixel.w);
+}
+
+#if COMPOSITE_SSE
+// The same rounding as Div255, on 8 16 bit lanes
+inline __m128i Div255(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Copy each pixel's alpha to all of its lanes
+inline __m128i BroadcastAlpha(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// 2 pixels, widened to 16 bits per channel
+template<typename F>
+inline __m128i Widened(__m128i a, __m128i b, F fn)
+{
+    auto zero = _mm_setzero_si128();
+    auto lo = fn(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    auto hi = fn(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+// 4 pixels at a time
+inline __m128i BlendPixels(BlendMode mode, __m128i dest, __m128i source)
+{
+    switch (mode)
+    {
+    default:
+    case BlendMode::Replace:
+        return source;
+    case BlendMode::SourceOver:
+        return Widened(dest, source, [](__m128i d, __m128i s)
+        {
+            auto inverse = _mm_sub_epi16(_mm_set1_epi16(255), BroadcastAlpha(s));
+            return _mm_add_epi16(s, Div255(_mm_mullo_epi16(d, inverse)));
+        });
+    case BlendMode::Additive:
+        return _mm_adds_epu8(source, dest);
+    case BlendMode::Multiply:
+        return Widened(dest, source, [](__m128i d, __m128i s)
+        {
+            return Div255(_mm_mullo_epi16(d, s));
+        });
+    }
+}
+#endif
+
+} // namespace
+
+void BlendRowScalar(BlendMode mode, glm::u8vec4* pDest, const glm::u8vec4* pSource, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pDest[i] = BlendPixel(mode, pDest[i], pSource[i]);
+    }
+}
+
+void BlendRow(BlendMode mode, glm::u8vec4* pDest, const glm::u8vec4* pSource, uint32_t count)
+{
+    if (mode == BlendMode::Replace)
+    {
+        memmove(pDest, pSource, count * sizeof(glm::u8vec4));
+        return;
+    }
+
+    uint32_t i = 0;
+#if COMPOSITE_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        auto dest = _mm_loadu_si128((const __m128i*)(pDest + i));
+        auto source = _mm_loadu_si128((const __m128i*)(pSource + i));
+        _mm_storeu_si128((__m128i*)(pDest + i), BlendPixels(mode, dest, source));
+    }
+#endif
+    BlendRowScalar(mode, pDest + i, pSource + i, count - i);
+}
+
+void PremultiplyRowScalar(glm::u8vec4* pPixels, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pPixels[i] = PremultiplyPixel(pPixels[i]);
+    }
+}
+
+void PremultiplyRow(glm::u8vec4* pPixels, uint32_t count)
+{
+    uint32_t i = 0;
+#if COMPOSITE_SSE
+    // Alpha is multiplied by 255, which leaves it unchanged
+    auto alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    for (; i + 4 <= count; i += 4)
+    {
+        auto pixels = _mm_loadu_si128((const __m128i*)(pPixels + i));
+        auto result = Widened(pixels, pixels, [&](__m128i p, __m128i)
+        {
+            auto alpha = _mm_or_si128(BroadcastAlpha(p), alphaOne);
+            return Div255(_mm_mullo_epi16(p, alpha));
+        });
+        _mm_storeu_si128((__m128i*)(pPixels + i), result);
+    }
+#endif
+    PremultiplyRowScalar(pPixels + i, count - i);
+}
+
+void PremultiplyAlpha(Bitmap& bitmap)
+{
+    for (uint32_t y = 0; y < bitmap.size.y; y++)
+    {
+        PremultiplyRow((glm::u8vec4*)&bitmap.bits[bitmap.stride * y], bitmap.size.x);
+    }
+}
+
+void FillBlend(Bitmap& bitmap, int x, int y, int xx, int yy, const glm::u8vec4& col, BlendMode mode)
+{
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    xx = std::min(xx, int(bitmap.size.x));
+    yy = std::min(yy, int(bitmap.size.y));
+    if (x >= xx || y >= yy)
+    {
+        return;
+    }
+
+    if (mode == BlendMode::Replace)
+    {
+        DrawBlock(bitmap, x, y, xx, yy, col);
+        return;
+    }
+
+    // Blend from a short run of the color, so the row kernel can be reused
+    const int RunLength = 64;
+    glm::u8vec4 run[RunLength];
+    std::fill_n(run, RunLength, col);
+
+    for (int row = y; row < yy; row++)
+    {
+        auto pDest = (glm::u8vec4*)&bitmap.bits[bitmap.stride * row] + x;
+        for (int remaining = xx - x; remaining > 0; remaining -= RunLength)
+        {
+            auto count = std::min(remaining, RunLength);
+            BlendRow(mode, pDest, run, count);
+            pDest += count;
+        }
+    }
+}
+
+void BlitBlend(Bitmap& target, const Bitmap& source, int x, int y, BlendMode mode)
+{
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + int(source.size.x), int(target.size.x));
+    int bottom = std::min(y + int(source.size.y), int(target.size.y));
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    for (int row = top; row < bottom; row++)
+    {
+        auto pDest = (glm::u8vec4*)&target.bits[target.stride * row] + left;
+        auto pSource = (const glm::u8vec4*)&source.bits[source.stride * (row - y)] + (left - x);
+        BlendRow(mode, pDest, pSource, right - left);
+    }
+}
+
+} // MCommon
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "primitives2d.h"
+
+namespace MCommon
+{
+
+// How a source pixel combines with the pixel under it.
+// Sources are premultiplied alpha; the results are rounded exactly, so the SIMD and scalar versions always agree
+enum class BlendMode
+{
+    Replace,    // dst = src
+    SourceOver, // dst = src + dst * (1 - src.a)
+    Additive,   // dst = min(src + dst, 1)
+    Multiply    // dst = src * dst
+};
+
+// Scale the color channels by alpha, in place
+void PremultiplyAlpha(Bitmap& bitmap);
+
+// Blend a solid color over the rectangle x, y -> xx, yy (exclusive), clipped
+void FillBlend(Bitmap& bitmap, int x, int y, int xx, int yy, const glm::u8vec4& col, BlendMode mode);
+
+// Blend the source onto the target at x, y, clipped
+void BlitBlend(Bitmap& target, const Bitmap& source, int x, int y, BlendMode mode);
+
+// The row kernels. BlendRow uses SIMD where it is available; the scalar versions are the reference
+void BlendRow(BlendMode mode, glm::u8vec4* pDest, const glm::u8vec4* pSource, uint32_t count);
+void BlendRowScalar(BlendMode mode, glm::u8vec4* pDest, const glm::u8vec4* pSource, uint32_t count);
+void PremultiplyRow(glm::u8vec4* pPixels, uint32_t count);
+void PremultiplyRowScalar(glm::u8vec4* pPixels, uint32_t count);
+
+} // MCommon
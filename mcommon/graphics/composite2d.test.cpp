@@ -0,0 +1,91 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include <random>
+#include "graphics/composite2d.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+std::vector<glm::u8vec4> RandomPixels(std::mt19937& random, uint32_t count)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<glm::u8vec4> pixels(count);
+    for (auto& pixel : pixels)
+    {
+        pixel = glm::u8vec4(byte(random), byte(random), byte(random), byte(random));
+    }
+    return pixels;
+}
+
+}
+
+// Odd lengths, so the scalar tail is covered too
+TEST(Composite2D, BlendMatchesScalar)
+{
+    std::mt19937 random(7);
+    for (auto mode : { BlendMode::Replace, BlendMode::SourceOver, BlendMode::Additive, BlendMode::Multiply })
+    {
+        for (uint32_t count : { 1u, 3u, 4u, 17u, 1023u })
+        {
+            auto source = RandomPixels(random, count);
+            PremultiplyRowScalar(source.data(), count);
+            auto dest = RandomPixels(random, count);
+            auto reference = dest;
+
+            BlendRow(mode, dest.data(), source.data(), count);
+            BlendRowScalar(mode, reference.data(), source.data(), count);
+            ASSERT_TRUE(dest == reference) << "Mode: " << int(mode) << ", Count: " << count;
+        }
+    }
+}
+
+TEST(Composite2D, PremultiplyMatchesScalar)
+{
+    std::mt19937 random(11);
+    auto pixels = RandomPixels(random, 4099);
+    auto reference = pixels;
+    PremultiplyRow(pixels.data(), uint32_t(pixels.size()));
+    PremultiplyRowScalar(reference.data(), uint32_t(reference.size()));
+    ASSERT_TRUE(pixels == reference);
+}
+
+TEST(Composite2D, KnownValues)
+{
+    glm::u8vec4 dest(200, 100, 0, 255);
+
+    // Half transparent white over the top
+    auto result = dest;
+    auto source = glm::u8vec4(128, 128, 128, 128);
+    BlendRowScalar(BlendMode::SourceOver, &result, &source, 1);
+    ASSERT_EQ(result, glm::u8vec4(228, 178, 128, 255));
+
+    result = dest;
+    BlendRowScalar(BlendMode::Additive, &result, &source, 1);
+    ASSERT_EQ(result, glm::u8vec4(255, 228, 128, 255));
+
+    result = dest;
+    BlendRowScalar(BlendMode::Multiply, &result, &source, 1);
+    ASSERT_EQ(result, glm::u8vec4(100, 50, 0, 128));
+
+    auto pixel = glm::u8vec4(255, 100, 0, 51);
+    PremultiplyRowScalar(&pixel, 1);
+    ASSERT_EQ(pixel, glm::u8vec4(51, 20, 0, 51));
+}
+
+TEST(Composite2D, FillAndBlitClip)
+{
+    std::vector<glm::u8vec4> pixels(6 * 4, glm::u8vec4(0, 0, 0, 255));
+    Bitmap bitmap{ (uint8_t*)pixels.data(), 6 * sizeof(glm::u8vec4), glm::uvec2(6, 4) };
+    FillBlend(bitmap, -2, -2, 2, 2, glm::u8vec4(10, 0, 0, 0), BlendMode::Additive);
+    ASSERT_EQ(pixels[0].x, 10);
+    ASSERT_EQ(pixels[1 * 6 + 1].x, 10);
+    ASSERT_EQ(pixels[2 * 6 + 2].x, 0);
+
+    std::vector<glm::u8vec4> sprite(3 * 3, glm::u8vec4(0, 20, 0, 0));
+    Bitmap spriteBitmap{ (uint8_t*)sprite.data(), 3 * sizeof(glm::u8vec4), glm::uvec2(3, 3) };
+    BlitBlend(bitmap, spriteBitmap, 4, 2, BlendMode::SourceOver);
+    ASSERT_EQ(pixels[3 * 6 + 5].y, 20);
+    ASSERT_EQ(pixels[3 * 6 + 3].y, 0);
+}
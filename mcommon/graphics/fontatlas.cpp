@@ -0,0 +1,258 @@
+#include "mcommon.h"
+#include "fontatlas.h"
+
+namespace MCommon
+{
+
+namespace
+{
+
+const uint32_t LookupSize = 128;
+
+template<typename T>
+void Write(std::string& data, const T& value)
+{
+    data.append((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+bool Read(const std::string& data, size_t& offset, T& value)
+{
+    if (offset + sizeof(T) > data.size())
+    {
+        return false;
+    }
+    memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+// 1D squared distance transform of f into d, along a line of n values
+void DistanceTransform1D(const float* f, float* d, int n, int* v, float* z)
+{
+    const float Infinity = std::numeric_limits<float>::max();
+
+    // Lower envelope of the parabolas rooted at each sample
+    int k = 0;
+    v[0] = 0;
+    z[0] = -Infinity;
+    z[1] = Infinity;
+    for (int q = 1; q < n; q++)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = Infinity;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q)
+        {
+            k++;
+        }
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+// Squared distance from each pixel to the nearest pixel that is 0 in the grid
+void DistanceTransform2D(std::vector<float>& grid, int width, int height)
+{
+    int n = std::max(width, height);
+    std::vector<float> f(n);
+    std::vector<float> d(n);
+    std::vector<int> v(n);
+    std::vector<float> z(n + 1);
+
+    for (int x = 0; x < width; x++)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            f[y] = grid[y * width + x];
+        }
+        DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+        for (int y = 0; y < height; y++)
+        {
+            grid[y * width + x] = d[y];
+        }
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        auto pRow = &grid[y * width];
+        DistanceTransform1D(pRow, d.data(), width, v.data(), z.data());
+        std::copy(d.begin(), d.begin() + width, pRow);
+    }
+}
+
+} // namespace
+
+const uint32_t FontAtlas::Magic;
+const uint32_t FontAtlas::Version;
+
+void FontAtlas::BuildLookup()
+{
+    m_lookup.assign(LookupSize, -1);
+    for (int32_t index = 0; index < int32_t(glyphs.size()); index++)
+    {
+        if (glyphs[index].codepoint < LookupSize)
+        {
+            m_lookup[glyphs[index].codepoint] = index;
+        }
+    }
+}
+
+const FontGlyph* FontAtlas::Find(uint32_t codepoint) const
+{
+    if (codepoint < m_lookup.size())
+    {
+        auto index = m_lookup[codepoint];
+        return index < 0 ? nullptr : &glyphs[index];
+    }
+
+    for (auto& glyph : glyphs)
+    {
+        if (glyph.codepoint == codepoint)
+        {
+            return &glyph;
+        }
+    }
+    return nullptr;
+}
+
+std::string FontAtlas::Save() const
+{
+    std::string data;
+    Write(data, Magic);
+    Write(data, Version);
+    Write(data, atlasSize);
+    Write(data, pixelSize);
+    Write(data, spread);
+    Write(data, ascender);
+    Write(data, lineHeight);
+    Write(data, uint32_t(glyphs.size()));
+    for (auto& glyph : glyphs)
+    {
+        Write(data, glyph.codepoint);
+        Write(data, glyph.offset);
+        Write(data, glyph.size);
+        Write(data, glyph.texRect);
+        Write(data, glyph.advance);
+    }
+    return data;
+}
+
+bool FontAtlas::Load(const std::string& data)
+{
+    size_t offset = 0;
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!Read(data, offset, magic) || magic != Magic ||
+        !Read(data, offset, version) || version != Version ||
+        !Read(data, offset, atlasSize) ||
+        !Read(data, offset, pixelSize) ||
+        !Read(data, offset, spread) ||
+        !Read(data, offset, ascender) ||
+        !Read(data, offset, lineHeight) ||
+        !Read(data, offset, count))
+    {
+        return false;
+    }
+
+    glyphs.resize(count);
+    for (auto& glyph : glyphs)
+    {
+        if (!Read(data, offset, glyph.codepoint) ||
+            !Read(data, offset, glyph.offset) ||
+            !Read(data, offset, glyph.size) ||
+            !Read(data, offset, glyph.texRect) ||
+            !Read(data, offset, glyph.advance))
+        {
+            glyphs.clear();
+            return false;
+        }
+    }
+    BuildLookup();
+    return true;
+}
+
+glm::vec2 FontAtlas::Layout(const std::string& text, const glm::vec2& pos, float size, std::vector<GlyphQuad>& quads) const
+{
+    float scale = pixelSize > 0.0f ? size / pixelSize : 0.0f;
+    glm::vec2 pen(pos.x, pos.y + ascender * scale);
+    for (auto ch : text)
+    {
+        auto pGlyph = Find(uint8_t(ch));
+        if (!pGlyph)
+        {
+            continue;
+        }
+
+        // Spaces have no quad, just an advance
+        if (pGlyph->size.x > 0.0f)
+        {
+            GlyphQuad quad;
+            quad.topLeft = pen + pGlyph->offset * scale;
+            quad.bottomRight = quad.topLeft + pGlyph->size * scale;
+            quad.texRect = pGlyph->texRect;
+            quads.push_back(quad);
+        }
+        pen.x += pGlyph->advance * scale;
+    }
+    return glm::vec2(pen.x, pos.y);
+}
+
+glm::vec2 FontAtlas::Measure(const std::string& text, float size) const
+{
+    float scale = pixelSize > 0.0f ? size / pixelSize : 0.0f;
+    float width = 0.0f;
+    for (auto ch : text)
+    {
+        auto pGlyph = Find(uint8_t(ch));
+        if (pGlyph)
+        {
+            width += pGlyph->advance * scale;
+        }
+    }
+    return glm::vec2(width, lineHeight * scale);
+}
+
+std::vector<float> SignedDistanceField(const uint8_t* pCoverage, uint32_t width, uint32_t height, uint32_t pitch)
+{
+    const float Infinity = 1e20f;
+
+    // Distance to the nearest inside pixel, and to the nearest outside pixel
+    std::vector<float> toInside(width * height);
+    std::vector<float> toOutside(width * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            bool inside = pCoverage[y * pitch + x] >= 128;
+            toInside[y * width + x] = inside ? 0.0f : Infinity;
+            toOutside[y * width + x] = inside ? Infinity : 0.0f;
+        }
+    }
+    DistanceTransform2D(toInside, int(width), int(height));
+    DistanceTransform2D(toOutside, int(width), int(height));
+
+    // The edge is half way between pixel centers
+    std::vector<float> distances(width * height);
+    for (uint32_t i = 0; i < width * height; i++)
+    {
+        distances[i] = toInside[i] == 0.0f ?
+            std::sqrt(toOutside[i]) - .5f :
+            .5f - std::sqrt(toInside[i]);
+    }
+    return distances;
+}
+
+} // MCommon
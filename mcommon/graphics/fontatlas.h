@@ -0,0 +1,66 @@
+#pragma once
+
+namespace MCommon
+{
+
+// A font baked to a signed distance field texture, and the metrics to lay out text with it.
+// Built offline by massetbuilder; the distance is stored in the alpha channel of the atlas.
+// All sizes are in pixels at the baked size, with y down from the baseline
+
+struct FontGlyph
+{
+    uint32_t codepoint = 0;
+    glm::vec2 offset = glm::vec2(0.0f); // Top left of the quad from the pen position
+    glm::vec2 size = glm::vec2(0.0f);   // Size of the quad, including the distance field margin
+    glm::vec4 texRect = glm::vec4(0.0f);// Texture coordinates of the top left and bottom right
+    float advance = 0.0f;               // Pen movement to the next glyph
+
+    FontGlyph() {}
+};
+
+// A positioned glyph, ready to become 2 triangles
+struct GlyphQuad
+{
+    glm::vec2 topLeft;
+    glm::vec2 bottomRight;
+    glm::vec4 texRect;
+};
+
+class FontAtlas
+{
+public:
+    static const uint32_t Magic = 0x544e464d; // 'MFNT'
+    static const uint32_t Version = 1;
+
+    float pixelSize = 0.0f;     // The size the glyphs were baked at
+    float spread = 0.0f;        // Distance range either side of the edge
+    float ascender = 0.0f;      // Baseline distance from the top of a line
+    float lineHeight = 0.0f;
+    glm::uvec2 atlasSize = glm::uvec2(0);
+    std::vector<FontGlyph> glyphs;
+
+    FontAtlas() {}
+
+    // Call after changing the glyphs
+    void BuildLookup();
+    const FontGlyph* Find(uint32_t codepoint) const;
+
+    // The binary metrics file
+    std::string Save() const;
+    bool Load(const std::string& data);
+
+    // Append the quads for a line of text at 'size' pixels high, with the top left at pos.
+    // Returns the pen position after the text; unknown characters are skipped
+    glm::vec2 Layout(const std::string& text, const glm::vec2& pos, float size, std::vector<GlyphQuad>& quads) const;
+    glm::vec2 Measure(const std::string& text, float size) const;
+
+private:
+    // Glyph index for each ASCII code, so layout doesn't search
+    std::vector<int32_t> m_lookup;
+};
+
+// Signed distance from each pixel center to the edge of the shape, in pixels; positive inside.
+// Coverage of 128 or more is inside. Exact, and linear in the pixel count (Felzenszwalb & Huttenlocher)
+std::vector<float> SignedDistanceField(const uint8_t* pCoverage, uint32_t width, uint32_t height, uint32_t pitch);
+
+} // MCommon
@@ -0,0 +1,113 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "graphics/fontatlas.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+FontAtlas MakeAtlas()
+{
+    FontAtlas atlas;
+    atlas.pixelSize = 32.0f;
+    atlas.spread = 4.0f;
+    atlas.ascender = 24.0f;
+    atlas.lineHeight = 36.0f;
+    atlas.atlasSize = glm::uvec2(256, 128);
+
+    FontGlyph space;
+    space.codepoint = ' ';
+    space.advance = 8.0f;
+    atlas.glyphs.push_back(space);
+
+    FontGlyph a;
+    a.codepoint = 'A';
+    a.offset = glm::vec2(-4.0f, -28.0f);
+    a.size = glm::vec2(24.0f, 32.0f);
+    a.texRect = glm::vec4(0.0f, 0.0f, .1f, .25f);
+    a.advance = 18.0f;
+    atlas.glyphs.push_back(a);
+
+    atlas.BuildLookup();
+    return atlas;
+}
+
+}
+
+TEST(FontAtlas, SaveLoadRoundTrip)
+{
+    auto atlas = MakeAtlas();
+
+    FontAtlas loaded;
+    ASSERT_TRUE(loaded.Load(atlas.Save()));
+    ASSERT_EQ(loaded.atlasSize, atlas.atlasSize);
+    ASSERT_EQ(loaded.pixelSize, atlas.pixelSize);
+    ASSERT_EQ(loaded.lineHeight, atlas.lineHeight);
+    ASSERT_EQ(loaded.glyphs.size(), atlas.glyphs.size());
+
+    auto pGlyph = loaded.Find('A');
+    ASSERT_NE(pGlyph, nullptr);
+    ASSERT_EQ(pGlyph->texRect, atlas.glyphs[1].texRect);
+    ASSERT_EQ(loaded.Find('B'), nullptr);
+}
+
+TEST(FontAtlas, LoadRejectsBadData)
+{
+    FontAtlas atlas;
+    ASSERT_FALSE(atlas.Load(""));
+    ASSERT_FALSE(atlas.Load("not a font at all"));
+
+    // Truncated
+    auto data = MakeAtlas().Save();
+    ASSERT_FALSE(atlas.Load(data.substr(0, data.size() - 2)));
+}
+
+TEST(FontAtlas, LayoutScalesAndAdvances)
+{
+    auto atlas = MakeAtlas();
+
+    std::vector<GlyphQuad> quads;
+    auto end = atlas.Layout("A A?", glm::vec2(10.0f, 20.0f), 16.0f, quads);
+
+    // The space and the unknown character have no quads
+    ASSERT_EQ(quads.size(), 2u);
+    ASSERT_EQ(end, glm::vec2(10.0f + (18.0f + 8.0f + 18.0f) * .5f, 20.0f));
+
+    // Half size, on a baseline half the ascender down
+    ASSERT_EQ(quads[0].topLeft, glm::vec2(10.0f - 2.0f, 20.0f + 12.0f - 14.0f));
+    ASSERT_EQ(quads[0].bottomRight, quads[0].topLeft + glm::vec2(12.0f, 16.0f));
+    ASSERT_EQ(quads[1].topLeft.x, quads[0].topLeft.x + 13.0f);
+
+    ASSERT_EQ(atlas.Measure("A A?", 16.0f), glm::vec2(22.0f, 18.0f));
+}
+
+TEST(FontAtlas, DistanceFieldOfDisc)
+{
+    const int Size = 64;
+    const float Radius = 20.0f;
+    const glm::vec2 Center(32.0f, 32.0f);
+
+    std::vector<uint8_t> coverage(Size * Size);
+    for (int y = 0; y < Size; y++)
+    {
+        for (int x = 0; x < Size; x++)
+        {
+            coverage[y * Size + x] = glm::length(glm::vec2(x + .5f, y + .5f) - Center) < Radius ? 255 : 0;
+        }
+    }
+
+    auto distances = SignedDistanceField(coverage.data(), Size, Size, Size);
+    for (int y = 0; y < Size; y++)
+    {
+        for (int x = 0; x < Size; x++)
+        {
+            auto expected = Radius - glm::length(glm::vec2(x + .5f, y + .5f) - Center);
+            auto actual = distances[y * Size + x];
+
+            // Pixelated edges, so allow a pixel
+            ASSERT_NEAR(actual, expected, 1.0f);
+            ASSERT_EQ(actual > 0.0f, coverage[y * Size + x] != 0);
+        }
+    }
+}
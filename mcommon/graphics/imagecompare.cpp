@@ -0,0 +1,102 @@
+#include "mcommon.h"
+#include "imagecompare.h"
+
+namespace MCommon
+{
+
+ImageDifference CompareImages(const Bitmap& a, const Bitmap& b, uint32_t tolerance)
+{
+    ImageDifference diff;
+    assert(a.size == b.size);
+
+    uint64_t total = 0;
+    for (uint32_t y = 0; y < a.size.y; y++)
+    {
+        auto pA = a.bits + y * a.stride;
+        auto pB = b.bits + y * b.stride;
+        for (uint32_t x = 0; x < a.size.x; x++)
+        {
+            uint32_t pixelMax = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t d = uint32_t(std::abs(int(pA[c]) - int(pB[c])));
+                pixelMax = std::max(pixelMax, d);
+                total += d;
+            }
+            if (pixelMax > tolerance)
+            {
+                diff.differentPixels++;
+            }
+            diff.maxDifference = std::max(diff.maxDifference, pixelMax);
+            pA += 4;
+            pB += 4;
+        }
+    }
+
+    uint64_t channels = uint64_t(a.size.x) * a.size.y * 4;
+    diff.meanDifference = channels ? double(total) / double(channels) : 0.0;
+    return diff;
+}
+
+uint64_t PerceptualHash(const Bitmap& bitmap)
+{
+    const uint32_t Width = 9;
+    const uint32_t Height = 8;
+    if (bitmap.size.x == 0 || bitmap.size.y == 0)
+    {
+        return 0;
+    }
+
+    // Each cell averages the pixels whose centers fall inside it; tiny images reuse pixels
+    float cells[Height][Width];
+    for (uint32_t cy = 0; cy < Height; cy++)
+    {
+        uint32_t y0 = cy * bitmap.size.y / Height;
+        uint32_t y1 = std::max(y0 + 1, (cy + 1) * bitmap.size.y / Height);
+        for (uint32_t cx = 0; cx < Width; cx++)
+        {
+            uint32_t x0 = cx * bitmap.size.x / Width;
+            uint32_t x1 = std::max(x0 + 1, (cx + 1) * bitmap.size.x / Width);
+
+            float sum = 0.0f;
+            for (uint32_t y = y0; y < y1; y++)
+            {
+                auto pPixel = bitmap.bits + y * bitmap.stride + x0 * 4;
+                for (uint32_t x = x0; x < x1; x++)
+                {
+                    sum += pPixel[0] * 0.299f + pPixel[1] * 0.587f + pPixel[2] * 0.114f;
+                    pPixel += 4;
+                }
+            }
+            cells[cy][cx] = sum / float((y1 - y0) * (x1 - x0));
+        }
+    }
+
+    uint64_t hash = 0;
+    for (uint32_t cy = 0; cy < Height; cy++)
+    {
+        for (uint32_t cx = 0; cx < Width - 1; cx++)
+        {
+            hash <<= 1;
+            if (cells[cy][cx] > cells[cy][cx + 1])
+            {
+                hash |= 1;
+            }
+        }
+    }
+    return hash;
+}
+
+uint32_t HashDistance(uint64_t a, uint64_t b)
+{
+    uint64_t bits = a ^ b;
+    uint32_t count = 0;
+    while (bits)
+    {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+} // MCommon
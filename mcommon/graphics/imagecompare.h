@@ -0,0 +1,29 @@
+#pragma once
+
+#include "primitives2d.h"
+
+namespace MCommon
+{
+
+// Checks for rendered images, so a change can be shown not to alter the output.
+// A golden image is compared pixel by pixel; a perceptual hash is a compact fingerprint
+// which survives small changes, such as rounding differences between drivers
+
+struct ImageDifference
+{
+    uint32_t maxDifference = 0;         // Largest difference in any channel
+    uint64_t differentPixels = 0;       // Pixels with a channel differing by more than the tolerance
+    double meanDifference = 0.0;        // Mean channel difference
+};
+
+// The bitmaps must be the same size
+ImageDifference CompareImages(const Bitmap& a, const Bitmap& b, uint32_t tolerance);
+
+// A 64 bit difference hash of the luminance: the image is box filtered to 9x8,
+// and each bit records if a pixel is brighter than its right neighbour
+uint64_t PerceptualHash(const Bitmap& bitmap);
+
+// Number of bits that differ; 0 for the same image, and usually under 5 for similar ones
+uint32_t HashDistance(uint64_t a, uint64_t b);
+
+} // MCommon
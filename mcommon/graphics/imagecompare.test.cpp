@@ -0,0 +1,74 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "graphics/imagecompare.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+struct TestImage
+{
+    TestImage(int width, int height)
+        : pixels(width * height)
+    {
+        bitmap.bits = (uint8_t*)pixels.data();
+        bitmap.stride = width * sizeof(glm::u8vec4);
+        bitmap.size = glm::uvec2(width, height);
+
+        // A diagonal gradient, with some detail
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                auto v = uint8_t((x * 255 / width + y * 128 / height + ((x / 7 + y / 5) & 1) * 40) & 0xFF);
+                pixels[y * width + x] = glm::u8vec4(v, 255 - v, v / 2, 255);
+            }
+        }
+    }
+    std::vector<glm::u8vec4> pixels;
+    Bitmap bitmap;
+};
+
+}
+
+TEST(ImageCompare, SameImage)
+{
+    TestImage a(64, 48);
+    TestImage b(64, 48);
+    auto diff = CompareImages(a.bitmap, b.bitmap, 0);
+    EXPECT_EQ(diff.maxDifference, 0u);
+    EXPECT_EQ(diff.differentPixels, 0u);
+    EXPECT_EQ(HashDistance(PerceptualHash(a.bitmap), PerceptualHash(b.bitmap)), 0u);
+}
+
+TEST(ImageCompare, Tolerance)
+{
+    TestImage a(64, 48);
+    TestImage b(64, 48);
+    b.pixels[10].x ^= 1;
+    b.pixels[20].y = uint8_t(b.pixels[20].y + 3 - (b.pixels[20].y > 250 ? 6 : 0));
+
+    auto diff = CompareImages(a.bitmap, b.bitmap, 1);
+    EXPECT_EQ(diff.maxDifference, 3u);
+    EXPECT_EQ(diff.differentPixels, 1u);
+    EXPECT_EQ(CompareImages(a.bitmap, b.bitmap, 0).differentPixels, 2u);
+}
+
+TEST(ImageCompare, HashSurvivesNoise)
+{
+    TestImage a(160, 120);
+    TestImage b(160, 120);
+    for (size_t i = 0; i < b.pixels.size(); i += 3)
+    {
+        b.pixels[i].x = uint8_t(std::min(255, b.pixels[i].x + 2));
+    }
+    EXPECT_LE(HashDistance(PerceptualHash(a.bitmap), PerceptualHash(b.bitmap)), 2u);
+
+    // A mirrored image is a different picture
+    for (int y = 0; y < 120; y++)
+    {
+        std::reverse(b.pixels.begin() + y * 160, b.pixels.begin() + (y + 1) * 160);
+    }
+    EXPECT_GT(HashDistance(PerceptualHash(a.bitmap), PerceptualHash(b.bitmap)), 16u);
+}
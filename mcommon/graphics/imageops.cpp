@@ -0,0 +1,331 @@
+#include "mcommon.h"
+#include "imageops.h"
+
+namespace MCommon
+{
+
+namespace
+{
+
+// Rows per block of parallel work
+const uint32_t RowBlock = 8;
+
+inline const glm::u8vec4* RowPtr(const Bitmap& bitmap, int y)
+{
+    return (const glm::u8vec4*)&bitmap.bits[bitmap.stride * y];
+}
+
+inline glm::u8vec4* RowPtr(Bitmap& bitmap, int y)
+{
+    return (glm::u8vec4*)&bitmap.bits[bitmap.stride * y];
+}
+
+inline glm::u8vec4 ToPixel(const glm::vec4& value)
+{
+    return glm::u8vec4(glm::clamp(value + .5f, glm::vec4(0.0f), glm::vec4(255.0f)));
+}
+
+// The source pixels that contribute to each target pixel along one axis, with their weights
+struct Contributions
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights; // 'stride' per target pixel
+    int stride = 0;
+};
+
+float FilterWeight(ResampleFilter filter, float x)
+{
+    x = std::abs(x);
+    switch (filter)
+    {
+    default:
+    case ResampleFilter::Box:
+        return x <= .5f ? 1.0f : 0.0f;
+    case ResampleFilter::Bilinear:
+        return std::max(1.0f - x, 0.0f);
+    case ResampleFilter::Lanczos3:
+    {
+        if (x < 1e-5f)
+        {
+            return 1.0f;
+        }
+        if (x >= 3.0f)
+        {
+            return 0.0f;
+        }
+        auto px = float(M_PI) * x;
+        return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+    }
+    }
+}
+
+float FilterRadius(ResampleFilter filter)
+{
+    switch (filter)
+    {
+    default:
+    case ResampleFilter::Box:
+        return .5f;
+    case ResampleFilter::Bilinear:
+        return 1.0f;
+    case ResampleFilter::Lanczos3:
+        return 3.0f;
+    }
+}
+
+Contributions BuildContributions(ResampleFilter filter, int sourceSize, int targetSize)
+{
+    float scale = sourceSize / float(targetSize);
+
+    // When shrinking, stretch the filter over the source pixels it covers
+    float filterScale = std::max(scale, 1.0f);
+    float support = FilterRadius(filter) * filterScale;
+
+    Contributions contributions;
+    contributions.stride = int(std::ceil(support * 2.0f)) + 2;
+    contributions.first.resize(targetSize);
+    contributions.count.resize(targetSize);
+    contributions.weights.resize(targetSize * contributions.stride, 0.0f);
+
+    for (int target = 0; target < targetSize; target++)
+    {
+        float center = (target + .5f) * scale;
+        int first = int(std::floor(center - support));
+        int last = std::min(int(std::ceil(center + support)), first + contributions.stride - 1);
+
+        auto pWeights = &contributions.weights[target * contributions.stride];
+        float total = 0.0f;
+        for (int source = first; source <= last; source++)
+        {
+            auto weight = FilterWeight(filter, (source + .5f - center) / filterScale);
+            pWeights[source - first] = weight;
+            total += weight;
+        }
+
+        // Normalize, so flat areas stay flat
+        if (total != 0.0f)
+        {
+            for (int i = 0; i <= last - first; i++)
+            {
+                pWeights[i] /= total;
+            }
+        }
+        contributions.first[target] = first;
+        contributions.count[target] = last - first + 1;
+    }
+    return contributions;
+}
+
+} // namespace
+
+std::vector<float> BoxKernel(int radius)
+{
+    radius = std::max(radius, 0);
+    return std::vector<float>(radius * 2 + 1, 1.0f / (radius * 2 + 1));
+}
+
+std::vector<float> GaussianKernel(float sigma)
+{
+    sigma = std::max(sigma, .01f);
+    int radius = int(std::ceil(sigma * 3.0f));
+    std::vector<float> kernel(radius * 2 + 1);
+    float total = 0.0f;
+    for (int i = -radius; i <= radius; i++)
+    {
+        kernel[i + radius] = std::exp(-(i * i) / (2.0f * sigma * sigma));
+        total += kernel[i + radius];
+    }
+    for (auto& weight : kernel)
+    {
+        weight /= total;
+    }
+    return kernel;
+}
+
+void ConvolveSeparable(const Bitmap& source, Bitmap& target, const std::vector<float>& kernel)
+{
+    int width = int(source.size.x);
+    int height = int(source.size.y);
+    if (width == 0 || height == 0 || kernel.empty() || target.size != source.size)
+    {
+        return;
+    }
+
+    int radius = int(kernel.size()) / 2;
+    std::vector<glm::vec4> horizontal(width * height);
+
+    // Across the rows, into the float buffer.
+    // The clamped edges are handled separately, so the middle of the row has no branches
+    ParallelFor(height, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        std::vector<glm::vec4> row(width);
+        for (uint32_t y = begin; y < end; y++)
+        {
+            auto pSource = RowPtr(source, y);
+            for (int x = 0; x < width; x++)
+            {
+                row[x] = glm::vec4(pSource[x]);
+            }
+
+            auto pOut = &horizontal[y * width];
+            for (int x = 0; x < width; x++)
+            {
+                glm::vec4 sum(0.0f);
+                if (x >= radius && x + radius < width)
+                {
+                    auto pIn = &row[x - radius];
+                    for (int k = 0; k < int(kernel.size()); k++)
+                    {
+                        sum += pIn[k] * kernel[k];
+                    }
+                }
+                else
+                {
+                    for (int k = 0; k < int(kernel.size()); k++)
+                    {
+                        sum += row[glm::clamp(x + k - radius, 0, width - 1)] * kernel[k];
+                    }
+                }
+                pOut[x] = sum;
+            }
+        }
+    });
+
+    // Down the columns, a whole row at a time
+    ParallelFor(height, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        std::vector<glm::vec4> sum(width);
+        for (uint32_t y = begin; y < end; y++)
+        {
+            std::fill(sum.begin(), sum.end(), glm::vec4(0.0f));
+            for (int k = 0; k < int(kernel.size()); k++)
+            {
+                auto pIn = &horizontal[glm::clamp(int(y) + k - radius, 0, height - 1) * width];
+                auto weight = kernel[k];
+                for (int x = 0; x < width; x++)
+                {
+                    sum[x] += pIn[x] * weight;
+                }
+            }
+
+            auto pTarget = RowPtr(target, y);
+            for (int x = 0; x < width; x++)
+            {
+                pTarget[x] = ToPixel(sum[x]);
+            }
+        }
+    });
+}
+
+void Resample(const Bitmap& source, Bitmap& target, ResampleFilter filter)
+{
+    int sourceWidth = int(source.size.x);
+    int sourceHeight = int(source.size.y);
+    int targetWidth = int(target.size.x);
+    int targetHeight = int(target.size.y);
+    if (sourceWidth == 0 || sourceHeight == 0 || targetWidth == 0 || targetHeight == 0)
+    {
+        return;
+    }
+
+    auto columns = BuildContributions(filter, sourceWidth, targetWidth);
+    auto rows = BuildContributions(filter, sourceHeight, targetHeight);
+
+    // Resize the rows first, into a buffer of target width and source height
+    std::vector<glm::vec4> horizontal(targetWidth * sourceHeight);
+    ParallelFor(sourceHeight, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            auto pSource = RowPtr(source, y);
+            auto pOut = &horizontal[y * targetWidth];
+            for (int x = 0; x < targetWidth; x++)
+            {
+                auto pWeights = &columns.weights[x * columns.stride];
+                auto first = columns.first[x];
+                glm::vec4 sum(0.0f);
+                for (int i = 0; i < columns.count[x]; i++)
+                {
+                    sum += glm::vec4(pSource[glm::clamp(first + i, 0, sourceWidth - 1)]) * pWeights[i];
+                }
+                pOut[x] = sum;
+            }
+        }
+    });
+
+    // Then combine the rows for each target row
+    ParallelFor(targetHeight, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        std::vector<glm::vec4> sum(targetWidth);
+        for (uint32_t y = begin; y < end; y++)
+        {
+            std::fill(sum.begin(), sum.end(), glm::vec4(0.0f));
+            auto pWeights = &rows.weights[y * rows.stride];
+            for (int i = 0; i < rows.count[y]; i++)
+            {
+                auto pIn = &horizontal[glm::clamp(rows.first[y] + i, 0, sourceHeight - 1) * targetWidth];
+                auto weight = pWeights[i];
+                for (int x = 0; x < targetWidth; x++)
+                {
+                    sum[x] += pIn[x] * weight;
+                }
+            }
+
+            auto pTarget = RowPtr(target, y);
+            for (int x = 0; x < targetWidth; x++)
+            {
+                pTarget[x] = ToPixel(sum[x]);
+            }
+        }
+    });
+}
+
+ColorLUT ColorLUT::Identity()
+{
+    ColorLUT lut;
+    for (int channel = 0; channel < 4; channel++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            lut.channels[channel][i] = uint8_t(i);
+        }
+    }
+    return lut;
+}
+
+void ApplyLUT(Bitmap& bitmap, const ColorLUT& lut)
+{
+    ParallelFor(bitmap.size.y, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            auto pRow = RowPtr(bitmap, y);
+            for (uint32_t x = 0; x < bitmap.size.x; x++)
+            {
+                auto& pixel = pRow[x];
+                pixel = glm::u8vec4(lut.channels[0][pixel.x], lut.channels[1][pixel.y], lut.channels[2][pixel.z], lut.channels[3][pixel.w]);
+            }
+        }
+    });
+}
+
+void ConvertLinear(const glm::vec3* pSource, Bitmap& target, const LinearLUT& lut)
+{
+    const float scale = float(LinearLUT::Size - 1);
+    ParallelFor(target.size.y, RowBlock, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            auto pIn = pSource + y * target.size.x;
+            auto pRow = RowPtr(target, y);
+            for (uint32_t x = 0; x < target.size.x; x++)
+            {
+                auto index = glm::uvec3(glm::clamp(pIn[x], 0.0f, 1.0f) * scale + .5f);
+                pRow[x] = glm::u8vec4(lut.table[index.x], lut.table[index.y], lut.table[index.z], 255);
+            }
+        }
+    });
+}
+
+} // MCommon
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "primitives2d.h"
+
+namespace MCommon
+{
+
+// Image processing on 8 bit RGBA bitmaps.
+// Work is split into blocks of rows across the cores; the inner loops run along rows, so they vectorise.
+// Bitmaps can have any stride
+
+enum class ResampleFilter
+{
+    Box,      // Area average
+    Bilinear, // Triangle; widened when shrinking, so it doesn't alias
+    Lanczos3  // Sharpest; can ring at hard edges
+};
+
+// 1D kernels for ConvolveSeparable; the weights sum to 1
+std::vector<float> BoxKernel(int radius);
+std::vector<float> GaussianKernel(float sigma);
+
+// Convolve with the kernel across the rows, then down the columns. Edges are clamped.
+// The kernel is centered, so should have an odd size. Source and target must be the same size, and can be the same bitmap
+void ConvolveSeparable(const Bitmap& source, Bitmap& target, const std::vector<float>& kernel);
+
+// Scale the source to fit the target
+void Resample(const Bitmap& source, Bitmap& target, ResampleFilter filter);
+
+// A lookup table for each channel
+struct ColorLUT
+{
+    uint8_t channels[4][256];
+
+    static ColorLUT Identity();
+};
+void ApplyLUT(Bitmap& bitmap, const ColorLUT& lut);
+
+// Maps linear float color in [0, 1] to 8 bits; values outside the range are clamped
+struct LinearLUT
+{
+    static const uint32_t Size = 4096;
+    uint8_t table[Size];
+
+    // Build from fn(float) -> float in [0, 1]
+    template<typename F>
+    static LinearLUT Build(F fn)
+    {
+        LinearLUT lut;
+        for (uint32_t i = 0; i < Size; i++)
+        {
+            lut.table[i] = uint8_t(glm::clamp(fn(i / float(Size - 1)), 0.0f, 1.0f) * 255.0f);
+        }
+        return lut;
+    }
+};
+
+// Convert a tightly packed float image the size of the target, writing opaque pixels
+void ConvertLinear(const glm::vec3* pSource, Bitmap& target, const LinearLUT& lut);
+
+} // MCommon
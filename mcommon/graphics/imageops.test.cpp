@@ -0,0 +1,91 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "graphics/imageops.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+// Padded rows, so the stride is always honoured
+struct TestBitmap
+{
+    TestBitmap(int width, int height, const glm::u8vec4& color = glm::u8vec4(0))
+        : pixels((width + 3) * height, color)
+    {
+        bitmap.bits = (uint8_t*)pixels.data();
+        bitmap.stride = (width + 3) * sizeof(glm::u8vec4);
+        bitmap.size = glm::uvec2(width, height);
+    }
+    glm::u8vec4& At(int x, int y) { return pixels[y * (bitmap.size.x + 3) + x]; }
+    std::vector<glm::u8vec4> pixels;
+    Bitmap bitmap;
+};
+
+}
+
+TEST(ImageOps, ConvolveFlatStaysFlat)
+{
+    TestBitmap test(37, 21, glm::u8vec4(10, 20, 30, 255));
+    ConvolveSeparable(test.bitmap, test.bitmap, GaussianKernel(2.5f));
+    for (int y = 0; y < 21; y++)
+    {
+        for (int x = 0; x < 37; x++)
+        {
+            ASSERT_EQ(test.At(x, y), glm::u8vec4(10, 20, 30, 255));
+        }
+    }
+}
+
+TEST(ImageOps, BoxBlurSpreadsImpulse)
+{
+    TestBitmap source(9, 9);
+    source.At(4, 4) = glm::u8vec4(225);
+    TestBitmap target(9, 9);
+    ConvolveSeparable(source.bitmap, target.bitmap, BoxKernel(1));
+    ASSERT_EQ(target.At(3, 3).x, 25);
+    ASSERT_EQ(target.At(5, 4).x, 25);
+    ASSERT_EQ(target.At(6, 4).x, 0);
+}
+
+TEST(ImageOps, ResampleFlatStaysFlat)
+{
+    for (auto filter : { ResampleFilter::Box, ResampleFilter::Bilinear, ResampleFilter::Lanczos3 })
+    {
+        TestBitmap source(31, 17, glm::u8vec4(200, 100, 50, 255));
+        TestBitmap smaller(12, 7);
+        TestBitmap larger(50, 40);
+        Resample(source.bitmap, smaller.bitmap, filter);
+        Resample(source.bitmap, larger.bitmap, filter);
+        ASSERT_EQ(smaller.At(5, 3), glm::u8vec4(200, 100, 50, 255));
+        ASSERT_EQ(larger.At(49, 39), glm::u8vec4(200, 100, 50, 255));
+    }
+}
+
+TEST(ImageOps, BoxHalvesCheckerboard)
+{
+    TestBitmap source(8, 8);
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            source.At(x, y) = ((x + y) & 1) ? glm::u8vec4(200) : glm::u8vec4(0);
+        }
+    }
+    TestBitmap target(4, 4);
+    Resample(source.bitmap, target.bitmap, ResampleFilter::Box);
+    ASSERT_EQ(target.At(1, 2), glm::u8vec4(100));
+}
+
+TEST(ImageOps, LUTs)
+{
+    TestBitmap test(5, 5, glm::u8vec4(10, 20, 30, 40));
+    auto lut = ColorLUT::Identity();
+    lut.channels[0][10] = 99;
+    ApplyLUT(test.bitmap, lut);
+    ASSERT_EQ(test.At(4, 4), glm::u8vec4(99, 20, 30, 40));
+
+    std::vector<glm::vec3> linear(5 * 5, glm::vec3(0.0f, .5f, 2.0f));
+    ConvertLinear(linear.data(), test.bitmap, LinearLUT::Build([](float v) { return v; }));
+    ASSERT_EQ(test.At(2, 3), glm::u8vec4(0, 127, 255, 255));
+}
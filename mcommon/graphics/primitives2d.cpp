@@ -4,124 +4,344 @@
 namespace MCommon
 {
 
-// Draw a square on the CPU
-void DrawBlock(Bitmap& bitmap, int x, int y, int xx, int yy, const glm::u8vec4& col)
+namespace
+{
+
+int64_t FloorDiv(int64_t a, int64_t b)
+{
+    auto q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+int64_t CeilDiv(int64_t a, int64_t b)
+{
+    return -FloorDiv(-a, b);
+}
+
+inline glm::u8vec4* PixelPtr(Bitmap& bitmap, int x, int y)
+{
+    return (glm::u8vec4*)&bitmap.bits[(bitmap.stride * y) + x * sizeof(glm::u8vec4)];
+}
+
+inline bool Inside(const Bitmap& bitmap, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < int(bitmap.size.x) && y < int(bitmap.size.y);
+}
+
+// Plot the 8 symmetric points of a circle
+template<typename F>
+void CircleOctants(int radius, F fn)
 {
-    for (int xPos = x; xPos < xx; xPos++)
+    // Integer midpoint algorithm, starting at the bottom and working round to the diagonal
+    int x = 0;
+    int y = radius;
+    int d = 1 - radius;
+    while (x <= y)
     {
-        for (int yPos = y; yPos < yy; yPos++)
+        fn(x, y);
+        fn(y, x);
+        fn(-x, y);
+        fn(-y, x);
+        fn(x, -y);
+        fn(y, -x);
+        fn(-x, -y);
+        fn(-y, -x);
+
+        if (d < 0)
+        {
+            d += 2 * x + 3;
+        }
+        else
         {
-            PutPixel(bitmap, xPos, yPos, col);
+            d += 2 * (x - y) + 5;
+            y--;
         }
+        x++;
     }
 }
 
-// Bresenhams line drawing algorithm
-void DrawLine(Bitmap& bitmap, int x1, int y1, int x2, int y2, const glm::u8vec4& color)
+// Visit the circle, only doing per pixel bounds checks when it straddles the border
+template<typename F>
+void ClippedCircle(Bitmap& bitmap, int cx, int cy, int radius, F accept)
 {
-    int x, y, dx, dy, dx1, dy1, px, py, xe, ye, i;
-    dx = x2 - x1;
-    dy = y2 - y1;
-    dx1 = (int)abs(dx);
-    dy1 = (int)abs(dy);
-    px = 2 * dy1 - dx1;
-    py = 2 * dx1 - dy1;
-    if (dy1 <= dx1)
+    if (radius < 0 ||
+        cx + radius < 0 || cy + radius < 0 ||
+        cx - radius >= int(bitmap.size.x) || cy - radius >= int(bitmap.size.y))
     {
-        if (dx >= 0)
-        {
-            x = x1;
-            y = y1;
-            xe = x2;
-        }
-        else
+        return;
+    }
+
+    bool inside = Inside(bitmap, cx - radius, cy - radius) && Inside(bitmap, cx + radius, cy + radius);
+    CircleOctants(radius, [&](int x, int y)
+    {
+        if (!accept(x, y))
         {
-            x = x2;
-            y = y2;
-            xe = x1;
+            return;
         }
-        PutPixel(bitmap, x, y, color);
-        for (i = 0; x < xe; i++)
+        if (inside || Inside(bitmap, cx + x, cy + y))
         {
-            x = x + 1;
-            if (px < 0)
-            {
-                px = px + 2 * dy1;
-            }
-            else
-            {
-                if ((dx < 0 && dy < 0) || (dx > 0 && dy > 0))
-                {
-                    y = y + 1;
-                }
-                else
-                {
-                    y = y - 1;
-                }
-                px = px + 2 * (dy1 - dx1);
-            }
-            PutPixel(bitmap, x, y, color);
+            *PixelPtr(bitmap, cx + x, cy + y) = accept.color;
         }
+    });
+}
+
+struct AcceptAll
+{
+    glm::u8vec4 color;
+    bool operator()(int, int) const { return true; }
+};
+
+// Angles start at +y and increase towards +x, matching the old sin/cos version.
+// Points are tested against the start and end directions with cross products, so there is no trig per pixel
+struct AcceptArc
+{
+    glm::u8vec4 color;
+    glm::dvec2 start;
+    glm::dvec2 end;
+    bool wide;
+
+    static double Cross(const glm::dvec2& a, const glm::dvec2& b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    // In the half turn starting at 'from' and ending before 'to'
+    static bool Between(const glm::dvec2& from, const glm::dvec2& to, const glm::dvec2& p)
+    {
+        return Cross(from, p) <= 0.0 && Cross(p, to) < 0.0;
+    }
+
+    bool operator()(int x, int y) const
+    {
+        auto p = glm::dvec2(x, y);
+        return wide ? !Between(end, start, p) : Between(start, end, p);
+    }
+};
+
+} // namespace
+
+// Draw a square on the CPU.
+// The rectangle is clipped once, and each row is a single span fill
+void DrawBlock(Bitmap& bitmap, int x, int y, int xx, int yy, const glm::u8vec4& col)
+{
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    xx = std::min(xx, int(bitmap.size.x));
+    yy = std::min(yy, int(bitmap.size.y));
+    if (x >= xx || y >= yy)
+    {
+        return;
+    }
+
+    // Fill as 32 bit words, which the compiler turns into wide stores
+    uint32_t value;
+    memcpy(&value, &col, sizeof(value));
+    for (int yPos = y; yPos < yy; yPos++)
+    {
+        std::fill_n((uint32_t*)PixelPtr(bitmap, x, yPos), xx - x, value);
+    }
+}
+
+// Bresenhams line drawing algorithm.
+// Instead of checking every pixel, the visible part of the line is found up front, and the
+// error term is set up directly at the first visible pixel, so the pixels match the unclipped line
+void DrawLine(Bitmap& bitmap, int x1, int y1, int x2, int y2, const glm::u8vec4& color)
+{
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    int dx1 = std::abs(dx);
+    int dy1 = std::abs(dy);
+
+    // Walk along the major axis, in the positive direction
+    bool xMajor = dy1 <= dx1;
+    int a0, b0, aMax, bMax, dMaj, dMin, bias;
+    if (xMajor)
+    {
+        bool forward = dx >= 0;
+        a0 = forward ? x1 : x2;
+        b0 = forward ? y1 : y2;
+        aMax = int(bitmap.size.x) - 1;
+        bMax = int(bitmap.size.y) - 1;
+        dMaj = dx1;
+        dMin = dy1;
+        bias = dMaj;
     }
     else
     {
-        if (dy >= 0)
+        bool forward = dy >= 0;
+        a0 = forward ? y1 : y2;
+        b0 = forward ? x1 : x2;
+        aMax = int(bitmap.size.y) - 1;
+        bMax = int(bitmap.size.x) - 1;
+        dMaj = dy1;
+        dMin = dx1;
+        bias = dMaj - 1;
+    }
+    int sign = ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) ? 1 : -1;
+
+    if (dMaj == 0)
+    {
+        PutPixel(bitmap, x1, y1, color);
+        return;
+    }
+
+    // After i steps, the minor axis has moved k(i) = floor((2 * i * dMin + bias) / (2 * dMaj)) pixels
+    int64_t iFirst = std::max(0, -a0);
+    int64_t iLast = std::min(dMaj, aMax - a0);
+
+    // The range of k that keeps the minor axis on the bitmap
+    int64_t kLow = sign > 0 ? -b0 : b0 - bMax;
+    int64_t kHigh = sign > 0 ? bMax - b0 : b0;
+    if (dMin == 0)
+    {
+        if (kLow > 0 || kHigh < 0)
         {
-            x = x1;
-            y = y1;
-            ye = y2;
+            return;
         }
-        else
+    }
+    else
+    {
+        iFirst = std::max(iFirst, CeilDiv(2 * kLow * dMaj - bias, 2 * int64_t(dMin)));
+        iLast = std::min(iLast, FloorDiv(2 * (kHigh + 1) * dMaj - bias - 1, 2 * int64_t(dMin)));
+    }
+    if (iFirst > iLast)
+    {
+        return;
+    }
+
+    // Start the error term at the first visible step
+    int64_t numerator = 2 * iFirst * dMin + bias;
+    int64_t k = FloorDiv(numerator, 2 * int64_t(dMaj));
+    int64_t error = numerator - k * 2 * dMaj;
+
+    int x = xMajor ? a0 + int(iFirst) : b0 + sign * int(k);
+    int y = xMajor ? b0 + sign * int(k) : a0 + int(iFirst);
+
+    auto pixelSize = int(sizeof(glm::u8vec4));
+    auto majorStep = xMajor ? pixelSize : int(bitmap.stride);
+    auto minorStep = sign * (xMajor ? int(bitmap.stride) : pixelSize);
+
+    auto pPixel = (uint8_t*)PixelPtr(bitmap, x, y);
+    for (int64_t i = iFirst; i <= iLast; i++)
+    {
+        *(glm::u8vec4*)pPixel = color;
+        pPixel += majorStep;
+        error += 2 * dMin;
+        if (error >= 2 * dMaj)
         {
-            x = x2;
-            y = y2;
-            ye = y1;
+            error -= 2 * dMaj;
+            pPixel += minorStep;
         }
-        PutPixel(bitmap, x, y, color);
-        for (i = 0; y < ye; i++)
+    }
+}
+
+void DrawCircle(Bitmap& pBitmap, int x, int y, int radius, const glm::u8vec4& col)
+{
+    ClippedCircle(pBitmap, x, y, radius, AcceptAll{ col });
+}
+
+// Angles in degrees
+void DrawArc(Bitmap& pBitmap, int x, int y, int radius, double startAngle, double endAngle, const glm::u8vec4& col)
+{
+    if (endAngle <= startAngle)
+    {
+        return;
+    }
+
+    if (endAngle - startAngle >= 360.0)
+    {
+        DrawCircle(pBitmap, x, y, radius, col);
+        return;
+    }
+
+    AcceptArc arc;
+    arc.color = col;
+    arc.start = glm::dvec2(sin(glm::radians(startAngle)), cos(glm::radians(startAngle)));
+    arc.end = glm::dvec2(sin(glm::radians(endAngle)), cos(glm::radians(endAngle)));
+    arc.wide = (endAngle - startAngle) > 180.0;
+    ClippedCircle(pBitmap, x, y, radius, arc);
+}
+
+// Half space rasterization over the clipped bounding box, stepping the edge functions incrementally
+void DrawTriangle(Bitmap& bitmap, const glm::ivec2& p0, const glm::ivec2& p1, const glm::ivec2& p2, const glm::u8vec4& col)
+{
+    glm::i64vec2 v[3] = { glm::i64vec2(p0), glm::i64vec2(p1), glm::i64vec2(p2) };
+
+    // Twice the area; make the winding consistent
+    auto area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    if (area == 0)
+    {
+        return;
+    }
+    if (area < 0)
+    {
+        std::swap(v[1], v[2]);
+    }
+
+    int minX = std::max(int(std::min(std::min(v[0].x, v[1].x), v[2].x)), 0);
+    int minY = std::max(int(std::min(std::min(v[0].y, v[1].y), v[2].y)), 0);
+    int maxX = std::min(int(std::max(std::max(v[0].x, v[1].x), v[2].x)), int(bitmap.size.x) - 1);
+    int maxY = std::min(int(std::max(std::max(v[0].y, v[1].y), v[2].y)), int(bitmap.size.y) - 1);
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // Edge i runs from v[i] to v[i + 1].
+    // Pixels exactly on an edge are only filled for top (horizontal, going right) and left (going up) edges
+    int64_t rowEdge[3];
+    int64_t stepX[3];
+    int64_t stepY[3];
+    for (int i = 0; i < 3; i++)
+    {
+        auto& a = v[i];
+        auto& b = v[(i + 1) % 3];
+        auto d = b - a;
+        bool topLeft = (d.y == 0 && d.x > 0) || d.y < 0;
+        stepX[i] = -d.y;
+        stepY[i] = d.x;
+        rowEdge[i] = d.x * (minY - a.y) - d.y * (minX - a.x) + (topLeft ? 0 : -1);
+    }
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        int64_t e0 = rowEdge[0];
+        int64_t e1 = rowEdge[1];
+        int64_t e2 = rowEdge[2];
+        auto pPixel = PixelPtr(bitmap, minX, y);
+        for (int x = minX; x <= maxX; x++)
         {
-            y = y + 1;
-            if (py <= 0)
-            {
-                py = py + 2 * dx1;
-            }
-            else
+            if ((e0 | e1 | e2) >= 0)
             {
-                if ((dx < 0 && dy < 0) || (dx > 0 && dy > 0))
-                {
-                    x = x + 1;
-                }
-                else
-                {
-                    x = x - 1;
-                }
-                py = py + 2 * (dx1 - dy1);
+                *pPixel = col;
             }
-            PutPixel(bitmap, x, y, color);
+            pPixel++;
+            e0 += stepX[0];
+            e1 += stepX[1];
+            e2 += stepX[2];
         }
+        rowEdge[0] += stepY[0];
+        rowEdge[1] += stepY[1];
+        rowEdge[2] += stepY[2];
     }
 }
 
-void DrawCircle(Bitmap& pBitmap, int x, int y, int radius, const glm::u8vec4& col)
+void Blit(Bitmap& target, const Bitmap& source, int x, int y)
 {
-    double step = (360.0 / (2.0 * M_PI * (double)radius));
-    for (double angle = 0.f; angle < 360.0; angle += step)
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + int(source.size.x), int(target.size.x));
+    int bottom = std::min(y + int(source.size.y), int(target.size.y));
+    if (left >= right || top >= bottom)
     {
-        int xx = (int)(radius * sin(glm::radians(angle)));
-        int yy = (int)(radius * cos(glm::radians(angle)));
-        PutPixel(pBitmap, x + xx, y + yy, col);
+        return;
     }
-}
 
-void DrawArc(Bitmap& pBitmap, int x, int y, int radius, double startAngle, double endAngle, const glm::u8vec4& col)
-{
-    double step = (360.0 / (2.0 * M_PI * (double)radius));
-    for (double angle = startAngle; angle < endAngle; angle += step)
+    for (int row = top; row < bottom; row++)
     {
-        int xx = (int)(radius * sin(glm::radians(angle)));
-        int yy = (int)(radius * cos(glm::radians(angle)));
-        PutPixel(pBitmap, x + xx, y + yy, col);
+        auto pSource = &source.bits[source.stride * (row - y) + (left - x) * sizeof(glm::u8vec4)];
+        memcpy(PixelPtr(target, left, row), pSource, (right - left) * sizeof(glm::u8vec4));
     }
 }
 
-} // MCommon
\ No newline at end of file
+} // MCommon
@@ -28,4 +28,10 @@ void DrawLine(Bitmap& bitmap, int x1, int y1, int x2, int y2, const glm::u8vec4&
 void DrawCircle(Bitmap& pBitmap, int x, int y, int radius, const glm::u8vec4& col);
 void DrawArc(Bitmap& pBitmap, int x, int y, int radius, double startAngle, double endAngle, const glm::u8vec4& col);
 
+// Filled, using the top-left rule so triangles sharing an edge don't overdraw it
+void DrawTriangle(Bitmap& bitmap, const glm::ivec2& p0, const glm::ivec2& p1, const glm::ivec2& p2, const glm::u8vec4& col);
+
+// Copy the source to x, y on the target, clipped
+void Blit(Bitmap& target, const Bitmap& source, int x, int y);
+
 } // MCommon
@@ -0,0 +1,142 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include <random>
+#include "graphics/primitives2d.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+struct TestBitmap
+{
+    TestBitmap(int width, int height)
+        : pixels(width * height, glm::u8vec4(0))
+    {
+        bitmap.bits = (uint8_t*)pixels.data();
+        bitmap.stride = width * sizeof(glm::u8vec4);
+        bitmap.size = glm::uvec2(width, height);
+    }
+    std::vector<glm::u8vec4> pixels;
+    Bitmap bitmap;
+};
+
+// The original per pixel Bresenham, which the clipped version must match
+void ReferenceLine(Bitmap& bitmap, int x1, int y1, int x2, int y2, const glm::u8vec4& color)
+{
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    int dx1 = abs(dx);
+    int dy1 = abs(dy);
+    int px = 2 * dy1 - dx1;
+    int py = 2 * dx1 - dy1;
+    bool sameSign = (dx < 0 && dy < 0) || (dx > 0 && dy > 0);
+    if (dy1 <= dx1)
+    {
+        int x = dx >= 0 ? x1 : x2;
+        int y = dx >= 0 ? y1 : y2;
+        int xe = dx >= 0 ? x2 : x1;
+        PutPixel(bitmap, x, y, color);
+        while (x < xe)
+        {
+            x++;
+            if (px < 0)
+            {
+                px += 2 * dy1;
+            }
+            else
+            {
+                y += sameSign ? 1 : -1;
+                px += 2 * (dy1 - dx1);
+            }
+            PutPixel(bitmap, x, y, color);
+        }
+    }
+    else
+    {
+        int x = dy >= 0 ? x1 : x2;
+        int y = dy >= 0 ? y1 : y2;
+        int ye = dy >= 0 ? y2 : y1;
+        PutPixel(bitmap, x, y, color);
+        while (y < ye)
+        {
+            y++;
+            if (py <= 0)
+            {
+                py += 2 * dx1;
+            }
+            else
+            {
+                x += sameSign ? 1 : -1;
+                py += 2 * (dx1 - dy1);
+            }
+            PutPixel(bitmap, x, y, color);
+        }
+    }
+}
+
+}
+
+TEST(Primitives2D, BlockClips)
+{
+    TestBitmap test(8, 4);
+    DrawBlock(test.bitmap, -5, 2, 3, 100, glm::u8vec4(255));
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            ASSERT_EQ(test.pixels[y * 8 + x].x, (x < 3 && y >= 2) ? 255 : 0);
+        }
+    }
+}
+
+TEST(Primitives2D, LineMatchesUnclipped)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> coord(-60, 100);
+    for (int line = 0; line < 5000; line++)
+    {
+        int x1 = coord(random);
+        int y1 = coord(random);
+        int x2 = coord(random);
+        int y2 = coord(random);
+
+        TestBitmap clipped(37, 29);
+        TestBitmap reference(37, 29);
+        DrawLine(clipped.bitmap, x1, y1, x2, y2, glm::u8vec4(255));
+        ReferenceLine(reference.bitmap, x1, y1, x2, y2, glm::u8vec4(255));
+        ASSERT_TRUE(clipped.pixels == reference.pixels) << x1 << "," << y1 << " - " << x2 << "," << y2;
+    }
+}
+
+TEST(Primitives2D, CircleClips)
+{
+    // Partly off the bitmap; the visible points are still on the circle
+    TestBitmap test(16, 16);
+    DrawCircle(test.bitmap, 2, 8, 6, glm::u8vec4(255));
+    int count = 0;
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 16; x++)
+        {
+            if (test.pixels[y * 16 + x].x)
+            {
+                auto distance = glm::length(glm::vec2(x - 2, y - 8));
+                ASSERT_NEAR(distance, 6.0f, 0.75f);
+                count++;
+            }
+        }
+    }
+    ASSERT_GT(count, 0);
+}
+
+TEST(Primitives2D, ArcQuadrant)
+{
+    // 0 degrees points down (+y), 90 degrees points right (+x)
+    TestBitmap test(32, 32);
+    DrawArc(test.bitmap, 16, 16, 10, 0.0, 90.0, glm::u8vec4(255));
+    ASSERT_EQ(test.pixels[26 * 32 + 16].x, 255);
+    ASSERT_EQ(test.pixels[16 * 32 + 26].x, 0);
+    ASSERT_EQ(test.pixels[6 * 32 + 16].x, 0);
+    ASSERT_EQ(test.pixels[16 * 32 + 6].x, 0);
+}
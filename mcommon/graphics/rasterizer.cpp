@@ -0,0 +1,782 @@
+#include "mcommon.h"
+#include "rasterizer.h"
+#include "threadpool/ThreadPool.hpp"
+
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTER_SSE 1
+#endif
+
+namespace MCommon
+{
+
+namespace
+{
+
+// Vertices are snapped to 1/16th of a pixel; with 8192 pixels at most, the edge steps across a 64 pixel
+// tile stay well inside 32 bits
+const int SubPixelBits = 4;
+const int SubPixels = 1 << SubPixelBits;
+const uint32_t MaxSize = 8192;
+const int MaxTileSize = 256;
+
+// Lookups for the texel and output conversions
+const int GammaSteps = 4096;
+struct ColorTables
+{
+    float unit[256];                // Byte to 0-1
+    float linear[256];              // sRGB byte to linear 0-1
+    float gamma[GammaSteps + 1];    // Linear 0-1 to pow(1/2.2)
+};
+
+const ColorTables& GetTables()
+{
+    static ColorTables tables = []()
+    {
+        ColorTables t;
+        for (int i = 0; i < 256; i++)
+        {
+            float value = i / 255.0f;
+            t.unit[i] = value;
+            t.linear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= GammaSteps; i++)
+        {
+            t.gamma[i] = std::pow(i / float(GammaSteps), 1.0f / 2.2f);
+        }
+        return t;
+    }();
+    return tables;
+}
+
+inline float Gamma(const ColorTables& tables, float value)
+{
+    return tables.gamma[int(glm::clamp(value, 0.0f, 1.0f) * GammaSteps + .5f)];
+}
+
+// Bilinear, with the coordinates wrapped
+glm::vec4 Sample(const RasterTexture::Level& level, const glm::vec2& uv, const float* pTable)
+{
+    float width = float(level.size.x);
+    float height = float(level.size.y);
+    float fx = uv.x * width - .5f;
+    float fy = uv.y * height - .5f;
+    fx -= std::floor(fx / width) * width;
+    fy -= std::floor(fy / height) * height;
+
+    int x0 = std::min(int(fx), int(level.size.x) - 1);
+    int y0 = std::min(int(fy), int(level.size.y) - 1);
+    int x1 = (x0 + 1 == int(level.size.x)) ? 0 : x0 + 1;
+    int y1 = (y0 + 1 == int(level.size.y)) ? 0 : y0 + 1;
+    float tx = fx - x0;
+    float ty = fy - y0;
+
+    auto fetch = [&](int x, int y)
+    {
+        auto& texel = level.texels[y * level.size.x + x];
+        return glm::vec4(pTable[texel.x], pTable[texel.y], pTable[texel.z], GetTables().unit[texel.w]);
+    };
+    auto top = glm::mix(fetch(x0, y0), fetch(x1, y0), tx);
+    auto bottom = glm::mix(fetch(x0, y1), fetch(x1, y1), tx);
+    return glm::mix(top, bottom, ty);
+}
+
+// Signed distance to each clip plane; -w <= x, y <= w and 0 <= z <= w
+inline float PlaneDistance(const glm::vec4& pos, int plane)
+{
+    switch (plane)
+    {
+    case 0: return pos.w + pos.x;
+    case 1: return pos.w - pos.x;
+    case 2: return pos.w + pos.y;
+    case 3: return pos.w - pos.y;
+    case 4: return pos.z;
+    default: return pos.w - pos.z;
+    }
+}
+
+inline uint32_t OutCode(const glm::vec4& pos)
+{
+    uint32_t code = 0;
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (PlaneDistance(pos, plane) < 0.0f)
+        {
+            code |= (1 << plane);
+        }
+    }
+    return code;
+}
+
+inline RasterVertex Lerp(const RasterVertex& a, const RasterVertex& b, float t)
+{
+    return RasterVertex(glm::mix(a.position, b.position, t), glm::mix(a.tex, b.tex, t), glm::mix(a.color, b.color, t));
+}
+
+inline bool SameState(const RasterState& a, const RasterState& b)
+{
+    return a.pTexture == b.pTexture && a.flags == b.flags && a.scissor == b.scissor;
+}
+
+// 4 pixels along a row; which are covered and pass the depth test, with their depth and
+// perspective correct barycentrics for vertices 1 and 2
+struct Quad
+{
+    uint32_t mask;
+    float z[4];
+    float b1[4];
+    float b2[4];
+};
+
+// Edge values, barycentrics and their steps along x
+struct QuadSetup
+{
+    int32_t edge[3];
+    int32_t edgeStep[3];
+    float l1;
+    float l2;
+    float l1Step;
+    float l2Step;
+    float z0;
+    float dz1;
+    float dz2;
+    float w0;
+    float dw1;
+    float dw2;
+    float invW1;
+    float invW2;
+};
+
+inline void EvaluateQuad(const QuadSetup& setup, uint32_t laneMask, const float* pDepth, bool depthTest, Quad& quad)
+{
+#if RASTER_SSE
+    __m128i any = _mm_setzero_si128();
+    for (int i = 0; i < 3; i++)
+    {
+        auto step = setup.edgeStep[i];
+        auto offsets = _mm_set_epi32(step * 3, step * 2, step, 0);
+        any = _mm_or_si128(any, _mm_add_epi32(_mm_set1_epi32(setup.edge[i]), offsets));
+    }
+
+    // All edges are >= 0 when none of the sign bits are set
+    quad.mask = ~uint32_t(_mm_movemask_ps(_mm_castsi128_ps(any))) & laneMask;
+    if (quad.mask == 0)
+    {
+        return;
+    }
+
+    auto laneF = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    auto l1 = _mm_add_ps(_mm_set1_ps(setup.l1), _mm_mul_ps(laneF, _mm_set1_ps(setup.l1Step)));
+    auto l2 = _mm_add_ps(_mm_set1_ps(setup.l2), _mm_mul_ps(laneF, _mm_set1_ps(setup.l2Step)));
+    auto z = _mm_add_ps(_mm_set1_ps(setup.z0), _mm_add_ps(_mm_mul_ps(l1, _mm_set1_ps(setup.dz1)), _mm_mul_ps(l2, _mm_set1_ps(setup.dz2))));
+
+    if (depthTest)
+    {
+        __m128 depth;
+        if (laneMask == 0xf)
+        {
+            depth = _mm_loadu_ps(pDepth);
+        }
+        else
+        {
+            float partial[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (laneMask & (1 << lane))
+                {
+                    partial[lane] = pDepth[lane];
+                }
+            }
+            depth = _mm_loadu_ps(partial);
+        }
+        quad.mask &= uint32_t(_mm_movemask_ps(_mm_cmpge_ps(z, depth)));
+        if (quad.mask == 0)
+        {
+            return;
+        }
+    }
+
+    auto invW = _mm_add_ps(_mm_set1_ps(setup.w0), _mm_add_ps(_mm_mul_ps(l1, _mm_set1_ps(setup.dw1)), _mm_mul_ps(l2, _mm_set1_ps(setup.dw2))));
+    auto w = _mm_div_ps(_mm_set1_ps(1.0f), invW);
+    _mm_storeu_ps(quad.z, z);
+    _mm_storeu_ps(quad.b1, _mm_mul_ps(_mm_mul_ps(l1, _mm_set1_ps(setup.invW1)), w));
+    _mm_storeu_ps(quad.b2, _mm_mul_ps(_mm_mul_ps(l2, _mm_set1_ps(setup.invW2)), w));
+#else
+    quad.mask = 0;
+    for (int lane = 0; lane < 4; lane++)
+    {
+        bool inside = (laneMask & (1 << lane)) != 0;
+        for (int i = 0; i < 3; i++)
+        {
+            inside = inside && (setup.edge[i] + setup.edgeStep[i] * lane) >= 0;
+        }
+
+        float l1 = setup.l1 + setup.l1Step * lane;
+        float l2 = setup.l2 + setup.l2Step * lane;
+        quad.z[lane] = setup.z0 + l1 * setup.dz1 + l2 * setup.dz2;
+        if (inside && depthTest)
+        {
+            inside = quad.z[lane] >= pDepth[lane];
+        }
+
+        float w = 1.0f / (setup.w0 + l1 * setup.dw1 + l2 * setup.dw2);
+        quad.b1[lane] = l1 * setup.invW1 * w;
+        quad.b2[lane] = l2 * setup.invW2 * w;
+        quad.mask |= inside ? (1 << lane) : 0;
+    }
+#endif
+}
+
+} // namespace
+
+void RasterTexture::Resize(const glm::uvec2& size)
+{
+    levels.resize(1);
+    levels[0].size = size;
+    levels[0].texels.resize(size.x * size.y);
+}
+
+void RasterTexture::BuildMips()
+{
+    if (levels.empty())
+    {
+        return;
+    }
+
+    levels.resize(1);
+    while (levels.back().size.x > 1 || levels.back().size.y > 1)
+    {
+        auto& source = levels.back();
+        Level level;
+        level.size = glm::max(source.size / 2u, glm::uvec2(1));
+        level.texels.resize(level.size.x * level.size.y);
+        for (uint32_t y = 0; y < level.size.y; y++)
+        {
+            for (uint32_t x = 0; x < level.size.x; x++)
+            {
+                glm::uvec4 sum(0);
+                for (uint32_t sy = 0; sy < 2; sy++)
+                {
+                    for (uint32_t sx = 0; sx < 2; sx++)
+                    {
+                        auto px = std::min(x * 2 + sx, source.size.x - 1);
+                        auto py = std::min(y * 2 + sy, source.size.y - 1);
+                        sum += glm::uvec4(source.texels[py * source.size.x + px]);
+                    }
+                }
+                level.texels[y * level.size.x + x] = glm::u8vec4((sum + glm::uvec4(2)) / 4u);
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+Rasterizer::Rasterizer(int tileSize)
+    : m_tileSize(glm::clamp(tileSize, 4, MaxTileSize))
+{
+}
+
+void Rasterizer::Resize(const glm::uvec2& size)
+{
+    auto clamped = glm::min(size, glm::uvec2(MaxSize));
+    if (clamped == m_size)
+    {
+        return;
+    }
+
+    Flush();
+    m_size = clamped;
+    m_color.assign(m_size.x * m_size.y, glm::u8vec4(0));
+    m_depth.assign(m_size.x * m_size.y, 0.0f);
+}
+
+Bitmap Rasterizer::GetBitmap()
+{
+    Bitmap bitmap;
+    bitmap.bits = m_color.empty() ? nullptr : (uint8_t*)m_color.data();
+    bitmap.stride = m_size.x * sizeof(glm::u8vec4);
+    bitmap.size = m_size;
+    return bitmap;
+}
+
+void Rasterizer::ClearColor(const glm::u8vec4& color)
+{
+    Flush();
+    ParallelFor(m_size.y, 64, [&](uint32_t begin, uint32_t end)
+    {
+        std::fill(m_color.begin() + begin * m_size.x, m_color.begin() + end * m_size.x, color);
+    });
+}
+
+void Rasterizer::ClearDepth(float depth)
+{
+    Flush();
+    ParallelFor(m_size.y, 64, [&](uint32_t begin, uint32_t end)
+    {
+        std::fill(m_depth.begin() + begin * m_size.x, m_depth.begin() + end * m_size.x, depth);
+    });
+}
+
+void Rasterizer::DrawTriangles(const RasterVertex* pVertices, const uint32_t* pIndices, uint32_t numIndices, const RasterState& state)
+{
+    if (m_size.x == 0 || m_size.y == 0 || numIndices < 3)
+    {
+        return;
+    }
+
+    if (m_states.empty() || !SameState(m_states.back(), state))
+    {
+        m_states.push_back(state);
+    }
+    auto stateIndex = uint32_t(m_states.size() - 1);
+
+    for (uint32_t index = 0; index + 2 < numIndices; index += 3)
+    {
+        const RasterVertex* triangle[3] = { &pVertices[pIndices[index]], &pVertices[pIndices[index + 1]], &pVertices[pIndices[index + 2]] };
+        ClipAndSetup(triangle, stateIndex);
+    }
+}
+
+// Only triangles crossing a plane are clipped; the polygon is then drawn as a fan
+void Rasterizer::ClipAndSetup(const RasterVertex* pVertices[3], uint32_t state)
+{
+    auto c0 = OutCode(pVertices[0]->position);
+    auto c1 = OutCode(pVertices[1]->position);
+    auto c2 = OutCode(pVertices[2]->position);
+    if (c0 & c1 & c2)
+    {
+        return;
+    }
+
+    if ((c0 | c1 | c2) == 0)
+    {
+        Setup(*pVertices[0], *pVertices[1], *pVertices[2], state);
+        return;
+    }
+
+    // Each plane adds a vertex at most
+    RasterVertex polygons[2][9];
+    uint32_t count = 3;
+    for (int i = 0; i < 3; i++)
+    {
+        polygons[0][i] = *pVertices[i];
+    }
+
+    int current = 0;
+    auto planes = c0 | c1 | c2;
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (!(planes & (1 << plane)))
+        {
+            continue;
+        }
+
+        auto& input = polygons[current];
+        auto& output = polygons[current ^ 1];
+        uint32_t outCount = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto& a = input[i];
+            auto& b = input[(i + 1) % count];
+            float da = PlaneDistance(a.position, plane);
+            float db = PlaneDistance(b.position, plane);
+            if (da >= 0.0f)
+            {
+                output[outCount++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                output[outCount++] = Lerp(a, b, da / (da - db));
+            }
+        }
+        count = outCount;
+        current ^= 1;
+        if (count < 3)
+        {
+            return;
+        }
+    }
+
+    auto& polygon = polygons[current];
+    for (uint32_t i = 1; i + 1 < count; i++)
+    {
+        Setup(polygon[0], polygon[i], polygon[i + 1], state);
+    }
+}
+
+void Rasterizer::Setup(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, uint32_t state)
+{
+    const RasterVertex* vertices[3] = { &v0, &v1, &v2 };
+
+    Triangle triangle;
+    for (int i = 0; i < 3; i++)
+    {
+        auto& vertex = *vertices[i];
+        float invW = 1.0f / std::max(vertex.position.w, 1e-20f);
+        auto ndc = glm::vec3(vertex.position) * invW;
+
+        // Y is down the screen
+        auto screen = glm::vec2((ndc.x * .5f + .5f) * m_size.x, (.5f - ndc.y * .5f) * m_size.y);
+        triangle.points[i] = glm::ivec2(glm::round(screen * float(SubPixels)));
+        triangle.z[i] = ndc.z;
+        triangle.invW[i] = invW;
+        triangle.tex[i] = vertex.tex;
+        triangle.color[i] = vertex.color;
+    }
+
+    auto& p = triangle.points;
+    triangle.area = int64_t(p[1].x - p[0].x) * (p[2].y - p[0].y) - int64_t(p[1].y - p[0].y) * (p[2].x - p[0].x);
+    if (triangle.area == 0)
+    {
+        return;
+    }
+
+    // Either winding is drawn; make them all the same
+    if (triangle.area < 0)
+    {
+        std::swap(triangle.points[1], triangle.points[2]);
+        std::swap(triangle.z[1], triangle.z[2]);
+        std::swap(triangle.invW[1], triangle.invW[2]);
+        std::swap(triangle.tex[1], triangle.tex[2]);
+        std::swap(triangle.color[1], triangle.color[2]);
+        triangle.area = -triangle.area;
+    }
+
+    // Pixels with centers inside the extents
+    auto minPoint = glm::min(p[0], glm::min(p[1], p[2]));
+    auto maxPoint = glm::max(p[0], glm::max(p[1], p[2]));
+    auto& scissor = m_states[state].scissor;
+    triangle.bounds.x = std::max(std::max((minPoint.x - SubPixels / 2 + SubPixels - 1) >> SubPixelBits, scissor.x), 0);
+    triangle.bounds.y = std::max(std::max((minPoint.y - SubPixels / 2 + SubPixels - 1) >> SubPixelBits, scissor.y), 0);
+    triangle.bounds.z = std::min(std::min(((maxPoint.x - SubPixels / 2) >> SubPixelBits) + 1, scissor.z), int(m_size.x));
+    triangle.bounds.w = std::min(std::min(((maxPoint.y - SubPixels / 2) >> SubPixelBits) + 1, scissor.w), int(m_size.y));
+    if (triangle.bounds.x >= triangle.bounds.z || triangle.bounds.y >= triangle.bounds.w)
+    {
+        return;
+    }
+
+    // One mip level for the whole triangle, from the ratio of texels to pixels
+    triangle.level = 0;
+    auto pTexture = m_states[state].pTexture;
+    if (pTexture && pTexture->levels.size() > 1)
+    {
+        auto uv1 = triangle.tex[1] - triangle.tex[0];
+        auto uv2 = triangle.tex[2] - triangle.tex[0];
+        auto& size = pTexture->levels[0].size;
+        float texels = std::abs(uv1.x * uv2.y - uv1.y * uv2.x) * size.x * size.y;
+        float pixels = float(triangle.area) / float(SubPixels * SubPixels);
+        if (texels > pixels)
+        {
+            float lod = .5f * std::log2(texels / pixels);
+            triangle.level = std::min(uint32_t(lod + .5f), uint32_t(pTexture->levels.size() - 1));
+        }
+    }
+
+    triangle.state = state;
+    m_triangles.push_back(triangle);
+}
+
+void Rasterizer::Bin()
+{
+    m_tileCount = (glm::ivec2(m_size) + glm::ivec2(m_tileSize - 1)) / m_tileSize;
+    auto numTiles = uint32_t(m_tileCount.x * m_tileCount.y);
+
+    auto tileRange = [&](const Triangle& triangle)
+    {
+        return glm::ivec4(triangle.bounds.x / m_tileSize, triangle.bounds.y / m_tileSize, (triangle.bounds.z - 1) / m_tileSize, (triangle.bounds.w - 1) / m_tileSize);
+    };
+
+    m_tileStart.assign(numTiles + 1, 0);
+    for (auto& triangle : m_triangles)
+    {
+        auto range = tileRange(triangle);
+        for (int y = range.y; y <= range.w; y++)
+        {
+            for (int x = range.x; x <= range.z; x++)
+            {
+                m_tileStart[y * m_tileCount.x + x + 1]++;
+            }
+        }
+    }
+
+    for (uint32_t tile = 0; tile < numTiles; tile++)
+    {
+        m_tileStart[tile + 1] += m_tileStart[tile];
+    }
+
+    // Scatter in drawing order, using the tile start as a cursor, then shift the cursors back
+    m_tileTriangles.resize(m_tileStart[numTiles]);
+    for (uint32_t index = 0; index < m_triangles.size(); index++)
+    {
+        auto range = tileRange(m_triangles[index]);
+        for (int y = range.y; y <= range.w; y++)
+        {
+            for (int x = range.x; x <= range.z; x++)
+            {
+                m_tileTriangles[m_tileStart[y * m_tileCount.x + x]++] = index;
+            }
+        }
+    }
+    for (uint32_t tile = numTiles; tile > 0; tile--)
+    {
+        m_tileStart[tile] = m_tileStart[tile - 1];
+    }
+    m_tileStart[0] = 0;
+}
+
+void Rasterizer::DrawTile(uint32_t tile)
+{
+    auto origin = glm::ivec2(tile % m_tileCount.x, tile / m_tileCount.x) * m_tileSize;
+    auto rect = glm::ivec4(origin, glm::min(origin + glm::ivec2(m_tileSize), glm::ivec2(m_size)));
+    for (uint32_t entry = m_tileStart[tile]; entry < m_tileStart[tile + 1]; entry++)
+    {
+        DrawTriangle(m_triangles[m_tileTriangles[entry]], rect);
+    }
+}
+
+void Rasterizer::DrawTriangle(const Triangle& triangle, const glm::ivec4& tileRect)
+{
+    auto rect = glm::ivec4(glm::max(glm::ivec2(tileRect), glm::ivec2(triangle.bounds)), glm::min(glm::ivec2(tileRect.z, tileRect.w), glm::ivec2(triangle.bounds.z, triangle.bounds.w)));
+    if (rect.x >= rect.z || rect.y >= rect.w)
+    {
+        return;
+    }
+
+    auto& state = m_states[triangle.state];
+    auto& points = triangle.points;
+
+    // Edge i is opposite vertex i, and is positive inside.
+    // At the first pixel center, exactly in 64 bits; then edges which are entirely in or out over this rect are
+    // resolved, so what's left is small enough to step in 32 bits
+    int64_t px = int64_t(rect.x) * SubPixels + SubPixels / 2;
+    int64_t py = int64_t(rect.y) * SubPixels + SubPixels / 2;
+    int64_t exact[3];
+    int32_t edge[3];
+    int32_t stepX[3];
+    int32_t stepY[3];
+    for (int i = 0; i < 3; i++)
+    {
+        auto& a = points[(i + 1) % 3];
+        auto& b = points[(i + 2) % 3];
+        int64_t dx = b.x - a.x;
+        int64_t dy = b.y - a.y;
+        exact[i] = dx * (py - a.y) - dy * (px - a.x);
+
+        // Top-left rule; pixels exactly on other edges are left to the neighbouring triangle
+        bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+        int64_t value = exact[i] - (topLeft ? 0 : 1);
+        int64_t sx = -dy * SubPixels;
+        int64_t sy = dx * SubPixels;
+        int64_t reach = std::abs(sx) * (rect.z - rect.x) + std::abs(sy) * (rect.w - rect.y);
+        if (value + reach < 0)
+        {
+            return;
+        }
+        if (value - reach >= 0)
+        {
+            value = 0;
+            sx = 0;
+            sy = 0;
+        }
+        edge[i] = int32_t(value);
+        stepX[i] = int32_t(sx);
+        stepY[i] = int32_t(sy);
+    }
+
+    // Screen space barycentrics, for depth and 1/w; the attributes use perspective correct ones
+    double invArea = 1.0 / double(triangle.area);
+    QuadSetup setup;
+    float l1Row = float(exact[1] * invArea);
+    float l2Row = float(exact[2] * invArea);
+    float l1StepY = float((points[0].x - points[2].x) * SubPixels * invArea);
+    float l2StepY = float((points[1].x - points[0].x) * SubPixels * invArea);
+    setup.l1Step = float((points[2].y - points[0].y) * SubPixels * invArea);
+    setup.l2Step = float((points[0].y - points[1].y) * SubPixels * invArea);
+    setup.z0 = triangle.z[0];
+    setup.dz1 = triangle.z[1] - triangle.z[0];
+    setup.dz2 = triangle.z[2] - triangle.z[0];
+    setup.w0 = triangle.invW[0];
+    setup.dw1 = triangle.invW[1] - triangle.invW[0];
+    setup.dw2 = triangle.invW[2] - triangle.invW[0];
+    setup.invW1 = triangle.invW[1];
+    setup.invW2 = triangle.invW[2];
+
+    auto& tables = GetTables();
+    const RasterTexture::Level* pLevel = nullptr;
+    const float* pTexelTable = tables.unit;
+    if (state.pTexture && !state.pTexture->levels.empty() && !state.pTexture->levels[0].texels.empty())
+    {
+        pLevel = &state.pTexture->levels[std::min(triangle.level, uint32_t(state.pTexture->levels.size() - 1))];
+        pTexelTable = state.pTexture->srgb ? tables.linear : tables.unit;
+    }
+
+    bool depthTest = (state.flags & RasterFlags::DepthTest) != 0;
+    bool depthWrite = (state.flags & RasterFlags::DepthWrite) != 0;
+    bool blend = (state.flags & RasterFlags::Blend) != 0;
+    bool gamma = (state.flags & RasterFlags::GammaOutput) != 0;
+    bool distanceField = pLevel && (state.flags & RasterFlags::DistanceField);
+
+    Quad quad;
+    for (int y = rect.y; y < rect.w; y++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            setup.edge[i] = edge[i];
+            setup.edgeStep[i] = stepX[i];
+        }
+        setup.l1 = l1Row;
+        setup.l2 = l2Row;
+
+        auto pColor = &m_color[y * m_size.x];
+        auto pDepth = &m_depth[y * m_size.x];
+        for (int x = rect.x; x < rect.z; x += 4)
+        {
+            auto lanes = std::min(4, rect.z - x);
+            EvaluateQuad(setup, (1u << lanes) - 1, pDepth + x, depthTest, quad);
+
+            if (quad.mask != 0)
+            {
+                // Relative to vertex 0, so flat attributes stay exact
+                auto attributes = [&](int lane, glm::vec2& uv, glm::vec4& color)
+                {
+                    float b1 = quad.b1[lane];
+                    float b2 = quad.b2[lane];
+                    uv = triangle.tex[0] + (triangle.tex[1] - triangle.tex[0]) * b1 + (triangle.tex[2] - triangle.tex[0]) * b2;
+                    color = triangle.color[0] + (triangle.color[1] - triangle.color[0]) * b1 + (triangle.color[2] - triangle.color[0]) * b2;
+                };
+
+                // The distance field is antialiased over its rate of change, from the neighbouring lanes
+                float distances[4];
+                if (distanceField)
+                {
+                    // Lanes outside the triangle are extrapolated
+                    auto full = quad;
+                    EvaluateQuad(setup, 0xf, pDepth + x, false, full);
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        float b1 = full.b1[lane];
+                        float b2 = full.b2[lane];
+                        auto uv = triangle.tex[0] + (triangle.tex[1] - triangle.tex[0]) * b1 + (triangle.tex[2] - triangle.tex[0]) * b2;
+                        distances[lane] = Sample(*pLevel, uv, pTexelTable).w;
+                    }
+                }
+
+                for (int lane = 0; lane < lanes; lane++)
+                {
+                    if (!(quad.mask & (1 << lane)))
+                    {
+                        continue;
+                    }
+
+                    glm::vec2 uv;
+                    glm::vec4 color;
+                    attributes(lane, uv, color);
+
+                    if (distanceField)
+                    {
+                        float change = std::abs(lane < 3 ? distances[lane + 1] - distances[lane] : distances[lane] - distances[lane - 1]);
+                        float width = std::max(change * 2.0f * .7f, .001f);
+                        float t = glm::clamp((distances[lane] - (.5f - width)) / (2.0f * width), 0.0f, 1.0f);
+                        color.w *= t * t * (3.0f - 2.0f * t);
+                    }
+                    else if (pLevel)
+                    {
+                        color *= Sample(*pLevel, uv, pTexelTable);
+                    }
+
+                    if (color.w <= 0.0f)
+                    {
+                        continue;
+                    }
+
+                    if (gamma)
+                    {
+                        color = glm::vec4(Gamma(tables, color.x), Gamma(tables, color.y), Gamma(tables, color.z), color.w);
+                    }
+
+                    auto& target = pColor[x + lane];
+                    if (blend)
+                    {
+                        auto dest = glm::vec4(target) / 255.0f;
+                        color = color * color.w + dest * (1.0f - color.w);
+                    }
+                    target = glm::u8vec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + .5f);
+
+                    if (depthWrite)
+                    {
+                        pDepth[x + lane] = quad.z[lane];
+                    }
+                }
+            }
+
+            for (int i = 0; i < 3; i++)
+            {
+                setup.edge[i] += stepX[i] * 4;
+            }
+            setup.l1 += setup.l1Step * 4;
+            setup.l2 += setup.l2Step * 4;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            edge[i] += stepY[i];
+        }
+        l1Row += l1StepY;
+        l2Row += l2StepY;
+    }
+}
+
+void Rasterizer::Flush(uint32_t threads)
+{
+    if (m_triangles.empty())
+    {
+        m_states.clear();
+        return;
+    }
+
+    Bin();
+
+    std::vector<uint32_t> tiles;
+    for (uint32_t tile = 0; tile < uint32_t(m_tileCount.x * m_tileCount.y); tile++)
+    {
+        if (m_tileStart[tile] != m_tileStart[tile + 1])
+        {
+            tiles.push_back(tile);
+        }
+    }
+
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(threads, uint32_t(tiles.size()));
+
+    // Threads take the next undrawn tile until there are none left; the flushing thread draws tiles too
+    std::atomic<uint32_t> nextTile(0);
+    auto drawTiles = [&]()
+    {
+        for (auto index = nextTile++; index < tiles.size(); index = nextTile++)
+        {
+            DrawTile(tiles[index]);
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (uint32_t thread = 1; thread < threads; thread++)
+    {
+        workers.push_back(GetWorkerPool().enqueue(drawTiles));
+    }
+    drawTiles();
+
+    for (auto& worker : workers)
+    {
+        worker.wait();
+    }
+
+    m_triangles.clear();
+    m_states.clear();
+}
+
+} // MCommon
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "primitives2d.h"
+
+namespace MCommon
+{
+
+// RGBA texels for the rasterizer, with optional mip levels
+struct RasterTexture
+{
+    struct Level
+    {
+        glm::uvec2 size = glm::uvec2(0);
+        std::vector<glm::u8vec4> texels;
+
+        Level() {}
+    };
+
+    std::vector<Level> levels;
+    bool srgb = false;      // Texels are decoded from sRGB to linear when sampled
+
+    RasterTexture() {}
+
+    // A single level, uninitialized
+    void Resize(const glm::uvec2& size);
+
+    // Box filter the first level down to 1x1
+    void BuildMips();
+};
+
+// A vertex after transform; the position is in clip space, with z from 0 to w
+struct RasterVertex
+{
+    RasterVertex() {}
+    RasterVertex(const glm::vec4& _pos, const glm::vec2& _tex, const glm::vec4& _color = glm::vec4(1.0f))
+        : position(_pos),
+        tex(_tex),
+        color(_color)
+    { }
+    glm::vec4 position;
+    glm::vec2 tex;
+    glm::vec4 color;
+};
+
+struct RasterFlags
+{
+    enum
+    {
+        DepthTest = (1 << 0),       // Pass if greater or equal to the depth buffer; Z is reversed
+        DepthWrite = (1 << 1),
+        Blend = (1 << 2),           // Source alpha, one minus source alpha
+        DistanceField = (1 << 3),   // Coverage from the texture alpha, a distance field with the edge at 0.5
+        GammaOutput = (1 << 4)      // Write pow(color, 1/2.2), as the shaders do
+    };
+};
+
+struct RasterState
+{
+    const RasterTexture* pTexture = nullptr;    // Samples white if not set
+    uint32_t flags = RasterFlags::DepthTest | RasterFlags::DepthWrite | RasterFlags::Blend | RasterFlags::GammaOutput;
+    glm::ivec4 scissor = glm::ivec4(0, 0, std::numeric_limits<int>::max(), std::numeric_limits<int>::max()); // Left, top, right, bottom (exclusive)
+
+    RasterState() {}
+};
+
+// A software rasterizer for triangles, into a color and depth buffer.
+// Triangles are clipped and set up as they are drawn, and rasterized at the flush:
+// they are binned into screen tiles with a counting sort, so each tile keeps the drawing order, and the
+// tiles are shared out over the cores. Coverage uses fixed point half-space edge functions with the top-left
+// rule, and the edges, depth and interpolation are stepped 4 pixels at a time.
+// Pixels are depth tested, perspective correct textured with a bilinear filter, and blended.
+// Textures must stay valid and unchanged until the flush
+class Rasterizer
+{
+public:
+    explicit Rasterizer(int tileSize = 64);
+
+    // Up to 8192 pixels each way
+    void Resize(const glm::uvec2& size);
+    const glm::uvec2& GetSize() const { return m_size; }
+
+    // Flush any queued triangles, then fill
+    void ClearColor(const glm::u8vec4& color);
+    void ClearDepth(float depth);
+
+    // A triangle list; each 3 indices are one triangle
+    void DrawTriangles(const RasterVertex* pVertices, const uint32_t* pIndices, uint32_t numIndices, const RasterState& state);
+
+    // Rasterize the queued triangles.
+    // threads = 0 uses all the cores
+    void Flush(uint32_t threads = 0);
+
+    // RGBA rows, top down
+    const std::vector<glm::u8vec4>& GetColor() const { return m_color; }
+    const std::vector<float>& GetDepth() const { return m_depth; }
+    Bitmap GetBitmap();
+
+    // Triangles waiting for the flush, after clipping
+    uint32_t GetNumQueued() const { return uint32_t(m_triangles.size()); }
+
+private:
+    struct Triangle
+    {
+        glm::ivec2 points[3];   // Fixed point, with SubPixelBits of fraction
+        glm::ivec4 bounds;      // Pixels covered; left, top, right, bottom (exclusive)
+        int64_t area;           // Twice the area, in fixed point
+        float z[3];
+        float invW[3];
+        glm::vec2 tex[3];
+        glm::vec4 color[3];
+        uint32_t state;
+        uint32_t level;         // Mip level
+    };
+
+    void ClipAndSetup(const RasterVertex* pVertices[3], uint32_t state);
+    void Setup(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, uint32_t state);
+    void Bin();
+    void DrawTile(uint32_t tile);
+    void DrawTriangle(const Triangle& triangle, const glm::ivec4& rect);
+
+private:
+    int m_tileSize;
+    glm::uvec2 m_size = glm::uvec2(0);
+    std::vector<glm::u8vec4> m_color;
+    std::vector<float> m_depth;
+
+    std::vector<RasterState> m_states;
+    std::vector<Triangle> m_triangles;
+
+    // Triangle indices, sorted by tile with a counting sort
+    glm::ivec2 m_tileCount = glm::ivec2(0);
+    std::vector<uint32_t> m_tileStart;
+    std::vector<uint32_t> m_tileTriangles;
+};
+
+} // MCommon
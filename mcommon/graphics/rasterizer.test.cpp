@@ -0,0 +1,211 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include <random>
+#include "graphics/rasterizer.h"
+
+using namespace MCommon;
+
+namespace
+{
+
+const glm::uvec2 Size(131, 97);
+
+// A vertex at a pixel position, with w = 1
+RasterVertex PixelVertex(const glm::vec2& pixel, float z = .5f, const glm::vec4& color = glm::vec4(1.0f), const glm::vec2& tex = glm::vec2(0.0f))
+{
+    auto ndc = glm::vec2(pixel.x / Size.x * 2.0f - 1.0f, 1.0f - pixel.y / Size.y * 2.0f);
+    return RasterVertex(glm::vec4(ndc, z, 1.0f), tex, color);
+}
+
+RasterState PlainState(uint32_t flags)
+{
+    RasterState state;
+    state.flags = flags;
+    return state;
+}
+
+}
+
+// A fan of triangles around a point, drawn half transparent; a pixel drawn twice would be brighter
+TEST(Rasterizer, SharedEdgesDrawOnce)
+{
+    Rasterizer raster(16);
+    raster.Resize(Size);
+    raster.ClearColor(glm::u8vec4(0, 0, 0, 255));
+
+    std::vector<RasterVertex> vertices;
+    std::vector<uint32_t> indices;
+    auto center = glm::vec2(61.3f, 44.7f);
+    vertices.push_back(PixelVertex(center, .5f, glm::vec4(1.0f, 1.0f, 1.0f, .5f)));
+    const int Spokes = 37;
+    for (int spoke = 0; spoke <= Spokes; spoke++)
+    {
+        float angle = spoke * glm::two_pi<float>() / Spokes;
+        vertices.push_back(PixelVertex(center + glm::vec2(std::cos(angle), std::sin(angle)) * 200.0f, .5f, glm::vec4(1.0f, 1.0f, 1.0f, .5f)));
+        if (spoke > 0)
+        {
+            indices.push_back(0);
+            indices.push_back(spoke);
+            indices.push_back(spoke + 1);
+        }
+    }
+
+    raster.DrawTriangles(vertices.data(), indices.data(), uint32_t(indices.size()), PlainState(RasterFlags::Blend));
+    raster.Flush();
+
+    auto first = raster.GetColor()[0];
+    EXPECT_NEAR(first.x, 128, 1);
+    EXPECT_NEAR(first.w, 191, 1);
+    for (auto& pixel : raster.GetColor())
+    {
+        ASSERT_EQ(pixel, first);
+    }
+}
+
+// Reversed Z; nearer is larger, so the second triangle is hidden
+TEST(Rasterizer, DepthTest)
+{
+    Rasterizer raster;
+    raster.Resize(Size);
+    raster.ClearColor(glm::u8vec4(0));
+    raster.ClearDepth(0.0f);
+
+    uint32_t indices[] = { 0, 1, 2 };
+    RasterVertex nearVerts[] = { PixelVertex(glm::vec2(0, 0), .8f, glm::vec4(1, 0, 0, 1)), PixelVertex(glm::vec2(100, 0), .8f, glm::vec4(1, 0, 0, 1)), PixelVertex(glm::vec2(0, 90), .8f, glm::vec4(1, 0, 0, 1)) };
+    RasterVertex farVerts[] = { PixelVertex(glm::vec2(0, 0), .2f, glm::vec4(0, 1, 0, 1)), PixelVertex(glm::vec2(120, 0), .2f, glm::vec4(0, 1, 0, 1)), PixelVertex(glm::vec2(0, 96), .2f, glm::vec4(0, 1, 0, 1)) };
+
+    auto flags = RasterFlags::DepthTest | RasterFlags::DepthWrite;
+    raster.DrawTriangles(nearVerts, indices, 3, PlainState(flags));
+    raster.DrawTriangles(farVerts, indices, 3, PlainState(flags));
+    raster.Flush();
+
+    EXPECT_EQ(raster.GetColor()[5 * Size.x + 5], glm::u8vec4(255, 0, 0, 255));
+    EXPECT_FLOAT_EQ(raster.GetDepth()[5 * Size.x + 5], .8f);
+
+    // Only the far triangle reaches here
+    EXPECT_EQ(raster.GetColor()[2 * Size.x + 110], glm::u8vec4(0, 255, 0, 255));
+    EXPECT_FLOAT_EQ(raster.GetDepth()[2 * Size.x + 110], .2f);
+}
+
+// A triangle much bigger than the screen is clipped to it, and covers every pixel once
+TEST(Rasterizer, ClipsToScreen)
+{
+    Rasterizer raster;
+    raster.Resize(Size);
+    raster.ClearColor(glm::u8vec4(0));
+
+    auto color = glm::vec4(1.0f, 1.0f, 1.0f, .5f);
+    RasterVertex vertices[] = {
+        RasterVertex(glm::vec4(-1.0f, -1.0f, .5f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(3.0f, -1.0f, .5f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(-1.0f, 3.0f, .5f, 1.0f), glm::vec2(0.0f), color),
+
+        // Beyond the far plane, and half way through the near plane
+        RasterVertex(glm::vec4(-1.0f, -1.0f, -.5f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(1.0f, -1.0f, -.5f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(-1.0f, 1.0f, -.5f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(-1.0f, 1.0f, 2.0f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(1.0f, 1.0f, 2.0f, 1.0f), glm::vec2(0.0f), color),
+        RasterVertex(glm::vec4(0.0f, -1.0f, 0.0f, 1.0f), glm::vec2(0.0f), color)
+    };
+
+    uint32_t indices[] = { 0, 1, 2 };
+    raster.DrawTriangles(vertices, indices, 3, PlainState(RasterFlags::Blend));
+    raster.Flush();
+    auto first = raster.GetColor()[0];
+    EXPECT_NEAR(first.x, 128, 1);
+    EXPECT_NEAR(first.w, 64, 1);
+    for (auto& pixel : raster.GetColor())
+    {
+        ASSERT_EQ(pixel, first);
+    }
+
+    uint32_t behind[] = { 3, 4, 5 };
+    raster.DrawTriangles(vertices, behind, 3, PlainState(RasterFlags::Blend));
+    EXPECT_EQ(raster.GetNumQueued(), 0u);
+
+    // z reaches w half way up the screen; only the bottom half is drawn
+    uint32_t crossing[] = { 6, 7, 8 };
+    raster.ClearColor(glm::u8vec4(0));
+    raster.DrawTriangles(vertices, crossing, 3, PlainState(0));
+    raster.Flush();
+    EXPECT_EQ(raster.GetColor()[(Size.y / 4) * Size.x + Size.x / 2], glm::u8vec4(0));
+    EXPECT_NE(raster.GetColor()[(Size.y * 3 / 4) * Size.x + Size.x / 2], glm::u8vec4(0));
+}
+
+// Halfway along a textured quad in perspective is not halfway across the screen
+TEST(Rasterizer, PerspectiveTexture)
+{
+    RasterTexture texture;
+    texture.Resize(glm::uvec2(64, 1));
+    for (uint32_t x = 0; x < 64; x++)
+    {
+        texture.levels[0].texels[x] = glm::u8vec4(x < 32 ? 255 : 0, 0, 0, 255);
+    }
+
+    Rasterizer raster;
+    raster.Resize(Size);
+    raster.ClearColor(glm::u8vec4(0));
+
+    // The right hand side is 3 times further away
+    RasterVertex vertices[] = {
+        RasterVertex(glm::vec4(-1.0f, -1.0f, .5f, 1.0f), glm::vec2(0.0f, 0.0f)),
+        RasterVertex(glm::vec4(3.0f, -3.0f, 1.5f, 3.0f), glm::vec2(1.0f, 0.0f)),
+        RasterVertex(glm::vec4(-1.0f, 1.0f, .5f, 1.0f), glm::vec2(0.0f, 1.0f)),
+        RasterVertex(glm::vec4(3.0f, 3.0f, 1.5f, 3.0f), glm::vec2(1.0f, 1.0f))
+    };
+    uint32_t indices[] = { 0, 1, 2, 2, 1, 3 };
+
+    RasterState state;
+    state.pTexture = &texture;
+    state.flags = 0;
+    raster.DrawTriangles(vertices, indices, 6, state);
+    raster.Flush();
+
+    // u/w and 1/w are linear on screen, so u = 0.5 is 3/4 of the way across
+    auto row = &raster.GetColor()[(Size.y / 2) * Size.x];
+    auto edge = std::find_if(row, row + Size.x, [](const glm::u8vec4& pixel) { return pixel.x < 128; }) - row;
+    EXPECT_NEAR(float(edge), Size.x * .75f, 1.5f);
+}
+
+// The tiles are independent, so any number of threads gives the same image
+TEST(Rasterizer, ThreadsMatch)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> coord(-30.0f, 160.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<RasterVertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t index = 0; index < 3000; index++)
+    {
+        vertices.push_back(PixelVertex(glm::vec2(coord(random), coord(random)), unit(random), glm::vec4(unit(random), unit(random), unit(random), unit(random))));
+        indices.push_back(index);
+    }
+
+    std::vector<glm::u8vec4> results[2];
+    for (int run = 0; run < 2; run++)
+    {
+        Rasterizer raster(32);
+        raster.Resize(Size);
+        raster.ClearColor(glm::u8vec4(0));
+        raster.ClearDepth(0.0f);
+        raster.DrawTriangles(vertices.data(), indices.data(), uint32_t(indices.size()), RasterState());
+        raster.Flush(run == 0 ? 1 : 0);
+        results[run] = raster.GetColor();
+    }
+    EXPECT_TRUE(results[0] == results[1]);
+}
+
+TEST(Rasterizer, Mips)
+{
+    RasterTexture texture;
+    texture.Resize(glm::uvec2(8, 4));
+    std::fill(texture.levels[0].texels.begin(), texture.levels[0].texels.end(), glm::u8vec4(200, 100, 50, 255));
+    texture.BuildMips();
+
+    ASSERT_EQ(texture.levels.size(), 4u);
+    EXPECT_EQ(texture.levels[1].size, glm::uvec2(4, 2));
+    EXPECT_EQ(texture.levels[3].size, glm::uvec2(1, 1));
+    EXPECT_EQ(texture.levels[3].texels[0], glm::u8vec4(200, 100, 50, 255));
+}
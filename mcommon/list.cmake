@@ -12,6 +12,9 @@ mcommon/ui/ui_manager.h
 mcommon/animation/timer.cpp
 mcommon/animation/timer.h
 
+mcommon/profile/profiler.cpp
+mcommon/profile/profiler.h
+
 mcommon/file/fileutils.cpp
 mcommon/file/fileutils.h
 mcommon/file/media_manager.cpp
@@ -32,9 +35,27 @@ mcommon/string/murmur_hash.h
 
 mcommon/graphics/primitives2d.cpp
 mcommon/graphics/primitives2d.h
+mcommon/graphics/commandlist2d.cpp
+mcommon/graphics/commandlist2d.h
+mcommon/graphics/composite2d.cpp
+mcommon/graphics/composite2d.h
+mcommon/graphics/imageops.cpp
+mcommon/graphics/imageops.h
+mcommon/graphics/fontatlas.cpp
+mcommon/graphics/fontatlas.h
+mcommon/graphics/blockdecode.cpp
+mcommon/graphics/blockdecode.h
+mcommon/graphics/blockencode.cpp
+mcommon/graphics/blockencode.h
+mcommon/graphics/rasterizer.cpp
+mcommon/graphics/rasterizer.h
+mcommon/graphics/imagecompare.cpp
+mcommon/graphics/imagecompare.h
 
 mcommon/mcommon.h
 mcommon/mcommon.cpp
+mcommon/threadutils.h
+mcommon/threadutils.cpp
 
 )
 set(MCOMMON_ROOT ${CMAKE_CURRENT_LIST_DIR} CACHE STRING "" FORCE)
@@ -0,0 +1,424 @@
+#include "mcommon.h"
+#include "profiler.h"
+#include "json/src/json.hpp"
+
+#include <chrono>
+
+using namespace nlohmann;
+
+namespace MCommon
+{
+
+const uint32_t Profiler::ZonesPerThread;
+const uint32_t Profiler::MaxDepth;
+const uint32_t Profiler::MaxFrames;
+
+struct ProfileRing
+{
+    uint32_t id = 0;
+    std::string name;                           // Guarded by the profiler's mutex
+    std::vector<ProfileZone> zones;
+    std::atomic<uint64_t> written;              // Zones ever written; the newest ZonesPerThread are kept
+    std::atomic<uint64_t> cleared;              // Zones before this were cleared
+
+    // Only touched by the thread which owns the ring
+    ProfileZone stack[Profiler::MaxDepth];
+    uint32_t depth = 0;
+
+    ProfileRing()
+        : zones(Profiler::ZonesPerThread),
+        written(0),
+        cleared(0)
+    {
+    }
+};
+
+// Hands the ring back when the thread exits
+struct ProfileThreadRing
+{
+    ProfileRing* pRing = nullptr;
+
+    ~ProfileThreadRing()
+    {
+        if (pRing)
+        {
+            Profiler::Instance().ReleaseRing(pRing);
+        }
+    }
+};
+
+namespace
+{
+thread_local ProfileThreadRing ThreadRing;
+}
+
+Profiler& Profiler::Instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : m_enabled(true)
+{
+}
+
+int64_t Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProfileRing* Profiler::GetRing()
+{
+    if (ThreadRing.pRing)
+    {
+        return ThreadRing.pRing;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_freeRings.empty())
+    {
+        ThreadRing.pRing = m_freeRings.back();
+        m_freeRings.pop_back();
+    }
+    else
+    {
+        auto spRing = std::make_shared<ProfileRing>();
+        spRing->id = uint32_t(m_rings.size() + 1);
+        m_rings.push_back(spRing);
+        ThreadRing.pRing = spRing.get();
+    }
+    return ThreadRing.pRing;
+}
+
+void Profiler::ReleaseRing(ProfileRing* pRing)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pRing->depth = 0;
+    pRing->name.clear();
+    m_freeRings.push_back(pRing);
+}
+
+void Profiler::BeginZone(const char* pName)
+{
+    auto pRing = GetRing();
+    auto depth = pRing->depth++;
+    if (depth >= MaxDepth)
+    {
+        return;
+    }
+
+    // A zone begun while disabled isn't recorded, even if the profiler is enabled before it ends
+    auto& zone = pRing->stack[depth];
+    zone.pName = m_enabled ? pName : nullptr;
+    zone.start = zone.pName ? Now() : 0;
+    zone.depth = depth;
+}
+
+void Profiler::EndZone()
+{
+    auto pRing = GetRing();
+    if (pRing->depth == 0)
+    {
+        return;
+    }
+
+    auto depth = --pRing->depth;
+    if (depth >= MaxDepth || pRing->stack[depth].pName == nullptr)
+    {
+        return;
+    }
+
+    auto& zone = pRing->stack[depth];
+    zone.end = Now();
+
+    auto index = pRing->written.load(std::memory_order_relaxed);
+    pRing->zones[index % ZonesPerThread] = zone;
+    pRing->written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::NewFrame()
+{
+    auto now = Now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_frames.size() < MaxFrames)
+    {
+        m_frames.push_back(now);
+    }
+    else
+    {
+        m_frames[m_nextFrame] = now;
+    }
+    m_nextFrame = (m_nextFrame + 1) % MaxFrames;
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    auto pRing = GetRing();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pRing->name = name;
+}
+
+std::vector<ProfileThread> Profiler::Collect(int64_t begin, int64_t end) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<ProfileThread> threads;
+    for (auto& spRing : m_rings)
+    {
+        auto oldest = [&](uint64_t written)
+        {
+            return std::max(spRing->cleared.load(), written > ZonesPerThread ? written - ZonesPerThread : 0);
+        };
+
+        auto written = spRing->written.load(std::memory_order_acquire);
+        std::vector<ProfileZone> zones;
+        for (auto index = oldest(written); index < written; index++)
+        {
+            zones.push_back(spRing->zones[index % ZonesPerThread]);
+        }
+
+        // The owner may have written over the oldest zones while they were copied, and may be writing the slot after
+        // the last one it published; those are dropped, so a torn zone is never returned
+        auto skip = std::min(uint64_t(zones.size()), oldest(spRing->written.load(std::memory_order_acquire) + 1) - oldest(written));
+
+        ProfileThread thread;
+        thread.id = spRing->id;
+        thread.name = spRing->name;
+        for (auto itr = zones.begin() + size_t(skip); itr != zones.end(); itr++)
+        {
+            if (itr->end > begin && itr->start < end)
+            {
+                thread.zones.push_back(*itr);
+            }
+        }
+
+        if (!thread.zones.empty())
+        {
+            threads.push_back(thread);
+        }
+    }
+    return threads;
+}
+
+std::vector<int64_t> Profiler::GetFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<int64_t> frames;
+    if (m_frames.size() < MaxFrames)
+    {
+        frames = m_frames;
+    }
+    else
+    {
+        frames.insert(frames.end(), m_frames.begin() + m_nextFrame, m_frames.end());
+        frames.insert(frames.end(), m_frames.begin(), m_frames.begin() + m_nextFrame);
+    }
+    return frames;
+}
+
+void Profiler::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& spRing : m_rings)
+    {
+        spRing->cleared = spRing->written.load(std::memory_order_acquire);
+    }
+    m_frames.clear();
+    m_nextFrame = 0;
+}
+
+std::string Profiler::ExportChromeTrace() const
+{
+    auto threads = Collect();
+    auto frames = GetFrames();
+
+    int64_t epoch = std::numeric_limits<int64_t>::max();
+    for (auto& thread : threads)
+    {
+        for (auto& zone : thread.zones)
+        {
+            epoch = std::min(epoch, zone.start);
+        }
+    }
+    for (auto frame : frames)
+    {
+        epoch = std::min(epoch, frame);
+    }
+
+    auto toMicroseconds = [&](int64_t time) { return double(time - epoch) / 1000.0; };
+
+    json events = json::array();
+    for (auto& thread : threads)
+    {
+        json threadName;
+        threadName["name"] = "thread_name";
+        threadName["ph"] = "M";
+        threadName["pid"] = 1;
+        threadName["tid"] = thread.id;
+        threadName["args"]["name"] = thread.name.empty() ? "Thread " + std::to_string(thread.id) : thread.name;
+        events.push_back(threadName);
+
+        for (auto& zone : thread.zones)
+        {
+            json event;
+            event["name"] = zone.pName;
+            event["ph"] = "X";
+            event["pid"] = 1;
+            event["tid"] = thread.id;
+            event["ts"] = toMicroseconds(zone.start);
+            event["dur"] = double(zone.end - zone.start) / 1000.0;
+            events.push_back(event);
+        }
+    }
+
+    // Frame starts, as global instant events
+    for (auto frame : frames)
+    {
+        json event;
+        event["name"] = "Frame";
+        event["ph"] = "i";
+        event["s"] = "g";
+        event["pid"] = 1;
+        event["tid"] = 0;
+        event["ts"] = toMicroseconds(frame);
+        events.push_back(event);
+    }
+
+    json trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ns";
+    return trace.dump();
+}
+
+bool Profiler::SaveChromeTrace(const fs::path& path) const
+{
+    auto trace = ExportChromeTrace();
+    return FileUtils::WriteFile(path, trace.c_str(), trace.size());
+}
+
+void ShowProfilerWindow(bool* pOpen)
+{
+    // The view is kept while paused, because the rings move on
+    static bool paused = false;
+    static int viewFrames = 3;
+    static std::vector<ProfileThread> threads;
+    static std::vector<int64_t> frames;
+    static int64_t viewBegin = 0;
+    static int64_t viewEnd = 0;
+
+    ImGui::SetNextWindowSize(ImVec2(900, 300), ImGuiSetCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", pOpen))
+    {
+        ImGui::End();
+        return;
+    }
+
+    auto& profiler = Profiler::Instance();
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    ImGui::PushItemWidth(150.0f);
+    ImGui::SliderInt("Frames", &viewFrames, 1, 16);
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("Save Trace"))
+    {
+        fs::path tracePath = fs::absolute("trace.json");
+        if (profiler.SaveChromeTrace(tracePath))
+        {
+            UIManager::Instance().AddMessage(MessageType::Info, "Saved profile trace: " + tracePath.string());
+        }
+    }
+
+    // The frame in progress hasn't finished, so the view ends where it began
+    if (!paused)
+    {
+        frames = profiler.GetFrames();
+        if (frames.size() >= 2)
+        {
+            viewEnd = frames.back();
+            viewBegin = frames[frames.size() - 1 - std::min(size_t(viewFrames), frames.size() - 1)];
+            threads = profiler.Collect(viewBegin, viewEnd);
+        }
+    }
+
+    if (threads.empty() || viewEnd <= viewBegin)
+    {
+        ImGui::Text("No frames recorded");
+        ImGui::End();
+        return;
+    }
+
+    ImGui::SameLine();
+    ImGui::Text("%.3f ms", (viewEnd - viewBegin) / 1000000.0);
+
+    auto pDrawList = ImGui::GetWindowDrawList();
+    auto width = std::max(ImGui::GetContentRegionAvailWidth(), 1.0f);
+    auto rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    auto scale = double(width) / double(viewEnd - viewBegin);
+    auto toX = [&](float left, int64_t time)
+    {
+        return left + float(double(glm::clamp(time, viewBegin, viewEnd) - viewBegin) * scale);
+    };
+
+    for (auto& thread : threads)
+    {
+        if (thread.name.empty())
+        {
+            ImGui::Text("Thread %u", thread.id);
+        }
+        else
+        {
+            ImGui::Text("%s", thread.name.c_str());
+        }
+
+        uint32_t depth = 0;
+        for (auto& zone : thread.zones)
+        {
+            depth = std::max(depth, zone.depth + 1);
+        }
+
+        auto origin = ImGui::GetCursorScreenPos();
+        auto laneMax = ImVec2(origin.x + width, origin.y + depth * rowHeight);
+        ImGui::PushClipRect(origin, laneMax, true);
+
+        for (auto frame : frames)
+        {
+            if (frame > viewBegin && frame < viewEnd)
+            {
+                auto x = toX(origin.x, frame);
+                pDrawList->AddLine(ImVec2(x, origin.y), ImVec2(x, laneMax.y), ImColor(255, 255, 255, 64));
+            }
+        }
+
+        for (auto& zone : thread.zones)
+        {
+            auto zoneMin = ImVec2(toX(origin.x, zone.start), origin.y + zone.depth * rowHeight);
+            auto zoneMax = ImVec2(std::max(toX(origin.x, zone.end), zoneMin.x + 1.0f), zoneMin.y + rowHeight - 1.0f);
+
+            // Colored by name, so a zone is the same color in every frame
+            auto hue = float(std::hash<std::string>()(zone.pName) % 360) / 360.0f;
+            pDrawList->AddRectFilled(zoneMin, zoneMax, ImColor::HSV(hue, 0.5f, 0.6f));
+
+            if (zoneMax.x - zoneMin.x > ImGui::CalcTextSize(zone.pName).x)
+            {
+                pDrawList->AddText(ImVec2(zoneMin.x + 2.0f, zoneMin.y), ImColor(255, 255, 255), zone.pName);
+            }
+
+            if (ImGui::IsMouseHoveringRect(zoneMin, zoneMax))
+            {
+                ImGui::SetTooltip("%s\n%.3f ms", zone.pName, (zone.end - zone.start) / 1000000.0);
+            }
+        }
+
+        ImGui::PopClipRect();
+        ImGui::Dummy(ImVec2(width, depth * rowHeight));
+    }
+
+    ImGui::End();
+}
+
+} // MCommon
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace MCommon
+{
+
+// A zone of time on a thread; times are in nanoseconds, from Profiler::Now
+struct ProfileZone
+{
+    const char* pName = nullptr;
+    int64_t start = 0;
+    int64_t end = 0;
+    uint32_t depth = 0;         // Number of zones it is inside, on its thread
+};
+
+struct ProfileThread
+{
+    uint32_t id = 0;
+    std::string name;
+    std::vector<ProfileZone> zones;     // In the order they ended
+};
+
+struct ProfileRing;
+
+// A hierarchical CPU profiler.
+// Each thread records its zones into its own ring, so recording takes no locks; when a ring is full the oldest zones
+// are overwritten. Rings of threads that have exited are reused by new ones, so short lived threads share a timeline lane.
+// Zone names aren't copied, so they must outlive the profiler; use string literals
+class Profiler
+{
+public:
+    static Profiler& Instance();
+
+    // Steady clock nanoseconds
+    static int64_t Now();
+
+    void SetEnabled(bool enabled) { m_enabled = enabled; }
+    bool IsEnabled() const { return m_enabled; }
+
+    // Zones nest, and end in the reverse order they begin; ProfileScope pairs them
+    void BeginZone(const char* pName);
+    void EndZone();
+
+    // Called at the start of each frame; the timeline shows whole frames
+    void NewFrame();
+
+    // The name of the calling thread's lane
+    void SetThreadName(const std::string& name);
+
+    // The recorded zones which overlap [begin, end), for every thread that has any
+    std::vector<ProfileThread> Collect(int64_t begin = 0, int64_t end = std::numeric_limits<int64_t>::max()) const;
+
+    // Start times of the recent frames, oldest first
+    std::vector<int64_t> GetFrames() const;
+
+    // Forget everything recorded so far
+    void Clear();
+
+    // Chrome trace event JSON, which Perfetto also reads; times are in microseconds from the first zone
+    std::string ExportChromeTrace() const;
+    bool SaveChromeTrace(const fs::path& path) const;
+
+    static const uint32_t ZonesPerThread = 16384;
+    static const uint32_t MaxDepth = 32;        // Deeper zones are timed by nothing
+    static const uint32_t MaxFrames = 256;
+
+private:
+    Profiler();
+    ProfileRing* GetRing();
+    void ReleaseRing(ProfileRing* pRing);
+    friend struct ProfileThreadRing;
+
+private:
+    std::atomic<bool> m_enabled;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<ProfileRing>> m_rings;
+    std::vector<ProfileRing*> m_freeRings;
+    std::vector<int64_t> m_frames;
+    uint32_t m_nextFrame = 0;
+};
+
+// Records a zone for the life of the scope
+class ProfileScope
+{
+public:
+    ProfileScope(const char* pName)
+    {
+        Profiler::Instance().BeginZone(pName);
+    }
+    ~ProfileScope()
+    {
+        Profiler::Instance().EndZone();
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) MCommon::ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+
+// A window with a lane for each thread, showing the zones of the last few frames; hover a zone for its time.
+// The view can be paused, and saved as a Chrome trace
+void ShowProfilerWindow(bool* pOpen);
+
+} // MCommon
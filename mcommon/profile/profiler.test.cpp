@@ -0,0 +1,142 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "profile/profiler.h"
+#include "json/src/json.hpp"
+
+using namespace MCommon;
+
+namespace
+{
+
+const ProfileThread* FindThread(const std::vector<ProfileThread>& threads, const std::string& name)
+{
+    for (auto& thread : threads)
+    {
+        if (thread.name == name)
+        {
+            return &thread;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+TEST(Profiler, Nesting)
+{
+    auto& profiler = Profiler::Instance();
+    profiler.Clear();
+    profiler.SetThreadName("Test");
+    {
+        PROFILE_SCOPE("Outer");
+        {
+            PROFILE_SCOPE("Inner");
+        }
+    }
+
+    auto threads = profiler.Collect();
+    auto pThread = FindThread(threads, "Test");
+    ASSERT_NE(pThread, nullptr);
+    ASSERT_EQ(pThread->zones.size(), 2u);
+
+    // Inner ends first
+    auto& inner = pThread->zones[0];
+    auto& outer = pThread->zones[1];
+    EXPECT_STREQ(inner.pName, "Inner");
+    EXPECT_EQ(inner.depth, 1u);
+    EXPECT_EQ(outer.depth, 0u);
+    EXPECT_LE(outer.start, inner.start);
+    EXPECT_GE(outer.end, inner.end);
+}
+
+TEST(Profiler, Disabled)
+{
+    auto& profiler = Profiler::Instance();
+    profiler.Clear();
+    profiler.SetEnabled(false);
+    {
+        PROFILE_SCOPE("Skipped");
+        profiler.SetEnabled(true);
+    }
+    {
+        PROFILE_SCOPE("Recorded");
+    }
+
+    auto threads = profiler.Collect();
+    ASSERT_EQ(threads.size(), 1u);
+    ASSERT_EQ(threads[0].zones.size(), 1u);
+    EXPECT_STREQ(threads[0].zones[0].pName, "Recorded");
+}
+
+// Only the newest zones are kept; the slot the next zone goes in isn't read, as it may be being written
+TEST(Profiler, Ring)
+{
+    auto& profiler = Profiler::Instance();
+    profiler.Clear();
+    for (uint32_t i = 0; i < Profiler::ZonesPerThread + 10; i++)
+    {
+        profiler.BeginZone(i < 10 ? "Old" : "New");
+        profiler.EndZone();
+    }
+
+    auto threads = profiler.Collect();
+    ASSERT_EQ(threads.size(), 1u);
+    EXPECT_EQ(threads[0].zones.size(), size_t(Profiler::ZonesPerThread - 1));
+    EXPECT_STREQ(threads[0].zones[0].pName, "New");
+}
+
+TEST(Profiler, Threads)
+{
+    auto& profiler = Profiler::Instance();
+    profiler.Clear();
+    std::vector<ProfileThread> running;
+    std::thread worker([&]()
+    {
+        profiler.SetThreadName("Worker");
+        {
+            PROFILE_SCOPE("Work");
+        }
+        running = profiler.Collect();
+    });
+    worker.join();
+
+    auto pWorker = FindThread(running, "Worker");
+    ASSERT_NE(pWorker, nullptr);
+    ASSERT_EQ(pWorker->zones.size(), 1u);
+    EXPECT_STREQ(pWorker->zones[0].pName, "Work");
+
+    // The ring is free for another thread once the worker exits, so it loses the name
+    auto threads = profiler.Collect();
+    EXPECT_EQ(FindThread(threads, "Worker"), nullptr);
+}
+
+TEST(Profiler, ChromeTrace)
+{
+    auto& profiler = Profiler::Instance();
+    profiler.Clear();
+    profiler.SetThreadName("Test");
+    profiler.NewFrame();
+    {
+        PROFILE_SCOPE("Zone");
+    }
+
+    auto trace = nlohmann::json::parse(profiler.ExportChromeTrace());
+    uint32_t complete = 0;
+    bool named = false;
+    for (auto& event : trace["traceEvents"])
+    {
+        if (event["ph"] == "X")
+        {
+            EXPECT_EQ(event["name"], "Zone");
+            EXPECT_GE(event["ts"].get<double>(), 0.0);
+            complete++;
+        }
+        else if (event["ph"] == "M" && event["args"]["name"] == "Test")
+        {
+            named = true;
+        }
+    }
+    EXPECT_EQ(complete, 1u);
+    EXPECT_TRUE(named);
+    EXPECT_EQ(profiler.GetFrames().size(), 1u);
+}
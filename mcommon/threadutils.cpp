@@ -0,0 +1,56 @@
+#include "mcommon.h"
+#include "threadpool/ThreadPool.hpp"
+
+#include <atomic>
+
+ThreadPool& GetWorkerPool()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return pool;
+}
+
+ThreadPool& GetLoaderPool()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency() / 2, 2u));
+    return pool;
+}
+
+void ParallelFor(uint32_t count, uint32_t minBlock, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // A few blocks per thread, so uneven blocks balance out
+    uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    uint32_t blockSize = std::max(std::max(minBlock, 1u), (count + threads * 4 - 1) / (threads * 4));
+    uint32_t numBlocks = (count + blockSize - 1) / blockSize;
+    if (numBlocks == 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::atomic<uint32_t> nextBlock(0);
+    auto runBlocks = [&]()
+    {
+        for (auto block = nextBlock++; block < numBlocks; block = nextBlock++)
+        {
+            auto begin = block * blockSize;
+            fn(begin, std::min(begin + blockSize, count));
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (uint32_t thread = 1; thread < std::min(threads, numBlocks); thread++)
+    {
+        workers.push_back(GetWorkerPool().enqueue(runBlocks));
+    }
+    runBlocks();
+
+    for (auto& worker : workers)
+    {
+        worker.wait();
+    }
+}
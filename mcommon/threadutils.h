@@ -3,6 +3,7 @@
 #include <thread>
 #include <future>
 #include <chrono>
+#include <functional>
 
 template<typename R>
 bool is_future_ready(std::future<R> const& f)
@@ -10,3 +11,16 @@ bool is_future_ready(std::future<R> const& f)
     return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; 
 }
 
+
+class ThreadPool;
+
+// Worker threads shared by the parallel loops, one less than the number of cores
+ThreadPool& GetWorkerPool();
+
+// Threads for reading and decoding files in the background.
+// Kept apart from the workers, so a long load never holds up a parallel loop
+ThreadPool& GetLoaderPool();
+
+// Split [0, count) into blocks of at least minBlock items, and call fn(begin, end) for each block across the cores.
+// The calling thread does a share of the work, and the call returns when every block is done
+void ParallelFor(uint32_t count, uint32_t minBlock, const std::function<void(uint32_t, uint32_t)>& fn);
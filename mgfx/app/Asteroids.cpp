@@ -3,14 +3,20 @@
 #include "graphics3d/device/IDevice.h"
 #include "file/media_manager.h"
 #include "animation/timer.h"
+#include "mcommon/string/murmur_hash.h"
 
 #include "stb/stb_image.h"
 #include "json/src/json.hpp"
 
 #include "Asteroids.h"
+#include "mgfx_settings.h"
+#include "profile/profiler.h"
 #include <graphics3d/camera/camera.h>
+#include <graphics2d/text/textbatch.h>
 
 #include <glm/gtx/vector_angle.hpp>
+#include <chrono>
+#include <fstream>
 
 // This is a simple demo of showing sprites on the screen from a loaded sprite map
 // A simple physical simulation manages the velocities of objects and their collisions
@@ -26,6 +32,12 @@ namespace
 const float MaxAcceleration = 1000.0f;
 const float MaxVelocity = 1000.0f;
 
+// Longest frame we try to catch up on
+const float MaxFrameTime = 0.25f;
+
+// Movements bigger than this in a step are teleports, such as wrapping at the border
+const float MaxInterpolationDistance = 100.0f;
+
 struct ShooterWindowData : public BaseWindowData
 {
     ShooterWindowData(Mgfx::Window* pWindow)
@@ -42,12 +54,16 @@ struct ShooterWindowData : public BaseWindowData
     virtual void Free() override
     {
         m_pWindow->GetDevice()->DestroyTexture(textureQuad);
+        spText.reset();
         BaseWindowData::Free();
     }
 
     // Sprite texture
     uint32_t textureQuad = 0;
     glm::uvec2 textureSize;
+
+    // Score text
+    std::shared_ptr<TextBatch> spText;
 };
 
 struct Properties
@@ -62,9 +78,76 @@ struct Properties
 
     float BoulderSpeedRange = 80.0f;
     float BoulderMinSpeed = 10.0f;
+
+    bool Interpolate = true;
+    int MaxSubSteps = 8;
 };
 
 Properties properties;
+
+// Atlas rectangle in texels, inset by half a texel so we don't sample the neighbours
+glm::vec4 SpriteRect(const glm::ivec2& coords, const glm::ivec2& size)
+{
+    return glm::vec4(coords.x, coords.y, coords.x + size.x, coords.y + size.y) + glm::vec4(.5f, .5f, -.5f, -.5f);
+}
+
+bool IsBoulder(EntityType type)
+{
+    return type == EntityType::BigBoulder ||
+        type == EntityType::MediumBoulder ||
+        type == EntityType::SmallBoulder;
+}
+
+const char* RecordingFile = "asteroids.rec";
+const uint32_t RecordingMagic = 0x43455241; // 'AREC'
+const uint32_t RecordingVersion = 1;
+
+template<typename T>
+uint64_t HashVector(const std::vector<T>& data, uint64_t seed)
+{
+    return data.empty() ? seed : murmur_hash_64(data.data(), uint32_t(data.size() * sizeof(T)), seed);
+}
+}
+
+const float Asteroids::StepTime = 0.02f;
+
+// The distributions in <random> differ between standard libraries, so the values are built directly
+// from the generator output, to keep recordings portable
+float Asteroids::Random(float min, float max)
+{
+    return min + (max - min) * (float(m_random() >> 8) * (1.0f / 16777216.0f));
+}
+
+glm::vec2 Asteroids::Random(const glm::vec2& min, const glm::vec2& max)
+{
+    auto x = Random(min.x, max.x);
+    auto y = Random(min.y, max.y);
+    return glm::vec2(x, y);
+}
+
+glm::vec3 Asteroids::Random(const glm::vec3& min, const glm::vec3& max)
+{
+    auto x = Random(min.x, max.x);
+    auto y = Random(min.y, max.y);
+    auto z = Random(min.z, max.z);
+    return glm::vec3(x, y, z);
+}
+
+// Inclusive
+int Asteroids::RandomInt(int min, int max)
+{
+    return min + int(m_random() % uint32_t(max - min + 1));
+}
+
+HashString Asteroids::RandomSprite(const std::vector<HashString>& sprites)
+{
+    return sprites[RandomInt(0, int(sprites.size()) - 1)];
+}
+
+uint32_t Asteroids::NewSeed()
+{
+    auto seed = MgfxSettings::Instance().GetSeed();
+    return seed != 0 ? seed : std::random_device()();
 }
 
 const char* Asteroids::Description() const
@@ -78,19 +161,21 @@ Keys: A,D Rotate, W Thrust, SPACE Shoot
 
 void Asteroids::CleanUp()
 {
-    m_allEntities.clear();
+    m_entities.Clear();
     m_spriteCoords.clear();
     m_bigBoulders.clear();
     m_mediumBoulders.clear();
     m_smallBoulders.clear();
     m_stars.clear();
     m_numbers.clear();
-    m_boulders.clear();
-
-    m_pShip = nullptr;
-    m_pFire1 = nullptr;
-    m_pFire2 = nullptr;
-    m_pUFO = nullptr;
+    m_numberSprites.clear();
+    m_sprites.clear();
+    m_particles.Clear();
+
+    m_ship = EntityHandle();
+    m_fireEntity1 = EntityHandle();
+    m_fireEntity2 = EntityHandle();
+    m_ufo = EntityHandle();
 }
 
 bool Asteroids::Init()
@@ -99,7 +184,7 @@ bool Asteroids::Init()
 
     auto spriteData = MediaManager::Instance().LoadAsset("shooter_sprites.json", MediaType::Texture);
     json parse = json::parse(spriteData);
-    m_numbers.resize(10);
+    m_numberSprites.resize(10);
     for (auto& entry : parse["TextureAtlas"]["SubTexture"])
     {
         auto x = std::stoi(entry["x"].get<std::string>());
@@ -164,9 +249,7 @@ bool Asteroids::Init()
                 auto strNum = name.substr(prefix, 1);
                 if (strNum[0] >= '0' && strNum[0] <= '9')
                 {
-                    auto pNum = AddEntity(EntityType::Digit, name);
-                    pNum->sizeScale = 2.0f;
-                    m_numbers[std::stoi(strNum)] = pNum;
+                    m_numberSprites[std::stoi(strNum)] = name;
 
                 }
             }
@@ -176,227 +259,228 @@ bool Asteroids::Init()
     return true;
 }
 
-void Asteroids::RemoveEntity(Entity* spEntity)
+void Asteroids::RemoveEntity(EntityHandle entity)
 {
-    if (!spEntity)
-        return;
-
-    auto itrFound = m_allEntities.find(spEntity->type);
-    if (itrFound != m_allEntities.end())
+    if (entity == m_ufo)
     {
-        // Erase if a boulder
-        if (spEntity->type == EntityType::BigBoulder ||
-            spEntity->type == EntityType::MediumBoulder ||
-            spEntity->type == EntityType::SmallBoulder)
-        {
-            m_boulders.erase(spEntity);
-        }
-
-        if (spEntity == m_pUFO)
-        {
-            m_pUFO = nullptr;
-        }
-        itrFound->second.erase(spEntity);
-        delete spEntity;
+        m_ufo = EntityHandle();
     }
+    m_entities.Remove(entity);
 }
 
-Entity* Asteroids::AddEntity(EntityType type, HashString spriteName)
+EntityHandle Asteroids::AddEntity(EntityType type, HashString spriteName)
 {
-    static uint32_t CurrentID = 0;
-
-    auto spEntity = new Entity();
-    spEntity->id = CurrentID++;
-    spEntity->type = type;
-    spEntity->spriteCoords = m_spriteCoords[spriteName];
-    spEntity->spriteSize = glm::ivec2(m_spriteCoords[spriteName].z, m_spriteCoords[spriteName].w);
-    spEntity->damage = 0;
-    spEntity->position = glm::vec3(0.0f);
-    spEntity->velocity = glm::vec3(0.0f);
-    spEntity->acceleration = glm::vec3(0.0f);
-    spEntity->angle = 0.0f;
-    spEntity->rotationalVelocity = 0.0f;
-    m_allEntities[type].insert(spEntity);
-    return spEntity;
+    auto entity = m_entities.Add(type);
+    auto index = m_entities.IndexOf(entity);
+    auto& coords = m_spriteCoords[spriteName];
+    m_entities.spriteCoords[index] = glm::ivec2(coords.x, coords.y);
+    m_entities.spriteSize[index] = glm::ivec2(coords.z, coords.w);
+    return entity;
 }
 
-void Asteroids::SplitBoulder(Entity* boulder)
+void Asteroids::SplitBoulder(EntityHandle boulder)
 {
-    std::vector<Entity*> newBoulders;
-    switch (boulder->type)
+    auto& e = m_entities;
+    auto index = e.IndexOf(boulder);
+    if (index == EntityPool::InvalidIndex)
+    {
+        return;
+    }
+
+    // Copy what the children need; adding entities may move the arrays
+    auto type = e.type[index];
+    auto position = e.position[index];
+    auto velocity = e.velocity[index];
+    auto rotationalVelocity = e.rotationalVelocity[index];
+
+    EntityType childType = EntityType::Unknown;
+    std::vector<HashString>* pChildSprites = nullptr;
+    switch (type)
     {
     case EntityType::BigBoulder:
-        newBoulders.push_back(AddEntity(EntityType::MediumBoulder, *select_randomly(m_mediumBoulders.begin(), m_mediumBoulders.end())));
-        newBoulders.push_back(AddEntity(EntityType::MediumBoulder, *select_randomly(m_mediumBoulders.begin(), m_mediumBoulders.end())));
-        AddExplosion(boulder->position, .65f);
+        childType = EntityType::MediumBoulder;
+        pChildSprites = &m_mediumBoulders;
+        AddExplosion(position, .65f);
         break;
     case EntityType::MediumBoulder:
-        newBoulders.push_back(AddEntity(EntityType::SmallBoulder, *select_randomly(m_smallBoulders.begin(), m_smallBoulders.end())));
-        newBoulders.push_back(AddEntity(EntityType::SmallBoulder, *select_randomly(m_smallBoulders.begin(), m_smallBoulders.end())));
-        AddExplosion(boulder->position, .45f);
+        childType = EntityType::SmallBoulder;
+        pChildSprites = &m_smallBoulders;
+        AddExplosion(position, .45f);
         break;
     default:
-        AddExplosion(boulder->position, .25f);
+        AddExplosion(position, .25f);
         break;
     }
-    for (auto& child : newBoulders)
+
+    if (pChildSprites)
     {
-        child->position = boulder->position;
-        child->velocity = boulder->velocity;
-        child->rotationalVelocity = boulder->rotationalVelocity * glm::linearRand(2.0f, 3.0f);
-        child->angle = RandRange(0.0f, 360.0f);
+        for (int i = 0; i < 2; i++)
+        {
+            auto child = e.IndexOf(AddEntity(childType, RandomSprite(*pChildSprites)));
+            e.position[child] = position;
+            e.rotationalVelocity[child] = rotationalVelocity * Random(2.0f, 3.0f);
+            e.angle[child] = Random(0.0f, 360.0f);
 
-        auto currentVelocityLength = length(boulder->velocity);
-        auto vRand = glm::normalize(glm::linearRand(glm::vec2(-1.0f), glm::vec2(1.0f)));
+            auto currentVelocityLength = length(velocity);
+            auto vRand = glm::normalize(Random(glm::vec2(-1.0f), glm::vec2(1.0f)));
 
-        child->velocity = vRand * currentVelocityLength;
-        child->sizeScale = 3.0f;
-        m_boulders.insert(child);
+            e.velocity[child] = vRand * currentVelocityLength;
+            e.sizeScale[child] = 3.0f;
+        }
     }
     RemoveEntity(boulder);
 }
 
 
-Entity* Asteroids::AddUFO(EntityType type)
+EntityHandle Asteroids::AddUFO(EntityType type)
 {
-    auto pUFO = AddEntity(type, type == EntityType::UFOEasy ? m_greenUFO : m_redUFO);
-    pUFO->position = GetRandomEntryPoint(pUFO->spriteSize);
+    auto& e = m_entities;
+    auto ufo = AddEntity(type, type == EntityType::UFOEasy ? m_greenUFO : m_redUFO);
+    auto index = e.IndexOf(ufo);
+    e.position[index] = GetRandomEntryPoint(e.spriteSize[index]);
     if (type == EntityType::UFOEasy)
     {
-        pUFO->velocity = glm::linearRand(glm::vec3(-1.0f) * properties.UFOEasySpeed, glm::vec3(1.0f) * properties.UFOEasySpeed);
+        e.velocity[index] = Random(glm::vec2(-1.0f) * properties.UFOEasySpeed, glm::vec2(1.0f) * properties.UFOEasySpeed);
     }
     else
     {
-        pUFO->velocity = glm::linearRand(glm::vec3(-1.0f) * properties.UFOHardSpeed, glm::vec3(1.0f) * properties.UFOHardSpeed);
+        e.velocity[index] = Random(glm::vec2(-1.0f) * properties.UFOHardSpeed, glm::vec2(1.0f) * properties.UFOHardSpeed);
     }
-    m_ufoTimer.Restart();
+    m_ufoTime = m_simTime;
     m_nextUFOFireTime = properties.UFOFireTime;
-    return pUFO;
+    return ufo;
 }
 
 void Asteroids::UFOFire()
 {
-    if (!m_pUFO)
+    auto& e = m_entities;
+    if (!e.IsValid(m_ufo))
     {
         return;
     }
-    auto pLaser = AddEntity(EntityType::UFOLaser, m_ufoLaser);
-    pLaser->position = m_pUFO->position;
-    glm::vec2 laserDir = glm::normalize(m_pShip->position - m_pUFO->position);
+    auto laser = e.IndexOf(AddEntity(EntityType::UFOLaser, m_ufoLaser));
+    auto ufo = e.IndexOf(m_ufo);
+    auto ship = e.IndexOf(m_ship);
+
+    e.position[laser] = e.position[ufo];
+    glm::vec2 laserDir = glm::normalize(e.position[ship] - e.position[ufo]);
 
-    float dither = glm::linearRand(-90.0f, 90.0f);
+    float dither = Random(-90.0f, 90.0f);
     if (fabs(dither) < 10.0f)
     {
-        dither = glm::linearRand(-60.0f, 60.0f);
+        dither = Random(-60.0f, 60.0f);
     }
     laserDir = glm::rotate(laserDir, glm::radians(dither));
 
     laserDir *= properties.UFOLaserSpeed;
 
-    pLaser->velocity = laserDir;
-    pLaser->angle = glm::linearRand(0.0f, 360.0f);
-    pLaser->rotationalVelocity = 100.0f;
-    pLaser->sizeScale = .75f;
-    pLaser->color = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
-    pLaser->death = properties.UFOLaserDuration;
+    e.velocity[laser] = laserDir;
+    e.angle[laser] = Random(0.0f, 360.0f);
+    e.rotationalVelocity[laser] = 100.0f;
+    e.sizeScale[laser] = .75f;
+    e.color[laser] = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+    e.death[laser] = properties.UFOLaserDuration;
 
 }
 
 // Find a location around the edge of the world to add an enemy object
-glm::vec3 Asteroids::GetRandomEntryPoint(const glm::ivec2& spriteSize) const
+glm::vec3 Asteroids::GetRandomEntryPoint(const glm::ivec2& spriteSize)
 {
     auto maxSpriteSize = std::max(spriteSize.x, spriteSize.y);
     auto maxWorldSize = std::max(m_worldSize.x, m_worldSize.y);
-    auto location = RandRange(0, int(maxWorldSize));
-    auto entrySide = RandRange(0, 3);
+    auto location = RandomInt(0, int(maxWorldSize));
+    auto entrySide = RandomInt(0, 3);
     switch (entrySide)
     {
     default:
     case 0:
-        return glm::vec3(location, 0.0f, glm::linearRand(.1f, .9f));
+        return glm::vec3(location, 0.0f, Random(.1f, .9f));
     case 1:
-        return glm::vec3(0.0f, location, glm::linearRand(.1f, .9f));
+        return glm::vec3(0.0f, location, Random(.1f, .9f));
     case 2:
-        return glm::vec3(location, maxSpriteSize + m_worldSize.y, glm::linearRand(.1f, .9f));
+        return glm::vec3(location, maxSpriteSize + m_worldSize.y, Random(.1f, .9f));
     case 3:
-        return glm::vec3(maxSpriteSize + m_worldSize.x, location, glm::linearRand(.1f, .9f));
+        return glm::vec3(maxSpriteSize + m_worldSize.x, location, Random(.1f, .9f));
     }
 }
 
-Entity* Asteroids::AddBoulder()
+EntityHandle Asteroids::AddBoulder()
 {
-    auto pRock = AddEntity(EntityType::BigBoulder, *select_randomly(m_bigBoulders.begin(), m_bigBoulders.end()));
+    auto& e = m_entities;
+    auto rock = AddEntity(EntityType::BigBoulder, RandomSprite(m_bigBoulders));
+    auto index = e.IndexOf(rock);
 
-    pRock->position = GetRandomEntryPoint(pRock->spriteSize);
-    pRock->rotationalVelocity = glm::linearRand(0.0f, 45.0f);
-    while (fabs(pRock->velocity.x) < properties.BoulderMinSpeed || fabs(pRock->velocity.y) < properties.BoulderMinSpeed)
+    e.position[index] = GetRandomEntryPoint(e.spriteSize[index]);
+    e.rotationalVelocity[index] = Random(0.0f, 45.0f);
+    while (fabs(e.velocity[index].x) < properties.BoulderMinSpeed || fabs(e.velocity[index].y) < properties.BoulderMinSpeed)
     {
-        pRock->velocity = glm::linearRand(glm::vec3(-properties.BoulderSpeedRange), glm::vec3(properties.BoulderSpeedRange));
+        e.velocity[index] = Random(glm::vec2(-properties.BoulderSpeedRange), glm::vec2(properties.BoulderSpeedRange));
     }
-    pRock->acceleration = glm::vec2(0.0f);
-    pRock->angle = glm::linearRand(0.0f, 360.0f);
-    pRock->sizeScale = 1.5f;
-    m_boulders.insert(pRock);
-    return pRock;
+    e.acceleration[index] = glm::vec2(0.0f);
+    e.angle[index] = Random(0.0f, 360.0f);
+    e.sizeScale[index] = 1.5f;
+    return rock;
 }
 
-Entity* Asteroids::AddStar()
+EntityHandle Asteroids::AddStar()
 {
-    auto pRock = AddEntity(EntityType::Star, *select_randomly(m_stars.begin(), m_stars.end()));
-
-    auto maxSpriteSize = std::max(pRock->spriteSize.x, pRock->spriteSize.y);
-    auto maxWorldSize = std::max(m_worldSize.x, m_worldSize.y);
-    auto entrySide = RandRange(0, 3);
-    auto location = RandRange(0, int(maxWorldSize));
+    auto& e = m_entities;
+    auto star = AddEntity(EntityType::Star, RandomSprite(m_stars));
+    auto index = e.IndexOf(star);
 
     // A randomly placed star, with slow rotation, slow velocity and dim color
-    pRock->rotationalVelocity = glm::linearRand(0.0f, 1.0f);
-    pRock->position = glm::linearRand(glm::vec3(0.0f), glm::vec3(m_worldSize.x, m_worldSize.y, 0.0f));
-    pRock->position.z = 0.0f;
-    pRock->velocity = glm::linearRand(glm::vec3(-3.f), glm::vec3(3.f));
-    pRock->angle = glm::linearRand(0.0f, 360.0f);
-    pRock->sizeScale = .25f;
-    pRock->color = glm::vec4(.75f);
-    return pRock;
+    e.rotationalVelocity[index] = Random(0.0f, 1.0f);
+    e.position[index] = Random(glm::vec3(0.0f), glm::vec3(m_worldSize.x, m_worldSize.y, 0.0f));
+    e.position[index].z = 0.0f;
+    e.velocity[index] = Random(glm::vec2(-3.f), glm::vec2(3.f));
+    e.angle[index] = Random(0.0f, 360.0f);
+    e.sizeScale[index] = .25f;
+    e.color[index] = glm::vec4(.75f);
+    return star;
 }
 
-void Asteroids::AddExplosion(const glm::vec3& position, float duration)
+void Asteroids::AddExplosion(glm::vec3 position, float duration)
 {
-    std::vector<Entity*> vecParticles;
-    vecParticles.push_back(AddStar());
-    vecParticles.push_back(AddStar());
-    vecParticles.push_back(AddStar());
-    vecParticles.push_back(AddStar());
-    vecParticles.push_back(AddStar());
-
     // particles are fast, bright and don't live long 
-    for (auto& particle : vecParticles)
+    for (int i = 0; i < 5; i++)
     {
-        particle->position = position;
-        particle->death = duration;
-        particle->color *= 1.5f;
-        particle->velocity = glm::linearRand(glm::vec3(-500.0f), glm::vec3(500.0f));
+        auto& coords = m_spriteCoords[RandomSprite(m_stars)];
+        auto spriteSize = glm::ivec2(coords.z, coords.w);
+        m_particles.Emit(position,
+            Random(glm::vec2(-500.0f), glm::vec2(500.0f)),
+            duration,
+            Random(0.0f, 360.0f),
+            glm::vec2(spriteSize) * .25f * .25f,
+            SpriteRect(glm::ivec2(coords.x, coords.y), spriteSize));
     }
 }
 
-void Asteroids::Restart()
+// A new game, with the given random seed.
+// Everything is rebuilt from scratch, so the same seed and input always give the same game
+void Asteroids::Restart(uint32_t seed)
 {
-    // Entity management could be better!
-    RemoveEntity(m_pShip);
-    RemoveEntity(m_pUFO);
+    m_seed = seed;
+    m_random.seed(seed);
 
-    while (!m_allEntities[EntityType::Star].empty())
-    {
-        RemoveEntity(*m_allEntities[EntityType::Star].begin());
-    }
+    m_simTime = 0.0f;
+    m_keyholdTime = 0.0f;
+    m_stepCount = 0;
+    m_bCanShoot = true;
+
+    m_entities.Clear();
+    m_particles.Clear();
+    m_ufo = EntityHandle();
 
-    while (!m_boulders.empty())
+    m_numbers.clear();
+    for (auto& digit : m_numberSprites)
     {
-        RemoveEntity(*m_boulders.begin());
+        auto num = AddEntity(EntityType::Digit, digit);
+        m_entities.sizeScale[m_entities.IndexOf(num)] = 2.0f;
+        m_numbers.push_back(num);
     }
 
-    m_pShip = AddEntity(EntityType::Ship, m_shipName);
-    m_pShip->position = glm::vec3(m_worldSize.x / 2, m_worldSize.y / 2, 0.0f);
+    m_ship = AddEntity(EntityType::Ship, m_shipName);
+    m_entities.position[m_entities.IndexOf(m_ship)] = glm::vec3(m_worldSize.x / 2, m_worldSize.y / 2, 0.0f);
 
     for (int i = 0; i < 5; i++)
     {
@@ -408,14 +492,13 @@ void Asteroids::Restart()
         AddStar();
     }
 
-    m_pFire1 = AddEntity(EntityType::Exhaust, m_fire1);
-    m_pFire2 = AddEntity(EntityType::Exhaust, m_fire2);
+    m_fireEntity1 = AddEntity(EntityType::Exhaust, m_fire1);
+    m_fireEntity2 = AddEntity(EntityType::Exhaust, m_fire2);
 
     m_gameState = GameState::Spawning;
-    m_pUFO = nullptr;
 
-    m_ufoTimer.Restart();
-    m_spawnTimer.Restart();
+    m_ufoTime = m_simTime;
+    m_spawnTime = m_simTime;
     m_score = 0;
     m_lives = 3;
 }
@@ -427,7 +510,8 @@ void Asteroids::ResizeWindow(Mgfx::Window* pWindow)
 
 void Asteroids::AddToWindow(Mgfx::Window* pWindow)
 {
-    auto data = MediaManager::Instance().LoadAsset("shooter_sprites.png", MediaType::Texture);
+    // Decoded here, so the source image rather than the compressed one
+    auto data = MediaManager::Instance().LoadAsset("shooter_sprites.png", MediaType::Texture | MediaType::Source);
     uint32_t quad = pWindow->GetDevice()->CreateTexture();
 
     int w;
@@ -449,13 +533,16 @@ void Asteroids::AddToWindow(Mgfx::Window* pWindow)
     pWindow->GetDevice()->UpdateTexture(quad);
 
     auto pWindowData = GetWindowData<ShooterWindowData>(pWindow);
-    pWindowData->AddGeometry(100000 * sizeof(GeometryVertex), 100000 * sizeof(uint32_t));
     pWindowData->textureQuad = quad;
     pWindowData->textureSize = glm::uvec2(w, h);
 
+    // Falls back to the numeral sprites if the font isn't built
+    pWindowData->spText = std::make_shared<TextBatch>(pWindow->GetDevice().get());
+    pWindowData->spText->Load("DroidSans");
+
     m_worldSize = pWindow->GetClientSize();
 
-    Restart();
+    Restart(NewSeed());
 }
 
 void Asteroids::RemoveFromWindow(Mgfx::Window* pWindow)
@@ -467,8 +554,42 @@ void Asteroids::DrawGUI(Mgfx::Window* pWindow)
 {
     if (ImGui::Button("Restart (Some properties required this)"))
     {
-        Restart();
+        m_playback = Playback::Live;
+        Restart(NewSeed());
+    }
+
+    // Recordings restart the game, then store the input for every step
+    if (m_playback != Playback::Recording)
+    {
+        if (ImGui::Button("Record"))
+        {
+            m_playback = Playback::Recording;
+            Restart(NewSeed());
+            m_recording.seed = m_seed;
+            m_recording.worldSize = m_worldSize;
+            m_recording.inputs.clear();
+        }
     }
+    else
+    {
+        if (ImGui::Button("Stop Recording"))
+        {
+            m_playback = Playback::Live;
+            SaveRecording(RecordingFile, m_recording);
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Replay"))
+    {
+        if (LoadRecording(RecordingFile, m_recording))
+        {
+            m_playback = Playback::Replaying;
+            m_worldSize = m_recording.worldSize;
+            Restart(m_recording.seed);
+        }
+    }
+    ImGui::Text("Step: %d, Seed: %u, State: %016llx", int(m_stepCount), m_seed, (unsigned long long)StateHash());
+
     ImGui::SliderFloat("UFO Easy Speed", &properties.UFOEasySpeed, 10.0f, 200.0f);
     ImGui::SliderFloat("UFO Hard Speed", &properties.UFOHardSpeed, 10.0f, 400.0f);
     ImGui::SliderFloat("UFO Spawn Time", &properties.UFOSpawnTime, 1.0f, 60.0f);
@@ -478,6 +599,8 @@ void Asteroids::DrawGUI(Mgfx::Window* pWindow)
     ImGui::SliderFloat("UFO Laser Duration", &properties.UFOLaserDuration, 1.0f, 10.0f);
     ImGui::SliderFloat("Boulder Speed Range", &properties.BoulderSpeedRange, 1.0f, 200.0f);
     ImGui::SliderFloat("Boulder Min Speed Range", &properties.BoulderMinSpeed, 1.0f, 100.0f);
+    ImGui::Checkbox("Interpolate", &properties.Interpolate);
+    ImGui::SliderInt("Max Sub Steps", &properties.MaxSubSteps, 1, 16);
 
     if ((properties.BoulderMinSpeed + 1.0f) >= properties.BoulderSpeedRange)
     {
@@ -487,95 +610,96 @@ void Asteroids::DrawGUI(Mgfx::Window* pWindow)
 
 void Asteroids::WrapAtBorders()
 {
-    for (auto& entityType : m_allEntities)
+    auto& e = m_entities;
+    auto ufo = e.IndexOf(m_ufo);
+    for (uint32_t index = 0; index < e.Size(); index++)
     {
-        for (auto& entity : entityType.second)
+        auto& position = e.position[index];
+        bool wrapped = false;
+        // Sprite position is origin center, and sprites are double sized !
+        auto spriteSize = glm::ceil(glm::vec2(e.spriteSize[index]) / 4.0f);
+        if (position.x < -spriteSize.x)
         {
-            bool wrapped = false;
-            // Sprite position is origin center, and sprites are double sized !
-            auto spriteSize = glm::ceil(glm::vec2(entity->spriteSize) / 4.0f);
-            if (entity->position.x < -spriteSize.x)
-            {
-                wrapped = true;
-                entity->position.x = float(spriteSize.x + m_worldSize.x);
-            }
-            if (entity->position.y < -spriteSize.y)
-            {
-                wrapped = true;
-                entity->position.y = float(spriteSize.y + m_worldSize.y);
-            }
-            if (entity->position.x > (m_worldSize.x + spriteSize.x))
-            {
-                wrapped = true;
-                entity->position.x = float(-spriteSize.x);
-            }
-            if (entity->position.y > (m_worldSize.y + spriteSize.y))
-            {
-                wrapped = true;
-                entity->position.y = float(-spriteSize.y);
-            }
+            wrapped = true;
+            position.x = float(spriteSize.x + m_worldSize.x);
+        }
+        if (position.y < -spriteSize.y)
+        {
+            wrapped = true;
+            position.y = float(spriteSize.y + m_worldSize.y);
+        }
+        if (position.x > (m_worldSize.x + spriteSize.x))
+        {
+            wrapped = true;
+            position.x = float(-spriteSize.x);
+        }
+        if (position.y > (m_worldSize.y + spriteSize.y))
+        {
+            wrapped = true;
+            position.y = float(-spriteSize.y);
+        }
 
-            // Special handling for UFO - kill it inside boundary
-            if (wrapped && entity == m_pUFO)
+        // Special handling for UFO - kill it inside boundary
+        if (wrapped && index == ufo)
+        {
+            if ((m_simTime - m_ufoTime) > properties.UFOLifeTime)
             {
-                if (m_ufoTimer.GetDelta() > properties.UFOLifeTime)
-                {
-                    // Force UFO death inside the boundary
-                    m_pUFO->death = .1f;
-                    m_ufoTimer.Restart();
-                }
+                // Force UFO death inside the boundary
+                e.death[ufo] = .1f;
+                m_ufoTime = m_simTime;
             }
         }
     }
 }
 
-void Asteroids::HandleInput()
+void Asteroids::HandleInput(uint8_t input)
 {
-    auto timeDelta = m_inputTimer.GetDelta();
-    m_inputTimer.Restart();
+    auto timeDelta = StepTime;
 
     if (m_gameState != GameState::Playing &&
         m_gameState != GameState::Spawning)
     {
         return;
     }
-    auto shipForward = glm::vec2(cos(glm::radians(m_pShip->angle - 90.0f)), sin(glm::radians(m_pShip->angle - 90.0f)));
-    if (ImGui::GetIO().KeysDown[SDLK_w])
+
+    auto& e = m_entities;
+    auto ship = e.IndexOf(m_ship);
+    auto shipForward = glm::vec2(cos(glm::radians(e.angle[ship] - 90.0f)), sin(glm::radians(e.angle[ship] - 90.0f)));
+    if (input & AsteroidsInput::Thrust)
     {
-        m_pShip->acceleration += shipForward * MaxAcceleration * timeDelta;
-        m_pShip->acceleration = glm::clamp(m_pShip->acceleration, glm::vec2(-MaxAcceleration), glm::vec2(MaxAcceleration));
+        e.acceleration[ship] += shipForward * MaxAcceleration * timeDelta;
+        e.acceleration[ship] = glm::clamp(e.acceleration[ship], glm::vec2(-MaxAcceleration), glm::vec2(MaxAcceleration));
     }
     else
     {
-        m_pShip->acceleration = glm::vec2(0.0f);
+        e.acceleration[ship] = glm::vec2(0.0f);
     }
 
-    float angleDelta = std::min(m_keyholdTimer.GetDelta() * 2000.0f, 300.0f);
-    if (ImGui::GetIO().KeysDown[SDLK_a])
+    float angleDelta = std::min((m_simTime - m_keyholdTime) * 2000.0f, 300.0f);
+    if (input & AsteroidsInput::Left)
     {
-        m_pShip->angle -= angleDelta * timeDelta;
+        e.angle[ship] -= angleDelta * timeDelta;
     }
-    else if (ImGui::GetIO().KeysDown[SDLK_d])
+    else if (input & AsteroidsInput::Right)
     {
-        m_pShip->angle += angleDelta * timeDelta;
+        e.angle[ship] += angleDelta * timeDelta;
     }
     else
     {
-        m_keyholdTimer.Restart();
+        m_keyholdTime = m_simTime;
     }
 
-    if (ImGui::GetIO().KeysDown[SDLK_SPACE])
+    if (input & AsteroidsInput::Fire)
     {
         if (m_bCanShoot)
         {
             m_bCanShoot = false;
-            auto pLaser = AddEntity(EntityType::Laser, m_laser);
-            pLaser->position = m_pShip->position + glm::vec3(shipForward * float(m_pShip->spriteSize.y *.2f), 0.0);
-            pLaser->startPosition = pLaser->position;
-            pLaser->angle = m_pShip->angle;
-            pLaser->death = .9f;
-            pLaser->color = glm::vec4(1.0f);
-            pLaser->velocity = shipForward * 500.0f;
+            auto laser = e.IndexOf(AddEntity(EntityType::Laser, m_laser));
+            e.position[laser] = e.position[ship] + glm::vec3(shipForward * float(e.spriteSize[ship].y *.2f), 0.0);
+            e.angle[laser] = e.angle[ship];
+            e.death[laser] = .9f;
+            e.color[laser] = glm::vec4(1.0f);
+            e.velocity[laser] = shipForward * 500.0f;
         }
     }
     else
@@ -586,35 +710,38 @@ void Asteroids::HandleInput()
 
 void Asteroids::StepPhysics()
 {
-    const float MaxAcceleration = 1000.0f;
-    const float MaxVelocity = 1000.0f;
+    auto timeDelta = StepTime;
 
-    auto timeDelta = m_physicsTimer.GetDelta();
+    m_particles.Step(timeDelta);
 
-    // Update physics 50fps
-    if (timeDelta < 0.02f)
-    {
-        return;
-    }
-    m_physicsTimer.Restart();
+    auto& e = m_entities;
 
     // Slow ship over time
-    m_pShip->velocity += -m_pShip->velocity * std::min(timeDelta, 1.0f) * .5f;
+    auto ship = e.IndexOf(m_ship);
+    e.velocity[ship] += -e.velocity[ship] * std::min(timeDelta, 1.0f) * .5f;
 
-    std::set<Entity*> victims;
-    for (auto& entityType : m_allEntities)
+    // Integrate; each array is walked in order
+    const uint32_t numEntities = e.Size();
+    for (uint32_t index = 0; index < numEntities; index++)
     {
-        for (auto& entity : entityType.second)
-        {
-            entity->age += timeDelta;
-            entity->velocity += entity->acceleration * timeDelta;
-            entity->angle += (entity->rotationalVelocity * timeDelta);
-            entity->position += glm::vec3(entity->velocity, 0.0f) * timeDelta;
+        e.age[index] += timeDelta;
+    }
+    for (uint32_t index = 0; index < numEntities; index++)
+    {
+        e.velocity[index] += e.acceleration[index] * timeDelta;
+        e.position[index] += glm::vec3(e.velocity[index] * timeDelta, 0.0f);
+    }
+    for (uint32_t index = 0; index < numEntities; index++)
+    {
+        e.angle[index] += e.rotationalVelocity[index] * timeDelta;
+    }
 
-            if (entity->death != 0.0f && entity->age >= entity->death)
-            {
-                victims.insert(entity);
-            }
+    m_victims.clear();
+    for (uint32_t index = 0; index < numEntities; index++)
+    {
+        if (e.death[index] != 0.0f && e.age[index] >= e.death[index])
+        {
+            m_victims.push_back(e.HandleOf(index));
         }
     }
 
@@ -622,71 +749,97 @@ void Asteroids::StepPhysics()
         m_gameState != GameState::Spawning)
     {
         // No colllisions at the end of the game
+        for (auto& victim : m_victims)
+        {
+            RemoveEntity(victim);
+        }
         return;
     }
 
-    struct Collision
+    auto ufo = e.IndexOf(m_ufo);
+
+    // Collision radius; half of the smallest sprite dimension
+    auto Radius = [&](uint32_t entity)
     {
-        Entity* spEntity1;
-        Entity* spEntity2;
+        return std::min(e.spriteSize[entity].x, e.spriteSize[entity].y) * .5f;
     };
-    std::vector<Collision> collisions;
-    std::set<Entity*> collidedEntities;
-    auto HasCollided = [&](Entity* pEntity) { return collidedEntities.find(pEntity) != collidedEntities.end(); };
-    auto CheckCollision = [&](Entity* spEntity1, Entity* spEntity2)
+
+    m_collisions.clear();
+    m_collided.assign(numEntities, 0);
+    auto CheckCollision = [&](uint32_t entity1, uint32_t entity2)
     {
-        if (HasCollided(spEntity1) || HasCollided(spEntity2))
+        if (m_collided[entity1] || m_collided[entity2])
             return false;
 
-        auto minSize = std::min(spEntity1->spriteSize.x, spEntity1->spriteSize.y) * .5f;
-        minSize += std::min(spEntity2->spriteSize.x, spEntity2->spriteSize.y) * .5f;
-        if (glm::distance(spEntity1->position, spEntity2->position) < minSize)
+        auto minSize = Radius(entity1) + Radius(entity2);
+        if (glm::distance(e.position[entity1], e.position[entity2]) < minSize)
         {
-            collisions.push_back(Collision{ spEntity1, spEntity2 });
-            collidedEntities.insert(spEntity1);
-            collidedEntities.insert(spEntity2);
+            m_collisions.push_back(Collision{ e.HandleOf(entity1), e.HandleOf(entity2) });
+            m_collided[entity1] = 1;
+            m_collided[entity2] = 1;
             return true;
         }
         return false;
     };
 
-    // Bullet with boulder and UFO
-    for (auto& bullet : m_allEntities[EntityType::Laser])
+    // Bucket everything that can be hit; the boulders, the UFO and its lasers.
+    // Entities can sit just outside the world before they wrap, so the grid covers that margin too
+    float maxRadius = 0.0f;
+    float margin = 0.0f;
+    for (uint32_t index = 0; index < numEntities; index++)
     {
-        for (auto& boulder : m_boulders)
+        margin = std::max(margin, float(std::max(e.spriteSize[index].x, e.spriteSize[index].y)) * .25f);
+        if (IsBoulder(e.type[index]) || e.type[index] == EntityType::UFOLaser || index == ufo)
         {
-            CheckCollision(bullet, boulder);
-        }
-
-        if (m_pUFO)
-        {
-            CheckCollision(bullet, m_pUFO);
+            maxRadius = std::max(maxRadius, Radius(index));
         }
     }
 
-    if (m_gameState != GameState::Spawning)
+    // With nothing left to hit, there's nothing to bucket or query
+    if (maxRadius > 0.0f)
     {
-        // Ship with a boulder
-        for (auto& boulder : m_boulders)
+        m_collisionGrid.Begin(glm::vec2(-margin), glm::vec2(m_worldSize) + glm::vec2(margin * 2.0f), maxRadius * 2.0f);
+        for (uint32_t index = 0; index < numEntities; index++)
         {
-            CheckCollision(boulder, m_pShip);
+            if (IsBoulder(e.type[index]) || e.type[index] == EntityType::UFOLaser || index == ufo)
+            {
+                m_collisionGrid.Add(index, glm::vec2(e.position[index]));
+            }
         }
+        m_collisionGrid.End();
 
-        for (auto& ufoLaser : m_allEntities[EntityType::UFOLaser])
+        // Bullet with boulder and UFO
+        e.ForEach(EntityType::Laser, [&](uint32_t bullet)
         {
-            CheckCollision(ufoLaser, m_pShip);
-        }
-    }
+            m_collisionGrid.Query(glm::vec2(e.position[bullet]), Radius(bullet) + maxRadius, [&](uint32_t target)
+            {
+                if (IsBoulder(e.type[target]) || target == ufo)
+                {
+                    CheckCollision(bullet, target);
+                }
+            });
+        });
 
-    if (m_pUFO)
-    {
-        // Ship with UFO
-        CheckCollision(m_pUFO, m_pShip);
+        // Ship with UFO, and with a boulder or UFO laser once it has spawned
+        m_collisionGrid.Query(glm::vec2(e.position[ship]), Radius(ship) + maxRadius, [&](uint32_t target)
+        {
+            if (target == ufo || m_gameState != GameState::Spawning)
+            {
+                CheckCollision(target, ship);
+            }
+        });
     }
 
-    auto HandleCollision = [&](Entity* spEntity)
+    auto HandleCollision = [&](EntityHandle entity)
     {
-        switch (spEntity->type)
+        // May already have gone, for example if it also died this step
+        auto index = e.IndexOf(entity);
+        if (index == EntityPool::InvalidIndex)
+        {
+            return;
+        }
+
+        switch (e.type[index])
         {
         case EntityType::SmallBoulder:
             m_score += 5;
@@ -694,24 +847,25 @@ void Asteroids::StepPhysics()
             m_score += 5;
         case EntityType::BigBoulder:
             m_score += 5;
-            SplitBoulder(spEntity);
+            SplitBoulder(entity);
             break;
         case EntityType::UFOHard:
             m_score += 20;
         case EntityType::UFOEasy:
             m_score += 20;
-            AddExplosion(spEntity->position, .3f);
-            RemoveEntity(spEntity);
-            m_ufoTimer.Restart();
+            AddExplosion(e.position[index], .3f);
+            RemoveEntity(entity);
+            m_ufoTime = m_simTime;
             break;
         case EntityType::Ship:
         {
-            AddExplosion(spEntity->position, 1.0f);
+            AddExplosion(e.position[index], 1.0f);
+            ship = e.IndexOf(m_ship);
             m_gameState = GameState::Spawning;
-            m_pShip->color.a = 0.0f;
-            m_pShip->velocity = glm::vec2(0.0f);
-            m_pShip->position = glm::vec3(m_worldSize.x / 2, m_worldSize.y / 2, 0.0f);
-            m_spawnTimer.Restart();
+            e.color[ship].a = 0.0f;
+            e.velocity[ship] = glm::vec2(0.0f);
+            e.position[ship] = glm::vec3(m_worldSize.x / 2, m_worldSize.y / 2, 0.0f);
+            m_spawnTime = m_simTime;
             m_lives--;
             if (m_lives <= 0)
             {
@@ -721,20 +875,20 @@ void Asteroids::StepPhysics()
         break;
         default:
         {
-            RemoveEntity(spEntity);
+            RemoveEntity(entity);
         }
         break;
 
         }
     };
 
-    for (auto& collision : collisions)
+    for (auto& collision : m_collisions)
     {
-        HandleCollision(collision.spEntity1);
-        HandleCollision(collision.spEntity2);
+        HandleCollision(collision.entity1);
+        HandleCollision(collision.entity2);
     }
 
-    for (auto& victim : victims)
+    for (auto& victim : m_victims)
     {
         RemoveEntity(victim);
     }
@@ -744,70 +898,67 @@ void Asteroids::StepPhysics()
 
 void Asteroids::UpdateGameState()
 {
-    m_pFire1->color = glm::vec4(0.0f);
-    m_pFire2->color = glm::vec4(0.0f);
+    auto& e = m_entities;
+    auto ship = e.IndexOf(m_ship);
+    auto fire1 = e.IndexOf(m_fireEntity1);
+    auto fire2 = e.IndexOf(m_fireEntity2);
+
+    e.color[fire1] = glm::vec4(0.0f);
+    e.color[fire2] = glm::vec4(0.0f);
 
     // Update visibility of ships thruster 
-    float shipAcceleration = glm::length(m_pShip->acceleration);
+    float shipAcceleration = glm::length(e.acceleration[ship]);
     if (shipAcceleration != 0.0f)
     {
-        auto shipForward = glm::vec2(cos(glm::radians(m_pShip->angle - 90.0f)), sin(glm::radians(m_pShip->angle - 90.0f)));
+        auto shipForward = glm::vec2(cos(glm::radians(e.angle[ship] - 90.0f)), sin(glm::radians(e.angle[ship] - 90.0f)));
         // Over a certain speed, change the ship's thruster
-        if (shipAcceleration > (MaxAcceleration / 5))
-        {
-            m_pFire2->position = m_pShip->position - glm::vec3(shipForward * float(m_pShip->spriteSize.y *.4f), 0.0);
-            m_pFire2->angle = m_pShip->angle;
-            m_pFire2->color = glm::vec4(1.0f);
-        }
-        else
-        {
-            m_pFire1->position = m_pShip->position - glm::vec3(shipForward * float(m_pShip->spriteSize.y *.4f), 0.0);
-            m_pFire1->angle = m_pShip->angle;
-            m_pFire1->color = glm::vec4(1.0f);
-        }
+        auto fire = (shipAcceleration > (MaxAcceleration / 5)) ? fire2 : fire1;
+        e.position[fire] = e.position[ship] - glm::vec3(shipForward * float(e.spriteSize[ship].y *.4f), 0.0);
+        e.angle[fire] = e.angle[ship];
+        e.color[fire] = glm::vec4(1.0f);
     }
 
     switch (m_gameState)
     {
     case GameState::End:
-        m_pShip->color.a = 0.0f;
-        m_pFire1->color.a = 0.0f;
-        m_pFire2->color.a = 0.0f;
+        e.color[ship].a = 0.0f;
+        e.color[fire1].a = 0.0f;
+        e.color[fire2].a = 0.0f;
         return;
         break;
     case GameState::Spawning:
     {
-        auto delta = m_spawnTimer.GetDelta();
+        auto delta = (m_simTime - m_spawnTime);
         if (delta > 3.0f)
         {
             m_gameState = GameState::Playing;
-            m_pShip->color.a = 1.0f;
+            e.color[ship].a = 1.0f;
         }
         else
         {
             if (delta < .75f)
             {
-                m_pShip->color.a = 0.0f;
+                e.color[ship].a = 0.0f;
             }
             else
             {
-                m_pShip->color.a = std::cos(glm::radians(delta * 500.0f)) * .5f + .5f;
+                e.color[ship].a = std::cos(glm::radians(delta * 500.0f)) * .5f + .5f;
             }
         }
     }
     break;
     default:
-        m_pShip->color.a = 1.0f;
+        e.color[ship].a = 1.0f;
         break;
     }
 
     // Spawn the UFO if appropriate
-    auto ufoTime = m_ufoTimer.GetDelta();
-    if (m_pUFO == nullptr)
+    auto ufoTime = (m_simTime - m_ufoTime);
+    if (!e.IsValid(m_ufo))
     {
         if (ufoTime > properties.UFOSpawnTime)
         {
-            m_pUFO = AddUFO(EntityType::UFOEasy);
+            m_ufo = AddUFO(EntityType::UFOEasy);
         }
     }
     else
@@ -820,83 +971,258 @@ void Asteroids::UpdateGameState()
     }
 }
 
-void Asteroids::Render(Mgfx::Window* pWindow)
+uint8_t Asteroids::ReadInput() const
 {
-    m_worldSize = pWindow->GetClientSize();
+    uint8_t input = 0;
+    auto& io = ImGui::GetIO();
+    if (io.KeysDown[SDLK_w])
+        input |= AsteroidsInput::Thrust;
+    if (io.KeysDown[SDLK_a])
+        input |= AsteroidsInput::Left;
+    if (io.KeysDown[SDLK_d])
+        input |= AsteroidsInput::Right;
+    if (io.KeysDown[SDLK_SPACE])
+        input |= AsteroidsInput::Fire;
+    return input;
+}
+
+void Asteroids::Step(uint8_t input)
+{
+    PROFILE_SCOPE("Asteroids::Step");
+    m_entities.StorePrevious();
 
-    HandleInput();
+    HandleInput(input);
 
     StepPhysics();
 
     UpdateGameState();
 
-    auto size = pWindow->GetClientSize();
-    auto pWindowData = GetWindowData<ShooterWindowData>(pWindow);
+    m_simTime += StepTime;
+    m_stepCount++;
+}
 
-    m_spCamera->SetFilmSize(size);
-    m_spCamera->SetPositionAndFocalPoint(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-    pWindow->GetDevice()->SetCamera(m_spCamera.get());
+uint64_t Asteroids::StateHash() const
+{
+    auto& e = m_entities;
+    uint64_t hash = m_seed;
+    hash = HashVector(e.type, hash);
+    hash = HashVector(e.position, hash);
+    hash = HashVector(e.velocity, hash);
+    hash = HashVector(e.angle, hash);
+    hash = HashVector(e.age, hash);
+
+    uint32_t game[] = { m_score, uint32_t(m_lives), uint32_t(m_gameState), m_particles.Size(), m_stepCount };
+    return murmur_hash_64(game, uint32_t(sizeof(game)), hash);
+}
 
-    uint32_t numTextures = RandRange(100, 500);
+AsteroidsRunStats Asteroids::RunHeadless(const AsteroidsRecording& recording, uint32_t extraBoulders)
+{
+    m_playback = Playback::Live;
+    m_worldSize = recording.worldSize;
+    Restart(recording.seed);
 
-    uint32_t vertexOffset = 0;
-    uint32_t indexOffset = 0;
-    auto pVertices = (GeometryVertex*)pWindowData->GetVB()->Map(10000, sizeof(GeometryVertex), vertexOffset);
-    auto pIndices = (uint32_t*)pWindowData->GetIB()->Map(10000, sizeof(uint32_t), indexOffset);
+    for (uint32_t i = 0; i < extraBoulders; i++)
+    {
+        AddBoulder();
+    }
 
-    auto pStartIndices = pIndices;
-    auto pStartVertices = pVertices;
+    std::vector<double> stepTimes;
+    stepTimes.reserve(recording.inputs.size());
 
-    uint32_t currentVertex = 0;
+    AsteroidsRunStats stats;
+    for (auto& input : recording.inputs)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        Step(input);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        stepTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        stats.entities = std::max(stats.entities, m_entities.Size());
+    }
 
-    auto drawSprite = [&](const Entity& entity)
+    stats.steps = uint32_t(stepTimes.size());
+    stats.stateHash = StateHash();
+    if (!stepTimes.empty())
     {
-        if (!pVertices || !pIndices)
+        for (auto& time : stepTimes)
         {
-            return;
+            stats.totalMs += time;
         }
-        glm::vec3 right = glm::vec3(cos(glm::radians(entity.angle)), sin(glm::radians(entity.angle)), 0.0f);
-        glm::vec3 down = glm::vec3(cos(glm::radians(entity.angle + 90.0f)), sin(glm::radians(entity.angle + 90.0f)), 0.0f);
-        glm::vec3 entitySize = glm::vec3(entity.spriteSize.x, entity.spriteSize.y, 0.0f) * .25f * entity.sizeScale;
+        stats.meanMs = stats.totalMs / stepTimes.size();
 
-        glm::vec3 quadTopLeft = entity.position - (right * entitySize.x) - (down * entitySize.y);
-        glm::vec3 quadTopRight = entity.position + (right * entitySize.x) - (down * entitySize.y);
-        glm::vec3 quadBottomLeft = entity.position - (right * entitySize.x) + (down * entitySize.y);
-        glm::vec3 quadBottomRight = entity.position + (right * entitySize.x) + (down * entitySize.y);
+        std::sort(stepTimes.begin(), stepTimes.end());
+        stats.minMs = stepTimes.front();
+        stats.maxMs = stepTimes.back();
+        stats.p99Ms = stepTimes[std::min(stepTimes.size() - 1, size_t(stepTimes.size() * .99))];
+    }
+    return stats;
+}
 
-        glm::vec4 spriteTexCoords(entity.spriteCoords.x, entity.spriteCoords.y, (entity.spriteCoords.x + entity.spriteSize.x), (entity.spriteCoords.y + entity.spriteSize.y));
-        spriteTexCoords += glm::vec4(.5f, .5f, -.5f, -.5f);
+AsteroidsRecording Asteroids::MakeStressRecording(uint32_t steps, const glm::uvec2& worldSize)
+{
+    AsteroidsRecording recording;
+    recording.seed = 1;
+    recording.worldSize = worldSize;
+    recording.inputs.resize(steps);
+    for (uint32_t step = 0; step < steps; step++)
+    {
+        // Spin, pulse the thrusters and keep tapping fire
+        uint8_t input = AsteroidsInput::Left;
+        if ((step / 50) % 2)
+            input |= AsteroidsInput::Thrust;
+        if (step % 2)
+            input |= AsteroidsInput::Fire;
+        recording.inputs[step] = input;
+    }
+    return recording;
+}
+
+bool Asteroids::SaveRecording(const std::string& path, const AsteroidsRecording& recording)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        LOG(ERROR) << "Could not write recording: " << path;
+        return false;
+    }
+
+    uint32_t header[] = { RecordingMagic, RecordingVersion, recording.seed, recording.worldSize.x, recording.worldSize.y, uint32_t(recording.inputs.size()) };
+    file.write((const char*)header, sizeof(header));
+    file.write((const char*)recording.inputs.data(), recording.inputs.size());
+    return bool(file);
+}
+
+bool Asteroids::LoadRecording(const std::string& path, AsteroidsRecording& recording)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        LOG(ERROR) << "Could not read recording: " << path;
+        return false;
+    }
+
+    uint32_t header[6];
+    if (!file.read((char*)header, sizeof(header)) ||
+        header[0] != RecordingMagic ||
+        header[1] != RecordingVersion)
+    {
+        LOG(ERROR) << "Not a recording: " << path;
+        return false;
+    }
+
+    recording.seed = header[2];
+    recording.worldSize = glm::uvec2(header[3], header[4]);
+    recording.inputs.resize(header[5]);
+    if (!file.read((char*)recording.inputs.data(), recording.inputs.size()))
+    {
+        LOG(ERROR) << "Truncated recording: " << path;
+        return false;
+    }
+    return true;
+}
+
+void Asteroids::Render(Mgfx::Window* pWindow)
+{
+    // A replay must run in the world it was recorded in
+    if (m_playback != Playback::Replaying)
+    {
+        m_worldSize = pWindow->GetClientSize();
+    }
+
+    // Run as many fixed steps as fit in the elapsed time, carrying the remainder to the next frame.
+    // If the steps can't keep up, give up on the backlog instead of falling further behind each frame
+    auto frameTime = MgfxSettings::Instance().GetFixedFrameTime();
+    m_accumulator += std::min(frameTime > 0.0f ? frameTime : m_frameTimer.GetDelta(), MaxFrameTime);
+    m_frameTimer.Restart();
+
+    int subSteps = 0;
+    while (m_accumulator >= StepTime)
+    {
+        if (subSteps++ == properties.MaxSubSteps)
+        {
+            m_accumulator = std::fmod(m_accumulator, StepTime);
+            break;
+        }
+        m_accumulator -= StepTime;
+
+        uint8_t input = ReadInput();
+        if (m_playback == Playback::Replaying)
+        {
+            if (m_stepCount < m_recording.inputs.size())
+            {
+                input = m_recording.inputs[m_stepCount];
+            }
+            else
+            {
+                m_playback = Playback::Live;
+            }
+        }
+        else if (m_playback == Playback::Recording)
+        {
+            m_recording.inputs.push_back(input);
+        }
+
+        Step(input);
+    }
+
+    // How far we are between the previous step and the current one
+    float alpha = properties.Interpolate ? (m_accumulator / StepTime) : 1.0f;
+
+    auto size = pWindow->GetClientSize();
+    auto pWindowData = GetWindowData<ShooterWindowData>(pWindow);
+
+    m_spCamera->SetFilmSize(size);
+    m_spCamera->SetPositionAndFocalPoint(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+    pWindow->GetDevice()->SetCamera(m_spCamera.get());
+
+    // One instance per sprite; the device builds the quads
+    m_sprites.clear();
+
+    auto& e = m_entities;
+    auto drawSpriteAt = [&](uint32_t entity, const glm::vec3& position, float angle)
+    {
+        auto& spriteSize = e.spriteSize[entity];
+        auto& spriteCoords = e.spriteCoords[entity];
+
+        glm::vec2 halfSize = glm::vec2(spriteSize) * .25f * e.sizeScale[entity];
+
+        glm::vec4 spriteTexCoords = SpriteRect(spriteCoords, spriteSize);
         spriteTexCoords.x /= pWindowData->textureSize.x;
         spriteTexCoords.z /= pWindowData->textureSize.x;
         spriteTexCoords.y /= pWindowData->textureSize.y;
         spriteTexCoords.w /= pWindowData->textureSize.y;
 
-        *pVertices++ = GeometryVertex(quadTopLeft, glm::vec2(spriteTexCoords.x, spriteTexCoords.y), entity.color);
-        *pVertices++ = GeometryVertex(quadTopRight, glm::vec2(spriteTexCoords.z, spriteTexCoords.y), entity.color);
-        *pVertices++ = GeometryVertex(quadBottomLeft, glm::vec2(spriteTexCoords.x, spriteTexCoords.w), entity.color);
-        *pVertices++ = GeometryVertex(quadBottomRight, glm::vec2(spriteTexCoords.z, spriteTexCoords.w), entity.color);
-
-        // Quad
-        *pIndices++ = 0 + currentVertex;
-        *pIndices++ = 1 + currentVertex;
-        *pIndices++ = 2 + currentVertex;
-        *pIndices++ = 2 + currentVertex;
-        *pIndices++ = 1 + currentVertex;
-        *pIndices++ = 3 + currentVertex;
-        currentVertex += 4;
+        auto color = glm::u8vec4(glm::clamp(e.color[entity], glm::vec4(0.0f), glm::vec4(1.0f)) * 255.0f + .5f);
+        m_sprites.push_back(SpriteInstance(position, angle, halfSize, spriteTexCoords, color));
     };
+    auto drawSprite = [&](uint32_t entity)
+    {
+        auto position = e.position[entity];
+        auto angle = e.angle[entity];
 
+        // Blend from the previous step, unless the entity is new or jumped across the border
+        if (e.hasPrevious[entity] &&
+            glm::length(glm::vec2(position - e.previousPosition[entity])) < MaxInterpolationDistance)
+        {
+            position = glm::mix(e.previousPosition[entity], position, alpha);
+            angle = glm::mix(e.previousAngle[entity], angle, alpha);
+        }
+        drawSpriteAt(entity, position, angle);
+    };
 
-    // Draw the world 
-    for (auto& entityType : m_allEntities)
+    // Draw the world, a type at a time so they layer as before
+    for (int type = 0; type < int(EntityType::Count); type++)
     {
-        if (entityType.first == EntityType::Digit)
+        if (EntityType(type) == EntityType::Digit)
         {
             continue;
         }
-        for (auto& entity : entityType.second)
+        e.ForEach(EntityType(type), drawSprite);
+
+        // Explosions were stars, so keep them in the same layer
+        if (EntityType(type) == EntityType::Star)
         {
-            drawSprite(*entity);
+            m_particles.AddSprites(m_sprites, glm::vec2(pWindowData->textureSize), (alpha - 1.0f) * StepTime);
         }
     }
 
@@ -910,26 +1236,32 @@ void Asteroids::Render(Mgfx::Window* pWindow)
             if (index < 0 || index > 9)
                 continue;
 
-            auto pEntity = m_numbers[index];
-            pEntity->position = glm::vec3(pos, 0.0f);
-            pos.x += pEntity->spriteSize.x + 5;
-            drawSprite(*pEntity);
+            // Drawing doesn't touch the simulation state
+            auto entity = e.IndexOf(m_numbers[index]);
+            drawSpriteAt(entity, glm::vec3(pos, 0.0f), e.angle[entity]);
+            pos.x += e.spriteSize[entity].x + 5;
         }
     };
 
-    glm::vec2 scorePos(15, 15);
-    drawNumber(m_score, scorePos);
-
-    scorePos.x += 80;
-    drawNumber(m_lives, scorePos);
+    auto& spText = pWindowData->spText;
+    if (!spText || !spText->IsLoaded())
+    {
+        glm::vec2 scorePos(15, 15);
+        drawNumber(m_score, scorePos);
 
-    pWindowData->GetIB()->UnMap();
-    pWindowData->GetVB()->UnMap();
+        scorePos.x += 80;
+        drawNumber(m_lives, scorePos);
+    }
 
-    uint32_t numVertices = uint32_t(pVertices - pStartVertices);
-    uint32_t numIndices = uint32_t(pIndices - pStartIndices);
+    pWindow->GetDevice()->DrawSprites(pWindowData->textureQuad, m_sprites.data(), uint32_t(m_sprites.size()));
 
-    pWindow->GetDevice()->BeginGeometry(pWindowData->textureQuad, pWindowData->GetVB(), pWindowData->GetIB());
-    pWindow->GetDevice()->DrawTriangles(vertexOffset, indexOffset, numVertices, numIndices);
-    pWindow->GetDevice()->EndGeometry();
+    // The text goes on top, in one draw
+    if (spText && spText->IsLoaded())
+    {
+        const float TextSize = 32.0f;
+        const glm::vec4 TextColor(1.0f, .85f, .3f, 1.0f);
+        spText->AddText("SCORE " + std::to_string(m_score), glm::vec2(15.0f, 10.0f), TextSize, TextColor);
+        spText->AddText("LIVES " + std::to_string(m_lives), glm::vec2(15.0f, 10.0f + TextSize), TextSize, TextColor);
+        spText->Draw();
+    }
 }
@@ -3,23 +3,11 @@
 #include "MgfxRender.h"
 #include "animation/timer.h"
 #include "graphics3d/device/IDevice.h"
+#include "EntityPool.h"
+#include "SpatialHash.h"
+#include "ParticleSystem.h"
 
-enum class EntityType
-{
-    Unknown,
-    Ship,
-    BigBoulder,
-    MediumBoulder,
-    SmallBoulder,
-    Star,
-    Exhaust,
-    Laser,
-    Explosion,
-    UFOEasy,
-    UFOHard,
-    UFOLaser,
-    Digit
-};
+#include <random>
 
 enum class GameState
 {
@@ -29,26 +17,37 @@ enum class GameState
     End
 };
 
-struct Entity
+// The player's controls for one simulation step
+struct AsteroidsInput
+{
+    enum
+    {
+        Thrust = (1 << 0),
+        Left = (1 << 1),
+        Right = (1 << 2),
+        Fire = (1 << 3)
+    };
+};
+
+// Everything needed to play a game again: the seed, the world and the input for each step
+struct AsteroidsRecording
+{
+    uint32_t seed = 0;
+    glm::uvec2 worldSize = glm::uvec2(0);
+    std::vector<uint8_t> inputs;
+};
+
+// Results of a headless run
+struct AsteroidsRunStats
 {
-    uint32_t id = 0;
-    EntityType type;
-    glm::vec4 color = glm::vec4(1.0f);
-    glm::ivec2 spriteCoords;
-    glm::ivec2 spriteSize;
-    float sizeScale = 1.0f;
-    glm::vec2 velocity;
-    glm::vec2 acceleration;
-    
-    glm::vec3 position;
-    float angle;
-    float rotationalVelocity;
-    float rotationalAcceleration = 0.0f;
-    float age = 0.0f;
-    float death = 0.0f;
-    glm::vec3 startPosition;
-
-    uint32_t damage;
+    uint32_t steps = 0;
+    uint32_t entities = 0;
+    double totalMs = 0.0;
+    double meanMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double p99Ms = 0.0;
+    uint64_t stateHash = 0;
 };
 
 namespace Mgfx
@@ -69,20 +68,46 @@ public:
     virtual const char* Name() const override { return "Asteroids"; }
     virtual const char* Description() const override;
 
-private:
-    glm::vec3 GetRandomEntryPoint(const glm::ivec2& spriteSize) const;
+    // The simulation always advances by this much, so runs are repeatable
+    static const float StepTime;
+
+    // Run a recording without a window, as fast as possible, timing every step.
+    // extraBoulders are added at the start, for stress testing the simulation
+    AsteroidsRunStats RunHeadless(const AsteroidsRecording& recording, uint32_t extraBoulders = 0);
+
+    // A scripted recording which keeps the ship turning and firing
+    static AsteroidsRecording MakeStressRecording(uint32_t steps, const glm::uvec2& worldSize);
 
-    Entity* AddEntity(EntityType type, HashString spriteName);
-    Entity* AddBoulder();
-    Entity* AddStar();
-    Entity* AddUFO(EntityType type);
-    void AddExplosion(const glm::vec3& position, float duration);
-    void RemoveEntity(Entity* spEntity);
-    void SplitBoulder(Entity* boulder);
+    static bool SaveRecording(const std::string& path, const AsteroidsRecording& recording);
+    static bool LoadRecording(const std::string& path, AsteroidsRecording& recording);
 
-    void Restart();
+    // A hash of the simulation state; the same recording always gives the same hash
+    uint64_t StateHash() const;
+
+private:
+    glm::vec3 GetRandomEntryPoint(const glm::ivec2& spriteSize);
+
+    // All randomness in the game comes from the seeded generator
+    float Random(float min, float max);
+    glm::vec2 Random(const glm::vec2& min, const glm::vec2& max);
+    glm::vec3 Random(const glm::vec3& min, const glm::vec3& max);
+    int RandomInt(int min, int max);
+    HashString RandomSprite(const std::vector<HashString>& sprites);
+    static uint32_t NewSeed();
+
+    EntityHandle AddEntity(EntityType type, HashString spriteName);
+    EntityHandle AddBoulder();
+    EntityHandle AddStar();
+    EntityHandle AddUFO(EntityType type);
+    void AddExplosion(glm::vec3 position, float duration); // By value; the source may live in the entity arrays
+    void RemoveEntity(EntityHandle entity);
+    void SplitBoulder(EntityHandle boulder);
+
+    void Restart(uint32_t seed);
+    void Step(uint8_t input);
+    uint8_t ReadInput() const;
     void StepPhysics();
-    void HandleInput();
+    void HandleInput(uint8_t input);
     void WrapAtBorders();
     void UpdateGameState();
     void UFOFire();
@@ -102,22 +127,51 @@ private:
     HashString m_redUFO;
     HashString m_greenUFO;
 
-    std::vector<Entity*> m_numbers;
-
-    std::map<EntityType, std::set<Entity*>> m_allEntities;
-    std::set<Entity*> m_boulders;
-    Entity* m_pShip = nullptr;
-    Entity* m_pFire1 = nullptr;
-    Entity* m_pFire2 = nullptr;
-    Entity* m_pUFO = nullptr;
+    std::vector<HashString> m_numberSprites;
+    std::vector<EntityHandle> m_numbers;
+
+    EntityPool m_entities;
+    EntityHandle m_ship;
+    EntityHandle m_fireEntity1;
+    EntityHandle m_fireEntity2;
+    EntityHandle m_ufo;
+
+    // Scratch space for the physics step, kept to avoid allocations
+    struct Collision
+    {
+        EntityHandle entity1;
+        EntityHandle entity2;
+    };
+    std::vector<Collision> m_collisions;
+    std::vector<EntityHandle> m_victims;
+    std::vector<uint8_t> m_collided;
+    SpatialHash m_collisionGrid;
+
+    ParticleSystem m_particles;
+    std::vector<Mgfx::SpriteInstance> m_sprites;
 
     GameState m_gameState = GameState::Start;
 
-    Timer m_inputTimer;
-    Timer m_physicsTimer;
-    Timer m_spawnTimer;
-    Timer m_keyholdTimer;
-    Timer m_ufoTimer;
+    // Game time is counted in steps; only the frame timer looks at the clock
+    Timer m_frameTimer;
+    float m_accumulator = 0.0f;
+    float m_simTime = 0.0f;
+    float m_spawnTime = 0.0f;
+    float m_keyholdTime = 0.0f;
+    float m_ufoTime = 0.0f;
+    uint32_t m_stepCount = 0;
+
+    uint32_t m_seed = 0;
+    std::mt19937 m_random;
+
+    enum class Playback
+    {
+        Live,
+        Recording,
+        Replaying
+    };
+    Playback m_playback = Playback::Live;
+    AsteroidsRecording m_recording;
     float m_nextUFOFireTime = 0.0f;
     uint32_t m_score = 0;
     int32_t m_lives = 3;
@@ -0,0 +1,133 @@
+#include "mgfx_app.h"
+#include "EntityPool.h"
+
+const uint32_t EntityPool::InvalidIndex;
+
+EntityHandle EntityPool::Add(EntityType entityType)
+{
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = uint32_t(m_slots.size());
+        m_slots.push_back(Slot());
+    }
+
+    uint32_t index = Size();
+    m_slots[slot].index = index;
+    m_indexToSlot.push_back(slot);
+
+    type.push_back(entityType);
+    position.push_back(glm::vec3(0.0f));
+    velocity.push_back(glm::vec2(0.0f));
+    acceleration.push_back(glm::vec2(0.0f));
+    angle.push_back(0.0f);
+    rotationalVelocity.push_back(0.0f);
+    age.push_back(0.0f);
+    death.push_back(0.0f);
+    sizeScale.push_back(1.0f);
+    color.push_back(glm::vec4(1.0f));
+    spriteCoords.push_back(glm::ivec2(0));
+    spriteSize.push_back(glm::ivec2(0));
+    previousPosition.push_back(glm::vec3(0.0f));
+    previousAngle.push_back(0.0f);
+    hasPrevious.push_back(0);
+
+    return EntityHandle{ slot, m_slots[slot].generation };
+}
+
+void EntityPool::Remove(EntityHandle handle)
+{
+    auto index = IndexOf(handle);
+    if (index == InvalidIndex)
+    {
+        return;
+    }
+
+    // Move the last entity into the hole
+    auto last = Size() - 1;
+    if (index != last)
+    {
+        type[index] = type[last];
+        position[index] = position[last];
+        velocity[index] = velocity[last];
+        acceleration[index] = acceleration[last];
+        angle[index] = angle[last];
+        rotationalVelocity[index] = rotationalVelocity[last];
+        age[index] = age[last];
+        death[index] = death[last];
+        sizeScale[index] = sizeScale[last];
+        color[index] = color[last];
+        spriteCoords[index] = spriteCoords[last];
+        spriteSize[index] = spriteSize[last];
+        previousPosition[index] = previousPosition[last];
+        previousAngle[index] = previousAngle[last];
+        hasPrevious[index] = hasPrevious[last];
+
+        m_indexToSlot[index] = m_indexToSlot[last];
+        m_slots[m_indexToSlot[index]].index = index;
+    }
+
+    type.pop_back();
+    position.pop_back();
+    velocity.pop_back();
+    acceleration.pop_back();
+    angle.pop_back();
+    rotationalVelocity.pop_back();
+    age.pop_back();
+    death.pop_back();
+    sizeScale.pop_back();
+    color.pop_back();
+    spriteCoords.pop_back();
+    spriteSize.pop_back();
+    previousPosition.pop_back();
+    previousAngle.pop_back();
+    hasPrevious.pop_back();
+    m_indexToSlot.pop_back();
+
+    // Invalidate any handles to this slot
+    auto& slot = m_slots[handle.slot];
+    slot.index = InvalidIndex;
+    slot.generation++;
+    m_freeSlots.push_back(handle.slot);
+}
+
+void EntityPool::Clear()
+{
+    while (Size() > 0)
+    {
+        Remove(HandleOf(Size() - 1));
+    }
+}
+
+void EntityPool::StorePrevious()
+{
+    previousPosition = position;
+    previousAngle = angle;
+    hasPrevious.assign(Size(), 1);
+}
+
+bool EntityPool::IsValid(EntityHandle handle) const
+{
+    return IndexOf(handle) != InvalidIndex;
+}
+
+uint32_t EntityPool::IndexOf(EntityHandle handle) const
+{
+    if (handle.slot >= m_slots.size() ||
+        m_slots[handle.slot].generation != handle.generation)
+    {
+        return InvalidIndex;
+    }
+    return m_slots[handle.slot].index;
+}
+
+EntityHandle EntityPool::HandleOf(uint32_t index) const
+{
+    auto slot = m_indexToSlot[index];
+    return EntityHandle{ slot, m_slots[slot].generation };
+}
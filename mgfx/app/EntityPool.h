@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+enum class EntityType
+{
+    Unknown,
+    Ship,
+    BigBoulder,
+    MediumBoulder,
+    SmallBoulder,
+    Star,
+    Exhaust,
+    Laser,
+    Explosion,
+    UFOEasy,
+    UFOHard,
+    UFOLaser,
+    Digit,
+    Count
+};
+
+// A reference to an entity in the pool.
+// The generation changes when the slot is reused, so a stale handle is never confused with a new entity
+struct EntityHandle
+{
+    EntityHandle() {}
+    EntityHandle(uint32_t s, uint32_t g) : slot(s), generation(g) {}
+
+    uint32_t slot = 0xFFFFFFFF;
+    uint32_t generation = 0;
+
+    bool operator == (const EntityHandle& rhs) const { return slot == rhs.slot && generation == rhs.generation; }
+    bool operator != (const EntityHandle& rhs) const { return !(*this == rhs); }
+};
+
+// Entities stored as a structure of arrays.
+// The arrays are packed; removal moves the last entity into the hole, so adding and removing are O(1)
+// and walking the entities is a linear scan over contiguous memory.
+// Entity indices are only stable until the next Remove; hold on to handles instead
+class EntityPool
+{
+public:
+    EntityHandle Add(EntityType entityType);
+    void Remove(EntityHandle handle);
+    void Clear();
+
+    bool IsValid(EntityHandle handle) const;
+
+    // The current index of the entity in the arrays, or InvalidIndex
+    uint32_t IndexOf(EntityHandle handle) const;
+    EntityHandle HandleOf(uint32_t index) const;
+    uint32_t Size() const { return uint32_t(type.size()); }
+
+    // Remember the current positions and angles, for interpolating between simulation steps.
+    // Entities added afterwards have no previous state until the next call
+    void StorePrevious();
+
+    // Call fn(index) for every entity of the given type
+    template<typename F>
+    void ForEach(EntityType entityType, F fn)
+    {
+        for (uint32_t index = 0; index < Size(); index++)
+        {
+            if (type[index] == entityType)
+            {
+                fn(index);
+            }
+        }
+    }
+
+    static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    // Entity data, indexed by entity index
+    std::vector<EntityType> type;
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec2> velocity;
+    std::vector<glm::vec2> acceleration;
+    std::vector<float> angle;
+    std::vector<float> rotationalVelocity;
+    std::vector<float> age;
+    std::vector<float> death;
+    std::vector<float> sizeScale;
+    std::vector<glm::vec4> color;
+    std::vector<glm::ivec2> spriteCoords;
+    std::vector<glm::ivec2> spriteSize;
+
+    // State at the start of the last step
+    std::vector<glm::vec3> previousPosition;
+    std::vector<float> previousAngle;
+    std::vector<uint8_t> hasPrevious;
+
+private:
+    struct Slot
+    {
+        uint32_t index = InvalidIndex;
+        uint32_t generation = 0;
+    };
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<uint32_t> m_indexToSlot;
+};
@@ -0,0 +1,83 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "mgfx/app/EntityPool.h"
+
+TEST(EntityPool, AddRemove)
+{
+    EntityPool pool;
+    auto first = pool.Add(EntityType::Ship);
+    auto second = pool.Add(EntityType::Laser);
+    auto third = pool.Add(EntityType::Star);
+    pool.position[pool.IndexOf(third)] = glm::vec3(3.0f);
+
+    ASSERT_EQ(pool.Size(), 3u);
+
+    // The last entity fills the hole, and keeps its data
+    pool.Remove(first);
+    ASSERT_EQ(pool.Size(), 2u);
+    ASSERT_FALSE(pool.IsValid(first));
+    ASSERT_TRUE(pool.IsValid(second));
+    ASSERT_EQ(pool.IndexOf(third), 0u);
+    ASSERT_EQ(pool.type[pool.IndexOf(third)], EntityType::Star);
+    ASSERT_EQ(pool.position[pool.IndexOf(third)], glm::vec3(3.0f));
+
+    // Removing twice is harmless
+    pool.Remove(first);
+    ASSERT_EQ(pool.Size(), 2u);
+}
+
+TEST(EntityPool, StaleHandle)
+{
+    EntityPool pool;
+    auto first = pool.Add(EntityType::Ship);
+    pool.Remove(first);
+
+    // The slot is reused, but the old handle doesn't see the new entity
+    auto second = pool.Add(EntityType::Laser);
+    ASSERT_EQ(first.slot, second.slot);
+    ASSERT_FALSE(pool.IsValid(first));
+    ASSERT_EQ(pool.IndexOf(first), EntityPool::InvalidIndex);
+    ASSERT_TRUE(pool.IsValid(second));
+    ASSERT_EQ(pool.HandleOf(pool.IndexOf(second)), second);
+}
+
+TEST(EntityPool, ForEach)
+{
+    EntityPool pool;
+    for (int i = 0; i < 10; i++)
+    {
+        pool.Add(i % 2 ? EntityType::Laser : EntityType::Star);
+    }
+
+    int count = 0;
+    pool.ForEach(EntityType::Laser, [&](uint32_t index)
+    {
+        ASSERT_EQ(pool.type[index], EntityType::Laser);
+        count++;
+    });
+    ASSERT_EQ(count, 5);
+
+    pool.Clear();
+    ASSERT_EQ(pool.Size(), 0u);
+}
+
+TEST(EntityPool, StorePrevious)
+{
+    EntityPool pool;
+    auto first = pool.Add(EntityType::Ship);
+    auto second = pool.Add(EntityType::Star);
+    pool.position[pool.IndexOf(second)] = glm::vec3(2.0f);
+    pool.StorePrevious();
+    pool.position[pool.IndexOf(second)] = glm::vec3(4.0f);
+
+    // New entities have nothing to interpolate from
+    auto third = pool.Add(EntityType::Laser);
+    ASSERT_EQ(pool.hasPrevious[pool.IndexOf(third)], 0);
+
+    // The previous state moves with the entity
+    pool.Remove(first);
+    auto index = pool.IndexOf(second);
+    ASSERT_EQ(pool.hasPrevious[index], 1);
+    ASSERT_EQ(pool.previousPosition[index], glm::vec3(2.0f));
+    ASSERT_EQ(pool.position[index], glm::vec3(4.0f));
+}
@@ -3,6 +3,7 @@
 #include "graphics3d/device/IDevice.h"
 #include "graphics3d/camera/camera.h"
 #include "GameOfLife.h"
+#include "profile/profiler.h"
 #include <thread>
 
 const char* GameOfLife::Description() const
@@ -33,8 +34,18 @@ void GameOfLife::ResizeWindow(Mgfx::Window* pWindow)
 
 void GameOfLife::AddToWindow(Mgfx::Window* pWindow)
 {
-    // Not necessary, but forces the creation of quad/vb here
-    GetWindowData<WindowDataFullScreenQuad>(pWindow);
+    // A byte per cell; dead is 0, and live cells are 128 + their age, which the palette colors
+    auto pData = GetWindowData<WindowDataFullScreenQuad>(pWindow);
+    pData->SetQuadFormat(TextureFormat::R8);
+
+    std::vector<glm::u8vec4> palette(256, glm::u8vec4(0, 0, 0, 255));
+    for (uint32_t age = 0; age < 128; age++)
+    {
+        // Scale by age for more interesting visualization
+        auto scaled = uint8_t(std::min(255.0f * (age / 100.0f), 255.0f));
+        palette[128 + age] = glm::u8vec4(scaled, 255 - scaled, 0, 255);
+    }
+    pWindow->GetDevice()->SetTexturePalette(pData->GetQuad(), palette.data(), uint32_t(palette.size()));
 }
 
 void GameOfLife::RemoveFromWindow(Mgfx::Window* pWindow)
@@ -61,7 +72,7 @@ void GameOfLife::Render(Mgfx::Window* pWindow)
     m_spCamera->SetPositionAndFocalPoint(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
     pWindow->GetDevice()->SetCamera(m_spCamera.get());
 
-    auto bitmapData = pWindow->GetDevice()->ResizeTexture(pWindowData->GetQuad(), pWindowData->GetQuadSize());
+    auto bitmapData = pWindow->GetDevice()->ResizeTexture(pWindowData->GetQuad(), pWindowData->GetQuadSize(), pWindowData->GetQuadFormat());
 
     // Resize our ping-pong buffers
     if (m_gridSize != size)
@@ -79,28 +90,19 @@ void GameOfLife::Render(Mgfx::Window* pWindow)
     // Step the simulation
     Step();
 
-    // Copy the results to the quad
+    // Copy the results to the quad, a block of rows per core
     auto pCells = &m_buffers[1 - m_currentBuffer][0];
-    for (uint32_t y = 0; y < size.y; y++)
+    ParallelFor(size.y, 16, [&](uint32_t begin, uint32_t end)
     {
-        for (uint32_t x = 0; x < size.x; x++)
+        for (uint32_t y = begin; y < end; y++)
         {
-            auto pCurrentCell = pCells + (y * m_gridSize.x + x);
-            auto& pixel = *bitmapData.LinePtr(y, x);
-            if (pCurrentCell->alive)
+            for (uint32_t x = 0; x < size.x; x++)
             {
-                // Alive, scale by age for more interesting visualization
-                uint32_t age = (uint8_t)(255.0f * ((float)pCurrentCell->age / 100.0f));
-                pixel.r = age;
-                pixel.g = 255 - age;
-                pixel.a = 255;
-            }
-            else
-            {
-                pixel = glm::u8vec4(0, 0, 0, 255);
+                auto pCurrentCell = pCells + (y * m_gridSize.x + x);
+                *bitmapData.RowPtr<uint8_t>(y, x) = pCurrentCell->alive ? uint8_t(128 + pCurrentCell->age) : 0;
             }
         }
-    }
+    });
 
     // Use the graphics hardware to show our result
     // First, update the quad since we drew on it
@@ -127,6 +129,7 @@ void GameOfLife::Reset()
 
 void GameOfLife::Step()
 {
+    PROFILE_SCOPE("GameOfLife::Step");
     auto sourceBuffer = 1 - m_currentBuffer;
     auto destBuffer = m_currentBuffer;
 
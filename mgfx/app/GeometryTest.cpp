@@ -74,8 +74,7 @@ void GeometryTest::AddToWindow(Mgfx::Window* pWindow)
 
     // We don't want to loop around and start writing to buffers that aren't yet finished drawing.
     // So this number is backbuffers + 1
-    // This introduces the idea that we are 'cooperating' with the backend device behavior, which is probably beyond the 
-    // scope of this simple sample app. 
+    // The GL device fences its own streaming regions now, but DX12 maps the buffer directly and still relies on this.
     const uint32_t numFramesBuffered = 4;
     pData->AddGeometry(m_numQuads * verticesPerQuad * sizeof(GeometryVertex) * numFramesBuffered, m_numQuads * indicesPerQuad * numFramesBuffered *sizeof(uint32_t));
 
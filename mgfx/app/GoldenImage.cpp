@@ -0,0 +1,114 @@
+#include "mgfx_app.h"
+#include "GoldenImage.h"
+#include "graphics3d/device/IDevice.h"
+#include "mcommon/graphics/imagecompare.h"
+
+#include "stb/stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace Mgfx;
+using namespace MCommon;
+
+namespace
+{
+
+Bitmap CaptureBitmap(const FrameCapture& capture)
+{
+    return Bitmap{ (uint8_t*)capture.pixels.data(), capture.size.x * uint32_t(sizeof(glm::u8vec4)), capture.size };
+}
+
+std::string HashToString(uint64_t hash)
+{
+    std::ostringstream str;
+    str << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return str.str();
+}
+
+bool CheckGoldenImage(const fs::path& path, const FrameCapture& capture, uint32_t tolerance)
+{
+    int w, h, comp;
+    auto pGolden = stbi_load(path.string().c_str(), &w, &h, &comp, 4);
+    if (pGolden == nullptr)
+    {
+        LOG(ERROR) << "Couldn't load golden image: " << path.string();
+        return false;
+    }
+
+    bool pass = false;
+    if (glm::uvec2(w, h) != capture.size)
+    {
+        LOG(ERROR) << std::dec << "Golden image is " << w << "x" << h << ", frame is " << capture.size.x << "x" << capture.size.y;
+    }
+    else
+    {
+        Bitmap golden{ pGolden, uint32_t(w) * uint32_t(sizeof(glm::u8vec4)), capture.size };
+        auto diff = CompareImages(golden, CaptureBitmap(capture), tolerance);
+        pass = diff.differentPixels == 0;
+        LOG(INFO) << std::dec << (pass ? "Passed" : "FAILED") << ": " << diff.differentPixels << " pixels differ by more than " << tolerance
+            << ", Max difference: " << diff.maxDifference << ", Mean difference: " << diff.meanDifference;
+    }
+    stbi_image_free(pGolden);
+    return pass;
+}
+
+bool CheckGoldenHash(const fs::path& path, uint64_t hash, uint32_t tolerance)
+{
+    std::ifstream file(path.string());
+    std::string text;
+    file >> text;
+
+    uint64_t golden = 0;
+    try
+    {
+        golden = std::stoull(text, nullptr, 16);
+    }
+    catch (std::exception&)
+    {
+        LOG(ERROR) << "Couldn't read golden hash: " << path.string();
+        return false;
+    }
+
+    auto distance = HashDistance(golden, hash);
+    bool pass = distance <= tolerance;
+    LOG(INFO) << std::dec << (pass ? "Passed" : "FAILED") << ": Hash " << HashToString(hash) << ", Golden " << HashToString(golden) << ", " << distance << " bits differ";
+    return pass;
+}
+
+}
+
+bool SaveCapture(const fs::path& path, const FrameCapture& capture)
+{
+    if (!stbi_write_png(path.string().c_str(), capture.size.x, capture.size.y, 4, capture.pixels.data(), capture.size.x * sizeof(glm::u8vec4)))
+    {
+        LOG(ERROR) << "Couldn't write: " << path.string();
+        return false;
+    }
+    return true;
+}
+
+bool CheckGolden(const fs::path& path, const FrameCapture& capture, uint32_t tolerance)
+{
+    auto hash = PerceptualHash(CaptureBitmap(capture));
+    LOG(INFO) << std::dec << "Frame " << capture.frame << ", " << capture.size.x << "x" << capture.size.y << ", Hash: " << HashToString(hash);
+
+    bool image = path.extension().string() == ".png";
+    if (!fs::exists(path))
+    {
+        LOG(INFO) << "Writing new golden file: " << path.string();
+        if (image)
+        {
+            return SaveCapture(path, capture);
+        }
+
+        std::ofstream file(path.string());
+        file << HashToString(hash) << std::endl;
+        return bool(file);
+    }
+
+    return image ? CheckGoldenImage(path, capture, tolerance) : CheckGoldenHash(path, hash, tolerance);
+}
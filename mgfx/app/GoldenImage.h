@@ -0,0 +1,16 @@
+#pragma once
+
+namespace Mgfx
+{
+struct FrameCapture;
+}
+
+// Saving and checking the frames from capture runs.
+// A golden file ending in .png is compared pixel by pixel; any other file holds a perceptual hash, in hex,
+// which is smaller to store and tolerates small differences between drivers
+
+bool SaveCapture(const fs::path& path, const Mgfx::FrameCapture& capture);
+
+// If the golden file doesn't exist it is written from this frame, and the check passes.
+// The tolerance is the allowed difference of any channel for an image, or the number of different bits for a hash
+bool CheckGolden(const fs::path& path, const Mgfx::FrameCapture& capture, uint32_t tolerance);
@@ -3,8 +3,10 @@
 #include "graphics3d/device/IDevice.h"
 #include "graphics3d/camera/camera.h"
 #include "Mazes.h"
+#include "mgfx_settings.h"
 #include <glm/gtc/random.hpp>
-#include "mcommon/graphics/primitives2d.h"
+#include "mcommon/graphics/commandlist2d.h"
+#include "mcommon/string/murmur_hash.h"
 #include <list>
 using namespace Mgfx;
 using namespace MCommon;
@@ -17,35 +19,64 @@ const int East = 1;
 const int North = 2;
 const int South = 3;
 
+// Cells along the side of a chunk in the infinite maze
+const int ChunkSize = 16;
+
 struct Properties
 {
     uint32_t MazeWidth = 100;
     uint32_t MazeHeight = 100;
     bool ShowDistanceField = false;
     bool ShowPath = false;
+    bool Infinite = false;
+    int CellSize = 16;
+    int SpareChunks = 32;
 };
 
 Properties properties;
+
+int FloorDiv(int value, int divisor)
+{
+    return int(std::floor(float(value) / float(divisor)));
+}
+
+uint64_t ChunkKey(const glm::ivec2& coord)
+{
+    return (uint64_t(uint32_t(coord.x)) << 32) | uint64_t(uint32_t(coord.y));
+}
 }
 
 const char* Mazes::Description() const
 {
     return R"(The maze generated is a 'Perfect Maze', which has a unique path between any 2 points.  It is also 'solved' from top left to bottom right, and the texture of the maze can be displayed.
 See the book 'Mazes For Programmers' for lots of examples.  The settings let you see the single path between the corners and the 'texture' of the maze.
+The infinite maze is built from chunks which are generated from their own seed as you drag the view around.  Neighbouring chunks agree on the openings between them, and chunks that are no longer visible are thrown away.
 )";
 }
 
 bool Mazes::Init()
 {
     m_spCamera = std::make_shared<Camera>(CameraMode::Ortho);
-    RandomWalkMaze();
+    auto seed = MgfxSettings::Instance().GetSeed();
+    m_rng.seed(seed != 0 ? seed : std::random_device()());
+    GenerateMaze();
     return true;
 }
 
 void Mazes::CleanUp()
 {
-    m_cells.clear();
-    m_doors.clear();
+    m_maze = MazeGrid();
+    m_chunkCache.clear();
+    m_chunkLookup.clear();
+    m_pDrawnBits = nullptr;
+}
+
+// Mark every cell as stale, so it is redrawn on the next render.
+// A clear is only needed if the walls have changed
+void Mazes::InvalidateAll(bool clear)
+{
+    m_currentDrawCount++;
+    m_clearRequired |= clear;
 }
 
 void Mazes::ResizeWindow(Mgfx::Window* pWindow)
@@ -68,18 +99,53 @@ void Mazes::DrawGUI(Mgfx::Window* pWindow)
 {
     if (ImGui::Button("Regenerate"))
     {
-        RandomWalkMaze();
+        GenerateMaze();
+    }
+
+    if (ImGui::Checkbox("Infinite", &properties.Infinite))
+    {
+        GenerateMaze();
+    }
+
+    if (properties.Infinite)
+    {
+        if (ImGui::SliderInt("Cell Size", &properties.CellSize, 4, 64))
+        {
+            InvalidateAll(true);
+        }
+        ImGui::SliderInt("Spare Chunks", &properties.SpareChunks, 0, 256);
+        ImGui::Text("Drag with the left mouse button to move around");
+        ImGui::Text("Cached Chunks: %d, Generated: %d", int(m_chunkCache.size()), int(m_chunksGenerated));
+    }
+    else
+    {
+        int size = int(properties.MazeHeight);
+        if (ImGui::SliderInt("Size", &size, 2, 100))
+        {
+            properties.MazeWidth = properties.MazeHeight = size;
+            GenerateMaze();
+        }
     }
 
-    int size = int(properties.MazeHeight);
-    if (ImGui::SliderInt("Size", &size, 2, 100))
+    if (ImGui::Checkbox("Show Distance Field", &properties.ShowDistanceField))
     {
-        properties.MazeWidth = properties.MazeHeight = size;
-        RandomWalkMaze();
+        InvalidateAll(false);
     }
 
-    ImGui::Checkbox("Show Distance Field", &properties.ShowDistanceField);
-    ImGui::Checkbox("Show Path", &properties.ShowPath);
+    if (!properties.Infinite)
+    {
+        if (ImGui::Checkbox("Show Path", &properties.ShowPath))
+        {
+            // Only the path cells change
+            for (auto& cell : m_maze.cells)
+            {
+                if (cell.path)
+                {
+                    cell.drawCount = 0;
+                }
+            }
+        }
+    }
 }
 
 glm::ivec2 GetAdjacentCoords(glm::ivec2& coords, int direction)
@@ -111,16 +177,79 @@ Cell* Mazes::GetAdjacent(Cell& cell, int direction)
     }
 }
 
-Cell* Mazes::GetCell(const glm::ivec2& coord)
+Cell* MazeGrid::GetCell(const glm::ivec2& coord)
 {
-    if (coord.y < 0 || coord.y >= int(properties.MazeHeight) ||
-        coord.x < 0 || coord.x >= int(properties.MazeWidth))
+    if (coord.y < 0 || coord.y >= size.y ||
+        coord.x < 0 || coord.x >= size.x)
     {
         return nullptr;
     }
-    return &m_cells[coord.y * properties.MazeWidth + coord.x];
+    return &cells[coord.y * size.x + coord.x];
 };
 
+// A hash of the world seed and the chunk, so that every chunk can be built on its own
+uint64_t Mazes::ChunkSeed(const glm::ivec2& coord, uint32_t salt) const
+{
+    int32_t key[3] = { coord.x, coord.y, int32_t(salt) };
+    return murmur_hash_64(key, sizeof(key), m_worldSeed);
+}
+
+// Find a chunk in the cache, or build it
+MazeChunk* Mazes::GetChunk(const glm::ivec2& coord)
+{
+    auto key = ChunkKey(coord);
+    auto itrFound = m_chunkLookup.find(key);
+    if (itrFound != m_chunkLookup.end())
+    {
+        // Most recently used to the front
+        m_chunkCache.splice(m_chunkCache.begin(), m_chunkCache, itrFound->second);
+        return itrFound->second->get();
+    }
+
+    auto spChunk = std::make_shared<MazeChunk>();
+    spChunk->coord = coord;
+
+    std::mt19937 rng(uint32_t(ChunkSeed(coord, 0)));
+    RandomWalkMaze(spChunk->grid, glm::ivec2(ChunkSize), rng);
+    OpenChunkBorders(*spChunk);
+    CalculateDistances(spChunk->grid);
+
+    m_chunkCache.push_front(spChunk);
+    m_chunkLookup[key] = m_chunkCache.begin();
+    m_chunksGenerated++;
+    return spChunk.get();
+}
+
+// Each shared edge is owned by the chunk to the west or north of it, and the opening is picked from that chunk's seed.
+// So both neighbours agree on it without needing to talk to each other.
+void Mazes::OpenChunkBorders(MazeChunk& chunk)
+{
+    auto opening = [&](const glm::ivec2& owner, int direction)
+    {
+        return int(ChunkSeed(owner, direction + 1) % ChunkSize);
+    };
+
+    chunk.grid.GetCell(glm::ivec2(ChunkSize - 1, opening(chunk.coord, East)))->vecDoors[East]->open = true;
+    chunk.grid.GetCell(glm::ivec2(opening(chunk.coord, South), ChunkSize - 1))->vecDoors[South]->open = true;
+    chunk.grid.GetCell(glm::ivec2(0, opening(chunk.coord - glm::ivec2(1, 0), East)))->vecDoors[West]->open = true;
+    chunk.grid.GetCell(glm::ivec2(opening(chunk.coord - glm::ivec2(0, 1), South), 0))->vecDoors[North]->open = true;
+}
+
+// Throw away the least recently seen chunks that are off screen, keeping a few spare for panning back
+void Mazes::EvictChunks(uint32_t numVisible)
+{
+    while (m_chunkCache.size() > numVisible + uint32_t(properties.SpareChunks))
+    {
+        auto& spOldest = m_chunkCache.back();
+        if (spOldest->lastVisibleFrame == m_currentFrame)
+        {
+            break;
+        }
+        m_chunkLookup.erase(ChunkKey(spOldest->coord));
+        m_chunkCache.pop_back();
+    }
+}
+
 void Mazes::Render(Mgfx::Window* pWindow)
 {
     auto pData = GetWindowData<WindowDataFullScreenQuad>(pWindow);
@@ -130,30 +259,45 @@ void Mazes::Render(Mgfx::Window* pWindow)
     m_spCamera->SetFilmSize(size);
     m_spCamera->SetPositionAndFocalPoint(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
     pWindow->GetDevice()->SetCamera(m_spCamera.get());
-     
-    TextureData bitmapData = pData->GetQuadData();
-    for (uint32_t y = 0; y < size.y; y++)
-    {
-        std::fill(bitmapData.LinePtr(y, 0), bitmapData.LinePtr(y, size.x), glm::u8vec4(0));
-    }
 
-    int maxLength = std::max(properties.MazeHeight, properties.MazeWidth);
-    int maxWindowSize = std::min(size.x, size.y);
-    maxWindowSize -= 80;
+    m_currentFrame++;
 
-    float locationScale = std::floor(maxWindowSize / float(maxLength));
-    int cellHalfSize = int(locationScale / 2);
+    // Drag the infinite maze around
+    if (properties.Infinite)
+    {
+        auto& io = ImGui::GetIO();
+        if (!io.WantCaptureMouse && io.MouseDown[0])
+        {
+            auto delta = glm::ivec2(int(io.MouseDelta.x), int(io.MouseDelta.y));
+            if (delta != glm::ivec2(0))
+            {
+                m_viewOffset -= delta;
+                InvalidateAll(true);
+            }
+        }
+    }
 
-    glm::uvec2 border(size.x - (cellHalfSize * 2 * properties.MazeWidth),
-        size.y - (cellHalfSize * 2 * properties.MazeHeight));
-    border /= 2;
+    TextureData bitmapData = pData->GetQuadData();
 
-    m_currentDrawCount++;
+    // If the quad was reallocated, our cached drawing is gone
+    if (m_drawnSize != size || m_pDrawnBits != bitmapData.pData)
+    {
+        m_drawnSize = size;
+        m_pDrawnBits = bitmapData.pData;
+        InvalidateAll(true);
+    }
 
-    float distanceColorStep = 255.0f / float(m_maxDistance);
+    if (m_clearRequired)
+    {
+        for (uint32_t y = 0; y < size.y; y++)
+        {
+            std::fill(bitmapData.LinePtr(y, 0), bitmapData.LinePtr(y, size.x), glm::u8vec4(0));
+        }
+        m_clearRequired = false;
+    }
 
     Bitmap bitmap{ bitmapData.pData, bitmapData.pitch, size };
-    auto drawCell = [&](Cell& cell)
+    auto drawCell = [&](Cell& cell, const glm::ivec2& center, int cellHalfSize, float distanceColorStep)
     {
         glm::u8vec4 col(0, 0, 0, 200);
         if (cell.distance == -1)
@@ -168,19 +312,20 @@ void Mazes::Render(Mgfx::Window* pWindow)
             col.y = 255 - col.x;
         }
 
-        auto center = glm::uvec2(cell.center * locationScale) + border;
+        // Clear the inside of the cell; the walls are left alone, since they only change on regeneration
+        m_commands.DrawBlock(center.x - cellHalfSize + 1, center.y - cellHalfSize + 1, center.x + cellHalfSize, center.y + cellHalfSize, glm::u8vec4(0));
 
         const int blockBorder = cellHalfSize / 2;
         if (properties.ShowDistanceField)
         {
-            DrawBlock(bitmap, center.x - cellHalfSize + blockBorder, center.y - cellHalfSize + blockBorder, center.x + cellHalfSize - blockBorder, center.y + cellHalfSize - blockBorder, col);
+            m_commands.DrawBlock(center.x - cellHalfSize + blockBorder, center.y - cellHalfSize + blockBorder, center.x + cellHalfSize - blockBorder, center.y + cellHalfSize - blockBorder, col);
         }
 
         if (properties.ShowPath)
         {
             if (cell.path)
             {
-               DrawBlock(bitmap, center.x - cellHalfSize + blockBorder, center.y - cellHalfSize + blockBorder, center.x + cellHalfSize - blockBorder, center.y + cellHalfSize - blockBorder, glm::u8vec4(0, 255, 255, 255));
+               m_commands.DrawBlock(center.x - cellHalfSize + blockBorder, center.y - cellHalfSize + blockBorder, center.x + cellHalfSize - blockBorder, center.y + cellHalfSize - blockBorder, glm::u8vec4(0, 255, 255, 255));
             }
         }
 
@@ -190,52 +335,133 @@ void Mazes::Render(Mgfx::Window* pWindow)
         col.w = 255;
         if (!cell.vecDoors[East]->open)
         {
-            DrawLine(bitmap, center.x + cellHalfSize, center.y - cellHalfSize, center.x + cellHalfSize, center.y + cellHalfSize, col);
+            m_commands.DrawLine(center.x + cellHalfSize, center.y - cellHalfSize, center.x + cellHalfSize, center.y + cellHalfSize, col);
         }
         if (!cell.vecDoors[West]->open)
         {
-            DrawLine(bitmap, center.x - cellHalfSize, center.y - cellHalfSize, center.x - cellHalfSize, center.y + cellHalfSize, col);
+            m_commands.DrawLine(center.x - cellHalfSize, center.y - cellHalfSize, center.x - cellHalfSize, center.y + cellHalfSize, col);
         }
         if (!cell.vecDoors[North]->open)
         {
-            DrawLine(bitmap, center.x - cellHalfSize, center.y - cellHalfSize, center.x + cellHalfSize, center.y - cellHalfSize, col);
+            m_commands.DrawLine(center.x - cellHalfSize, center.y - cellHalfSize, center.x + cellHalfSize, center.y - cellHalfSize, col);
         }
         if (!cell.vecDoors[South]->open)
         {
-            DrawLine(bitmap, center.x - cellHalfSize, center.y + cellHalfSize, center.x + cellHalfSize, center.y + cellHalfSize, col);
+            m_commands.DrawLine(center.x - cellHalfSize, center.y + cellHalfSize, center.x + cellHalfSize, center.y + cellHalfSize, col);
         }
     };
 
-    for (auto& spCell : m_cells)
+    // Only draw the cells that have changed since they were last drawn
+    bool dirty = false;
+    auto drawGrid = [&](MazeGrid& grid, const glm::ivec2& origin, float locationScale)
+    {
+        int cellHalfSize = int(locationScale / 2);
+        float distanceColorStep = 255.0f / float(std::max(grid.maxDistance, 1u));
+        for (auto& cell : grid.cells)
+        {
+            if (cell.drawCount != m_currentDrawCount)
+            {
+                drawCell(cell, glm::ivec2(cell.center * locationScale) + origin, cellHalfSize, distanceColorStep);
+                cell.drawCount = m_currentDrawCount;
+                dirty = true;
+            }
+        }
+    };
+
+    if (properties.Infinite)
+    {
+        // Only the chunks under the view are generated and drawn
+        int chunkPixels = ChunkSize * properties.CellSize;
+        glm::ivec2 firstChunk(FloorDiv(m_viewOffset.x, chunkPixels), FloorDiv(m_viewOffset.y, chunkPixels));
+        glm::ivec2 lastChunk(FloorDiv(m_viewOffset.x + int(size.x) - 1, chunkPixels), FloorDiv(m_viewOffset.y + int(size.y) - 1, chunkPixels));
+
+        uint32_t numVisible = 0;
+        for (int y = firstChunk.y; y <= lastChunk.y; y++)
+        {
+            for (int x = firstChunk.x; x <= lastChunk.x; x++)
+            {
+                auto pChunk = GetChunk(glm::ivec2(x, y));
+                pChunk->lastVisibleFrame = m_currentFrame;
+                drawGrid(pChunk->grid, pChunk->coord * chunkPixels - m_viewOffset, float(properties.CellSize));
+                numVisible++;
+            }
+        }
+        EvictChunks(numVisible);
+    }
+    else
     {
-        drawCell(spCell);
+        int maxLength = std::max(properties.MazeHeight, properties.MazeWidth);
+        int maxWindowSize = std::min(size.x, size.y);
+        maxWindowSize -= 80;
+
+        float locationScale = std::floor(maxWindowSize / float(maxLength));
+        int cellHalfSize = int(locationScale / 2);
+
+        glm::uvec2 border(size.x - (cellHalfSize * 2 * properties.MazeWidth),
+            size.y - (cellHalfSize * 2 * properties.MazeHeight));
+        border /= 2;
+
+        drawGrid(m_maze, glm::ivec2(border), locationScale);
     }
 
+    // The cells were recorded; draw them all at once, across the cores
+    m_commands.Flush(bitmap);
+
     // Use the graphics hardware to show our result
-    // First, update the quad since we drew on it
-    pWindow->GetDevice()->UpdateTexture(pData->GetQuad());
+    // First, update the quad if we drew on it; the texture keeps its contents otherwise
+    if (dirty)
+    {
+        pWindow->GetDevice()->UpdateTexture(pData->GetQuad());
+    }
 
     // Draw the quad over the whole screen
     pData->DrawFSQuad();
 }
 
-void Mazes::RandomWalkMaze()
+// Build the maze for the current mode
+void Mazes::GenerateMaze()
 {
-    m_cells.resize(properties.MazeHeight * properties.MazeWidth);
-    m_doors.clear();
+    // New walls, so a full redraw
+    InvalidateAll(true);
 
-    for (unsigned int x = 0; x < properties.MazeWidth; x++)
+    m_chunkCache.clear();
+    m_chunkLookup.clear();
+    m_chunksGenerated = 0;
+
+    if (properties.Infinite)
     {
-        for (unsigned int y = 0; y < properties.MazeHeight; y++)
+        // Every chunk is derived from the world seed
+        m_maze = MazeGrid();
+        m_worldSeed = (uint64_t(m_rng()) << 32) | m_rng();
+        m_viewOffset = glm::ivec2(0);
+    }
+    else
+    {
+        RandomWalkMaze(m_maze, glm::ivec2(properties.MazeWidth, properties.MazeHeight), m_rng);
+        CalculateDistances(m_maze);
+        FindPath(m_maze);
+    }
+}
+
+void Mazes::RandomWalkMaze(MazeGrid& grid, const glm::ivec2& size, std::mt19937& rng)
+{
+    grid.size = size;
+    grid.cells.clear();
+    grid.cells.resize(size.x * size.y);
+    grid.doors.clear();
+
+    for (int x = 0; x < size.x; x++)
+    {
+        for (int y = 0; y < size.y; y++)
         {
             glm::ivec2 coord(x, y);
 
-            GetCell(coord)->center = glm::vec2(x + .5f, y + .5f);
-            GetCell(coord)->coord = glm::uvec2(x, y);
-            GetCell(coord)->visitCount = 0;
-            GetCell(coord)->drawCount = 0;
-            GetCell(coord)->distance = -1;
-            GetCell(coord)->path = false;
+            grid.GetCell(coord)->center = glm::vec2(x + .5f, y + .5f);
+            grid.GetCell(coord)->coord = coord;
+            grid.GetCell(coord)->visitCount = 0;
+            grid.GetCell(coord)->drawCount = 0;
+            grid.GetCell(coord)->distance = -1;
+            grid.GetCell(coord)->path = false;
         }
     }
 
@@ -244,21 +470,21 @@ void Mazes::RandomWalkMaze()
     {
         // This should be easier; best way to find a unique door?
         auto dirTarget = GetAdjacentCoords(cell.coord, direction);
-        auto index1 = ((dirTarget.y + 1) * properties.MazeWidth * 2) + (dirTarget.x + 1);
-        auto index2 = ((cell.coord.y + 1) * properties.MazeWidth * 2) + (cell.coord.x + 1);
+        auto index1 = ((dirTarget.y + 1) * size.x * 2) + (dirTarget.x + 1);
+        auto index2 = ((cell.coord.y + 1) * size.x * 2) + (cell.coord.x + 1);
         if (index1 > index2)
             std::swap(index1, index2);
 
         uint64_t key = (uint64_t(index1) | (uint64_t(index2) << 32));
-        return &m_doors[key];
+        return &grid.doors[key];
     };
 
     // Add the doors
-    for (unsigned int y = 0; y < properties.MazeHeight; y++)
+    for (int y = 0; y < size.y; y++)
     {
-        for (unsigned int x = 0; x < properties.MazeWidth; x++)
+        for (int x = 0; x < size.x; x++)
         {
-            auto cell = GetCell(glm::ivec2(x, y));
+            auto cell = grid.GetCell(glm::ivec2(x, y));
             cell->vecDoors.resize(4);
 
             auto pLeftDoor = getUniqueDoor(*cell, West);
@@ -279,31 +505,19 @@ void Mazes::RandomWalkMaze()
         }
     }
 
-    auto oppositeDir = [](int dir)
-    {
-        switch (dir)
-        {
-        default:
-        case East:
-            return West;
-        case West:
-            return East;
-        case North:
-            return South;
-        case South:
-            return North;
-        }
-    };
-
     // Random Walk - lets start from a random point
-    auto pCurrent = &m_cells[glm::linearRand(uint32_t(size_t(0)), uint32_t(m_cells.size() - 1))];
+    std::uniform_int_distribution<uint32_t> cellDist(0, uint32_t(grid.cells.size() - 1));
+    std::uniform_int_distribution<uint32_t> dirDist(0, 3);
+
+    auto pCurrent = &grid.cells[cellDist(rng)];
     m_currentVisitCount++;
+    pCurrent->visitCount = m_currentVisitCount;
 
-    auto NumToVisit = properties.MazeWidth * properties.MazeHeight;
+    auto NumToVisit = grid.cells.size() - 1;
     while (NumToVisit > 0)
     {
         // Walk in a random direction
-        auto dir = glm::linearRand(uint32_t(0), uint32_t(3));
+        auto dir = dirDist(rng);
         auto pTarget = GetAdjacent(*pCurrent, dir);
         if (pTarget)
         {
@@ -319,15 +533,15 @@ void Mazes::RandomWalkMaze()
             pCurrent = pTarget;
         }
     }
+}
 
-
-    m_currentVisitCount++;
-
-    // Dijkstra
+// Dijkstra, from the top left
+void Mazes::CalculateDistances(MazeGrid& grid)
+{
     std::list<Cell*> considerCells;
-    considerCells.push_back(&m_cells[0]);
+    considerCells.push_back(&grid.cells[0]);
 
-    m_maxDistance = 0;
+    grid.maxDistance = 0;
     while (!considerCells.empty())
     {
         auto* thisEntry = considerCells.back();
@@ -342,20 +556,24 @@ void Mazes::RandomWalkMaze()
             auto pDoor = thisEntry->vecDoors[i];
             if (pDoor->open)
             {
+                // Chunk border openings lead out of the grid
                 Cell* entry = GetAdjacent(*thisEntry, i);
-                if (entry->distance == -1)
+                if (entry && entry->distance == -1)
                 {
                     entry->distance = thisEntry->distance + 1;
                     considerCells.push_back(entry);
-                    m_maxDistance = std::max((uint32_t)entry->distance, m_maxDistance);
+                    grid.maxDistance = std::max((uint32_t)entry->distance, grid.maxDistance);
                 }
             }
         }
     }
+}
 
-    // Find the shortest path by walking from the end back to the beginning,
-    // while travelling along the minimum distance route
-    Cell* cell = GetCell(glm::ivec2(properties.MazeWidth - 1, properties.MazeHeight - 1));
+// Find the shortest path by walking from the end back to the beginning,
+// while travelling along the minimum distance route
+void Mazes::FindPath(MazeGrid& grid)
+{
+    Cell* cell = grid.GetCell(grid.size - glm::ivec2(1));
 
     while (cell->distance != 0)
     {
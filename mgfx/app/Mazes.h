@@ -1,7 +1,11 @@
 #pragma once
 
 #include "MgfxRender.h"
+#include "mcommon/graphics/commandlist2d.h"
 #include <glm/gtx/hash.hpp>
+#include <unordered_map>
+#include <random>
+#include <list>
 
 struct Cell;
 
@@ -25,6 +29,26 @@ struct Cell
     std::vector<Door*> vecDoors;  // Doors, indexed by directions
 };
 
+// A rectangular grid of cells and the doors between them.
+// The fixed maze is a single grid, the infinite maze is a grid per chunk
+struct MazeGrid
+{
+    glm::ivec2 size = glm::ivec2(0);
+    std::vector<Cell> cells;
+    std::unordered_map<uint64_t, Door> doors;
+    uint32_t maxDistance = 0;
+
+    Cell* GetCell(const glm::ivec2& coord);
+};
+
+// A piece of the infinite maze, generated on demand from its own seed
+struct MazeChunk
+{
+    glm::ivec2 coord;
+    MazeGrid grid;
+    uint32_t lastVisibleFrame = 0;
+};
+
 // Drawing into CPU memory and displaying it with the GPU
 class Mazes : public MgfxRender
 {
@@ -40,19 +64,39 @@ public:
     virtual const char* Description() const override;
 
 private:
-    void RandomWalkMaze();
+    void GenerateMaze();
+    void RandomWalkMaze(MazeGrid& grid, const glm::ivec2& size, std::mt19937& rng);
+    void CalculateDistances(MazeGrid& grid);
+    void FindPath(MazeGrid& grid);
+    void InvalidateAll(bool clear);
+
+    // Infinite maze
+    MazeChunk* GetChunk(const glm::ivec2& coord);
+    void OpenChunkBorders(MazeChunk& chunk);
+    void EvictChunks(uint32_t numVisible);
+    uint64_t ChunkSeed(const glm::ivec2& coord, uint32_t salt) const;
 
-    Door& HashDoor(Cell& cell, int direction);
     Cell* GetAdjacent(Cell& pCell, int direction);
-    Cell* GetCell(const glm::ivec2& coord);
 
 private:
-    std::vector<Cell> m_cells;
-    std::unordered_map<uint64_t, Door> m_doors;
+    MazeGrid m_maze;
+    std::mt19937 m_rng;
+
+    // Chunks of the infinite maze; most recently visible at the front
+    std::list<std::shared_ptr<MazeChunk>> m_chunkCache;
+    std::unordered_map<uint64_t, std::list<std::shared_ptr<MazeChunk>>::iterator> m_chunkLookup;
+    uint64_t m_worldSeed = 0;
+    uint32_t m_currentFrame = 0;
+    uint32_t m_chunksGenerated = 0;
+    glm::ivec2 m_viewOffset = glm::ivec2(0);
 
     uint32_t m_currentDrawCount = 0;
     uint32_t m_currentVisitCount = 0;
-    uint32_t m_maxDistance = 0;
+
+    // The quad bitmap is a cache of the maze; we only clear it when the layout changes
+    bool m_clearRequired = true;
+    glm::uvec2 m_drawnSize = glm::uvec2(0);
+    uint8_t* m_pDrawnBits = nullptr;
+    MCommon::CommandList2D m_commands;
     std::shared_ptr<Mgfx::Camera> m_spCamera;
 };
-
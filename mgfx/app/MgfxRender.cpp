@@ -83,11 +83,20 @@ void WindowDataFullScreenQuad::DrawFSQuad()
     m_pWindow->GetDevice()->EndGeometry();
 }
 
+void WindowDataFullScreenQuad::SetQuadFormat(TextureFormat format)
+{
+    if (m_quadFormat != format)
+    {
+        m_quadFormat = format;
+        Resize();
+    }
+}
+
 void WindowDataFullScreenQuad::Resize()
 {
     if (m_pWindow && m_quadID != 0)
     {
-        m_quadData = m_pWindow->GetDevice()->ResizeTexture(m_quadID, m_pWindow->GetClientSize());
+        m_quadData = m_pWindow->GetDevice()->ResizeTexture(m_quadID, m_pWindow->GetClientSize(), m_quadFormat);
         m_quadSize = m_pWindow->GetClientSize();
 
         glm::vec2 quadPos(0.0f);
@@ -50,10 +50,15 @@ public:
     const glm::uvec2& GetQuadSize() const { return m_quadSize; }
     const Mgfx::TextureData& GetQuadData() const { return m_quadData; }
 
+    // Reallocates the quad data if the format changes
+    void SetQuadFormat(Mgfx::TextureFormat format);
+    Mgfx::TextureFormat GetQuadFormat() const { return m_quadFormat; }
+
 protected:
     uint32_t m_quadID = 0;
     glm::uvec2 m_quadSize;
     Mgfx::TextureData m_quadData;
+    Mgfx::TextureFormat m_quadFormat = Mgfx::TextureFormat::RGBA8;
 
 private:
     std::shared_ptr<Mgfx::IDeviceBuffer> m_spFSVertexBuffer;
@@ -78,6 +83,8 @@ struct MgfxRender
     virtual const char* Name() const = 0;
     virtual const char* Description() const = 0;
 
+    // True until everything the renderer loads in the background is being drawn; captures wait for it
+    virtual bool IsLoading(Mgfx::Window* pWindow) { return false; }
 
     virtual void FreeWindowData(Mgfx::Window* pWindow)
     {
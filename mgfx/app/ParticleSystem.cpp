@@ -0,0 +1,148 @@
+#include "mgfx_app.h"
+#include "graphics3d/device/IDevice.h"
+#include "ParticleSystem.h"
+#include "profile/profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+using namespace Mgfx;
+
+ParticleSystem::ParticleSystem(uint32_t capacity)
+{
+    // Pad to a multiple of the vector width, so the integration never has a remainder
+    m_capacity = std::max(4u, (capacity + 3) & ~3u);
+
+    m_positionX.resize(m_capacity, 0.0f);
+    m_positionY.resize(m_capacity, 0.0f);
+    m_velocityX.resize(m_capacity, 0.0f);
+    m_velocityY.resize(m_capacity, 0.0f);
+    m_age.resize(m_capacity, 0.0f);
+    m_life.resize(m_capacity, 0.0f);
+    m_depth.resize(m_capacity, 0.0f);
+    m_angle.resize(m_capacity, 0.0f);
+    m_halfSize.resize(m_capacity);
+    m_texRect.resize(m_capacity);
+    m_color.resize(m_capacity);
+}
+
+void ParticleSystem::Emit(const glm::vec3& position,
+    const glm::vec2& velocity,
+    float life,
+    float angle,
+    const glm::vec2& halfSize,
+    const glm::vec4& texRect,
+    const glm::u8vec4& color)
+{
+    uint32_t index;
+    if (m_count < m_capacity)
+    {
+        index = m_count++;
+    }
+    else
+    {
+        index = m_nextReplace;
+        m_nextReplace = (m_nextReplace + 1) % m_capacity;
+    }
+
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_velocityX[index] = velocity.x;
+    m_velocityY[index] = velocity.y;
+    m_age[index] = 0.0f;
+    m_life[index] = life;
+    m_depth[index] = position.z;
+    m_angle[index] = angle;
+    m_halfSize[index] = halfSize;
+    m_texRect[index] = texRect;
+    m_color[index] = color;
+}
+
+void ParticleSystem::Step(float timeDelta)
+{
+    PROFILE_SCOPE("ParticleSystem::Step");
+    Integrate(timeDelta);
+    Compact();
+}
+
+void ParticleSystem::Integrate(float timeDelta)
+{
+    // Round up; the padding particles are integrated too, but never drawn
+    uint32_t count = (m_count + 3) & ~3u;
+
+#if PARTICLES_SSE
+    auto delta = _mm_set1_ps(timeDelta);
+    for (uint32_t index = 0; index < count; index += 4)
+    {
+        auto px = _mm_loadu_ps(&m_positionX[index]);
+        auto py = _mm_loadu_ps(&m_positionY[index]);
+        auto vx = _mm_loadu_ps(&m_velocityX[index]);
+        auto vy = _mm_loadu_ps(&m_velocityY[index]);
+        auto age = _mm_loadu_ps(&m_age[index]);
+
+        _mm_storeu_ps(&m_positionX[index], _mm_add_ps(px, _mm_mul_ps(vx, delta)));
+        _mm_storeu_ps(&m_positionY[index], _mm_add_ps(py, _mm_mul_ps(vy, delta)));
+        _mm_storeu_ps(&m_age[index], _mm_add_ps(age, delta));
+    }
+#else
+    for (uint32_t index = 0; index < count; index++)
+    {
+        m_positionX[index] += m_velocityX[index] * timeDelta;
+        m_positionY[index] += m_velocityY[index] * timeDelta;
+        m_age[index] += timeDelta;
+    }
+#endif
+}
+
+// Slide the live particles down over the dead ones
+void ParticleSystem::Compact()
+{
+    uint32_t live = 0;
+    for (uint32_t index = 0; index < m_count; index++)
+    {
+        if (m_age[index] >= m_life[index])
+        {
+            continue;
+        }
+
+        if (live != index)
+        {
+            m_positionX[live] = m_positionX[index];
+            m_positionY[live] = m_positionY[index];
+            m_velocityX[live] = m_velocityX[index];
+            m_velocityY[live] = m_velocityY[index];
+            m_age[live] = m_age[index];
+            m_life[live] = m_life[index];
+            m_depth[live] = m_depth[index];
+            m_angle[live] = m_angle[index];
+            m_halfSize[live] = m_halfSize[index];
+            m_texRect[live] = m_texRect[index];
+            m_color[live] = m_color[index];
+        }
+        live++;
+    }
+    m_count = live;
+}
+
+void ParticleSystem::AddSprites(std::vector<SpriteInstance>& sprites, const glm::vec2& textureSize, float timeOffset) const
+{
+    auto texScale = glm::vec4(1.0f / textureSize.x, 1.0f / textureSize.y, 1.0f / textureSize.x, 1.0f / textureSize.y);
+    for (uint32_t index = 0; index < m_count; index++)
+    {
+        sprites.push_back(SpriteInstance(glm::vec3(m_positionX[index] + m_velocityX[index] * timeOffset,
+                m_positionY[index] + m_velocityY[index] * timeOffset,
+                m_depth[index]),
+            m_angle[index],
+            m_halfSize[index],
+            m_texRect[index] * texScale,
+            m_color[index]));
+    }
+}
+
+void ParticleSystem::Clear()
+{
+    m_count = 0;
+    m_nextReplace = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Mgfx
+{
+struct SpriteInstance;
+}
+
+// Short lived sprites, such as explosion debris.
+// Particles live in fixed size arrays, one per field, so there is no allocation after construction.
+// Integration runs 4 particles at a time, and expired particles are removed in a single compaction pass.
+// When the pool is full, new particles replace existing ones in ring order.
+class ParticleSystem
+{
+public:
+    explicit ParticleSystem(uint32_t capacity = 8192);
+
+    // texRect is the atlas rectangle in texels
+    void Emit(const glm::vec3& position,
+        const glm::vec2& velocity,
+        float life,
+        float angle,
+        const glm::vec2& halfSize,
+        const glm::vec4& texRect,
+        const glm::u8vec4& color = glm::u8vec4(255));
+
+    // Move the particles and remove the dead ones
+    void Step(float timeDelta);
+
+    // Add a sprite for each particle, normalizing the atlas rectangles by the texture size.
+    // Positions are moved along the velocity by timeOffset, for drawing between steps
+    void AddSprites(std::vector<Mgfx::SpriteInstance>& sprites, const glm::vec2& textureSize, float timeOffset = 0.0f) const;
+
+    void Clear();
+    uint32_t Size() const { return m_count; }
+    uint32_t Capacity() const { return m_capacity; }
+
+private:
+    void Integrate(float timeDelta);
+    void Compact();
+
+private:
+    uint32_t m_capacity = 0;
+    uint32_t m_count = 0;
+    uint32_t m_nextReplace = 0;
+
+    // Updated every step
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+    std::vector<float> m_age;
+
+    // Fixed at emission
+    std::vector<float> m_life;
+    std::vector<float> m_depth;
+    std::vector<float> m_angle;
+    std::vector<glm::vec2> m_halfSize;
+    std::vector<glm::vec4> m_texRect;
+    std::vector<glm::u8vec4> m_color;
+};
@@ -0,0 +1,42 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "mgfx_core/graphics3d/device/IDevice.h"
+#include "mgfx/app/ParticleSystem.h"
+
+using namespace Mgfx;
+
+TEST(ParticleSystem, StepAndExpire)
+{
+    ParticleSystem particles(16);
+    particles.Emit(glm::vec3(0.0f), glm::vec2(10.0f, 0.0f), 1.0f, 0.0f, glm::vec2(1.0f), glm::vec4(0.0f, 0.0f, 8.0f, 8.0f));
+    particles.Emit(glm::vec3(0.0f), glm::vec2(0.0f, 10.0f), 2.0f, 0.0f, glm::vec2(1.0f), glm::vec4(0.0f, 0.0f, 8.0f, 8.0f));
+    particles.Emit(glm::vec3(0.0f), glm::vec2(0.0f, -10.0f), 0.25f, 0.0f, glm::vec2(1.0f), glm::vec4(0.0f, 0.0f, 8.0f, 8.0f));
+    ASSERT_EQ(particles.Size(), 3u);
+
+    particles.Step(0.5f);
+    ASSERT_EQ(particles.Size(), 2u);
+
+    std::vector<SpriteInstance> sprites;
+    particles.AddSprites(sprites, glm::vec2(16.0f));
+    ASSERT_EQ(sprites.size(), 2u);
+    ASSERT_EQ(sprites[0].pos, glm::vec3(5.0f, 0.0f, 0.0f));
+    ASSERT_EQ(sprites[1].pos, glm::vec3(0.0f, 5.0f, 0.0f));
+    ASSERT_EQ(sprites[0].texRect, glm::vec4(0.0f, 0.0f, 0.5f, 0.5f));
+
+    particles.Step(1.0f);
+    ASSERT_EQ(particles.Size(), 1u);
+}
+
+TEST(ParticleSystem, FullPoolReplaces)
+{
+    ParticleSystem particles(8);
+    ASSERT_EQ(particles.Capacity(), 8u);
+    for (int i = 0; i < 20; i++)
+    {
+        particles.Emit(glm::vec3(float(i)), glm::vec2(0.0f), 1.0f, 0.0f, glm::vec2(1.0f), glm::vec4(0.0f));
+    }
+    ASSERT_EQ(particles.Size(), 8u);
+
+    particles.Clear();
+    ASSERT_EQ(particles.Size(), 0u);
+}
@@ -3,9 +3,12 @@
 #include "graphics3d/device/IDevice.h"
 #include "graphics3d/camera/camera.h"
 #include "RayTracer.h"
+#include "mgfx_settings.h"
 #include <glm/gtc/random.hpp>
 #include "mcommon/graphics/primitives2d.h"
+#include "mcommon/graphics/imageops.h"
 #include "ui/camera_manipulator.h"
+#include "profile/profiler.h"
 #include <list>
 #include <thread>
 #include <chrono>
@@ -23,9 +26,13 @@ struct Properties
     float FieldOfView = 60.0f;
     int MaxDepth = 3;
     int Partitions = 2;
+    float Blur = 0.0f;
 };
 
 Properties properties;
+
+// Power - SRGB/Gamma 2.2
+const LinearLUT GammaLUT = LinearLUT::Build([](float value) { return std::pow(value, 2.2f); });
 }
 
 const char* RayTracer::Description() const
@@ -109,6 +116,7 @@ void RayTracer::DrawGUI(Mgfx::Window* pWindow)
     }
     ImGui::SliderInt("Max Depth", &properties.MaxDepth, 1, 5);
     ImGui::SliderInt("Num Threads", &properties.Partitions, 1, 12);
+    ImGui::SliderFloat("Blur", &properties.Blur, 0.0f, 4.0f);
     ImGui::Text("Samples: %d", m_currentFrame);
     ImGui::Text("RayTrace Time: %f ms", m_frameTime);
 }
@@ -286,25 +294,39 @@ void RayTracer::Render(Mgfx::Window* pWindow)
     if (m_threadRunning)
     {
         // Use wait_for() with zero milliseconds to check thread status.
-        auto status = m_future.wait_for(std::chrono::milliseconds(0));
+        // Capture runs wait, so each frame shows the same number of passes
+        auto waitTime = MgfxSettings::Instance().IsCapture() ? std::chrono::milliseconds(60000) : std::chrono::milliseconds(0);
+        auto status = m_future.wait_for(waitTime);
         if (status == std::future_status::ready)
         {
-            // Use the graphics hardware to show our result
+            // Use the graphics hardware to show our result.
+            // The float buffer is copied as it is, and the GPU clamps it; the blur works on 8 bit color, so converts on the CPU
+            pData->SetQuadFormat(properties.Blur > 0.0f ? TextureFormat::RGBA8 : TextureFormat::RGBA32F);
             auto pQuadData = pData->GetQuadData();
 
-            // First copy our floating point buffer into the staging memory for the texture
-            for (uint32_t y = 0; y < size.y; y++)
+            if (pQuadData.format == TextureFormat::RGBA32F)
             {
-                for (uint32_t x = 0; x < size.x; x++)
+                ParallelFor(size.y, 16, [&](uint32_t begin, uint32_t end)
                 {
-                    // Float color, clamped
-                    auto color = glm::min(glm::vec3(traceBuffer[y * size.x + x]), 1.0f);
-
-                    // Power - SRGB/Gamma 2.2
-                    color = glm::pow(color, glm::vec3(2.2f));
+                    for (uint32_t y = begin; y < end; y++)
+                    {
+                        auto pSource = &traceBuffer[y * size.x];
+                        auto pTarget = pQuadData.RowPtr<glm::vec4>(y);
+                        for (uint32_t x = 0; x < size.x; x++)
+                        {
+                            pTarget[x] = glm::vec4(pSource[x], 1.0f);
+                        }
+                    }
+                });
+            }
+            else
+            {
+                // First copy our floating point buffer into the staging memory for the texture
+                Bitmap bitmap{ pQuadData.pData, pQuadData.pitch, size };
+                ConvertLinear(traceBuffer.data(), bitmap, GammaLUT);
 
-                    *pQuadData.LinePtr(y, x) = glm::u8vec4(color * 255.0f, 255);
-                }
+                // Soften the noise of the early samples
+                ConvolveSeparable(bitmap, bitmap, GaussianKernel(properties.Blur));
             }
             pWindow->GetDevice()->UpdateTexture(pData->GetQuad());
 
@@ -328,6 +350,7 @@ void RayTracer::Render(Mgfx::Window* pWindow)
         // Run the ray tracing asynchronously to this rendering thread
         m_future = std::async(std::launch::async, [=]
         {
+            PROFILE_SCOPE("RayTracer::Trace");
             auto start = std::chrono::high_resolution_clock::now();
 
             // If camera moved, start accumulatig pixels
@@ -349,6 +372,7 @@ void RayTracer::Render(Mgfx::Window* pWindow)
             {
                 auto pT = std::make_shared<std::thread>([=](int offset)
                 {
+                    PROFILE_SCOPE("TraceRay batch");
                     for (int y = offset; y < int(size.y); y += properties.Partitions)
                     {
                         if (m_killThread)
@@ -0,0 +1,70 @@
+#include "mgfx_app.h"
+#include "SpatialHash.h"
+
+const uint32_t SpatialHash::MaxCells;
+
+void SpatialHash::Begin(const glm::vec2& origin, const glm::vec2& extent, float cellSize)
+{
+    m_origin = origin;
+    m_cellSize = std::max(std::max(cellSize, 1.0f), std::sqrt(extent.x * extent.y / float(MaxCells)));
+    m_gridSize = glm::max(glm::ivec2(glm::ceil(extent / m_cellSize)), glm::ivec2(1));
+
+    // Rounding up each side can still go over
+    while (NumCells() > MaxCells)
+    {
+        m_cellSize *= 1.1f;
+        m_gridSize = glm::max(glm::ivec2(glm::ceil(extent / m_cellSize)), glm::ivec2(1));
+    }
+
+    m_addedItems.clear();
+    m_addedCells.clear();
+}
+
+void SpatialHash::Add(uint32_t item, const glm::vec2& position)
+{
+    m_addedItems.push_back(item);
+    m_addedCells.push_back(CellIndex(CellCoord(position)));
+}
+
+void SpatialHash::End()
+{
+    // Count the items in each cell
+    m_cellStart.assign(NumCells() + 1, 0);
+    for (auto& cell : m_addedCells)
+    {
+        m_cellStart[cell + 1]++;
+    }
+
+    // Running total gives the start of each cell
+    for (uint32_t cell = 0; cell < NumCells(); cell++)
+    {
+        m_cellStart[cell + 1] += m_cellStart[cell];
+    }
+
+    // Scatter the items to their cells, using the cell start as a cursor.
+    // This leaves each cursor at the start of the following cell, so shift them back down one
+    m_items.resize(m_addedItems.size());
+    for (uint32_t index = 0; index < m_addedItems.size(); index++)
+    {
+        auto cell = m_addedCells[index];
+        m_items[m_cellStart[cell]++] = m_addedItems[index];
+    }
+    for (uint32_t cell = NumCells(); cell > 0; cell--)
+    {
+        m_cellStart[cell] = m_cellStart[cell - 1];
+    }
+    m_cellStart[0] = 0;
+}
+
+glm::ivec2 SpatialHash::CellCoord(const glm::vec2& position) const
+{
+    return glm::ivec2(glm::floor((position - m_origin) / m_cellSize));
+}
+
+uint32_t SpatialHash::CellIndex(const glm::ivec2& coord) const
+{
+    // Wrap, including negative coordinates
+    auto wrapped = coord % m_gridSize;
+    wrapped += glm::ivec2(wrapped.x < 0 ? m_gridSize.x : 0, wrapped.y < 0 ? m_gridSize.y : 0);
+    return uint32_t(wrapped.y * m_gridSize.x + wrapped.x);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// A uniform grid over a wrapping world, rebuilt from scratch each step.
+// Items are bucketed with a counting sort, so a rebuild is linear and doesn't allocate once the arrays have grown.
+// Cell coordinates wrap at the edges of the grid, so items that have drifted past the border still land in a cell,
+// and a query near one edge also visits the cells on the opposite side
+class SpatialHash
+{
+public:
+    // Start a new build covering origin to origin + extent.
+    // The cell size is raised if needed to keep the grid within MaxCells, so a tiny or zero size stays cheap
+    void Begin(const glm::vec2& origin, const glm::vec2& extent, float cellSize);
+    void Add(uint32_t item, const glm::vec2& position);
+    void End();
+
+    // Call fn(item) for every item in a cell touched by the circle
+    template<typename F>
+    void Query(const glm::vec2& position, float radius, F fn) const
+    {
+        if (m_cellStart.empty())
+        {
+            return;
+        }
+
+        auto minCell = CellCoord(position - glm::vec2(radius));
+        auto maxCell = CellCoord(position + glm::vec2(radius));
+
+        // Don't visit a wrapped cell twice
+        maxCell = glm::min(maxCell, minCell + m_gridSize - glm::ivec2(1));
+
+        for (int y = minCell.y; y <= maxCell.y; y++)
+        {
+            for (int x = minCell.x; x <= maxCell.x; x++)
+            {
+                auto cell = CellIndex(glm::ivec2(x, y));
+                for (uint32_t entry = m_cellStart[cell]; entry < m_cellStart[cell + 1]; entry++)
+                {
+                    fn(m_items[entry]);
+                }
+            }
+        }
+    }
+
+    uint32_t NumCells() const { return uint32_t(m_gridSize.x * m_gridSize.y); }
+
+    static const uint32_t MaxCells = 4096;
+
+private:
+    glm::ivec2 CellCoord(const glm::vec2& position) const;
+    uint32_t CellIndex(const glm::ivec2& coord) const;
+
+    glm::vec2 m_origin = glm::vec2(0.0f);
+    float m_cellSize = 1.0f;
+    glm::ivec2 m_gridSize = glm::ivec2(0);
+
+    std::vector<uint32_t> m_addedItems;
+    std::vector<uint32_t> m_addedCells;
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_items;
+};
@@ -0,0 +1,60 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "mgfx/app/SpatialHash.h"
+
+namespace
+{
+std::vector<uint32_t> QueryItems(const SpatialHash& hash, const glm::vec2& pos, float radius)
+{
+    std::vector<uint32_t> items;
+    hash.Query(pos, radius, [&](uint32_t item) { items.push_back(item); });
+    std::sort(items.begin(), items.end());
+    return items;
+}
+}
+
+TEST(SpatialHash, Query)
+{
+    SpatialHash hash;
+    hash.Begin(glm::vec2(0.0f), glm::vec2(100.0f), 10.0f);
+    hash.Add(0, glm::vec2(5.0f, 5.0f));
+    hash.Add(1, glm::vec2(15.0f, 5.0f));
+    hash.Add(2, glm::vec2(55.0f, 55.0f));
+    hash.End();
+
+    ASSERT_EQ(QueryItems(hash, glm::vec2(5.0f, 5.0f), 1.0f), std::vector<uint32_t>({ 0 }));
+    ASSERT_EQ(QueryItems(hash, glm::vec2(10.0f, 5.0f), 2.0f), std::vector<uint32_t>({ 0, 1 }));
+    ASSERT_EQ(QueryItems(hash, glm::vec2(55.0f, 55.0f), 1.0f), std::vector<uint32_t>({ 2 }));
+    ASSERT_TRUE(QueryItems(hash, glm::vec2(35.0f, 35.0f), 1.0f).empty());
+}
+
+TEST(SpatialHash, Wrap)
+{
+    SpatialHash hash;
+    hash.Begin(glm::vec2(0.0f), glm::vec2(100.0f), 10.0f);
+    hash.Add(0, glm::vec2(95.0f, 50.0f));
+    hash.Add(1, glm::vec2(-5.0f, 50.0f));
+    hash.End();
+
+    // A query at the left edge sees the items on the right, and items past the edge wrap
+    ASSERT_EQ(QueryItems(hash, glm::vec2(1.0f, 50.0f), 2.0f), std::vector<uint32_t>({ 0, 1 }));
+
+    // A big query only visits each cell once
+    ASSERT_EQ(QueryItems(hash, glm::vec2(50.0f, 50.0f), 500.0f), std::vector<uint32_t>({ 0, 1 }));
+}
+
+TEST(SpatialHash, ZeroCellSize)
+{
+    // No radius to size the cells by; the grid stays small, and queries still find everything nearby
+    SpatialHash hash;
+    hash.Begin(glm::vec2(-50.0f), glm::vec2(3940.0f, 2260.0f), 0.0f);
+    ASSERT_LE(hash.NumCells(), SpatialHash::MaxCells);
+
+    hash.Add(0, glm::vec2(100.0f, 100.0f));
+    hash.Add(1, glm::vec2(3000.0f, 2000.0f));
+    hash.End();
+
+    ASSERT_EQ(QueryItems(hash, glm::vec2(100.0f, 100.0f), 0.0f), std::vector<uint32_t>({ 0 }));
+    ASSERT_EQ(QueryItems(hash, glm::vec2(3000.0f, 2000.0f), 1.0f), std::vector<uint32_t>({ 1 }));
+    ASSERT_TRUE(QueryItems(hash, glm::vec2(1500.0f, 1000.0f), 1.0f).empty());
+}
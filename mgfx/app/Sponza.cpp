@@ -21,6 +21,7 @@ bool Sponza::LoadScene()
 {
     // Create a simple scene
     m_spScene = std::make_shared<Scene>();
+    m_sceneDrawn = false;
     m_spScene->SetClearColor(glm::vec4(0.7f, .7f, .8f, 0.0f));
 
     std::string inPath("sponza/sponza.mmesh");
@@ -28,8 +29,9 @@ bool Sponza::LoadScene()
     auto meshPath = MediaManager::Instance().FindAsset(inPath.c_str(), MediaType::Model);
     if (!meshPath.empty())
     {
+        // Drawn once it has loaded, so the window stays responsive
         auto spMesh = std::make_shared<Mesh>();
-        spMesh->Load(meshPath);
+        spMesh->LoadAsync(meshPath);
         m_spScene->AddMesh(spMesh);
     }
     else
@@ -111,6 +113,14 @@ void Sponza::Render(Mgfx::Window* pWindow)
     }
 
     // Draw the scene
+    bool loaded = !m_spScene->IsLoading();
     m_spScene->Render(pWindow->GetDevice().get());
+    m_sceneDrawn = loaded;
+}
+
+// The meshes load first, then the device streams their textures once they are drawn
+bool Sponza::IsLoading(Mgfx::Window* pWindow)
+{
+    return !m_sceneDrawn || pWindow->GetDevice()->IsStreaming();
 }
 
@@ -19,6 +19,7 @@ public:
     virtual void DrawGUI(Mgfx::Window* pWindow) override;
     virtual const char* Name() const override { return "3D"; }
     virtual const char* Description() const override;
+    virtual bool IsLoading(Mgfx::Window* pWindow) override;
 
 private:
     bool LoadScene();
@@ -26,4 +27,5 @@ private:
 private:
     std::shared_ptr<Mgfx::Scene> m_spScene;
     std::shared_ptr<Mgfx::CameraManipulator> m_spCameraManipulator;
+    bool m_sceneDrawn = false;      // Every mesh had loaded when the scene was last drawn
 };
\ No newline at end of file
@@ -8,8 +8,8 @@
 #include <DX12/deviceDX12.h>
 #endif
 
-#if PROJECT_DEVICE_NULL
-#include <Null/deviceNull.h>
+#if PROJECT_DEVICE_SOFT
+#include <Soft/deviceSoft.h>
 #endif
 
 #include "mgfx_settings.h"
@@ -18,6 +18,9 @@
 #include "ui/window.h"
 
 #include "file/media_manager.h"
+#include "profile/profiler.h"
+#include "device/Record/deviceRecord.h"
+#include "device/Record/deviceReplay.h"
 
 #include "tclap/CmdLine.h"
 
@@ -27,6 +30,7 @@
 #include "GameOfLife.h"
 #include "Mazes.h"
 #include "RayTracer.h"
+#include "GoldenImage.h"
 
 INITIALIZE_EASYLOGGINGPP
 
@@ -75,6 +79,7 @@ void ShowGUI(Window* pWindow)
     pWindow->GetDevice()->BeginGUI();
 
     static bool show_test_window = false;
+    static bool show_profiler = false;
 
     int selected = 0;
     const auto& renderers = MgfxSettings::Instance().GetRenderers();
@@ -130,6 +135,12 @@ void ShowGUI(Window* pWindow)
     {
         show_test_window ^= 1;
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Profiler"))
+    {
+        show_profiler ^= 1;
+    }
+
     // 3. Show the ImGui test window. Most of the sample code is in ImGui::ShowTestWindow()
     if (show_test_window)
     {
@@ -137,6 +148,11 @@ void ShowGUI(Window* pWindow)
         ImGui::ShowTestWindow(&show_test_window);
     }
 
+    if (show_profiler)
+    {
+        MCommon::ShowProfilerWindow(&show_profiler);
+    }
+
     pWindow->GetDevice()->EndGUI();
 }
 
@@ -148,7 +164,21 @@ bool ReadCommandLine(int argc, char** argv, int& exitCode)
         TCLAP::CmdLine cmd(APPLICATION_NAME, ' ', APPLICATION_VERSION);
         TCLAP::SwitchArg gl("", "gl", "Enable OpenGL", cmd, false);
         TCLAP::SwitchArg d3d("", "d3d", "Enable DX12", cmd, false);
+        TCLAP::SwitchArg soft("", "soft", "Enable the software device", cmd, false);
         TCLAP::SwitchArg console("c", "console", "Enable Console", cmd, false);
+        TCLAP::ValueArg<std::string> replay("", "replay", "Replay an Asteroids recording headless, and report timings", false, "", "file", cmd);
+        TCLAP::ValueArg<uint32_t> stress("", "stress", "Run a headless Asteroids stress test with this many extra boulders", false, 0, "boulders", cmd);
+        TCLAP::ValueArg<uint32_t> steps("", "steps", "Number of steps for the stress test", false, 3000, "steps", cmd);
+        TCLAP::ValueArg<std::string> renderer("", "renderer", "The renderer to start with", false, "", "name", cmd);
+        TCLAP::ValueArg<uint32_t> frames("", "frames", "Draw this many frames with fixed seeds and timing, then capture the last and exit", false, 0, "frames", cmd);
+        TCLAP::ValueArg<std::string> capture("", "capture", "Write the captured frame to this PNG", false, "", "file", cmd);
+        TCLAP::ValueArg<std::string> golden("", "golden", "Check the captured frame against this PNG or hash file; written if missing", false, "", "file", cmd);
+        TCLAP::ValueArg<uint32_t> tolerance("", "tolerance", "Allowed channel difference from a golden PNG, or differing bits from a golden hash", false, 2, "tolerance", cmd);
+        TCLAP::ValueArg<std::string> recordDevice("", "record-device", "Record the device calls to this command stream", false, "", "file", cmd);
+        TCLAP::ValueArg<std::string> replayDevice("", "replay-device", "Replay a device command stream as fast as possible, and report timings", false, "", "file", cmd);
+        TCLAP::ValueArg<uint32_t> loops("", "loops", "Number of times to play the device command stream", false, 1, "loops", cmd);
+        TCLAP::ValueArg<uint32_t> seed("", "seed", "Seed for renderers which randomize; capture runs use 1 if not given", false, 0, "seed", cmd);
+        TCLAP::ValueArg<std::string> trace("", "trace", "Save the CPU profile to this Chrome trace JSON on exit", false, "", "file", cmd);
 
         cmd.setExceptionHandling(false);
         cmd.ignoreUnmatched(false);
@@ -158,6 +188,23 @@ bool ReadCommandLine(int argc, char** argv, int& exitCode)
             cmd.parse(argc, argv);
 
             MgfxSettings::Instance().SetConsole(console.getValue());
+            MgfxSettings::Instance().SetReplayFile(replay.getValue());
+            MgfxSettings::Instance().SetStressBoulders(stress.getValue());
+            MgfxSettings::Instance().SetStressSteps(steps.getValue());
+            MgfxSettings::Instance().SetStartRenderer(renderer.getValue());
+            MgfxSettings::Instance().SetCaptureFrames(frames.getValue());
+            MgfxSettings::Instance().SetCaptureFile(capture.getValue());
+            MgfxSettings::Instance().SetGoldenFile(golden.getValue());
+            MgfxSettings::Instance().SetGoldenTolerance(tolerance.getValue());
+            MgfxSettings::Instance().SetSeed(seed.getValue());
+            MgfxSettings::Instance().SetDeviceRecordFile(recordDevice.getValue());
+            MgfxSettings::Instance().SetDeviceReplayFile(replayDevice.getValue());
+            MgfxSettings::Instance().SetDeviceReplayLoops(loops.getValue());
+            MgfxSettings::Instance().SetTraceFile(trace.getValue());
+            if (MgfxSettings::Instance().IsCapture() && seed.getValue() == 0)
+            {
+                MgfxSettings::Instance().SetSeed(1);
+            }
 #if TARGET_PC
             // Show the console if the user supplied args
             // On a Win32 app, this isn't available by default
@@ -176,6 +223,13 @@ bool ReadCommandLine(int argc, char** argv, int& exitCode)
                 MgfxSettings::Instance().SetDevice(MgfxSettings::Device::DX12);
             }
             else
+#endif
+#ifdef PROJECT_DEVICE_SOFT
+            if (soft.getValue())
+            {
+                MgfxSettings::Instance().SetDevice(MgfxSettings::Device::Soft);
+            }
+            else
 #endif
             {
                 MgfxSettings::Instance().SetDevice(MgfxSettings::Device::GL);
@@ -217,6 +271,154 @@ void CreateDevice(std::vector<std::shared_ptr<IDevice>>& devices)
     devices.push_back(pDevice);
 }
 
+void SaveTrace()
+{
+    auto& traceFile = MgfxSettings::Instance().GetTraceFile();
+    if (!traceFile.empty() && !MCommon::Profiler::Instance().SaveChromeTrace(traceFile))
+    {
+        LOG(ERROR) << "Couldn't write the trace: " << traceFile;
+    }
+}
+
+// Run the Asteroids simulation without a window, as fast as it will go
+int RunHeadless()
+{
+    auto& settings = MgfxSettings::Instance();
+
+    AsteroidsRecording recording;
+    if (!settings.GetReplayFile().empty())
+    {
+        if (!Asteroids::LoadRecording(settings.GetReplayFile(), recording))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        recording = Asteroids::MakeStressRecording(settings.GetStressSteps(), glm::uvec2(1920, 1080));
+    }
+
+    Asteroids asteroids;
+    if (!asteroids.Init())
+    {
+        LOG(ERROR) << "Could not initialize Asteroids";
+        return 1;
+    }
+
+    auto stats = asteroids.RunHeadless(recording, settings.GetStressBoulders());
+    asteroids.CleanUp();
+
+    std::ostringstream str;
+    str << "Steps: " << stats.steps << ", Max Entities: " << stats.entities
+        << ", Total: " << stats.totalMs << "ms, Mean: " << stats.meanMs << "ms, Min: " << stats.minMs
+        << "ms, Max: " << stats.maxMs << "ms, P99: " << stats.p99Ms << "ms"
+        << ", State: " << std::hex << stats.stateHash;
+    LOG(INFO) << str.str();
+    return 0;
+}
+
+// Draw the current renderer for a fixed number of frames, without the GUI, then save and check the last one.
+// Returns the exit code
+int RunCapture(Window* pWindow)
+{
+    auto& settings = MgfxSettings::Instance();
+    auto pDevice = pWindow->GetDevice();
+    auto pRenderer = WindowRenderers[pWindow];
+
+    auto drawFrame = [&](bool capture)
+    {
+        // Input would change the result
+        SDL_Event e;
+        while (SDL_PollEvent(&e))
+        {
+        }
+
+        MCommon::Profiler::Instance().NewFrame();
+        pWindow->PreRender(settings.GetFixedFrameTime());
+        if (!pDevice->BeginFrame())
+        {
+            return false;
+        }
+
+        {
+            PROFILE_SCOPE("Render");
+            pRenderer->Render(pWindow);
+        }
+
+        if (capture)
+        {
+            pDevice->RequestCapture();
+        }
+
+        PROFILE_SCOPE("Swap");
+        pDevice->Swap();
+        return true;
+    };
+
+    // Background loads finish before the counted frames, so the capture doesn't depend on how long they took
+    Timer loadTimer;
+    while (pRenderer->IsLoading(pWindow))
+    {
+        if (loadTimer.GetDelta() > 60.0f)
+        {
+            LOG(ERROR) << "Timed out waiting for the renderer to load";
+            return 1;
+        }
+
+        if (!drawFrame(false))
+        {
+            return 1;
+        }
+    }
+
+    for (uint32_t frame = 0; frame < settings.GetCaptureFrames(); frame++)
+    {
+        if (!drawFrame(frame == settings.GetCaptureFrames() - 1))
+        {
+            return 1;
+        }
+    }
+
+    FrameCapture capture;
+    if (!pDevice->GetCapture(capture, true))
+    {
+        LOG(ERROR) << "Couldn't read back the frame";
+        return 1;
+    }
+
+    if (!settings.GetCaptureFile().empty() && !SaveCapture(settings.GetCaptureFile(), capture))
+    {
+        return 1;
+    }
+
+    if (!settings.GetGoldenFile().empty())
+    {
+        return CheckGolden(settings.GetGoldenFile(), capture, settings.GetGoldenTolerance()) ? 0 : 1;
+    }
+    return 0;
+}
+
+// Play a recorded command stream into the device, without the app
+int RunDeviceReplay(IDevice* pDevice)
+{
+    auto& settings = MgfxSettings::Instance();
+
+    DeviceReplay replay;
+    if (!replay.Load(settings.GetDeviceReplayFile()))
+    {
+        return 1;
+    }
+
+    ReplayStats stats;
+    bool ok = replay.Play(pDevice, settings.GetDeviceReplayLoops(), stats);
+
+    std::ostringstream str;
+    str << pDevice->GetName() << ", Frames: " << stats.frames << ", Commands: " << stats.commands
+        << ", Total: " << stats.totalMs << "ms, Mean: " << stats.meanMs << "ms, Min: " << stats.minMs
+        << "ms, Max: " << stats.maxMs << "ms, P99: " << stats.p99Ms << "ms";
+    LOG(INFO) << str.str();
+    return ok ? 0 : 1;
+}
 
 int main(int argc, char** argv)
 {
@@ -232,12 +434,21 @@ int main(int argc, char** argv)
     }
     MediaManager::Instance().SetAssetPath(basePath);
 
+    MCommon::Profiler::Instance().SetThreadName("Main");
+
     int exitCode = 0;
     if (!ReadCommandLine(argc, argv, exitCode))
     {
         return exitCode;
     }
 
+    if (MgfxSettings::Instance().IsHeadless())
+    {
+        exitCode = RunHeadless();
+        SaveTrace();
+        return exitCode;
+    }
+
     // Setup SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0)
     {
@@ -254,6 +465,20 @@ int main(int argc, char** argv)
     
     //MgfxSettings::Instance().AddRenderer(std::make_shared<GeometryTest>());
 
+    if (!MgfxSettings::Instance().GetStartRenderer().empty() &&
+        !MgfxSettings::Instance().SelectRenderer(MgfxSettings::Instance().GetStartRenderer()))
+    {
+        LOG(ERROR) << "Unknown renderer: " << MgfxSettings::Instance().GetStartRenderer();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Some renderers randomize with glm, which uses rand()
+    if (MgfxSettings::Instance().GetSeed() != 0)
+    {
+        std::srand(MgfxSettings::Instance().GetSeed());
+    }
+
     std::vector<std::shared_ptr<IDevice>> vecDevices;
 
 #if PROJECT_DEVICE_GL
@@ -263,8 +488,11 @@ int main(int argc, char** argv)
     }
 #endif
 
-#if PROJECT_DEVICE_NULL
-    //CreateDevice<DeviceNull>(vecDevices);
+#if PROJECT_DEVICE_SOFT
+    if (MgfxSettings::Instance().GetDevice() == MgfxSettings::Device::Soft)
+    {
+        CreateDevice<DeviceSoft>(vecDevices);
+    }
 #endif
 
 #if PROJECT_DEVICE_DX12
@@ -274,6 +502,29 @@ int main(int argc, char** argv)
     }
 #endif
 
+    if (!MgfxSettings::Instance().GetDeviceReplayFile().empty())
+    {
+        exitCode = vecDevices.empty() ? 1 : RunDeviceReplay(vecDevices[0].get());
+        for (auto& spDevice : vecDevices)
+        {
+            spDevice->Cleanup();
+        }
+        MgfxSettings::Instance().ClearRenderers();
+        SaveTrace();
+        SDL_Quit();
+        return exitCode;
+    }
+
+    // Everything the app asks of the device goes through the recorder
+    if (!MgfxSettings::Instance().GetDeviceRecordFile().empty() && !vecDevices.empty())
+    {
+        auto spWriter = std::make_shared<CommandWriter>();
+        if (spWriter->Open(MgfxSettings::Instance().GetDeviceRecordFile()))
+        {
+            vecDevices[0] = std::make_shared<DeviceRecord>(vecDevices[0], spWriter);
+        }
+    }
+
     auto pCurrentRender = MgfxSettings::Instance().GetCurrentRenderer();
     for (auto& pDevice : vecDevices)
     {
@@ -283,8 +534,15 @@ int main(int argc, char** argv)
 
     Timer frameTimer;
 
-    // Main loop
     bool done = false;
+    if (MgfxSettings::Instance().IsCapture())
+    {
+        auto& windows = WindowManager::Instance().GetWindows();
+        exitCode = windows.empty() ? 1 : RunCapture(windows.begin()->second.get());
+        done = true;
+    }
+
+    // Main loop
     while (!done)
     {
         SDL_Event e;
@@ -349,6 +607,7 @@ int main(int argc, char** argv)
 
         auto frameDelta = frameTimer.GetDelta();
         frameTimer.Restart();
+        MCommon::Profiler::Instance().NewFrame();
 
         // No more events, lets do some drawing
         // Walk the list of windows currently drawing
@@ -371,11 +630,18 @@ int main(int argc, char** argv)
             {
                 if (spWindow->GetDevice()->BeginFrame())
                 {
-                    pRenderer->Render(spWindow.get());
+                    {
+                        PROFILE_SCOPE("Render");
+                        pRenderer->Render(spWindow.get());
+                    }
 
-                    ShowGUI(spWindow.get());
+                    {
+                        PROFILE_SCOPE("GUI");
+                        ShowGUI(spWindow.get());
+                    }
 
                     // Display result
+                    PROFILE_SCOPE("Swap");
                     spWindow->GetDevice()->Swap();
                 }
             }
@@ -393,9 +659,10 @@ int main(int argc, char** argv)
     }
 
     MgfxSettings::Instance().ClearRenderers();
+    SaveTrace();
 
     ImGui::Shutdown();
     SDL_Quit();
 
-    return 0;
+    return exitCode;
 }
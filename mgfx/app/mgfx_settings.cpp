@@ -19,6 +19,25 @@ void MgfxSettings::SetCurrentRenderer(MgfxRender* pRender)
     m_pCurrentRenderer = pRender;
 }
 
+bool MgfxSettings::SelectRenderer(const std::string& name)
+{
+    auto simplify = [](const std::string& str)
+    {
+        return StringUtils::toLower(StringUtils::ReplaceString(str, " ", ""));
+    };
+
+    auto search = simplify(name);
+    for (auto& spRender : m_renderers)
+    {
+        if (simplify(spRender->Name()) == search)
+        {
+            m_pCurrentRenderer = spRender.get();
+            return true;
+        }
+    }
+    return false;
+}
+
 void MgfxSettings::AddRenderer(std::shared_ptr<MgfxRender> spRender)
 {
     m_renderers.push_back(spRender);
@@ -7,7 +7,8 @@ public:
     enum class Device
     {
         GL,
-        DX12
+        DX12,
+        Soft
     };
 
     static MgfxSettings& Instance();
@@ -15,6 +16,9 @@ public:
     MgfxRender* GetCurrentRenderer() const;
     void SetCurrentRenderer(MgfxRender* render);
 
+    // Pick a renderer by name, ignoring case and spaces
+    bool SelectRenderer(const std::string& name);
+
     void SetDevice(Device device) { m_device = device; }
     Device GetDevice() const { return m_device; }
 
@@ -25,10 +29,67 @@ public:
     void SetConsole(bool console) { m_bConsole = console; }
     bool GetConsole() const { return m_bConsole; }
 
+    // Headless Asteroids runs, from a recording or a stress test
+    void SetReplayFile(const std::string& file) { m_replayFile = file; }
+    const std::string& GetReplayFile() const { return m_replayFile; }
+    void SetStressBoulders(uint32_t boulders) { m_stressBoulders = boulders; }
+    uint32_t GetStressBoulders() const { return m_stressBoulders; }
+    void SetStressSteps(uint32_t steps) { m_stressSteps = steps; }
+    uint32_t GetStressSteps() const { return m_stressSteps; }
+    bool IsHeadless() const { return !m_replayFile.empty() || m_stressBoulders != 0; }
+
+    // The renderer to start with, from the command line
+    void SetStartRenderer(const std::string& name) { m_startRenderer = name; }
+    const std::string& GetStartRenderer() const { return m_startRenderer; }
+
+    // Capture runs draw a number of frames with fixed seeds and frame times, then save the last one
+    // and/or check it against a golden image or hash
+    void SetCaptureFrames(uint32_t frames) { m_captureFrames = frames; }
+    uint32_t GetCaptureFrames() const { return m_captureFrames; }
+    void SetCaptureFile(const std::string& file) { m_captureFile = file; }
+    const std::string& GetCaptureFile() const { return m_captureFile; }
+    void SetGoldenFile(const std::string& file) { m_goldenFile = file; }
+    const std::string& GetGoldenFile() const { return m_goldenFile; }
+    void SetGoldenTolerance(uint32_t tolerance) { m_goldenTolerance = tolerance; }
+    uint32_t GetGoldenTolerance() const { return m_goldenTolerance; }
+    bool IsCapture() const { return m_captureFrames != 0; }
+
+    // Device command streams; recorded from a normal session, and replayed alone to time the device
+    void SetDeviceRecordFile(const std::string& file) { m_deviceRecordFile = file; }
+    const std::string& GetDeviceRecordFile() const { return m_deviceRecordFile; }
+    void SetDeviceReplayFile(const std::string& file) { m_deviceReplayFile = file; }
+    const std::string& GetDeviceReplayFile() const { return m_deviceReplayFile; }
+    void SetDeviceReplayLoops(uint32_t loops) { m_deviceReplayLoops = loops; }
+    uint32_t GetDeviceReplayLoops() const { return m_deviceReplayLoops; }
+
+    // The CPU profile is saved to this Chrome trace on exit, if it is set
+    void SetTraceFile(const std::string& file) { m_traceFile = file; }
+    const std::string& GetTraceFile() const { return m_traceFile; }
+
+    // Renderers which randomize use this seed if it isn't 0
+    void SetSeed(uint32_t seed) { m_seed = seed; }
+    uint32_t GetSeed() const { return m_seed; }
+
+    // When not 0, frames advance by this time instead of the real time
+    float GetFixedFrameTime() const { return IsCapture() ? (1.0f / 60.0f) : 0.0f; }
+
 private:
     std::vector<std::shared_ptr<MgfxRender>> m_renderers;
     MgfxRender* m_pCurrentRenderer = nullptr;
     Device m_device = Device::GL;
     bool m_bConsole = false;
+    std::string m_replayFile;
+    uint32_t m_stressBoulders = 0;
+    uint32_t m_stressSteps = 3000;
+    std::string m_startRenderer;
+    uint32_t m_captureFrames = 0;
+    std::string m_captureFile;
+    std::string m_goldenFile;
+    uint32_t m_goldenTolerance = 2;
+    uint32_t m_seed = 0;
+    std::string m_deviceRecordFile;
+    std::string m_deviceReplayFile;
+    uint32_t m_deviceReplayLoops = 1;
+    std::string m_traceFile;
 };
 
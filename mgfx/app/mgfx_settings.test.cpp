@@ -1,6 +1,29 @@
 #include "mcommon.h"
 #include <gtest/gtest.h>
+#include "mgfx/app/mgfx_app.h"
 #include "mgfx/app/mgfx_settings.h"
+#include "mgfx/app/MgfxRender.h"
+
+namespace
+{
+
+struct TestRender : public MgfxRender
+{
+    explicit TestRender(const char* name) : m_name(name) {}
+    virtual bool Init() override { return true; }
+    virtual void CleanUp() override {}
+    virtual void AddToWindow(Mgfx::Window*) override {}
+    virtual void RemoveFromWindow(Mgfx::Window*) override {}
+    virtual void ResizeWindow(Mgfx::Window*) override {}
+    virtual void Render(Mgfx::Window*) override {}
+    virtual void DrawGUI(Mgfx::Window*) override {}
+    virtual const char* Name() const override { return m_name; }
+    virtual const char* Description() const override { return ""; }
+
+    const char* m_name;
+};
+
+}
 
 TEST(App, MgfxSettings)
 {
@@ -14,4 +37,20 @@ TEST(App, MgfxSettings)
     mode = MgfxSettings::Instance().GetMode();
     ASSERT_EQ(mode, AppMode::Display2D);
     */
-}
\ No newline at end of file
+}
+
+TEST(App, SelectRenderer)
+{
+    auto& settings = MgfxSettings::Instance();
+    settings.AddRenderer(std::make_shared<TestRender>("Asteroids"));
+    settings.AddRenderer(std::make_shared<TestRender>("Game Of Life"));
+    ASSERT_STREQ(settings.GetCurrentRenderer()->Name(), "Asteroids");
+
+    EXPECT_TRUE(settings.SelectRenderer("gameoflife"));
+    EXPECT_STREQ(settings.GetCurrentRenderer()->Name(), "Game Of Life");
+
+    EXPECT_FALSE(settings.SelectRenderer("Sponza"));
+    EXPECT_STREQ(settings.GetCurrentRenderer()->Name(), "Game Of Life");
+
+    settings.ClearRenderers();
+}
@@ -7,16 +7,24 @@ LIST(APPEND MGFX_APP_SOURCES
     mgfx/app/Sponza.h
     mgfx/app/Asteroids.cpp
     mgfx/app/Asteroids.h
+    mgfx/app/EntityPool.cpp
+    mgfx/app/EntityPool.h
     mgfx/app/GeometryTest.cpp
     mgfx/app/GeometryTest.h
+    mgfx/app/GoldenImage.cpp
+    mgfx/app/GoldenImage.h
     mgfx/app/GameOfLife.cpp
     mgfx/app/GameOfLife.h
     mgfx/app/Mazes.cpp
     mgfx/app/Mazes.h
     mgfx/app/RayTracer.cpp
     mgfx/app/RayTracer.h
+    mgfx/app/SpatialHash.cpp
+    mgfx/app/SpatialHash.h
     mgfx/app/MgfxRender.cpp
     mgfx/app/MgfxRender.h
+    mgfx/app/ParticleSystem.cpp
+    mgfx/app/ParticleSystem.h
     mgfx/app/mgfx_app.h
     mgfx/app/mgfx_settings.cpp
     mgfx/app/mgfx_settings.h
@@ -24,6 +32,11 @@ LIST(APPEND MGFX_APP_SOURCES
 )
 
 LIST(APPEND TEST_SOURCES
+    mgfx/app/EntityPool.cpp
+    mgfx/app/ParticleSystem.cpp
+    mgfx/app/SpatialHash.cpp
     mgfx/app/mgfx_settings.cpp
     mgfx/app/mgfx_settings.h
+    mgfx/app/MgfxRender.cpp
+    mgfx/app/MgfxRender.h
 )
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "mgfx_core.h"
+#include "textbatch.h"
+#include "file/media_manager.h"
+#include <stb/stb_image.h>
+
+using namespace MCommon;
+
+namespace Mgfx
+{
+
+namespace
+{
+
+const uint32_t VerticesPerQuad = 4;
+const uint32_t IndicesPerQuad = 6;
+
+// Initial buffer space; the buffers grow to fit
+const uint32_t InitialQuads = 1024;
+
+}
+
+TextBatch::TextBatch(IDevice* pDevice)
+    : m_pDevice(pDevice)
+{
+}
+
+TextBatch::~TextBatch()
+{
+    if (m_textureID != 0)
+    {
+        m_pDevice->DestroyTexture(m_textureID);
+    }
+}
+
+bool TextBatch::Load(const char* pszFontName)
+{
+    std::string name(pszFontName);
+    auto metrics = MediaManager::Instance().LoadAsset((name + ".font").c_str(), MediaType::Font);
+    if (!m_atlas.Load(metrics))
+    {
+        LOG(ERROR) << "Could not load font metrics: " << name;
+        return false;
+    }
+
+    auto image = MediaManager::Instance().LoadAsset((name + ".png").c_str(), MediaType::Font);
+
+    int w;
+    int h;
+    int comp;
+    auto pPixels = stbi_load_from_memory((stbi_uc*)image.c_str(), int(image.size()), &w, &h, &comp, 4);
+    if (!pPixels)
+    {
+        LOG(ERROR) << "Could not load font atlas: " << name;
+        return false;
+    }
+
+    m_textureID = m_pDevice->CreateTexture();
+    auto textureData = m_pDevice->ResizeTexture(m_textureID, glm::uvec2(w, h));
+    if (textureData.pData)
+    {
+        for (int y = 0; y < h; y++)
+        {
+            memcpy(textureData.LinePtr(y, 0), pPixels + y * sizeof(glm::u8vec4) * w, w * sizeof(glm::u8vec4));
+        }
+    }
+    stbi_image_free(pPixels);
+    m_pDevice->UpdateTexture(m_textureID);
+
+    m_spVertexBuffer = m_pDevice->CreateBuffer(InitialQuads * VerticesPerQuad * sizeof(GeometryVertex), DeviceBufferFlags::VertexBuffer);
+    m_spIndexBuffer = m_pDevice->CreateBuffer(InitialQuads * IndicesPerQuad * sizeof(uint32_t), DeviceBufferFlags::IndexBuffer);
+    return true;
+}
+
+glm::vec2 TextBatch::AddText(const std::string& text, const glm::vec2& pos, float size, const glm::vec4& color)
+{
+    m_quads.clear();
+    auto end = m_atlas.Layout(text, pos, size, m_quads);
+
+    for (auto& quad : m_quads)
+    {
+        m_vertices.push_back(GeometryVertex(glm::vec3(quad.topLeft, 0.0f), glm::vec2(quad.texRect.x, quad.texRect.y), color));
+        m_vertices.push_back(GeometryVertex(glm::vec3(quad.bottomRight.x, quad.topLeft.y, 0.0f), glm::vec2(quad.texRect.z, quad.texRect.y), color));
+        m_vertices.push_back(GeometryVertex(glm::vec3(quad.topLeft.x, quad.bottomRight.y, 0.0f), glm::vec2(quad.texRect.x, quad.texRect.w), color));
+        m_vertices.push_back(GeometryVertex(glm::vec3(quad.bottomRight, 0.0f), glm::vec2(quad.texRect.z, quad.texRect.w), color));
+    }
+    return end;
+}
+
+void TextBatch::Clear()
+{
+    m_vertices.clear();
+}
+
+void TextBatch::Draw()
+{
+    uint32_t numQuads = GetNumQuads();
+    if (numQuads == 0 || !IsLoaded())
+    {
+        Clear();
+        return;
+    }
+
+    m_pDevice->BeginGeometry(m_textureID, m_spVertexBuffer.get(), m_spIndexBuffer.get(), GeometryFlags::DistanceField);
+
+    uint32_t vertexOffset;
+    uint32_t indexOffset;
+    auto pVertices = (GeometryVertex*)m_spVertexBuffer->Map(numQuads * VerticesPerQuad, sizeof(GeometryVertex), vertexOffset);
+    auto pIndices = (uint32_t*)m_spIndexBuffer->Map(numQuads * IndicesPerQuad, sizeof(uint32_t), indexOffset);
+
+    memcpy(pVertices, m_vertices.data(), m_vertices.size() * sizeof(GeometryVertex));
+    for (uint32_t quad = 0; quad < numQuads; quad++)
+    {
+        uint32_t base = quad * VerticesPerQuad;
+        *pIndices++ = base + 0;
+        *pIndices++ = base + 1;
+        *pIndices++ = base + 2;
+        *pIndices++ = base + 2;
+        *pIndices++ = base + 1;
+        *pIndices++ = base + 3;
+    }
+
+    m_spVertexBuffer->UnMap();
+    m_spIndexBuffer->UnMap();
+
+    m_pDevice->DrawTriangles(vertexOffset, indexOffset, numQuads * VerticesPerQuad, numQuads * IndicesPerQuad);
+    m_pDevice->EndGeometry();
+
+    Clear();
+}
+
+} // namespace Mgfx
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "graphics/fontatlas.h"
+#include "device/IDevice.h"
+
+namespace Mgfx
+{
+
+// Screen text in a distance field font.
+// Strings are laid out from the baked glyph metrics as they are added, and everything added
+// is drawn with one DrawTriangles call; no glyphs are rendered at runtime, and any size is sharp
+class TextBatch
+{
+public:
+    TextBatch(IDevice* pDevice);
+    ~TextBatch();
+
+    // Loads 'name.font' and 'name.png' from the fonts, as baked by massetbuilder
+    bool Load(const char* pszFontName);
+    bool IsLoaded() const { return m_textureID != 0; }
+    const MCommon::FontAtlas& GetAtlas() const { return m_atlas; }
+
+    // Queue a line of text with its top left at pos, 'size' pixels high.
+    // Returns the pen position after the text
+    glm::vec2 AddText(const std::string& text, const glm::vec2& pos, float size, const glm::vec4& color = glm::vec4(1.0f));
+
+    // Draw the queued text with the device camera, and start a new batch
+    void Draw();
+    void Clear();
+
+    uint32_t GetNumQuads() const { return uint32_t(m_vertices.size() / 4); }
+
+private:
+    IDevice* m_pDevice = nullptr;
+    MCommon::FontAtlas m_atlas;
+    uint32_t m_textureID = 0;
+
+    std::shared_ptr<IDeviceBuffer> m_spVertexBuffer;
+    std::shared_ptr<IDeviceBuffer> m_spIndexBuffer;
+
+    std::vector<MCommon::GlyphQuad> m_quads;
+    std::vector<GeometryVertex> m_vertices;
+};
+
+} // namespace Mgfx
@@ -38,6 +38,38 @@ void Camera::SetFilmSize(const glm::uvec2& size)
     m_aspectRatio = size.x / float(size.y);
 }
 
+CameraState Camera::GetState() const
+{
+    CameraState state;
+    state.mode = m_mode;
+    state.position = m_position;
+    state.focalPoint = m_focalPoint;
+    state.viewDirection = m_viewDirection;
+    state.orientation = m_orientation;
+    state.filmSize = m_filmSize;
+    state.fieldOfView = m_fieldOfView;
+    return state;
+}
+
+// Restores the view; any movement in progress is stopped
+void Camera::SetState(const CameraState& state)
+{
+    m_mode = state.mode;
+    m_position = state.position;
+    m_focalPoint = state.focalPoint;
+    m_viewDirection = state.viewDirection;
+    m_orientation = state.orientation;
+    m_fieldOfView = state.fieldOfView;
+    m_halfAngle = float(tan(glm::radians(m_fieldOfView) / 2.0));
+    SetFilmSize(state.filmSize);
+
+    m_orbitDelta = glm::vec2(0.0f);
+    m_positionDelta = glm::vec3(0.0f);
+    m_walkDelta = glm::vec3(0.0f);
+
+    UpdateRightUp();
+}
+
 // Update the camera based on the time passed.
 bool Camera::Update()
 {
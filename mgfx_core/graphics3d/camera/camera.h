@@ -17,6 +17,18 @@ enum class CameraMode
     Ortho = 1
 };
 
+// Everything which decides what the camera sees, so a view can be saved and restored
+struct CameraState
+{
+    CameraMode mode;
+    glm::vec3 position;
+    glm::vec3 focalPoint;
+    glm::vec3 viewDirection;
+    glm::quat orientation;
+    glm::uvec2 filmSize;
+    float fieldOfView;
+};
+
 // This is my favourite little camera; used in ray tracing and 3D projects.
 // A simple camera with a quaternion for orientation and a position in space.
 class Camera
@@ -50,6 +62,9 @@ public:
     // A ray into the world through a screen pixel
     Ray GetWorldRay(const glm::vec2& imageSample);
 
+    CameraState GetState() const;
+    void SetState(const CameraState& state);
+
     // Standard manipulation functions
     void Walk(glm::vec3 planes);
     void Dolly(float distance);
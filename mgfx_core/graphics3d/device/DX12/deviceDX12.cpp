@@ -18,6 +18,7 @@
 #include <stb/stb_image.h>
 #include "SDL_syswm.h"
 #include "ui/imgui_sdl_common.h"
+#include "profile/profiler.h"
 
 using namespace Microsoft::WRL;
 using namespace Graphics;
@@ -250,6 +251,7 @@ bool DeviceDX12::BeginFrame()
 
 void DeviceDX12::DrawMesh(Mesh* pMesh, GeometryType type)
 {
+    PROFILE_SCOPE("DeviceDX12::DrawMesh");
     static std::vector<Mesh*> alphaMeshes;
 
     MeshDX12* pDeviceMesh = nullptr;
@@ -267,7 +269,7 @@ void DeviceDX12::DrawMesh(Mesh* pMesh, GeometryType type)
     pDeviceMesh->Draw(type);
 }
 
-void DeviceDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB)
+void DeviceDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
 {
     auto itr = m_mapIDToTextureData.find(id);
     if (itr == m_mapIDToTextureData.end())
@@ -275,7 +277,7 @@ void DeviceDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* p
         return;
     }
     auto& spTexture = itr->second;
-    m_spGeometry->BeginGeometry(id, pVB, pIB);
+    m_spGeometry->BeginGeometry(id, pVB, pIB, flags);
 }
 
 void DeviceDX12::EndGeometry()
@@ -292,6 +294,11 @@ void DeviceDX12::DrawTriangles(
     m_spGeometry->DrawTriangles(VBOffset, IBOffset, numVertices, numIndices);
 }
 
+void DeviceDX12::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    m_spGeometry->DrawSprites(id, pSprites, numSprites);
+}
+
 void DeviceDX12::Cleanup()
 {
     SDL_DestroyWindow(m_pSDLWindow);
@@ -350,9 +357,109 @@ void DeviceDX12::Flush()
 // Copy the back buffer to the screen
 void DeviceDX12::Swap()
 {
+    if (m_captureRequested)
+    {
+        m_captureRequested = false;
+        ReadCapture();
+    }
+    m_frameCount++;
+
     Graphics::Present();
 }
 
+void DeviceDX12::RequestCapture()
+{
+    m_captureRequested = true;
+}
+
+bool DeviceDX12::GetCapture(FrameCapture& capture, bool wait)
+{
+    if (m_captures.empty())
+    {
+        return false;
+    }
+    capture = std::move(m_captures.front());
+    m_captures.pop_front();
+    return true;
+}
+
+namespace
+{
+// R11G11B10_FLOAT channels have no sign, a 5 bit exponent and a 6 or 5 bit mantissa
+float UnpackSmallFloat(uint32_t bits, uint32_t mantissaBits)
+{
+    uint32_t mantissa = bits & ((1 << mantissaBits) - 1);
+    uint32_t exponent = (bits >> mantissaBits) & 0x1f;
+    float fraction = float(mantissa) / float(1 << mantissaBits);
+    if (exponent == 0)
+    {
+        return std::ldexp(fraction, -14);
+    }
+    else if (exponent == 31)
+    {
+        // Infinity, or NaN
+        return mantissa == 0 ? 1.0f : 0.0f;
+    }
+    return std::ldexp(1.0f + fraction, int(exponent) - 15);
+}
+
+// The same conversion as PresentSDRPS
+uint8_t LinearToSRGB8(float value)
+{
+    value = glm::clamp(value, 0.0f, 1.0f);
+    value = value < 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(value * 255.0f + 0.5f);
+}
+}
+
+// Copy the scene buffer to the readback heap and wait for it; captures are only taken by test runs,
+// so the stall doesn't matter
+void DeviceDX12::ReadCapture()
+{
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footPrint;
+    uint64_t totalBytes = 0;
+    g_Device->GetCopyableFootprints(&g_SceneColorBuffer.GetResource()->GetDesc(), 0, 1, 0, &footPrint, nullptr, nullptr, &totalBytes);
+
+    ComPtr<ID3D12Resource> spReadback;
+    if (FAILED(g_Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK), D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(totalBytes), D3D12_RESOURCE_STATE_COPY_DEST, nullptr, MY_IID_PPV_ARGS(spReadback.GetAddressOf()))))
+    {
+        LOG(ERROR) << "Couldn't create the capture readback buffer";
+        return;
+    }
+
+    GpuResource readback(spReadback.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+    CommandContext::ReadbackTexture2D(readback, g_SceneColorBuffer);
+
+    uint8_t* pData = nullptr;
+    if (FAILED(spReadback->Map(0, &CD3DX12_RANGE(0, SIZE_T(totalBytes)), (void**)&pData)))
+    {
+        LOG(ERROR) << "Couldn't map the capture readback buffer";
+        return;
+    }
+
+    FrameCapture capture;
+    capture.size = glm::uvec2(footPrint.Footprint.Width, footPrint.Footprint.Height);
+    capture.frame = m_frameCount;
+    capture.pixels.resize(capture.size.x * capture.size.y);
+    for (uint32_t y = 0; y < capture.size.y; y++)
+    {
+        auto pRow = (const uint32_t*)(pData + footPrint.Offset + y * footPrint.Footprint.RowPitch);
+        for (uint32_t x = 0; x < capture.size.x; x++)
+        {
+            auto packed = pRow[x];
+            capture.pixels[y * capture.size.x + x] = glm::u8vec4(
+                LinearToSRGB8(UnpackSmallFloat(packed & 0x7ff, 6)),
+                LinearToSRGB8(UnpackSmallFloat((packed >> 11) & 0x7ff, 6)),
+                LinearToSRGB8(UnpackSmallFloat(packed >> 22, 5)),
+                255);
+        }
+    }
+    spReadback->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+    m_captures.push_back(std::move(capture));
+}
+
 uint32_t DeviceDX12::CreateTexture()
 {
     auto spTextureData = std::make_shared<TextureDataDX12>();
@@ -378,7 +485,22 @@ void DeviceDX12::DestroyTexture(uint32_t id)
     m_mapIDToTextureData.erase(id);
 }
 
-TextureData DeviceDX12::ResizeTexture(uint32_t id, const glm::uvec2& size)
+namespace
+{
+DXGI_FORMAT ToDXGIFormat(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::R8: return DXGI_FORMAT_R8_UNORM;
+    case TextureFormat::RG8: return DXGI_FORMAT_R8G8_UNORM;
+    case TextureFormat::RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case TextureFormat::RGBA32F: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+}
+
+TextureData DeviceDX12::ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format)
 {
     TextureData ret;
     auto itr = m_mapIDToTextureData.find(id);
@@ -388,14 +510,14 @@ TextureData DeviceDX12::ResizeTexture(uint32_t id, const glm::uvec2& size)
     }
 
     auto& spTexture = itr->second;
-    if (spTexture->Size != size)
+    if (spTexture->Size != size || spTexture->m_data.format != format)
     {
         if (spTexture->m_data.pData)
         {
             spTexture->m_uploadBuffer.Destroy();
             spTexture->m_data.pData = nullptr;
         }
-        spTexture->m_texture.Create(size.x, size.y, DXGI_FORMAT_R8G8B8A8_UNORM);
+        spTexture->m_texture.Create(size.x, size.y, ToDXGIFormat(format));
 
         D3D12_PLACED_SUBRESOURCE_FOOTPRINT footPrint;
         Graphics::g_Device->GetCopyableFootprints(&spTexture->m_texture.GetResource()->GetDesc(), 0, 1, 0, &footPrint, nullptr, nullptr, nullptr);
@@ -404,6 +526,7 @@ TextureData DeviceDX12::ResizeTexture(uint32_t id, const glm::uvec2& size)
         spTexture->m_uploadBuffer.Create(L"DeviceTexUpload", uint32_t(uploadBufferSize), sizeof(uint8_t));
         spTexture->m_data.pData = (uint8_t*)spTexture->m_uploadBuffer.Map();
         spTexture->m_data.pitch = footPrint.Footprint.RowPitch;
+        spTexture->m_data.format = format;
         spTexture->Size = size;
 
     }
@@ -413,6 +536,7 @@ TextureData DeviceDX12::ResizeTexture(uint32_t id, const glm::uvec2& size)
 // Send the quad to the GPU, and prepare it fo drawing
 void DeviceDX12::UpdateTexture(uint32_t id)
 {
+    PROFILE_SCOPE("DeviceDX12::UpdateTexture");
     auto itr = m_mapIDToTextureData.find(id);
     if (itr == m_mapIDToTextureData.end())
     {
@@ -422,6 +546,27 @@ void DeviceDX12::UpdateTexture(uint32_t id)
     UploadTexture(id);
 }
 
+// Indices are looked up in the palette by QuadPS, which samples both without filtering
+void DeviceDX12::SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors)
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    std::vector<glm::u8vec4> palette(256, glm::u8vec4(0));
+    std::copy(pColors, pColors + std::min(numColors, uint32_t(palette.size())), palette.begin());
+
+    // Replacing the palette frees the old one, which a frame in flight may still read
+    auto& spTexture = itr->second;
+    if (spTexture->m_palette.GetResource() != nullptr)
+    {
+        g_CommandManager.IdleGPU();
+    }
+    spTexture->m_palette.Create(palette.size(), 1, DXGI_FORMAT_R8G8B8A8_UNORM, palette.data());
+}
+
 void DeviceDX12::UploadTexture(uint32_t id)
 {
     auto itr = m_mapIDToTextureData.find(id);
@@ -3,6 +3,7 @@
 //#include "shader.h"
 #include <cstdint>
 #include <memory>
+#include <deque>
 #include "IDevice.h"
 
 #include "d3d12.h"
@@ -43,6 +44,9 @@ struct TextureDataDX12
     glm::uvec2 Size = glm::uvec2(0);
     Texture m_texture;
     DynamicUploadBuffer m_uploadBuffer;
+
+    // 256 colors, looked up by R8 textures
+    Texture m_palette;
    
     // Loaded
     const ManagedTexture* m_pManagedTexture;
@@ -64,6 +68,8 @@ public:
     virtual void EndGUI() override;
     virtual void Flush() override;
     virtual void Swap() override;
+    virtual void RequestCapture() override;
+    virtual bool GetCapture(FrameCapture& capture, bool wait) override;
 
     virtual void DrawMesh(Mesh* pMesh, GeometryType type) override;
 
@@ -75,20 +81,22 @@ public:
     // 2D Rendering functions
     uint32_t CreateTexture() override;
     virtual void DestroyTexture(uint32_t id) override;
-    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size) override;
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format = TextureFormat::RGBA8) override;
     virtual void UpdateTexture(uint32_t id) override;
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) override;
     uint32_t LoadTexture(const fs::path& path);
 
     // Buffers
     virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) override;
 
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) override;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
     virtual void EndGeometry() override;
     virtual void DrawTriangles(
         uint32_t VBOffset,
         uint32_t IBOffset,
         uint32_t numVertices,
         uint32_t numIndices) override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
 
     virtual void Cleanup() override;
     virtual void ProcessEvent(SDL_Event& event) override;
@@ -102,6 +110,7 @@ public:
 
 private:
     void UploadTexture(uint32_t id);
+    void ReadCapture();
 
     //void WaitForPreviousFrame();
     void LoadAssets();
@@ -129,6 +138,11 @@ private:
     uint32_t m_clearFlags = ClearType::Depth | ClearType::Color;
     bool m_inFrame = false;
     uint32_t m_deviceFlags = DeviceFlags::SyncToRefresh;
+
+    // Captures are read back from the scene buffer when swapped
+    bool m_captureRequested = false;
+    uint64_t m_frameCount = 0;
+    std::deque<FrameCapture> m_captures;
 };
 
 inline void CheckDX12(HRESULT hr, const char* call, const char* file, int line)
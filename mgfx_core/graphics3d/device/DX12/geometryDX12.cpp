@@ -26,10 +26,13 @@ void GeometryDX12::Init()
     SamplerDesc DefaultSamplerDesc;
 
     // Signature
-    m_rootSig.Reset(2, 1);
+    // Texture and palette, projection, and the texture mode from QuadPS
+    m_rootSig.Reset(3, 2);
     m_rootSig.InitStaticSampler(0, DefaultSamplerDesc, D3D12_SHADER_VISIBILITY_PIXEL);
-    m_rootSig[0].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_rootSig.InitStaticSampler(1, SamplerPointClampDesc, D3D12_SHADER_VISIBILITY_PIXEL);
+    m_rootSig[0].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 2, D3D12_SHADER_VISIBILITY_PIXEL);
     m_rootSig[1].InitAsConstants(0, 16, D3D12_SHADER_VISIBILITY_VERTEX);
+    m_rootSig[2].InitAsConstants(0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
     m_rootSig.Finalize(L"GeometryDX12", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
     // Define the vertex input layout.
@@ -54,6 +57,51 @@ void GeometryDX12::Init()
     m_geometryPSO.SetPixelShader(pixelShaderBlob.c_str(), pixelShaderBlob.size());
     m_geometryPSO.Finalize();
 
+    // Text is the same, with a distance field pixel shader
+    std::string textShaderBlob = MediaManager::Instance().LoadAsset("TextPS.cso", MediaType::Shader);
+    m_textPSO = m_geometryPSO;
+    m_textPSO.SetPixelShader(textShaderBlob.c_str(), textShaderBlob.size());
+    m_textPSO.Finalize();
+
+    // Sprites are the same, with per instance data expanded in the vertex shader
+    D3D12_INPUT_ELEMENT_DESC spriteElementDescs[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(SpriteInstance, pos), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "ANGLE", 0, DXGI_FORMAT_R32_FLOAT, 0, offsetof(SpriteInstance, angle), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(SpriteInstance, halfSize), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(SpriteInstance, texRect), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(SpriteInstance, color), D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
+    };
+
+    std::string spriteShaderBlob = MediaManager::Instance().LoadAsset("SpriteVS.cso", MediaType::Shader);
+
+    m_spritePSO = m_geometryPSO;
+    m_spritePSO.SetInputLayout(_countof(spriteElementDescs), spriteElementDescs);
+    m_spritePSO.SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
+    m_spritePSO.SetVertexShader(spriteShaderBlob.c_str(), spriteShaderBlob.size());
+    m_spritePSO.Finalize();
+
+}
+
+// Binds the texture, and its palette if it has one; the mode matches QuadPS
+void GeometryDX12::SetTexture(GraphicsContext& context, TextureDataDX12* pTexture)
+{
+    int mode = 0;
+    D3D12_CPU_DESCRIPTOR_HANDLE handles[2] = { pTexture->m_texture.GetSRV(), pTexture->m_texture.GetSRV() };
+    if (pTexture->m_data.format == TextureFormat::R8 && pTexture->m_palette.GetResource() != nullptr)
+    {
+        mode = 1;
+        handles[1] = pTexture->m_palette.GetSRV();
+        context.TransitionResource(pTexture->m_palette, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    }
+    else if (pTexture->m_data.format == TextureFormat::RGBA16F || pTexture->m_data.format == TextureFormat::RGBA32F)
+    {
+        mode = 2;
+    }
+
+    context.SetDynamicDescriptors(0, 0, 2, handles);
+    context.SetConstants(2, mode);
+    context.TransitionResource(pTexture->m_texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 }
 
 void GeometryDX12::EndGeometry()
@@ -63,19 +111,19 @@ void GeometryDX12::EndGeometry()
     m_pContext = nullptr;
 }
 
-void GeometryDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB)
+void GeometryDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
 {
     auto pCurrentTexture = m_pDevice->GetTexture(id);
     auto projection = m_pDevice->GetCamera()->GetProjection(Camera::ProjectionType::D3D);
 
     m_pContext = &GraphicsContext::Begin(L"Begin Geometry");
     m_pContext->SetRootSignature(m_rootSig);
-    m_pContext->SetPipelineState(m_geometryPSO);
+    m_pContext->SetPipelineState((flags & GeometryFlags::DistanceField) ? m_textPSO : m_geometryPSO);
     m_pContext->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     m_pContext->SetViewportAndScissor(0, 0, m_pDevice->GetCamera()->GetFilmSize().x, m_pDevice->GetCamera()->GetFilmSize().y);
     m_pContext->SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV());
-    m_pContext->SetDynamicDescriptor(0, 0, pCurrentTexture->m_texture.GetSRV());
     m_pContext->SetConstants(1, 16, &projection);
+    SetTexture(*m_pContext, pCurrentTexture);
 
     // Initialize the vertex buffer view
     m_vertexBufferView.BufferLocation = ((BufferDX12*)pVB)->GetBuffer().GetGpuPointer();
@@ -87,8 +135,6 @@ void GeometryDX12::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer*
     m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
     m_indexBufferView.SizeInBytes = pIB->GetByteSize();
     m_pContext->SetIndexBuffer(m_indexBufferView);
-    
-    m_pContext->TransitionResource(pCurrentTexture->m_texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 }
 
 void GeometryDX12::DrawTriangles(
@@ -100,4 +146,29 @@ void GeometryDX12::DrawTriangles(
     m_pContext->DrawIndexedInstanced(numIndices, 1, IBOffset, VBOffset, 0);
 }
 
+void GeometryDX12::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    if (numSprites == 0)
+    {
+        return;
+    }
+
+    auto pCurrentTexture = m_pDevice->GetTexture(id);
+    auto projection = m_pDevice->GetCamera()->GetProjection(Camera::ProjectionType::D3D);
+
+    auto& context = GraphicsContext::Begin(L"Draw Sprites");
+    context.SetRootSignature(m_rootSig);
+    context.SetPipelineState(m_spritePSO);
+    context.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    context.SetViewportAndScissor(0, 0, m_pDevice->GetCamera()->GetFilmSize().x, m_pDevice->GetCamera()->GetFilmSize().y);
+    context.SetRenderTarget(g_SceneColorBuffer.GetRTV(), g_SceneDepthBuffer.GetDSV());
+    context.SetConstants(1, 16, &projection);
+    SetTexture(context, pCurrentTexture);
+
+    // The instances are copied to the per-frame upload heap, which grows as needed
+    context.SetDynamicVB(0, numSprites, sizeof(SpriteInstance), pSprites);
+    context.DrawInstanced(4, numSprites);
+    context.Finish(true);
+}
+
 } // namespace Mgfx
@@ -5,6 +5,7 @@ namespace Mgfx
 {
 
 class BufferDX12;
+struct TextureDataDX12;
 
 class GeometryDX12 : public IGeometry
 {
@@ -18,11 +19,13 @@ public:
         uint32_t numVertices,
         uint32_t numIndices) override;
 
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) override;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
     virtual void EndGeometry() override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
 
 private:
     void Init();
+    void SetTexture(GraphicsContext& context, TextureDataDX12* pTexture);
 
 private:
     static const uint32_t QuadVertexSize = sizeof(GeometryVertex);
@@ -37,6 +40,8 @@ private:
 
     RootSignature m_rootSig;
     GraphicsPSO m_geometryPSO;
+    GraphicsPSO m_spritePSO;
+    GraphicsPSO m_textPSO;
     GraphicsContext* m_pContext = nullptr;
 };
 
@@ -1,23 +1,81 @@
 #include "mgfx_core.h"
 #include "deviceGL.h"
 #include "bufferGL.h"
+#include "animation/timer.h"
 
 namespace Mgfx
 {
 
+namespace
+{
+// Room at the end of each region to align the start of a mapping to its type
+const uint32_t RegionSlack = 256;
+}
+
+const uint32_t BufferGL::NumRegions;
+
 BufferGL::BufferGL(DeviceGL* pDevice, uint32_t size, uint32_t flags)
     : m_pDevice(pDevice),
-    m_size(size),
     m_flags(flags)
 {
+    Create(size);
+}
+
+BufferGL::~BufferGL()
+{
+    Destroy();
+}
+
+void BufferGL::Create(uint32_t size)
+{
+    m_size = size;
+    m_offset = 0;
+    m_region = 0;
+    m_reset = true;
+
     CHECK_GL(glGenBuffers(1, &m_bufferID));
     Bind();
+
+    if (m_pDevice->HasBufferStorage())
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        m_regionStride = size + RegionSlack;
+        CHECK_GL(m_pDevice->BufferStorage(GetBufferType(), GLsizeiptr(m_regionStride) * NumRegions, nullptr, flags));
+        m_pPersistent = (uint8_t*)glMapBufferRange(GetBufferType(), 0, GLsizeiptr(m_regionStride) * NumRegions, flags);
+        if (m_pPersistent)
+        {
+            return;
+        }
+
+        // Storage is immutable, so start again with a plain buffer
+        LOG(WARNING) << "Persistent buffer map failed, falling back to glMapBufferRange";
+        CHECK_GL(glDeleteBuffers(1, &m_bufferID));
+        CHECK_GL(glGenBuffers(1, &m_bufferID));
+        Bind();
+    }
     CHECK_GL(glBufferData(GetBufferType(), size, NULL, GL_DYNAMIC_DRAW));
 }
 
-BufferGL::~BufferGL()
+// GL keeps the storage alive until the GPU is done with it, so there is no need to wait on the fences
+void BufferGL::Destroy()
 {
+    for (auto& fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (m_pPersistent)
+    {
+        Bind();
+        CHECK_GL(glUnmapBuffer(GetBufferType()));
+        m_pPersistent = nullptr;
+    }
     CHECK_GL(glDeleteBuffers(1, &m_bufferID));
+    m_bufferID = 0;
 }
 
 void BufferGL::Bind() const
@@ -35,6 +93,13 @@ void BufferGL::EnsureSize(uint32_t size)
     // Force it to grow
     if (size > m_size)
     {
+        if (m_pPersistent)
+        {
+            Destroy();
+            Create(size);
+            return;
+        }
+
         Bind();
         CHECK_GL(glBufferData(GetBufferType(), size, NULL, GL_DYNAMIC_DRAW));
         m_size = size;
@@ -64,13 +129,19 @@ void* BufferGL::Map(unsigned int num, unsigned int typeSize, unsigned int& offse
     }
 
     m_mapped = true;
-
-    Bind();
+    m_pDevice->GetStreamStats().maps++;
 
     uint32_t byteSize = num * typeSize;
 
     EnsureSize(byteSize);
 
+    if (m_pPersistent)
+    {
+        return MapPersistent(byteSize, typeSize, offset);
+    }
+
+    Bind();
+
     if (m_reset || ((m_offset + byteSize) > m_size))
     {
         offset = 0;
@@ -89,19 +160,114 @@ void* BufferGL::Map(unsigned int num, unsigned int typeSize, unsigned int& offse
     }
 }
 
+// Allocate from the current frame's region. Offsets are in elements from the start of the buffer,
+// so the start is aligned to the type
+void* BufferGL::MapPersistent(uint32_t byteSize, uint32_t typeSize, uint32_t& offset)
+{
+    // First map of a new frame; the last region is done with until the GPU finishes that frame
+    if (m_frame != m_pDevice->GetFrameCount())
+    {
+        m_frame = m_pDevice->GetFrameCount();
+        if (m_offset != 0)
+        {
+            NextRegion();
+        }
+    }
+
+    auto alignedStart = [&]()
+    {
+        uint32_t start = m_region * m_regionStride + m_offset;
+        return ((start + typeSize - 1) / typeSize) * typeSize;
+    };
+
+    uint32_t start = alignedStart();
+    if (start + byteSize > m_region * m_regionStride + m_regionStride)
+    {
+        // This frame filled its region
+        m_pDevice->GetStreamStats().wraps++;
+        NextRegion();
+        start = alignedStart();
+
+        // Types bigger than the slack may still not line up
+        if (start + byteSize > m_region * m_regionStride + m_regionStride)
+        {
+            Destroy();
+            Create(byteSize + typeSize);
+            start = alignedStart();
+        }
+    }
+
+    offset = start / typeSize;
+    m_offset = start + byteSize - m_region * m_regionStride;
+    return m_pPersistent + start;
+}
+
+// Fence the writes to this region, and move on to the next one, once the GPU has finished with it
+void BufferGL::NextRegion()
+{
+    if (m_fences[m_region])
+    {
+        glDeleteSync(m_fences[m_region]);
+    }
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_region = (m_region + 1) % NumRegions;
+    m_offset = 0;
+    WaitRegion(m_region);
+}
+
+void BufferGL::WaitRegion(uint32_t region)
+{
+    auto& fence = m_fences[region];
+    if (!fence)
+    {
+        return;
+    }
+
+    auto result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        auto& stats = m_pDevice->GetStreamStats();
+        stats.stalls++;
+
+        Timer timer;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        stats.stallMs += timer.GetDelta() * 1000.0;
+    }
+
+    if (result == GL_WAIT_FAILED)
+    {
+        LOG(ERROR) << "Buffer fence wait failed";
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
 void BufferGL::UnMap()
 {
     assert(m_mapped);
     if (m_mapped)
     {
-        Bind();
-        CHECK_GL(glUnmapBuffer(GetBufferType()));
+        // Coherent; nothing to do
+        if (!m_pPersistent)
+        {
+            Bind();
+            CHECK_GL(glUnmapBuffer(GetBufferType()));
+        }
         m_mapped = false;
     }
 }
 
 uint32_t BufferGL::GetBufferType() const
 {
+    if (m_flags & DeviceBufferFlags::IndirectBuffer)
+    {
+        return GL_DRAW_INDIRECT_BUFFER;
+    }
     return (m_flags & DeviceBufferFlags::IndexBuffer) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
 }
 
@@ -5,9 +5,11 @@ namespace Mgfx
 
 // A helper to draw dynamic data into a geoemtry buffer in opengl
 // The idea is to gain some parallelism between writing buffer data and the hardware reading it.
-// Really, this is just a simple wrapper around the GL API.
 // Conforms to IDeviceBuffer, since DX12 was added to do the same thing.
-// The difference here is that GL cannot permanently map the buffer, so calling UnMap is important 
+// Where the driver has buffer storage (GL 4.4), the buffer is mapped once, persistently, and split into a region
+// per frame in flight. Each region is fenced when the frame moves on, and only written again once the GPU has passed
+// the fence; so there is no map/unmap cost, and no hazard.
+// Otherwise, ranges are mapped unsynchronized, and the buffer is invalidated when it wraps; calling UnMap is important
 // (as the sample code does)
 class BufferGL : public IDeviceBuffer
 {
@@ -25,10 +27,22 @@ public:
     virtual void Bind() const override;
     virtual void UnBind() const override;
 
-private:
+    bool IsPersistent() const { return m_pPersistent != nullptr; }
+
+    // Growing a persistent buffer creates new storage under a new name, so anything bound to it must be bound again
     uint32_t GetBufferID() const { return m_bufferID; }
+
+    static const uint32_t NumRegions = 3;
+
+private:
     uint32_t GetBufferType() const;
 
+    void Create(uint32_t size);
+    void Destroy();
+    void* MapPersistent(uint32_t byteSize, uint32_t typeSize, uint32_t& offset);
+    void NextRegion();
+    void WaitRegion(uint32_t region);
+
 public:
     DeviceGL* m_pDevice = nullptr;
     uint32_t m_offset = 0;
@@ -39,6 +53,13 @@ public:
     uint32_t m_flags = 0;
     bool m_mapped = false;
     bool m_reset = true;
+
+    // Persistent mapping; m_offset is within the current region
+    uint8_t* m_pPersistent = nullptr;
+    uint32_t m_regionStride = 0;
+    uint32_t m_region = 0;
+    uint64_t m_frame = 0;
+    GLsync m_fences[NumRegions] = {};
 };
 
 } // namespace Mgfx
@@ -3,6 +3,7 @@
 #include "device/GL/deviceGL.h"
 #include "device/GL/geometryGL.h"
 #include "device/GL/bufferGL.h"
+#include "device/GL/textureStreamGL.h"
 #include "camera/camera.h"
 #include "scene/scene.h"
 #include "geometry/mesh.h"
@@ -10,7 +11,7 @@
 #include "ui/window.h"
 #include "ui/imgui_sdl_common.h"
 #include "file/media_manager.h"
-#include "gli/gli.hpp"
+#include "profile/profiler.h"
 
 #include <iostream>
 
@@ -81,6 +82,24 @@ bool DeviceGL::Init()
         CHECK_GL(glEnable(GL_DEBUG_OUTPUT));
     }
 
+    // Persistently mapped streaming buffers, if the driver can
+    if (gl3wIsSupported(4, 4) || HasExtension("GL_ARB_buffer_storage"))
+    {
+        m_glBufferStorage = (PFNGLBUFFERSTORAGEPROC_MGFX)SDL_GL_GetProcAddress("glBufferStorage");
+    }
+    LOG(INFO) << "Streaming buffers: " << (m_glBufferStorage ? "persistent" : "map range");
+
+    // Multi-draw needs the base instance, to find the material of each draw
+    m_multiDrawIndirect = glMultiDrawElementsIndirect != nullptr &&
+        (gl3wIsSupported(4, 3) || (HasExtension("GL_ARB_multi_draw_indirect") && HasExtension("GL_ARB_base_instance")));
+    if (m_multiDrawIndirect)
+    {
+        m_spIndirectBuffer = std::make_shared<BufferGL>(this, 1024 * sizeof(GLDrawCommand), DeviceBufferFlags::IndirectBuffer);
+    }
+    LOG(INFO) << "Mesh draws: " << (m_multiDrawIndirect ? "multi-draw indirect" : "base vertex");
+
+    m_spTextureStream = std::make_shared<TextureStreamGL>(this);
+
     m_spImGuiDraw = std::make_shared<ImGuiSDL_GL3>();
 
     SDL_GL_SetSwapInterval(1);
@@ -109,7 +128,6 @@ bool DeviceGL::Init()
         CameraID = glGetUniformLocation(programID, "camera_pos");
         LightDirID = glGetUniformLocation(programID, "light_dir");
 
-        HasNormalMapID = glGetUniformLocation(programID, "has_normalmap");
     }
 
     CHECK_GL(glGenVertexArrays(1, &VertexArrayID));
@@ -133,23 +151,34 @@ void DeviceGL::DestroyDeviceMeshes()
         DestroyDeviceMesh(spMesh.second.get());
     }
     m_mapDeviceMeshes.clear();
+}
 
-    for (auto& tex : m_mapPathToTextureID)
+bool DeviceGL::HasExtension(const char* pName) const
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
     {
-        glDeleteTextures(1, &tex.second);
+        auto pExtension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (pExtension && strcmp(pExtension, pName) == 0)
+        {
+            return true;
+        }
     }
-    m_mapPathToTextureID.clear();
+    return false;
 }
 
 void DeviceGL::DestroyDeviceMesh(GLMesh* pDeviceMesh)
 {
     SDL_GL_MakeCurrent(pSDLWindow, glContext);
-    for (auto& indexPart : pDeviceMesh->m_glMeshParts)
+    m_spTextureStream->Remove(pDeviceMesh);
+    glDeleteVertexArrays(1, &pDeviceMesh->vertexArrayID);
+    glDeleteBuffers(1, &pDeviceMesh->verticesID);
+    glDeleteBuffers(1, &pDeviceMesh->indicesID);
+    glDeleteBuffers(1, &pDeviceMesh->materialsID);
+    for (auto& texArray : pDeviceMesh->textureArrays)
     {
-        auto& spGLPart = indexPart.second;
-        glDeleteBuffers(1, &spGLPart->normalID);
-        glDeleteBuffers(1, &spGLPart->positionID);
-        glDeleteBuffers(1, &spGLPart->uvID);
+        glDeleteTextures(1, &texArray.textureID);
     }
 }
 
@@ -158,101 +187,6 @@ std::shared_ptr<IDeviceBuffer> DeviceGL::CreateBuffer(uint32_t size, uint32_t fl
     return std::static_pointer_cast<IDeviceBuffer>(std::make_shared<BufferGL>(this, size, flags));
 }
 
-uint32_t DeviceGL::LoadTexture(const fs::path& path)
-{
-    if (!fs::exists(path))
-    {
-        return 0;
-    }
-
-    SDL_GL_MakeCurrent(pSDLWindow, glContext);
-    auto itr = m_mapPathToTextureID.find(path);
-    if (itr == m_mapPathToTextureID.end())
-    {
-        GLuint TextureName = 0;
-        if (path.extension().string() == ".dds")
-        {
-            gli::texture Texture = gli::load(path.string());
-            if (Texture.empty())
-                return 0;
-
-            Texture = gli::flip(Texture);
-
-            gli::gl GL(gli::gl::PROFILE_GL33);
-            gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
-            GLenum Target = GL.translate(Texture.target());
-            assert(gli::is_compressed(Texture.format()) && Target == gli::gl::TARGET_2D);
-
-            glGenTextures(1, &TextureName);
-            glBindTexture(Target, TextureName);
-
-            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-            if (Texture.levels() > 1)
-            {
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-            }
-            else
-            {
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-            }
-            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-            glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
-            glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
-            glTexParameteriv(Target, GL_TEXTURE_SWIZZLE_RGBA, &Format.Swizzles[0]);
-            glTexStorage2D(Target, static_cast<GLint>(Texture.levels()), Format.Internal, Texture.extent().x, Texture.extent().y);
-            for (std::size_t Level = 0; Level < Texture.levels(); ++Level)
-            {
-                glm::tvec3<GLsizei> Extent(Texture.extent(Level));
-                glCompressedTexSubImage2D(
-                    Target, static_cast<GLint>(Level), 0, 0, Extent.x, Extent.y,
-                    Format.Internal, static_cast<GLsizei>(Texture.size(Level)), Texture.data(0, 0, Level));
-            }
-        }
-        else
-        {
-            int w;
-            int h;
-            int comp;
-            unsigned char* image = stbi_load(path.string().c_str(), &w, &h, &comp, STBI_default);
-
-            assert(image != nullptr);
-            if (image != nullptr)
-            {
-                CHECK_GL(glGenTextures(1, &TextureName));
-                CHECK_GL(glBindTexture(GL_TEXTURE_2D, TextureName));
-
-                if (comp == 3)
-                {
-                    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image));
-                }
-                else if (comp == 4)
-                {
-                    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image));
-                }
-
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-                CHECK_GL(glGenerateMipmap(GL_TEXTURE_2D));
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-                CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-                CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
-
-                stbi_image_free(image);
-            }
-        }
-
-        if (TextureName != 0)
-        {
-            m_mapPathToTextureID[path] = TextureName;
-        }
-        return TextureName;
-    }
-    return itr->second;
-}
-
 uint32_t DeviceGL::CreateTexture()
 {
 
@@ -264,7 +198,7 @@ uint32_t DeviceGL::CreateTexture()
     CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
 
     auto spTextureData = std::make_shared<TextureDataGL>();
-    CHECK_GL(glGenBuffers(1, &spTextureData->PBOBufferID));
+    CHECK_GL(glGenBuffers(TextureDataGL::NumPBOs, spTextureData->PBOBufferIDs));
     spTextureData->currentPBO = 0;
 
     m_mapIDToTextureData[tex] = spTextureData;
@@ -278,13 +212,24 @@ void DeviceGL::DestroyTexture(uint32_t id)
     {
         return;
     }
-    glDeleteBuffers(1, &itr->second->PBOBufferID);
+    glDeleteBuffers(TextureDataGL::NumPBOs, itr->second->PBOBufferIDs);
+    glDeleteTextures(1, &itr->second->PaletteID);
     m_mapIDToTextureData.erase(itr);
 
     CHECK_GL(glDeleteTextures(1, &id));
 }
 
-TextureData DeviceGL::ResizeTexture(uint32_t id, const glm::uvec2& size)
+const TextureDataGL* DeviceGL::GetTextureData(uint32_t id) const
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return nullptr;
+    }
+    return itr->second.get();
+}
+
+TextureData DeviceGL::ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format)
 {
     TextureData ret;
     auto itr = m_mapIDToTextureData.find(id);
@@ -293,45 +238,148 @@ TextureData DeviceGL::ResizeTexture(uint32_t id, const glm::uvec2& size)
         return ret;
     }
 
-    itr->second->quadData.resize(size.x * size.y);
+    itr->second->quadData.resize(size.x * size.y * TextureFormatSize(format));
     itr->second->RequiredSize = size;
-    ret.pData = &itr->second->quadData[0].x;
-    ret.pitch = size.x * sizeof(glm::u8vec4);
+    itr->second->RequiredFormat = format;
+    ret.pData = itr->second->quadData.data();
+    ret.pitch = size.x * TextureFormatSize(format);
+    ret.format = format;
     return ret;
 }
 
+// Indices are looked up in the palette when drawn, so they are sampled without filtering
+void DeviceGL::SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors)
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    auto& spTexture = itr->second;
+    std::vector<glm::u8vec4> palette(256, glm::u8vec4(0));
+    std::copy(pColors, pColors + std::min(numColors, uint32_t(palette.size())), palette.begin());
+
+    if (spTexture->PaletteID == 0)
+    {
+        CHECK_GL(glGenTextures(1, &spTexture->PaletteID));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, spTexture->PaletteID));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, id));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    }
+
+    CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D, spTexture->PaletteID));
+    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(palette.size()), 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette.data()));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+namespace
+{
+struct GLFormat
+{
+    GLint internalFormat;
+    GLenum format;
+    GLenum type;
+};
+
+GLFormat GetGLFormat(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::R8: return GLFormat{ GL_R8, GL_RED, GL_UNSIGNED_BYTE };
+    case TextureFormat::RG8: return GLFormat{ GL_RG8, GL_RG, GL_UNSIGNED_BYTE };
+    case TextureFormat::RGBA16F: return GLFormat{ GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT };
+    case TextureFormat::RGBA32F: return GLFormat{ GL_RGBA32F, GL_RGBA, GL_FLOAT };
+    default: return GLFormat{ GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+    }
+}
+}
+
 void DeviceGL::UpdateTexture(uint32_t id)
 {
+    PROFILE_SCOPE("DeviceGL::UpdateTexture");
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+    UpdateTextureRegion(id, glm::uvec2(0), itr->second->RequiredSize);
+}
+
+// The region's rows are packed into the next pixel buffer, and copied to the texture from there by the GPU
+void DeviceGL::UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size)
+{
+    PROFILE_SCOPE("DeviceGL::UpdateTextureRegion");
     auto itr = m_mapIDToTextureData.find(id);
     if (itr == m_mapIDToTextureData.end())
     {
         return;
     }
 
-    auto byteSize = itr->second->quadData.size() * sizeof(glm::u8vec4);
     auto& spTexture = itr->second;
-    bool skip = false;
-    if (spTexture->Size != spTexture->RequiredSize)
+    CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D, id));
+
+    // Storage is only allocated when the size or format changes, and then all of it needs filling
+    auto regionOffset = offset;
+    auto regionSize = size;
+    auto glFormat = GetGLFormat(spTexture->RequiredFormat);
+    if (spTexture->Size != spTexture->RequiredSize || spTexture->Format != spTexture->RequiredFormat)
+    {
+        spTexture->Size = spTexture->RequiredSize;
+        spTexture->Format = spTexture->RequiredFormat;
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, glFormat.internalFormat, spTexture->Size.x, spTexture->Size.y, 0, glFormat.format, glFormat.type, nullptr));
+        regionOffset = glm::uvec2(0);
+        regionSize = spTexture->Size;
+    }
+
+    regionOffset = glm::min(regionOffset, spTexture->Size);
+    regionSize = glm::min(regionSize, spTexture->Size - regionOffset);
+    if (regionSize.x == 0 || regionSize.y == 0)
+    {
+        return;
+    }
+
+    spTexture->currentPBO = (spTexture->currentPBO + 1) % TextureDataGL::NumPBOs;
+    auto& pboSize = spTexture->PBOSizes[spTexture->currentPBO];
+    uint32_t texelSize = TextureFormatSize(spTexture->Format);
+    uint32_t rowBytes = regionSize.x * texelSize;
+    uint32_t byteSize = rowBytes * regionSize.y;
+
+    CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spTexture->PBOBufferIDs[spTexture->currentPBO]));
+    if (byteSize > pboSize)
     {
-        CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spTexture->PBOBufferID));
         CHECK_GL(glBufferData(GL_PIXEL_UNPACK_BUFFER, byteSize, 0, GL_STREAM_DRAW));
-        itr->second->Size = spTexture->RequiredSize;
-        skip = true;
+        pboSize = byteSize;
     }
 
-    CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spTexture->PBOBufferID));
-    GLubyte* ptr = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, byteSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-    memcpy(ptr, &itr->second->quadData[0], byteSize);
-    CHECK_GL(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    auto ptr = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, byteSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (ptr)
+    {
+        for (uint32_t y = 0; y < regionSize.y; y++)
+        {
+            memcpy(ptr + y * rowBytes, &spTexture->quadData[((regionOffset.y + y) * spTexture->Size.x + regionOffset.x) * texelSize], rowBytes);
+        }
+        CHECK_GL(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
 
-    CHECK_GL(glBindTexture(GL_TEXTURE_2D, id));
-    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, spTexture->Size.x, spTexture->Size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+        // Rows of 1 and 2 byte texels aren't padded
+        CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        CHECK_GL(glTexSubImage2D(GL_TEXTURE_2D, 0, regionOffset.x, regionOffset.y, regionSize.x, regionSize.y, glFormat.format, glFormat.type, 0));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
     CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
 }
 
-void DeviceGL::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB)
+void DeviceGL::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
 {
-    m_spGeometry->BeginGeometry(id, pVB, pIB);
+    m_spGeometry->BeginGeometry(id, pVB, pIB, flags);
 }
 
 void DeviceGL::EndGeometry()
@@ -348,6 +396,11 @@ void DeviceGL::DrawTriangles(
     m_spGeometry->DrawTriangles(VBOffset, IBOffset, numVertices, numIndices);
 }
 
+void DeviceGL::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    m_spGeometry->DrawSprites(id, pSprites, numSprites);
+}
+
 Camera* DeviceGL::GetCamera() const
 {
     return m_pCurrentCamera;
@@ -416,6 +469,12 @@ bool DeviceGL::BeginFrame()
 
     SDL_GL_MakeCurrent(pSDLWindow, glContext);
 
+    // Copy in the textures which have loaded, within the frame's budget
+    for (auto pDeviceMesh : m_spTextureStream->Update())
+    {
+        ResolveMeshTextures(pDeviceMesh);
+    }
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -469,36 +528,62 @@ std::shared_ptr<GLMesh> DeviceGL::BuildDeviceMesh(Mesh* pMesh)
     SDL_GL_MakeCurrent(pSDLWindow, glContext);
     auto spDeviceMesh = std::make_shared<GLMesh>();
 
-    CHECK_GL(glBindVertexArray(VertexArrayID));
-
+    // Each texture is loaded once, however many parts use it
+    std::vector<fs::path> texturePaths;
+    std::map<fs::path, uint32_t> mapPathToTexture;
+    auto findTexture = [&](const std::string& name)
+    {
+        auto path = MediaManager::Instance().FindAsset(name.c_str(), MediaType::Texture, &pMesh->GetRootPath());
+        auto itr = mapPathToTexture.find(path);
+        if (itr != mapPathToTexture.end())
+        {
+            return int32_t(itr->second);
+        }
+        mapPathToTexture[path] = uint32_t(texturePaths.size());
+        texturePaths.push_back(path);
+        return int32_t(texturePaths.size() - 1);
+    };
+
+    // All the parts are appended to one vertex and index buffer
+    std::vector<GLMeshVertex> vertices;
+    std::vector<uint32_t> indices;
     for (auto& spPart : pMesh->GetMeshParts())
     {
         auto spGLPart = std::make_shared<GLMeshPart>();
+        spGLPart->index = uint32_t(spDeviceMesh->m_glMeshParts.size());
+        spGLPart->firstIndex = uint32_t(indices.size());
+        spGLPart->baseVertex = uint32_t(vertices.size());
+        spGLPart->numIndices = uint32_t(spPart->Indices.size());
 
-        CHECK_GL(glGenBuffers(1, &spGLPart->positionID));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->positionID));
-        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*spPart->Positions.size(), spPart->Positions.data(), GL_STATIC_DRAW));
-
-        CHECK_GL(glGenBuffers(1, &spGLPart->normalID));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->normalID));
-        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*spPart->Normals.size(), spPart->Normals.data(), GL_STATIC_DRAW));
-
-        CHECK_GL(glGenBuffers(1, &spGLPart->uvID));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->uvID));
-        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2)*spPart->UVs.size(), spPart->UVs.data(), GL_STATIC_DRAW));
-
-        CHECK_GL(glGenBuffers(1, &spGLPart->indicesID));
-        CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spGLPart->indicesID));
-        CHECK_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t)*spPart->Indices.size(), spPart->Indices.data(), GL_STATIC_DRAW));
+        // Parts without normals or UVs get defaults, so every part has the same layout
+        for (size_t i = 0; i < spPart->Positions.size(); i++)
+        {
+            GLMeshVertex vertex;
+            vertex.pos = spPart->Positions[i];
+            vertex.normal = i < spPart->Normals.size() ? spPart->Normals[i] : glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.uv = i < spPart->UVs.size() ? spPart->UVs[i] : glm::vec2(0.0f);
+            vertices.push_back(vertex);
+        }
+        indices.insert(indices.end(), spPart->Indices.begin(), spPart->Indices.end());
 
-        spGLPart->numIndices = uint32_t(spPart->Indices.size());
+        if (!spPart->Positions.empty())
+        {
+            glm::vec3 minBound(std::numeric_limits<float>::max());
+            glm::vec3 maxBound(-std::numeric_limits<float>::max());
+            for (auto& pos : spPart->Positions)
+            {
+                minBound = glm::min(minBound, pos);
+                maxBound = glm::max(maxBound, pos);
+            }
+            spGLPart->center = (minBound + maxBound) * 0.5f;
+        }
 
         if (spPart->MaterialID != -1)
         {
             auto& mat = pMesh->GetMaterials()[spPart->MaterialID];
             if (!mat->diffuseTex.empty())
             {
-                spGLPart->textureID = LoadTexture(MediaManager::Instance().FindAsset(mat->diffuseTex.c_str(), MediaType::Texture, &pMesh->GetRootPath()));
+                spGLPart->diffuseTexture = findTexture(mat->diffuseTex);
 
                 // This is a hack to detect transparent textures in Sponza.
                 // We could scan the texture for alpha < 1, or store the information in the scene file as a better solution
@@ -512,33 +597,116 @@ std::shared_ptr<GLMesh> DeviceGL::BuildDeviceMesh(Mesh* pMesh)
 
             if (!mat->normalTex.empty())
             {
-                spGLPart->textureIDNormal = LoadTexture(MediaManager::Instance().FindAsset(mat->normalTex.c_str(), MediaType::Texture, &pMesh->GetRootPath()));
+                spGLPart->normalTexture = findTexture(mat->normalTex);
             }
             // Another fix for bad sponza data ;) TODO: Fix the source asset
             else if (!mat->heightTex.empty() && mat->heightTex.find("diff") == std::string::npos)
             {
-                spGLPart->textureIDNormal = LoadTexture(MediaManager::Instance().FindAsset(mat->heightTex.c_str(), MediaType::Texture, &pMesh->GetRootPath()));
-            }
-            else
-            {
-                spGLPart->textureIDNormal = 0;
+                spGLPart->normalTexture = findTexture(mat->heightTex);
             }
         }
+        spDeviceMesh->m_glMeshParts.push_back(spGLPart);
+    }
+
+    CHECK_GL(glGenVertexArrays(1, &spDeviceMesh->vertexArrayID));
+    CHECK_GL(glBindVertexArray(spDeviceMesh->vertexArrayID));
+
+    CHECK_GL(glGenBuffers(1, &spDeviceMesh->verticesID));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spDeviceMesh->verticesID));
+    CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(GLMeshVertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW));
+
+    // attrib, size, type, normalized, stride, offset 
+    CHECK_GL(glEnableVertexAttribArray(0));
+    CHECK_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLMeshVertex), (void*)offsetof(GLMeshVertex, pos)));
+    CHECK_GL(glEnableVertexAttribArray(1));
+    CHECK_GL(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GLMeshVertex), (void*)offsetof(GLMeshVertex, normal)));
+    CHECK_GL(glEnableVertexAttribArray(2));
+    CHECK_GL(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GLMeshVertex), (void*)offsetof(GLMeshVertex, uv)));
+
+    // One material per instance, so the base instance of a draw picks its part's layers.
+    // Without multi-draw, the attribute is left disabled and set before each draw
+    if (m_multiDrawIndirect)
+    {
+        CHECK_GL(glGenBuffers(1, &spDeviceMesh->materialsID));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spDeviceMesh->materialsID));
+        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(glm::ivec2) * spDeviceMesh->m_glMeshParts.size(), nullptr, GL_DYNAMIC_DRAW));
+        CHECK_GL(glEnableVertexAttribArray(3));
+        CHECK_GL(glVertexAttribIPointer(3, 2, GL_INT, sizeof(glm::ivec2), (void*)0));
+        CHECK_GL(glVertexAttribDivisor(3, 1));
+    }
+
+    // The element buffer binding is part of the vertex array state
+    CHECK_GL(glGenBuffers(1, &spDeviceMesh->indicesID));
+    CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spDeviceMesh->indicesID));
+    CHECK_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * indices.size(), indices.data(), GL_STATIC_DRAW));
+
+    CHECK_GL(glBindVertexArray(VertexArrayID));
+
+    // The textures load in the background; placeholders until then
+    m_spTextureStream->Add(spDeviceMesh.get(), texturePaths);
+    ResolveMeshTextures(spDeviceMesh.get());
+
+    LOG(INFO) << std::dec << "Mesh: " << spDeviceMesh->m_glMeshParts.size() << " parts, " << texturePaths.size() << " textures";
+    return spDeviceMesh;
+}
+
+// Point the parts at the arrays which are resident, and the rest at the placeholder
+void DeviceGL::ResolveMeshTextures(GLMesh* pDeviceMesh)
+{
+    auto resident = [&](int32_t texture)
+    {
+        if (texture < 0 || pDeviceMesh->textureSlots[texture].x < 0)
+        {
+            return false;
+        }
+        return pDeviceMesh->textureArrays[pDeviceMesh->textureSlots[texture].x].resident;
+    };
+
+    std::vector<glm::ivec2> materials;
+    for (auto& spGLPart : pDeviceMesh->m_glMeshParts)
+    {
+        if (resident(spGLPart->diffuseTexture))
+        {
+            auto slot = pDeviceMesh->textureSlots[spGLPart->diffuseTexture];
+            spGLPart->diffuseID = pDeviceMesh->textureArrays[slot.x].textureID;
+            spGLPart->diffuseLayer = slot.y;
+        }
+        else
+        {
+            spGLPart->diffuseID = spGLPart->diffuseTexture >= 0 ? m_spTextureStream->GetPlaceholderID() : 0;
+            spGLPart->diffuseLayer = spGLPart->diffuseTexture >= 0 ? 0 : -1;
+        }
+
+        if (resident(spGLPart->normalTexture))
+        {
+            auto slot = pDeviceMesh->textureSlots[spGLPart->normalTexture];
+            spGLPart->normalID = pDeviceMesh->textureArrays[slot.x].textureID;
+            spGLPart->normalLayer = slot.y;
+        }
         else
         {
-            spGLPart->textureID = 0;
-            spGLPart->textureIDNormal = 0;
+            spGLPart->normalID = 0;
+            spGLPart->normalLayer = -1;
         }
-        spDeviceMesh->m_glMeshParts[spPart.get()] = spGLPart;
+        materials.push_back(glm::ivec2(spGLPart->diffuseLayer, spGLPart->normalLayer));
     }
 
-    return spDeviceMesh;
+    if (pDeviceMesh->materialsID && !materials.empty())
+    {
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, pDeviceMesh->materialsID));
+        CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::ivec2) * materials.size(), materials.data()));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
 }
 
-void DeviceGL::DrawMesh(Mesh* pMesh, GeometryType type)
+bool DeviceGL::IsStreaming() const
 {
-    static std::vector<Mesh*> alphaMeshes;
+    return m_spTextureStream && m_spTextureStream->IsStreaming();
+}
 
+void DeviceGL::DrawMesh(Mesh* pMesh, GeometryType type)
+{
+    PROFILE_SCOPE("DeviceGL::DrawMesh");
     GLMesh* pDeviceMesh = nullptr;
     auto itrFound = m_mapDeviceMeshes.find(pMesh);
     if (itrFound == m_mapDeviceMeshes.end())
@@ -552,61 +720,99 @@ void DeviceGL::DrawMesh(Mesh* pMesh, GeometryType type)
         pDeviceMesh = itrFound->second.get();
     }
 
-    CHECK_GL(glBindVertexArray(VertexArrayID));
-
-    for (auto& indexPart : pDeviceMesh->m_glMeshParts)
+    // Queue the parts of the requested type, keyed by their textures and distance from the camera
+    auto cameraPos = m_pCurrentCamera ? m_pCurrentCamera->GetPosition() : glm::vec3(0.0f);
+    m_renderQueue.Clear();
+    m_queueParts.clear();
+    for (auto& spGLPart : pDeviceMesh->m_glMeshParts)
     {
-        auto spGLPart = indexPart.second;
-
-        // Skip if not the requested type
-        if ((spGLPart->transparent && type == GeometryType::Opaque) ||
-            (!spGLPart->transparent && type == GeometryType::Transparent))
+        if (spGLPart->transparent != (type == GeometryType::Transparent))
         {
             continue;
         }
 
-        CHECK_GL(glEnableVertexAttribArray(0));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->positionID));
-        // attrib, size, type, normalized, stride, offset 
-        CHECK_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+        auto depth = glm::length(spGLPart->center - cameraPos);
+        auto key = spGLPart->transparent ?
+            RenderQueue::TransparentKey(depth) :
+            RenderQueue::OpaqueKey(spGLPart->normalID, spGLPart->diffuseID, depth);
+        m_renderQueue.Add(key, uint32_t(m_queueParts.size()));
+        m_queueParts.push_back(spGLPart.get());
+    }
+
+    m_renderQueue.Sort();
+    SubmitMeshParts(pDeviceMesh);
+}
 
-        CHECK_GL(glEnableVertexAttribArray(1));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->normalID));
-        CHECK_GL(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+// Draw the sorted parts, in runs which share texture arrays; the arrays are only bound once per run.
+// A run is a single multi-draw where the driver can, or a draw per part with a base vertex where it can't
+void DeviceGL::SubmitMeshParts(GLMesh* pDeviceMesh)
+{
+    if (m_renderQueue.IsEmpty())
+    {
+        return;
+    }
 
-        CHECK_GL(glEnableVertexAttribArray(2));
-        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, spGLPart->uvID));
-        CHECK_GL(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+    auto& items = m_renderQueue.GetItems();
+    CHECK_GL(glBindVertexArray(pDeviceMesh->vertexArrayID));
 
-        CHECK_GL(glActiveTexture(GL_TEXTURE0));
-        if (spGLPart->textureID)
+    uint32_t commandOffset = 0;
+    if (m_multiDrawIndirect)
+    {
+        auto pCommands = (GLDrawCommand*)m_spIndirectBuffer->Map(uint32_t(items.size()), sizeof(GLDrawCommand), commandOffset);
+        if (!pCommands)
         {
-            CHECK_GL(glBindTexture(GL_TEXTURE_2D, spGLPart->textureID));
+            CHECK_GL(glBindVertexArray(VertexArrayID));
+            return;
         }
-        else
+        for (auto& item : items)
+        {
+            auto pGLPart = m_queueParts[item.index];
+            *pCommands++ = GLDrawCommand{ pGLPart->numIndices, 1, pGLPart->firstIndex, pGLPart->baseVertex, pGLPart->index };
+        }
+        m_spIndirectBuffer->UnMap();
+        m_spIndirectBuffer->Bind();
+    }
+
+    size_t runStart = 0;
+    while (runStart < items.size())
+    {
+        auto pFirst = m_queueParts[items[runStart].index];
+        size_t runEnd = runStart + 1;
+        while (runEnd < items.size() &&
+            m_queueParts[items[runEnd].index]->diffuseID == pFirst->diffuseID &&
+            m_queueParts[items[runEnd].index]->normalID == pFirst->normalID)
         {
-            CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+            runEnd++;
         }
 
+        CHECK_GL(glActiveTexture(GL_TEXTURE0));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, pFirst->diffuseID));
         CHECK_GL(glActiveTexture(GL_TEXTURE1));
-        if (spGLPart->textureIDNormal)
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, pFirst->normalID));
+
+        if (m_multiDrawIndirect)
         {
-            CHECK_GL(glUniform1i(HasNormalMapID, 1));
-            CHECK_GL(glBindTexture(GL_TEXTURE_2D, spGLPart->textureIDNormal));
+            auto pIndirect = (void*)(uintptr_t((commandOffset + runStart) * sizeof(GLDrawCommand)));
+            CHECK_GL(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, pIndirect, GLsizei(runEnd - runStart), 0));
         }
         else
         {
-            CHECK_GL(glUniform1i(HasNormalMapID, 0));
-            CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+            for (size_t i = runStart; i < runEnd; i++)
+            {
+                auto pGLPart = m_queueParts[items[i].index];
+                CHECK_GL(glVertexAttribI2i(3, pGLPart->diffuseLayer, pGLPart->normalLayer));
+                CHECK_GL(glDrawElementsBaseVertex(GL_TRIANGLES, pGLPart->numIndices, GL_UNSIGNED_INT,
+                    (void*)(uintptr_t(pGLPart->firstIndex * sizeof(uint32_t))), GLint(pGLPart->baseVertex)));
+            }
         }
-
-        CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, spGLPart->indicesID));
-        CHECK_GL(glDrawElements(GL_TRIANGLES, spGLPart->numIndices, GL_UNSIGNED_INT, (void*)0));
+        runStart = runEnd;
     }
 
-    CHECK_GL(glDisableVertexAttribArray(0));
-    CHECK_GL(glDisableVertexAttribArray(1));
-    CHECK_GL(glDisableVertexAttribArray(2));
+    if (m_multiDrawIndirect)
+    {
+        m_spIndirectBuffer->UnBind();
+    }
+    CHECK_GL(glBindVertexArray(VertexArrayID));
 }
 
 void DeviceGL::Cleanup()
@@ -615,20 +821,29 @@ void DeviceGL::Cleanup()
     SDL_GL_MakeCurrent(pSDLWindow, glContext);
 
     m_spGeometry.reset();
+    m_spIndirectBuffer.reset();
 
     m_spImGuiDraw->Shutdown();
     m_spImGuiDraw.reset();
 
     DestroyDeviceMeshes();
+    m_spTextureStream.reset();
 
     glDeleteTextures(1, &BackBufferTextureID);
 
+    DestroyCaptures();
+
+    LOG(INFO) << std::dec << "Streaming buffers: Maps: " << m_streamStats.maps << ", Wraps: " << m_streamStats.wraps
+        << ", Stalls: " << m_streamStats.stalls << " (" << m_streamStats.stallMs << "ms)";
+
     glDeleteVertexArrays(1, &VertexArrayID);
     glDeleteProgram(programID);
 
     for (auto& qd : m_mapIDToTextureData)
     {
         glDeleteTextures(1, &qd.first);
+        glDeleteTextures(1, &qd.second->PaletteID);
+        glDeleteBuffers(TextureDataGL::NumPBOs, qd.second->PBOBufferIDs);
     }
     m_mapIDToTextureData.clear();
 
@@ -670,7 +885,137 @@ void DeviceGL::Swap()
     m_inFrame = false;
 
     SDL_GL_MakeCurrent(pSDLWindow, glContext);
+    if (m_captureRequested)
+    {
+        m_captureRequested = false;
+        BeginCapture();
+    }
+    m_frameCount++;
+
     SDL_GL_SwapWindow(pSDLWindow);
 }
 
+void DeviceGL::RequestCapture()
+{
+    m_captureRequested = true;
+}
+
+// Queue a copy of the back buffer into the next pixel buffer in the ring.
+// The copy runs on the GPU; the fence tells us when the data can be mapped without stalling
+void DeviceGL::BeginCapture()
+{
+    auto& slot = m_captureRing[m_nextCapture];
+    m_nextCapture = (m_nextCapture + 1) % NumCaptureBuffers;
+
+    // Ring is full; finish the oldest
+    if (slot.fence)
+    {
+        FrameCapture capture;
+        if (ReadCapture(slot, capture, true))
+        {
+            m_finishedCaptures.push_back(std::move(capture));
+        }
+    }
+
+    int w, h;
+    SDL_GL_GetDrawableSize(pSDLWindow, &w, &h);
+    slot.size = glm::uvec2(w, h);
+    slot.frame = m_frameCount;
+
+    if (slot.PBOBufferID == 0)
+    {
+        CHECK_GL(glGenBuffers(1, &slot.PBOBufferID));
+    }
+
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBOBufferID));
+    CHECK_GL(glBufferData(GL_PIXEL_PACK_BUFFER, w * h * sizeof(glm::u8vec4), nullptr, GL_STREAM_READ));
+    CHECK_GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    CHECK_GL(glReadBuffer(GL_BACK));
+    CHECK_GL(glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Map the pixel buffer if the GPU is done with it, flipping to top row first
+bool DeviceGL::ReadCapture(CaptureGL& slot, FrameCapture& capture, bool wait)
+{
+    if (!slot.fence)
+    {
+        return false;
+    }
+
+    auto result = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    if (result == GL_WAIT_FAILED)
+    {
+        LOG(ERROR) << "Frame capture failed";
+        return false;
+    }
+
+    capture.size = slot.size;
+    capture.frame = slot.frame;
+    capture.pixels.resize(slot.size.x * slot.size.y);
+
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBOBufferID));
+    auto pData = (const glm::u8vec4*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, capture.pixels.size() * sizeof(glm::u8vec4), GL_MAP_READ_BIT);
+    if (pData)
+    {
+        for (uint32_t y = 0; y < slot.size.y; y++)
+        {
+            auto pSource = pData + (slot.size.y - y - 1) * slot.size.x;
+            auto pTarget = &capture.pixels[y * slot.size.x];
+            for (uint32_t x = 0; x < slot.size.x; x++)
+            {
+                pTarget[x] = glm::u8vec4(pSource[x].x, pSource[x].y, pSource[x].z, 255);
+            }
+        }
+        CHECK_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    return pData != nullptr;
+}
+
+bool DeviceGL::GetCapture(FrameCapture& capture, bool wait)
+{
+    if (!m_finishedCaptures.empty())
+    {
+        capture = std::move(m_finishedCaptures.front());
+        m_finishedCaptures.pop_front();
+        return true;
+    }
+
+    // The oldest capture is the first in use after the next one to be written
+    SDL_GL_MakeCurrent(pSDLWindow, glContext);
+    for (uint32_t i = 0; i < NumCaptureBuffers; i++)
+    {
+        auto& slot = m_captureRing[(m_nextCapture + i) % NumCaptureBuffers];
+        if (slot.fence)
+        {
+            return ReadCapture(slot, capture, wait);
+        }
+    }
+    return false;
+}
+
+void DeviceGL::DestroyCaptures()
+{
+    for (auto& slot : m_captureRing)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.PBOBufferID);
+        slot = CaptureGL();
+    }
+    m_finishedCaptures.clear();
+}
+
 } // namespace Mgfx
@@ -4,6 +4,16 @@
 #include "imguisdl_gl3.h"
 #include "shader.h"
 #include "IDevice.h"
+#include "scene/renderqueue.h"
+#include <deque>
+
+// Buffer storage is GL 4.4 (or ARB_buffer_storage), newer than our headers; it is looked up at runtime
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_MGFX)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
 
 struct SDL_Window;
 union SDL_Event;
@@ -17,34 +27,104 @@ class Scene;
 
 class Window;
 class GeometryGL;
+class BufferGL;
+class TextureStreamGL;
 struct WindowData;
 struct MeshPart;
 
+// Updates go through a ring of pixel buffers, so writing the next one doesn't wait for the GPU to read the last
 struct TextureDataGL
 {
+    static const uint32_t NumPBOs = 3;
+
     uint32_t ImageID = 0;
-    uint32_t PBOBufferID = 0;
+    uint32_t PBOBufferIDs[NumPBOs] = {};
+    uint32_t PBOSizes[NumPBOs] = {};
     uint32_t currentPBO = 0;
     glm::uvec2 Size = glm::uvec2(0);
     glm::uvec2 RequiredSize = glm::uvec2(0);
-    std::vector<glm::u8vec4> quadData;
+    TextureFormat Format = TextureFormat::RGBA8;
+    TextureFormat RequiredFormat = TextureFormat::RGBA8;
+    std::vector<uint8_t> quadData;
+
+    // A 256x1 texture of colors, for R8 textures
+    uint32_t PaletteID = 0;
+};
+
+// The vertex layout of mesh parts; interleaved, so one fetch gets everything for a vertex
+struct GLMeshVertex
+{
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// Mesh textures of the same size and format share an array; parts pick theirs by layer
+struct GLTextureArray
+{
+    uint32_t textureID = 0;
+    uint32_t numLayers = 0;
+    bool resident = false;                  // All the layers are loaded
 };
 
+// A range of the mesh buffers, and its textures
 struct GLMeshPart
 {
-    uint32_t positionID = 0;
-    uint32_t normalID = 0;
-    uint32_t uvID = 0;
-    uint32_t indicesID = 0;
+    uint32_t index = 0;                     // Into the mesh material buffer, as the base instance
+    uint32_t firstIndex = 0;
+    uint32_t baseVertex = 0;
     uint32_t numIndices = 0;
-    uint32_t textureID = 0;
-    uint32_t textureIDNormal = 0;
+    int32_t diffuseTexture = -1;            // Into the mesh textures; -1 for none
+    int32_t normalTexture = -1;
+
+    // What is drawn; a placeholder, or no normal map, until the array is resident
+    uint32_t diffuseID = 0;
+    int32_t diffuseLayer = -1;
+    uint32_t normalID = 0;
+    int32_t normalLayer = -1;
     bool transparent = false;
+    glm::vec3 center = glm::vec3(0.0f);     // Of the bounds; for sorting by depth
 };
 
+// The layout of glMultiDrawElementsIndirect commands
+struct GLDrawCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    uint32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// A frame being read back through a pixel buffer; ready when the fence is signalled
+struct CaptureGL
+{
+    uint32_t PBOBufferID = 0;
+    GLsync fence = nullptr;
+    glm::uvec2 size = glm::uvec2(0);
+    uint64_t frame = 0;
+};
+
+// Streaming statistics, summed over all the buffers of a device
+struct StreamStatsGL
+{
+    uint64_t maps = 0;
+    uint64_t wraps = 0;         // A frame filled its region, and moved on to the next one early
+    uint64_t stalls = 0;        // Waited for the GPU to finish reading a region
+    double stallMs = 0.0;
+};
+
+// All the parts of a mesh share one vertex array, vertex buffer and index buffer.
+// The material buffer holds the texture layers of each part; an instanced attribute, found by the base instance
 struct GLMesh
 {
-    std::map<MeshPart*, std::shared_ptr<GLMeshPart>> m_glMeshParts;
+    uint32_t vertexArrayID = 0;
+    uint32_t verticesID = 0;
+    uint32_t indicesID = 0;
+    uint32_t materialsID = 0;
+    std::vector<glm::ivec2> textureSlots;   // The array and layer of each texture; -1 until read, or if it can't be
+    std::vector<GLTextureArray> textureArrays;
+    std::vector<std::shared_ptr<GLMeshPart>> m_glMeshParts;
 };
 
 class DeviceGL : public IDevice
@@ -65,18 +145,21 @@ public:
     // 2D Rendering functions
     uint32_t CreateTexture() override;
     virtual void DestroyTexture(uint32_t id) override;
-    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size) override;
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format = TextureFormat::RGBA8) override;
     virtual void UpdateTexture(uint32_t id) override;
+    virtual void UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size) override;
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) override;
 
     virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) override;
    
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) override;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
     virtual void EndGeometry() override;
     virtual void DrawTriangles(
         uint32_t VBOffset,
         uint32_t IBOffset,
         uint32_t numVertices,
         uint32_t numIndices) override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
 
     virtual void BeginGUI() override;
     virtual void EndGUI() override;
@@ -84,9 +167,19 @@ public:
     virtual void ProcessEvent(SDL_Event& event) override;
     virtual void Flush() override;
     virtual void Swap() override;
+    virtual void RequestCapture() override;
+    virtual bool GetCapture(FrameCapture& capture, bool wait) override;
     virtual SDL_Window* GetSDLWindow() const override { return pSDLWindow; }
 
     virtual const char* GetName() const override { return "OpenGL"; }
+    virtual bool IsStreaming() const override;
+
+    uint64_t GetFrameCount() const { return m_frameCount; }
+    const TextureDataGL* GetTextureData(uint32_t id) const;
+
+    bool HasBufferStorage() const { return m_glBufferStorage != nullptr; }
+    void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) { m_glBufferStorage(target, size, data, flags); }
+    StreamStatsGL& GetStreamStats() { return m_streamStats; }
 
 private:
 
@@ -94,12 +187,18 @@ private:
     void DestroyDeviceMesh(GLMesh* pDeviceMesh);
     void DestroyDeviceMeshes();
 
-    uint32_t LoadTexture(const fs::path& path);
+    void ResolveMeshTextures(GLMesh* pDeviceMesh);
+    void SubmitMeshParts(GLMesh* pDeviceMesh);
+
+    void BeginCapture();
+    bool ReadCapture(CaptureGL& slot, FrameCapture& capture, bool wait);
+    void DestroyCaptures();
+
+    bool HasExtension(const char* pName) const;
 
 private:
     std::map<Mesh*, std::shared_ptr<GLMesh>> m_mapDeviceMeshes;
     std::map<uint32_t, std::shared_ptr<TextureDataGL>> m_mapIDToTextureData;
-    std::map<fs::path, uint32_t> m_mapPathToTextureID;
 
     SDL_Window* pSDLWindow = nullptr;
     SDL_GLContext glContext = nullptr;
@@ -115,7 +214,6 @@ private:
     uint32_t ModelMatrixID = 0;
 
     uint32_t TextureID = 0;
-    uint32_t HasNormalMapID = 0;
     uint32_t TextureIDNormal = 0;
 
     uint32_t CameraID = 0;
@@ -124,13 +222,34 @@ private:
     uint32_t BackBufferTextureID = 0;
 
     std::shared_ptr<GeometryGL> m_spGeometry;
+    std::shared_ptr<TextureStreamGL> m_spTextureStream;
     Camera* m_pCurrentCamera = nullptr;
 
+    // Mesh parts are sorted before they are drawn; the queue indexes the parts
+    RenderQueue m_renderQueue;
+    std::vector<GLMeshPart*> m_queueParts;
+
+    // Each run of parts with the same texture arrays is one multi-draw, from commands streamed to this buffer.
+    // Without multi-draw indirect, the parts of a run are drawn one by one with a base vertex
+    bool m_multiDrawIndirect = false;
+    std::shared_ptr<BufferGL> m_spIndirectBuffer;
+
     glm::vec4 m_clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
     float m_clearDepth = 0.0f;
     uint32_t m_clearFlags = ClearType::Depth | ClearType::Color;
     bool m_inFrame = false;
     uint32_t m_deviceFlags = DeviceFlags::SyncToRefresh;
+
+    // Captures are read back asynchronously, round a ring of pixel buffers
+    static const uint32_t NumCaptureBuffers = 3;
+    CaptureGL m_captureRing[NumCaptureBuffers];
+    uint32_t m_nextCapture = 0;
+    std::deque<FrameCapture> m_finishedCaptures;
+
+    PFNGLBUFFERSTORAGEPROC_MGFX m_glBufferStorage = nullptr;
+    StreamStatsGL m_streamStats;
+    bool m_captureRequested = false;
+    uint64_t m_frameCount = 0;
 };
 
 inline void CheckGL(const char* call, const char* file, int line)
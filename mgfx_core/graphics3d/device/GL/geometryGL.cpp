@@ -20,15 +20,56 @@ GeometryGL::GeometryGL(DeviceGL* pDevice)
     glActiveTexture(GL_TEXTURE0);
     m_samplerID = glGetUniformLocation(m_programID, "albedo_sampler");
     m_projectionID = glGetUniformLocation(m_programID, "Projection");
+    m_modeID = glGetUniformLocation(m_programID, "texture_mode");
     glUniform1i(m_samplerID, 0);
+    glUniform1i(glGetUniformLocation(m_programID, "palette_sampler"), 1);
     glUseProgram(0);
 
+    // Text uses the same vertices, with a distance field pixel shader
+    m_textProgramID = LoadShaders(MediaManager::Instance().FindAsset("Quad.vertexshader", MediaType::Shader).c_str(), MediaManager::Instance().FindAsset("Text.fragmentshader", MediaType::Shader).c_str());
+    glUseProgram(m_textProgramID);
+    m_textProjectionID = glGetUniformLocation(m_textProgramID, "Projection");
+    glUniform1i(glGetUniformLocation(m_textProgramID, "albedo_sampler"), 0);
+    glUseProgram(0);
+
+    // Sprites use the same pixel shader, but build their quads from the instance data
+    m_spriteProgramID = LoadShaders(MediaManager::Instance().FindAsset("Sprite.vertexshader", MediaType::Shader).c_str(), MediaManager::Instance().FindAsset("Quad.fragmentshader", MediaType::Shader).c_str());
+    glUseProgram(m_spriteProgramID);
+    m_spriteProjectionID = glGetUniformLocation(m_spriteProgramID, "Projection");
+    m_spriteModeID = glGetUniformLocation(m_spriteProgramID, "texture_mode");
+    glUniform1i(glGetUniformLocation(m_spriteProgramID, "albedo_sampler"), 0);
+    glUniform1i(glGetUniformLocation(m_spriteProgramID, "palette_sampler"), 1);
+    glUseProgram(0);
+
+    CHECK_GL(glGenBuffers(1, &m_spriteBufferID));
+    CHECK_GL(glGenVertexArrays(1, &m_spriteVertexArrayID));
+    CHECK_GL(glBindVertexArray(m_spriteVertexArrayID));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, m_spriteBufferID));
+
+    // One record per instance
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK_GL(glEnableVertexAttribArray(i));
+        CHECK_GL(glVertexAttribDivisor(i, 1));
+    }
+    CHECK_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, pos)));
+    CHECK_GL(glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, angle)));
+    CHECK_GL(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, halfSize)));
+    CHECK_GL(glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, texRect)));
+    CHECK_GL(glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), (void*)offsetof(SpriteInstance, color)));
+    CHECK_GL(glBindVertexArray(0));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
 GeometryGL::~GeometryGL()
 {
     glDeleteVertexArrays(1, &VertexArrayID);
     glDeleteProgram(m_programID);
+    glDeleteProgram(m_textProgramID);
+
+    glDeleteVertexArrays(1, &m_spriteVertexArrayID);
+    glDeleteBuffers(1, &m_spriteBufferID);
+    glDeleteProgram(m_spriteProgramID);
 }
 
 void GeometryGL::EndGeometry()
@@ -39,14 +80,15 @@ void GeometryGL::EndGeometry()
     CHECK_GL(glEnable(GL_DEPTH_TEST));
 }
 
-void GeometryGL::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB)
+// Shared state for quads and sprites
+void GeometryGL::BeginState(uint32_t id, uint32_t programID, uint32_t projectionID, int32_t modeID)
 {
     CHECK_GL(glCullFace(GL_BACK));
     CHECK_GL(glDisable(GL_CULL_FACE));
     CHECK_GL(glEnable(GL_DEPTH_TEST));
     CHECK_GL(glEnable(GL_BLEND));
 
-    CHECK_GL(glUseProgram(m_programID));
+    CHECK_GL(glUseProgram(programID));
 
     auto pCamera = m_pDevice->GetCamera();
     if (pCamera)
@@ -58,18 +100,61 @@ void GeometryGL::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* p
 
         // Send our transformation to the currently bound shader, 
         // in the "MVP" uniform
-        CHECK_GL(glUniformMatrix4fv(m_projectionID, 1, GL_FALSE, &MVP[0][0]));
+        CHECK_GL(glUniformMatrix4fv(projectionID, 1, GL_FALSE, &MVP[0][0]));
+    }
+
+    // How the shader reads the texture; matches the modes in Quad.fragmentshader
+    if (modeID != -1)
+    {
+        int mode = 0;
+        auto pTextureData = m_pDevice->GetTextureData(id);
+        if (pTextureData)
+        {
+            if (pTextureData->Format == TextureFormat::R8 && pTextureData->PaletteID != 0)
+            {
+                mode = 1;
+                CHECK_GL(glActiveTexture(GL_TEXTURE1));
+                CHECK_GL(glBindTexture(GL_TEXTURE_2D, pTextureData->PaletteID));
+            }
+            else if (pTextureData->Format == TextureFormat::RGBA16F || pTextureData->Format == TextureFormat::RGBA32F)
+            {
+                mode = 2;
+            }
+        }
+        CHECK_GL(glUniform1i(modeID, mode));
     }
 
     CHECK_GL(glActiveTexture(GL_TEXTURE0));
 
     CHECK_GL(glBindTexture(GL_TEXTURE_2D, id));
+}
+
+void GeometryGL::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
+{
+    if (flags & GeometryFlags::DistanceField)
+    {
+        BeginState(id, m_textProgramID, m_textProjectionID);
+    }
+    else
+    {
+        BeginState(id, m_programID, m_projectionID, m_modeID);
+    }
 
     // Vertices
+    m_pVB = static_cast<BufferGL*>(pVB);
+    m_pIB = static_cast<BufferGL*>(pIB);
+    BindBuffers();
+}
+
+// Points the VAO at the current buffer names; called again if a persistent buffer was reallocated by a Map
+void GeometryGL::BindBuffers()
+{
     CHECK_GL(glBindVertexArray(VertexArrayID));
 
-    pVB->Bind();
-    pIB->Bind();
+    m_pVB->Bind();
+    m_pIB->Bind();
+    m_boundVB = m_pVB->GetBufferID();
+    m_boundIB = m_pIB->GetBufferID();
 
     CHECK_GL(glEnableVertexAttribArray(0));
     CHECK_GL(glEnableVertexAttribArray(1));
@@ -87,7 +172,39 @@ void GeometryGL::DrawTriangles(
     uint32_t numVertices,
     uint32_t numIndices)
 {
+    if (m_pVB->GetBufferID() != m_boundVB || m_pIB->GetBufferID() != m_boundIB)
+    {
+        BindBuffers();
+    }
     CHECK_GL(glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (void*)(IBOffset * sizeof(uint32_t)), VBOffset));
 }
 
+void GeometryGL::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    if (numSprites == 0)
+    {
+        return;
+    }
+
+    BeginState(id, m_spriteProgramID, m_spriteProjectionID, m_spriteModeID);
+
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, m_spriteBufferID));
+
+    // Grow by doubling; otherwise orphan the old storage so we don't wait on the previous draw
+    uint32_t byteSize = numSprites * sizeof(SpriteInstance);
+    if (byteSize > m_spriteBufferSize)
+    {
+        m_spriteBufferSize = std::max(byteSize, m_spriteBufferSize * 2);
+    }
+    CHECK_GL(glBufferData(GL_ARRAY_BUFFER, m_spriteBufferSize, nullptr, GL_STREAM_DRAW));
+    CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, byteSize, pSprites));
+
+    // 4 corners as a strip, built from the vertex ID
+    CHECK_GL(glBindVertexArray(m_spriteVertexArrayID));
+    CHECK_GL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numSprites));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    EndGeometry();
+}
+
 } // namespace Mgfx
@@ -12,21 +12,43 @@ public:
     ~GeometryGL();
 
     virtual void EndGeometry() override;
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
     virtual void DrawTriangles(
         uint32_t VBOffset,
         uint32_t IBOffset,
         uint32_t numVertices,
         uint32_t numIndices) override;
 
+private:
+    void BeginState(uint32_t id, uint32_t programID, uint32_t projectionID, int32_t modeID = -1);
+    void BindBuffers();
+
 private:
     DeviceGL* m_pDevice = nullptr;
     uint32_t VertexArrayID = 0;
     uint32_t m_programID = 0;
     uint32_t m_samplerID = 0;
     uint32_t m_projectionID = 0;
+    int32_t m_modeID = -1;
+    uint32_t m_textProgramID = 0;
+    uint32_t m_textProjectionID = 0;
     glm::vec4 lastTarget = glm::vec4(0.0f);
     glm::vec4 lastCoords = glm::vec4(0.0f);
+
+    // Geometry buffers, and the names bound to the VAO; growing a persistent buffer changes its name
+    BufferGL* m_pVB = nullptr;
+    BufferGL* m_pIB = nullptr;
+    uint32_t m_boundVB = 0;
+    uint32_t m_boundIB = 0;
+
+    // Instanced sprites
+    uint32_t m_spriteVertexArrayID = 0;
+    uint32_t m_spriteProgramID = 0;
+    uint32_t m_spriteProjectionID = 0;
+    int32_t m_spriteModeID = -1;
+    uint32_t m_spriteBufferID = 0;
+    uint32_t m_spriteBufferSize = 0;
 };
 
 } // namespace Mgfx
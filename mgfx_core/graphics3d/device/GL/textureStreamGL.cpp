@@ -0,0 +1,399 @@
+#include "mgfx_core.h"
+#include "deviceGL.h"
+#include "textureStreamGL.h"
+#include "animation/timer.h"
+#include "threadpool/ThreadPool.hpp"
+#include "gli/gli.hpp"
+#include "graphics/blockdecode.h"
+
+#include <stb/stb_image.h>
+
+namespace Mgfx
+{
+
+const uint32_t TextureStreamGL::UploadBudgetBytes;
+const uint32_t TextureStreamGL::MaxDecodes;
+const float TextureStreamGL::UploadBudgetMs = 2.0f;
+
+// A mesh texture. The first read finds the size and format, to place it in an array.
+// DDS textures come with their mips and are mostly compressed, so they keep their data from the first read; others
+// are decoded once their array is made, a few at a time, so that only a few images are held in memory
+struct StreamTextureGL
+{
+    fs::path path;
+    gli::texture dds;
+    GLint internalFormat = GL_RGBA8;
+    GLenum externalFormat = GL_RGBA;    // For uncompressed DDS, which are RGBA8 or BGRA8
+    GLenum type = GL_UNSIGNED_BYTE;
+    bool compressed = false;
+    gli::gl::swizzles swizzles = gli::gl::swizzles(GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA);
+    glm::uvec2 size = glm::uvec2(0);
+    uint32_t levels = 0;                // 0 if the mips are generated
+    std::vector<uint8_t> pixels;        // RGBA, once decoded
+
+    std::future<bool> read;
+    std::future<bool> decode;
+    bool uploaded = false;
+
+    bool SameArray(const StreamTextureGL& rhs) const
+    {
+        return internalFormat == rhs.internalFormat && externalFormat == rhs.externalFormat && swizzles == rhs.swizzles && size == rhs.size && levels == rhs.levels;
+    }
+};
+
+struct StreamMeshGL
+{
+    GLMesh* pDeviceMesh = nullptr;
+    std::vector<std::shared_ptr<StreamTextureGL>> textures;
+    std::vector<uint32_t> layersLeft;       // For each array; it is resident when they are all in
+    bool arraysMade = false;
+    uint64_t bytes = 0;
+    uint32_t frames = 0;
+};
+
+namespace
+{
+
+// On a loader thread
+bool ReadTexture(StreamTextureGL& tex)
+{
+    if (!fs::exists(tex.path))
+    {
+        return false;
+    }
+
+    if (tex.path.extension().string() == ".dds")
+    {
+        tex.dds = gli::load(tex.path.string());
+        auto format = tex.dds.format();
+        bool rgtc = format == gli::FORMAT_R_ATI1N_UNORM_BLOCK8 || format == gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+        bool rgba8 = format == gli::FORMAT_RGBA8_UNORM_PACK8 || format == gli::FORMAT_RGBA8_SRGB_PACK8 ||
+            format == gli::FORMAT_BGRA8_UNORM_PACK8 || format == gli::FORMAT_BGRA8_SRGB_PACK8;
+        if (tex.dds.empty() || !(gli::is_s3tc_compressed(format) || rgtc || rgba8) || tex.dds.target() != gli::TARGET_2D)
+        {
+            tex.dds = gli::texture();
+            return false;
+        }
+
+        // gli only flips S3TC; the BC4/BC5 maps from the asset builder are flipped here
+        if (rgtc)
+        {
+            auto blockFormat = format == gli::FORMAT_R_ATI1N_UNORM_BLOCK8 ? MCommon::BlockFormat::BC4 : MCommon::BlockFormat::BC5;
+            for (size_t level = 0; level < tex.dds.levels(); level++)
+            {
+                auto extent = tex.dds.extent(level);
+                MCommon::FlipBlocks(blockFormat, (uint8_t*)tex.dds.data(0, 0, level), extent.x, extent.y);
+            }
+        }
+        else
+        {
+            tex.dds = gli::flip(tex.dds);
+        }
+
+        gli::gl GL(gli::gl::PROFILE_GL33);
+        gli::gl::format const Format = GL.translate(tex.dds.format(), tex.dds.swizzles());
+        tex.internalFormat = Format.Internal;
+        tex.externalFormat = Format.External;
+        tex.type = Format.Type;
+        tex.compressed = gli::is_compressed(format);
+        tex.swizzles = Format.Swizzles;
+        tex.size = glm::uvec2(tex.dds.extent().x, tex.dds.extent().y);
+        tex.levels = uint32_t(tex.dds.levels());
+        return true;
+    }
+
+    int w, h, comp;
+    if (!stbi_info(tex.path.string().c_str(), &w, &h, &comp))
+    {
+        return false;
+    }
+    tex.size = glm::uvec2(w, h);
+    return true;
+}
+
+// On a loader thread; expanded to RGBA, so 3 and 4 component images can share arrays
+bool DecodeTexture(StreamTextureGL& tex)
+{
+    int w, h, comp;
+    unsigned char* image = stbi_load(tex.path.string().c_str(), &w, &h, &comp, STBI_rgb_alpha);
+    if (image == nullptr)
+    {
+        return false;
+    }
+
+    bool matches = glm::uvec2(w, h) == tex.size;
+    if (matches)
+    {
+        tex.pixels.assign(image, image + w * h * 4);
+    }
+    stbi_image_free(image);
+    return matches;
+}
+
+}
+
+TextureStreamGL::TextureStreamGL(DeviceGL* pDevice)
+    : m_pDevice(pDevice)
+{
+    const glm::u8vec4 grey(128, 128, 128, 255);
+    CHECK_GL(glGenTextures(1, &m_placeholderID));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, m_placeholderID));
+    CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    CHECK_GL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &grey));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
+
+// Reads still in flight hold on to their textures, so they can finish after the stream is gone
+TextureStreamGL::~TextureStreamGL()
+{
+    glDeleteTextures(1, &m_placeholderID);
+}
+
+void TextureStreamGL::Add(GLMesh* pDeviceMesh, const std::vector<fs::path>& paths)
+{
+    pDeviceMesh->textureSlots.assign(paths.size(), glm::ivec2(-1));
+    if (paths.empty())
+    {
+        return;
+    }
+
+    auto spMesh = std::make_shared<StreamMeshGL>();
+    spMesh->pDeviceMesh = pDeviceMesh;
+    for (auto& path : paths)
+    {
+        auto spTex = std::make_shared<StreamTextureGL>();
+        spTex->path = path;
+        spTex->read = GetLoaderPool().enqueue([spTex]() { return ReadTexture(*spTex); });
+        spMesh->textures.push_back(spTex);
+    }
+    m_meshes.push_back(spMesh);
+}
+
+void TextureStreamGL::Remove(GLMesh* pDeviceMesh)
+{
+    m_meshes.erase(std::remove_if(m_meshes.begin(), m_meshes.end(), [pDeviceMesh](const std::shared_ptr<StreamMeshGL>& spMesh)
+    {
+        return spMesh->pDeviceMesh == pDeviceMesh;
+    }), m_meshes.end());
+}
+
+// Once all the files of a mesh are read, group them into arrays by size and format, and make the storage for
+// every level of every layer
+void TextureStreamGL::MakeArrays(StreamMeshGL& mesh)
+{
+    auto pDeviceMesh = mesh.pDeviceMesh;
+
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    std::vector<uint32_t> arrayFirst;       // The first texture in each array, to compare formats against
+    for (uint32_t i = 0; i < uint32_t(mesh.textures.size()); i++)
+    {
+        auto& tex = *mesh.textures[i];
+        if (!tex.read.get())
+        {
+            LOG(WARNING) << "Couldn't read texture: " << tex.path.string();
+            continue;
+        }
+
+        uint32_t arrayIndex = 0;
+        for (; arrayIndex < arrayFirst.size(); arrayIndex++)
+        {
+            if (mesh.textures[arrayFirst[arrayIndex]]->SameArray(tex) &&
+                pDeviceMesh->textureArrays[arrayIndex].numLayers < uint32_t(maxLayers))
+            {
+                break;
+            }
+        }
+
+        if (arrayIndex == arrayFirst.size())
+        {
+            arrayFirst.push_back(i);
+            pDeviceMesh->textureArrays.push_back(GLTextureArray());
+        }
+        pDeviceMesh->textureSlots[i] = glm::ivec2(arrayIndex, pDeviceMesh->textureArrays[arrayIndex].numLayers++);
+    }
+
+    for (uint32_t arrayIndex = 0; arrayIndex < arrayFirst.size(); arrayIndex++)
+    {
+        auto& texArray = pDeviceMesh->textureArrays[arrayIndex];
+        auto& first = *mesh.textures[arrayFirst[arrayIndex]];
+        mesh.layersLeft.push_back(texArray.numLayers);
+
+        CHECK_GL(glGenTextures(1, &texArray.textureID));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, texArray.textureID));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, first.levels == 1 ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, &first.swizzles[0]));
+
+        if (first.levels == 0)
+        {
+            CHECK_GL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, first.size.x, first.size.y, texArray.numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        }
+        else
+        {
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0));
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, GLint(first.levels - 1)));
+            for (uint32_t level = 0; level < first.levels; level++)
+            {
+                auto extent = first.dds.extent(level);
+                if (first.compressed)
+                {
+                    CHECK_GL(glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, extent.x, extent.y, texArray.numLayers, 0,
+                        GLsizei(first.dds.size(level) * texArray.numLayers), nullptr));
+                }
+                else
+                {
+                    CHECK_GL(glTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.internalFormat, extent.x, extent.y, texArray.numLayers, 0,
+                        first.externalFormat, first.type, nullptr));
+                }
+            }
+        }
+    }
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+    mesh.arraysMade = true;
+}
+
+const std::vector<GLMesh*>& TextureStreamGL::Update()
+{
+    m_resident.clear();
+    if (m_meshes.empty())
+    {
+        return m_resident;
+    }
+
+    // At least one upload each frame, however big it is, so that everything gets there
+    Timer timer;
+    uint64_t bytes = 0;
+    bool uploaded = false;
+    auto budgetLeft = [&]()
+    {
+        return !uploaded || (bytes < UploadBudgetBytes && timer.GetDelta() * 1000.0f < UploadBudgetMs);
+    };
+
+    CHECK_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    for (auto itr = m_meshes.begin(); itr != m_meshes.end();)
+    {
+        auto& mesh = **itr;
+        auto pDeviceMesh = mesh.pDeviceMesh;
+        auto startBytes = bytes;
+        mesh.frames++;
+
+        if (!mesh.arraysMade)
+        {
+            bool read = std::all_of(mesh.textures.begin(), mesh.textures.end(), [](const std::shared_ptr<StreamTextureGL>& spTex)
+            {
+                return is_future_ready(spTex->read);
+            });
+
+            if (!read)
+            {
+                itr++;
+                continue;
+            }
+            MakeArrays(mesh);
+        }
+
+        // Keep a few images decoding ahead of the uploads
+        uint32_t decoding = uint32_t(std::count_if(mesh.textures.begin(), mesh.textures.end(), [](const std::shared_ptr<StreamTextureGL>& spTex)
+        {
+            return spTex->decode.valid();
+        }));
+        for (uint32_t i = 0; i < uint32_t(mesh.textures.size()) && decoding < MaxDecodes; i++)
+        {
+            auto spTex = mesh.textures[i];
+            if (pDeviceMesh->textureSlots[i].x >= 0 && spTex->levels == 0 && !spTex->uploaded && !spTex->decode.valid())
+            {
+                spTex->decode = GetLoaderPool().enqueue([spTex]() { return DecodeTexture(*spTex); });
+                decoding++;
+            }
+        }
+
+        for (uint32_t i = 0; i < uint32_t(mesh.textures.size()) && budgetLeft(); i++)
+        {
+            auto& tex = *mesh.textures[i];
+            auto slot = pDeviceMesh->textureSlots[i];
+            if (tex.uploaded || slot.x < 0)
+            {
+                continue;
+            }
+
+            auto& texArray = pDeviceMesh->textureArrays[slot.x];
+            if (tex.levels == 0)
+            {
+                if (!tex.decode.valid() || !is_future_ready(tex.decode))
+                {
+                    continue;
+                }
+
+                // A failed decode leaves the layer undefined; it was readable a moment ago, so this is rare
+                CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, texArray.textureID));
+                if (tex.decode.get())
+                {
+                    CHECK_GL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot.y, tex.size.x, tex.size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, tex.pixels.data()));
+                    bytes += tex.pixels.size();
+                }
+                else
+                {
+                    LOG(WARNING) << "Couldn't decode texture: " << tex.path.string();
+                }
+                tex.pixels = std::vector<uint8_t>();
+            }
+            else
+            {
+                CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, texArray.textureID));
+                for (uint32_t level = 0; level < tex.levels; level++)
+                {
+                    auto extent = tex.dds.extent(level);
+                    if (tex.compressed)
+                    {
+                        CHECK_GL(glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, slot.y, extent.x, extent.y, 1,
+                            tex.internalFormat, GLsizei(tex.dds.size(level)), tex.dds.data(0, 0, level)));
+                    }
+                    else
+                    {
+                        CHECK_GL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, slot.y, extent.x, extent.y, 1,
+                            tex.externalFormat, tex.type, tex.dds.data(0, 0, level)));
+                    }
+                    bytes += tex.dds.size(level);
+                }
+                tex.dds = gli::texture();
+            }
+            tex.uploaded = true;
+            uploaded = true;
+
+            if (--mesh.layersLeft[slot.x] == 0)
+            {
+                if (tex.levels == 0)
+                {
+                    CHECK_GL(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+                }
+                texArray.resident = true;
+                if (m_resident.empty() || m_resident.back() != pDeviceMesh)
+                {
+                    m_resident.push_back(pDeviceMesh);
+                }
+            }
+        }
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+        mesh.bytes += bytes - startBytes;
+        if (std::all_of(mesh.layersLeft.begin(), mesh.layersLeft.end(), [](uint32_t left) { return left == 0; }))
+        {
+            LOG(INFO) << std::dec << "Mesh textures resident: " << mesh.textures.size() << " textures, "
+                << (mesh.bytes / (1024 * 1024)) << "MB, over " << mesh.frames << " frames";
+            itr = m_meshes.erase(itr);
+        }
+        else
+        {
+            itr++;
+        }
+    }
+    return m_resident;
+}
+
+} // namespace Mgfx
@@ -0,0 +1,45 @@
+#pragma once
+
+namespace Mgfx
+{
+
+class DeviceGL;
+struct GLMesh;
+struct StreamMeshGL;
+
+// Loads the textures of meshes into their texture arrays in the background.
+// Files are read and decoded on the loader threads; the render thread only makes the arrays and copies
+// in the layers, up to a budget of time and bytes each frame. Until all the layers of an array are in,
+// the device draws its parts with a placeholder.
+class TextureStreamGL
+{
+public:
+    TextureStreamGL(DeviceGL* pDevice);
+    ~TextureStreamGL();
+
+    // The slots of the mesh are filled in when the files have been read, and the arrays marked resident when loaded
+    void Add(GLMesh* pDeviceMesh, const std::vector<fs::path>& paths);
+    void Remove(GLMesh* pDeviceMesh);
+
+    // Upload what is ready, within the budget; returns the meshes with newly resident arrays
+    const std::vector<GLMesh*>& Update();
+    bool IsStreaming() const { return !m_meshes.empty(); }
+
+    // A grey, single layer array
+    uint32_t GetPlaceholderID() const { return m_placeholderID; }
+
+    static const uint32_t UploadBudgetBytes = 16 * 1024 * 1024;
+    static const uint32_t MaxDecodes = 8;       // Decoded images waiting for upload; limits the memory held
+    static const float UploadBudgetMs;
+
+private:
+    void MakeArrays(StreamMeshGL& mesh);
+
+private:
+    DeviceGL* m_pDevice = nullptr;
+    uint32_t m_placeholderID = 0;
+    std::vector<std::shared_ptr<StreamMeshGL>> m_meshes;
+    std::vector<GLMesh*> m_resident;
+};
+
+} // namespace Mgfx
@@ -30,12 +30,49 @@ struct DeviceFlags
     };
 };
 
+// How geometry is shaded
+struct GeometryFlags
+{
+    enum
+    {
+        DistanceField = (1 << 0)   // The texture alpha is a signed distance field, edge at 0.5; for text
+    };
+};
+
+// The layout of the texture data the caller writes.
+// R8 textures with a palette are drawn through it; float textures hold linear color, and are clamped when drawn
+enum class TextureFormat : uint8_t
+{
+    RGBA8,
+    R8,
+    RG8,
+    RGBA16F,    // Half floats
+    RGBA32F
+};
+
+inline uint32_t TextureFormatSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::R8: return 1;
+    case TextureFormat::RG8: return 2;
+    case TextureFormat::RGBA16F: return 8;
+    case TextureFormat::RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
 struct TextureData
 {
     uint8_t* pData = nullptr;
     uint32_t pitch = 0;
+    TextureFormat format = TextureFormat::RGBA8;
 
     glm::u8vec4* LinePtr(uint32_t y, uint32_t x = 0) const { return (glm::u8vec4*)(pData + pitch * y + (x * sizeof(glm::u8vec4))); }
+
+    // For the other formats
+    template<typename T>
+    T* RowPtr(uint32_t y, uint32_t x = 0) const { return (T*)(pData + pitch * y) + x; }
 };
 
 struct GeometryVertex
@@ -56,13 +93,44 @@ struct GeometryVertex
     glm::vec3 normal;
 };
 
+// A single sprite; expanded into a quad by the vertex shader
+struct SpriteInstance
+{
+    SpriteInstance() {}
+    SpriteInstance(const glm::vec3& _pos,
+        float _angle,
+        const glm::vec2& _halfSize,
+        const glm::vec4& _texRect,
+        const glm::u8vec4& _color = glm::u8vec4(255))
+        : pos(_pos),
+        angle(_angle),
+        halfSize(_halfSize),
+        texRect(_texRect),
+        color(_color)
+    { }
+    glm::vec3 pos;          // Center of the sprite
+    float angle;            // Rotation in degrees
+    glm::vec2 halfSize;     // Half the width and height, scale included
+    glm::vec4 texRect;      // Texture coordinates of the top left and bottom right
+    glm::u8vec4 color;
+};
+
+// A frame read back from the device, as it would be displayed: RGBA with the top row first, and opaque
+struct FrameCapture
+{
+    glm::uvec2 size = glm::uvec2(0);
+    uint64_t frame = 0;                 // Counts Swap calls
+    std::vector<glm::u8vec4> pixels;
+};
+
 struct DeviceBufferFlags
 {
     enum
     {
         IndexBuffer = (1 << 0),
         VertexBuffer = (1 << 1),
-        UseUploadBuffer = (1 << 2)
+        UseUploadBuffer = (1 << 2),
+        IndirectBuffer = (1 << 3)       // Draw commands; GL only
     };
 };
 
@@ -94,8 +162,11 @@ struct IGeometry
         uint32_t numVertices,
         uint32_t numIndices) = 0;
 
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) = 0;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) = 0;
     virtual void EndGeometry() = 0;
+
+    // Draw instanced sprites with the texture; the instance buffer grows as required
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) = 0;
 };
 
 // An abstracted device, called to do the final rendering of the scene
@@ -121,14 +192,21 @@ struct IDevice
     // Textures
     virtual uint32_t CreateTexture() = 0;
     virtual void DestroyTexture(uint32_t id) = 0;
-    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size) = 0;
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format = TextureFormat::RGBA8) = 0;
     virtual void UpdateTexture(uint32_t id) = 0;
 
+    // Upload just a rectangle of the texture data; the rest of the texture keeps its contents.
+    // Devices which can't do better upload all of it
+    virtual void UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size) { UpdateTexture(id); }
+
+    // Colors for the values of an R8 texture; up to 256
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) = 0;
+
     // Buffers
     virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) = 0;
 
     // Geometry
-    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB) = 0;
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) = 0;
     virtual void EndGeometry() = 0;
     virtual void DrawTriangles(
         uint32_t VBOffset,
@@ -136,6 +214,9 @@ struct IDevice
         uint32_t numVertices,
         uint32_t numIndices) = 0;
 
+    // Sprites
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) = 0;
+
     // For displaying the overlay GUI 
     virtual void BeginGUI() = 0;
     virtual void EndGUI() = 0;
@@ -152,9 +233,17 @@ struct IDevice
     // Copy the back buffer to the screen window
     virtual void Swap() = 0;
 
+    // Read back the frame when it is next swapped.
+    // The GPU may finish it a few frames later; GetCapture returns finished frames in order, and can wait for the oldest
+    virtual void RequestCapture() = 0;
+    virtual bool GetCapture(FrameCapture& capture, bool wait = false) = 0;
+
     // Draw a mesh
     virtual void DrawMesh(Mesh* pMesh, GeometryType type) = 0;
 
+    // True while mesh textures are still loading in the background, and being drawn with placeholders
+    virtual bool IsStreaming() const { return false; }
+
     // Get the window associated with the device
     virtual SDL_Window* GetSDLWindow() const = 0;
 
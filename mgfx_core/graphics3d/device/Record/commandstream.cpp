@@ -0,0 +1,85 @@
+#include "mgfx_core.h"
+#include "commandstream.h"
+
+namespace Mgfx
+{
+
+const uint32_t CommandWriter::Magic;
+const uint32_t CommandWriter::Version;
+
+CommandWriter::CommandWriter()
+{
+    Write(Magic);
+    Write(Version);
+}
+
+CommandWriter::~CommandWriter()
+{
+    Flush();
+}
+
+bool CommandWriter::Open(const fs::path& path)
+{
+    m_file.open(path.string(), std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        LOG(ERROR) << "Couldn't open command stream: " << path.string();
+        return false;
+    }
+    Flush();
+    return true;
+}
+
+void CommandWriter::Close()
+{
+    Flush();
+    m_file.close();
+}
+
+void CommandWriter::WriteBytes(const void* pData, size_t size)
+{
+    auto pBytes = (const uint8_t*)pData;
+    m_data.insert(m_data.end(), pBytes, pBytes + size);
+}
+
+void CommandWriter::WriteString(const std::string& str)
+{
+    Write(uint32_t(str.size()));
+    WriteBytes(str.data(), str.size());
+}
+
+void CommandWriter::Flush()
+{
+    if (m_file.is_open() && !m_data.empty())
+    {
+        m_file.write((const char*)m_data.data(), m_data.size());
+        m_data.clear();
+    }
+}
+
+CommandReader::CommandReader(const uint8_t* pData, size_t size)
+    : m_pData(pData),
+    m_size(size)
+{
+}
+
+const uint8_t* CommandReader::ReadBytes(size_t size)
+{
+    if (m_failed || size > m_size - m_pos)
+    {
+        m_failed = true;
+        return nullptr;
+    }
+    auto pBytes = m_pData + m_pos;
+    m_pos += size;
+    return pBytes;
+}
+
+std::string CommandReader::ReadString()
+{
+    auto size = Read<uint32_t>();
+    auto pBytes = ReadBytes(size);
+    return pBytes ? std::string((const char*)pBytes, size) : std::string();
+}
+
+} // namespace Mgfx
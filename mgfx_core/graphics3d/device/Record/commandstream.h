@@ -0,0 +1,106 @@
+#pragma once
+
+namespace Mgfx
+{
+
+// A binary stream of device calls, written by DeviceRecord and played back by DeviceReplay.
+// Each command is a byte, followed by its arguments as they are laid out in memory, so a stream
+// is only read back by the same build on the same platform
+enum class DeviceCommand : uint8_t
+{
+    BeginFrame,
+    SetDeviceFlags,
+    SetClear,
+    SetCamera,          // Camera ID, then its state if the ID isn't 0
+    LoadMesh,           // Mesh ID and path, the first time a mesh is drawn
+    DrawMesh,
+    CreateTexture,
+    DestroyTexture,
+    ResizeTexture,      // Texture ID, size and format
+    UpdateTexture,      // Texture ID, size, and the texels
+    CreateBuffer,
+    DestroyBuffer,
+    EnsureSize,
+    MapBuffer,          // Buffer ID, element count and size, offset, and the data written while it was mapped
+    UploadBuffer,
+    BeginGeometry,
+    EndGeometry,
+    DrawTriangles,
+    DrawSprites,
+    BeginGUI,
+    EndGUI,
+    Flush,
+    Swap,
+    SetTexturePalette,  // Texture ID, color count, and the colors
+    Count
+};
+
+class CommandWriter
+{
+public:
+    static const uint32_t Magic = 0x5343474D; // 'MGCS'
+    static const uint32_t Version = 2;
+
+    CommandWriter();
+    ~CommandWriter();
+
+    // Without a file, the commands are kept in memory
+    bool Open(const fs::path& path);
+    void Close();
+
+    void Command(DeviceCommand command) { Write(uint8_t(command)); }
+
+    template<class T>
+    void Write(const T& value)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+    void WriteBytes(const void* pData, size_t size);
+    void WriteString(const std::string& str);
+
+    // Writes buffered commands to the file
+    void Flush();
+
+    const std::vector<uint8_t>& GetData() const { return m_data; }
+
+private:
+    std::ofstream m_file;
+    std::vector<uint8_t> m_data;
+};
+
+class CommandReader
+{
+public:
+    CommandReader(const uint8_t* pData, size_t size);
+
+    template<class T>
+    T Read()
+    {
+        T value;
+        auto pBytes = ReadBytes(sizeof(T));
+        if (pBytes)
+        {
+            memcpy(&value, pBytes, sizeof(T));
+        }
+        else
+        {
+            memset(&value, 0, sizeof(T));
+        }
+        return value;
+    }
+
+    // Returns nullptr if there isn't enough data left
+    const uint8_t* ReadBytes(size_t size);
+    std::string ReadString();
+
+    bool AtEnd() const { return m_pos == m_size; }
+    bool Failed() const { return m_failed; }
+
+private:
+    const uint8_t* m_pData;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_failed = false;
+};
+
+} // namespace Mgfx
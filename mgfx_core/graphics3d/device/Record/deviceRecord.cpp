@@ -0,0 +1,305 @@
+#include "mgfx_core.h"
+#include "deviceRecord.h"
+#include "camera/camera.h"
+#include "geometry/mesh.h"
+
+namespace Mgfx
+{
+
+BufferRecord::BufferRecord(const std::shared_ptr<IDeviceBuffer>& spBuffer, const std::shared_ptr<CommandWriter>& spWriter, uint32_t id)
+    : m_spBuffer(spBuffer),
+    m_spWriter(spWriter),
+    m_id(id)
+{
+}
+
+BufferRecord::~BufferRecord()
+{
+    m_spWriter->Command(DeviceCommand::DestroyBuffer);
+    m_spWriter->Write(m_id);
+}
+
+void* BufferRecord::Map(uint32_t num, uint32_t typeSize, uint32_t& offset)
+{
+    m_pMapped = m_spBuffer->Map(num, typeSize, offset);
+    m_mapNum = num;
+    m_mapTypeSize = typeSize;
+    m_mapOffset = offset;
+    return m_pMapped;
+}
+
+void BufferRecord::UnMap()
+{
+    if (m_pMapped)
+    {
+        m_spWriter->Command(DeviceCommand::MapBuffer);
+        m_spWriter->Write(m_id);
+        m_spWriter->Write(m_mapNum);
+        m_spWriter->Write(m_mapTypeSize);
+        m_spWriter->Write(m_mapOffset);
+        m_spWriter->WriteBytes(m_pMapped, m_mapNum * m_mapTypeSize);
+        m_pMapped = nullptr;
+    }
+    m_spBuffer->UnMap();
+}
+
+void BufferRecord::EnsureSize(uint32_t size)
+{
+    m_spWriter->Command(DeviceCommand::EnsureSize);
+    m_spWriter->Write(m_id);
+    m_spWriter->Write(size);
+    m_spBuffer->EnsureSize(size);
+}
+
+void BufferRecord::Upload()
+{
+    m_spWriter->Command(DeviceCommand::UploadBuffer);
+    m_spWriter->Write(m_id);
+    m_spBuffer->Upload();
+}
+
+DeviceRecord::DeviceRecord(const std::shared_ptr<IDevice>& spDevice, const std::shared_ptr<CommandWriter>& spWriter)
+    : m_spDevice(spDevice),
+    m_spWriter(spWriter)
+{
+}
+
+DeviceRecord::~DeviceRecord()
+{
+    m_spWriter->Flush();
+}
+
+bool DeviceRecord::Init()
+{
+    return m_spDevice->Init();
+}
+
+bool DeviceRecord::BeginFrame()
+{
+    m_spWriter->Command(DeviceCommand::BeginFrame);
+    return m_spDevice->BeginFrame();
+}
+
+void DeviceRecord::SetDeviceFlags(uint32_t flags)
+{
+    m_spWriter->Command(DeviceCommand::SetDeviceFlags);
+    m_spWriter->Write(flags);
+    m_spDevice->SetDeviceFlags(flags);
+}
+
+void DeviceRecord::DrawMesh(Mesh* pMesh, GeometryType type)
+{
+    auto itr = m_mapMeshToID.find(pMesh);
+    if (itr == m_mapMeshToID.end())
+    {
+        itr = m_mapMeshToID.insert(std::make_pair(pMesh, uint32_t(m_mapMeshToID.size() + 1))).first;
+        m_spWriter->Command(DeviceCommand::LoadMesh);
+        m_spWriter->Write(itr->second);
+        m_spWriter->WriteString(pMesh->GetPath().string());
+    }
+
+    m_spWriter->Command(DeviceCommand::DrawMesh);
+    m_spWriter->Write(itr->second);
+    m_spWriter->Write(type);
+    m_spDevice->DrawMesh(pMesh, type);
+}
+
+void DeviceRecord::SetClear(const glm::vec4& clearColor, float depth, uint32_t clearFlags)
+{
+    m_spWriter->Command(DeviceCommand::SetClear);
+    m_spWriter->Write(clearColor);
+    m_spWriter->Write(depth);
+    m_spWriter->Write(clearFlags);
+    m_spDevice->SetClear(clearColor, depth, clearFlags);
+}
+
+// Cameras move between frames, so the state is written every time
+void DeviceRecord::SetCamera(Camera* pCamera)
+{
+    m_spWriter->Command(DeviceCommand::SetCamera);
+    if (pCamera == nullptr)
+    {
+        m_spWriter->Write(uint32_t(0));
+    }
+    else
+    {
+        auto itr = m_mapCameraToID.find(pCamera);
+        if (itr == m_mapCameraToID.end())
+        {
+            itr = m_mapCameraToID.insert(std::make_pair(pCamera, uint32_t(m_mapCameraToID.size() + 1))).first;
+        }
+        m_spWriter->Write(itr->second);
+        m_spWriter->Write(pCamera->GetState());
+    }
+    m_spDevice->SetCamera(pCamera);
+}
+
+Camera* DeviceRecord::GetCamera() const
+{
+    return m_spDevice->GetCamera();
+}
+
+uint32_t DeviceRecord::CreateTexture()
+{
+    auto id = m_spDevice->CreateTexture();
+    m_spWriter->Command(DeviceCommand::CreateTexture);
+    m_spWriter->Write(id);
+    return id;
+}
+
+void DeviceRecord::DestroyTexture(uint32_t id)
+{
+    m_spWriter->Command(DeviceCommand::DestroyTexture);
+    m_spWriter->Write(id);
+    m_mapTextureData.erase(id);
+    m_spDevice->DestroyTexture(id);
+}
+
+TextureData DeviceRecord::ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format)
+{
+    m_spWriter->Command(DeviceCommand::ResizeTexture);
+    m_spWriter->Write(id);
+    m_spWriter->Write(size);
+    m_spWriter->Write(format);
+
+    auto data = m_spDevice->ResizeTexture(id, size, format);
+    m_mapTextureData[id] = std::make_pair(data, size);
+    return data;
+}
+
+// The pixels are written a row at a time, without the pitch.
+// Regions are recorded as whole updates, which replay the same
+void DeviceRecord::RecordTexture(uint32_t id)
+{
+    auto itr = m_mapTextureData.find(id);
+    if (itr != m_mapTextureData.end() && itr->second.first.pData)
+    {
+        auto& data = itr->second.first;
+        auto& size = itr->second.second;
+
+        m_spWriter->Command(DeviceCommand::UpdateTexture);
+        m_spWriter->Write(id);
+        m_spWriter->Write(size);
+        for (uint32_t y = 0; y < size.y; y++)
+        {
+            m_spWriter->WriteBytes(data.RowPtr<uint8_t>(y), size.x * TextureFormatSize(data.format));
+        }
+    }
+}
+
+void DeviceRecord::UpdateTexture(uint32_t id)
+{
+    RecordTexture(id);
+    m_spDevice->UpdateTexture(id);
+}
+
+void DeviceRecord::SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors)
+{
+    m_spWriter->Command(DeviceCommand::SetTexturePalette);
+    m_spWriter->Write(id);
+    m_spWriter->Write(numColors);
+    m_spWriter->WriteBytes(pColors, numColors * sizeof(glm::u8vec4));
+    m_spDevice->SetTexturePalette(id, pColors, numColors);
+}
+
+void DeviceRecord::UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size)
+{
+    RecordTexture(id);
+    m_spDevice->UpdateTextureRegion(id, offset, size);
+}
+
+std::shared_ptr<IDeviceBuffer> DeviceRecord::CreateBuffer(uint32_t size, uint32_t flags)
+{
+    auto id = m_nextBufferID++;
+    m_spWriter->Command(DeviceCommand::CreateBuffer);
+    m_spWriter->Write(id);
+    m_spWriter->Write(size);
+    m_spWriter->Write(flags);
+    return std::make_shared<BufferRecord>(m_spDevice->CreateBuffer(size, flags), m_spWriter, id);
+}
+
+void DeviceRecord::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
+{
+    auto pRecordVB = static_cast<BufferRecord*>(pVB);
+    auto pRecordIB = static_cast<BufferRecord*>(pIB);
+    m_spWriter->Command(DeviceCommand::BeginGeometry);
+    m_spWriter->Write(id);
+    m_spWriter->Write(pRecordVB ? pRecordVB->GetID() : 0);
+    m_spWriter->Write(pRecordIB ? pRecordIB->GetID() : 0);
+    m_spWriter->Write(flags);
+    m_spDevice->BeginGeometry(id, pRecordVB ? pRecordVB->GetBuffer() : nullptr, pRecordIB ? pRecordIB->GetBuffer() : nullptr, flags);
+}
+
+void DeviceRecord::EndGeometry()
+{
+    m_spWriter->Command(DeviceCommand::EndGeometry);
+    m_spDevice->EndGeometry();
+}
+
+void DeviceRecord::DrawTriangles(uint32_t VBOffset, uint32_t IBOffset, uint32_t numVertices, uint32_t numIndices)
+{
+    m_spWriter->Command(DeviceCommand::DrawTriangles);
+    m_spWriter->Write(VBOffset);
+    m_spWriter->Write(IBOffset);
+    m_spWriter->Write(numVertices);
+    m_spWriter->Write(numIndices);
+    m_spDevice->DrawTriangles(VBOffset, IBOffset, numVertices, numIndices);
+}
+
+void DeviceRecord::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    m_spWriter->Command(DeviceCommand::DrawSprites);
+    m_spWriter->Write(id);
+    m_spWriter->Write(numSprites);
+    m_spWriter->WriteBytes(pSprites, numSprites * sizeof(SpriteInstance));
+    m_spDevice->DrawSprites(id, pSprites, numSprites);
+}
+
+void DeviceRecord::BeginGUI()
+{
+    m_spWriter->Command(DeviceCommand::BeginGUI);
+    m_spDevice->BeginGUI();
+}
+
+void DeviceRecord::EndGUI()
+{
+    m_spWriter->Command(DeviceCommand::EndGUI);
+    m_spDevice->EndGUI();
+}
+
+void DeviceRecord::Cleanup()
+{
+    m_spWriter->Flush();
+    m_spDevice->Cleanup();
+}
+
+void DeviceRecord::ProcessEvent(SDL_Event& event)
+{
+    m_spDevice->ProcessEvent(event);
+}
+
+void DeviceRecord::Flush()
+{
+    m_spWriter->Command(DeviceCommand::Flush);
+    m_spDevice->Flush();
+}
+
+// A frame is complete, so write it out
+void DeviceRecord::Swap()
+{
+    m_spWriter->Command(DeviceCommand::Swap);
+    m_spWriter->Flush();
+    m_spDevice->Swap();
+}
+
+void DeviceRecord::RequestCapture()
+{
+    m_spDevice->RequestCapture();
+}
+
+bool DeviceRecord::GetCapture(FrameCapture& capture, bool wait)
+{
+    return m_spDevice->GetCapture(capture, wait);
+}
+
+} // namespace Mgfx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "IDevice.h"
+#include "commandstream.h"
+
+namespace Mgfx
+{
+
+class Camera;
+class Mesh;
+
+// Wraps a buffer from the real device, recording what is written to it
+class BufferRecord : public IDeviceBuffer
+{
+public:
+    BufferRecord(const std::shared_ptr<IDeviceBuffer>& spBuffer, const std::shared_ptr<CommandWriter>& spWriter, uint32_t id);
+    ~BufferRecord();
+
+    virtual void* Map(uint32_t num, uint32_t typeSize, uint32_t& offset) override;
+    virtual void UnMap() override;
+    virtual void EnsureSize(uint32_t size) override;
+    virtual void Upload() override;
+    virtual uint32_t GetByteSize() const override { return m_spBuffer->GetByteSize(); }
+    virtual void Bind() const override { m_spBuffer->Bind(); }
+    virtual void UnBind() const override { m_spBuffer->UnBind(); }
+
+    IDeviceBuffer* GetBuffer() const { return m_spBuffer.get(); }
+    uint32_t GetID() const { return m_id; }
+
+private:
+    std::shared_ptr<IDeviceBuffer> m_spBuffer;
+    std::shared_ptr<CommandWriter> m_spWriter;
+    uint32_t m_id;
+
+    // The current mapping; the data is recorded on UnMap, when the caller has filled it
+    void* m_pMapped = nullptr;
+    uint32_t m_mapNum = 0;
+    uint32_t m_mapTypeSize = 0;
+    uint32_t m_mapOffset = 0;
+};
+
+// A device which passes every call on to another one, writing them to a command stream as it goes.
+// Mapped buffers and texture updates are stored with their contents, cameras with their state, and meshes by path,
+// so DeviceReplay can send the same work to any device later without the app.
+// The GUI is drawn, but its contents aren't recorded
+class DeviceRecord : public IDevice
+{
+public:
+    DeviceRecord(const std::shared_ptr<IDevice>& spDevice, const std::shared_ptr<CommandWriter>& spWriter);
+    ~DeviceRecord();
+
+    virtual bool Init() override;
+
+    virtual bool BeginFrame() override;
+    virtual void SetDeviceFlags(uint32_t flags) override;
+    virtual void DrawMesh(Mesh* pMesh, GeometryType type) override;
+
+    virtual void SetClear(const glm::vec4& clearColor, float depth, uint32_t clearFlags) override;
+    virtual void SetCamera(Camera* pCamera) override;
+    virtual Camera* GetCamera() const override;
+
+    virtual uint32_t CreateTexture() override;
+    virtual void DestroyTexture(uint32_t id) override;
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format = TextureFormat::RGBA8) override;
+    virtual void UpdateTexture(uint32_t id) override;
+    virtual void UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size) override;
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) override;
+
+    virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) override;
+
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
+    virtual void EndGeometry() override;
+    virtual void DrawTriangles(
+        uint32_t VBOffset,
+        uint32_t IBOffset,
+        uint32_t numVertices,
+        uint32_t numIndices) override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
+
+    virtual void BeginGUI() override;
+    virtual void EndGUI() override;
+    virtual void Cleanup() override;
+    virtual void ProcessEvent(SDL_Event& event) override;
+    virtual void Flush() override;
+    virtual void Swap() override;
+    virtual void RequestCapture() override;
+    virtual bool GetCapture(FrameCapture& capture, bool wait) override;
+    virtual SDL_Window* GetSDLWindow() const override { return m_spDevice->GetSDLWindow(); }
+
+    virtual const char* GetName() const override { return m_spDevice->GetName(); }
+    virtual bool IsStreaming() const override { return m_spDevice->IsStreaming(); }
+
+private:
+    void RecordTexture(uint32_t id);
+
+private:
+    std::shared_ptr<IDevice> m_spDevice;
+    std::shared_ptr<CommandWriter> m_spWriter;
+
+    std::map<Camera*, uint32_t> m_mapCameraToID;
+    std::map<Mesh*, uint32_t> m_mapMeshToID;
+    std::map<uint32_t, std::pair<TextureData, glm::uvec2>> m_mapTextureData;
+    uint32_t m_nextBufferID = 1;
+};
+
+} // namespace Mgfx
@@ -0,0 +1,199 @@
+#include "mgfx_core.h"
+#include <gtest/gtest.h>
+#include "mgfx_core/graphics3d/device/Record/deviceRecord.h"
+#include "mgfx_core/graphics3d/device/Record/deviceReplay.h"
+#include "mgfx_core/graphics3d/camera/camera.h"
+
+using namespace Mgfx;
+
+namespace
+{
+
+// Writes every call to a log, so a recording and its replay can be compared
+struct LogBuffer : public IDeviceBuffer
+{
+    LogBuffer(std::vector<std::string>& log, uint32_t start) : m_log(log), m_start(start), m_data(65536) {}
+    virtual void* Map(uint32_t num, uint32_t typeSize, uint32_t& offset) override
+    {
+        offset = m_start;
+        m_mapStart = m_start * typeSize;
+        m_mapSize = num * typeSize;
+        return &m_data[m_mapStart];
+    }
+    virtual void UnMap() override
+    {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < m_mapSize; i++)
+        {
+            sum += m_data[m_mapStart + i] * (i + 1);
+        }
+        m_log.push_back("Data " + std::to_string(sum));
+    }
+    virtual void EnsureSize(uint32_t size) override { m_log.push_back("EnsureSize " + std::to_string(size)); }
+    virtual void Upload() override {}
+    virtual uint32_t GetByteSize() const override { return uint32_t(m_data.size()); }
+    virtual void Bind() const override {}
+    virtual void UnBind() const override {}
+
+    std::vector<std::string>& m_log;
+    uint32_t m_start;
+    uint32_t m_mapStart = 0;
+    uint32_t m_mapSize = 0;
+    std::vector<uint8_t> m_data;
+};
+
+struct LogDevice : public IDevice
+{
+    // The buffers hand out different offsets, and textures different IDs, to the recorded device
+    explicit LogDevice(uint32_t start) : m_start(start), m_nextTexture(start + 1) {}
+
+    virtual bool Init() override { return true; }
+    virtual bool BeginFrame() override { Log("BeginFrame"); return true; }
+    virtual void SetDeviceFlags(uint32_t flags) override {}
+    virtual void SetClear(const glm::vec4& color, float depth, uint32_t clearFlags) override { Log("SetClear", uint32_t(color.x * 255.0f), clearFlags); }
+    virtual void SetCamera(Camera* pCamera) override
+    {
+        m_pCamera = pCamera;
+        Log("SetCamera", pCamera ? uint32_t(pCamera->GetPosition().z) : 0u);
+    }
+    virtual Camera* GetCamera() const override { return m_pCamera; }
+    virtual uint32_t CreateTexture() override { return m_nextTexture++; }
+    virtual void DestroyTexture(uint32_t id) override { Log("DestroyTexture", id - m_start); }
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format) override
+    {
+        m_texture.resize(size.x * size.y * TextureFormatSize(format));
+        TextureData data;
+        data.pData = m_texture.data();
+        data.pitch = size.x * TextureFormatSize(format);
+        data.format = format;
+        return data;
+    }
+    virtual void UpdateTexture(uint32_t id) override { Log("UpdateTexture", id - m_start, m_texture[5]); }
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) override { Log("SetTexturePalette", id - m_start, numColors, pColors[numColors - 1].g); }
+    virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) override
+    {
+        return std::make_shared<LogBuffer>(m_log, m_start);
+    }
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags) override { Log("BeginGeometry", id - m_start, flags); }
+    virtual void EndGeometry() override { Log("EndGeometry"); }
+    virtual void DrawTriangles(uint32_t VBOffset, uint32_t IBOffset, uint32_t numVertices, uint32_t numIndices) override
+    {
+        Log("DrawTriangles", VBOffset - m_start, IBOffset - m_start, numIndices);
+    }
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override
+    {
+        Log("DrawSprites", id - m_start, uint32_t(pSprites[numSprites - 1].pos.x));
+    }
+    virtual void BeginGUI() override {}
+    virtual void EndGUI() override {}
+    virtual void Cleanup() override {}
+    virtual void ProcessEvent(SDL_Event& event) override {}
+    virtual void Flush() override {}
+    virtual void Swap() override { Log("Swap"); }
+    virtual void RequestCapture() override {}
+    virtual bool GetCapture(FrameCapture& capture, bool wait) override { return false; }
+    virtual void DrawMesh(Mesh* pMesh, GeometryType type) override {}
+    virtual SDL_Window* GetSDLWindow() const override { return nullptr; }
+    virtual const char* GetName() const override { return "Log"; }
+
+    void Log(const char* name, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0)
+    {
+        m_log.push_back(std::string(name) + " " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c));
+    }
+
+    uint32_t m_start;
+    uint32_t m_nextTexture;
+    Camera* m_pCamera = nullptr;
+    std::vector<uint8_t> m_texture;
+    std::vector<std::string> m_log;
+};
+
+}
+
+TEST(DeviceRecord, ReplayMatches)
+{
+    auto spLogDevice = std::make_shared<LogDevice>(0);
+    auto spWriter = std::make_shared<CommandWriter>();
+    {
+        DeviceRecord record(spLogDevice, spWriter);
+
+        Camera camera;
+        camera.SetPositionAndFocalPoint(glm::vec3(0.0f, 0.0f, 7.0f), glm::vec3(0.0f));
+
+        auto texture = record.CreateTexture();
+        auto spVB = record.CreateBuffer(1024, DeviceBufferFlags::VertexBuffer);
+        auto spIB = record.CreateBuffer(1024, DeviceBufferFlags::IndexBuffer);
+
+        for (uint32_t frame = 0; frame < 2; frame++)
+        {
+            record.SetClear(glm::vec4(frame * 0.5f), 0.0f, ClearType::Color);
+            record.BeginFrame();
+            record.SetCamera(&camera);
+
+            auto data = record.ResizeTexture(texture, glm::uvec2(4, 4));
+            *data.LinePtr(0, 1) = glm::u8vec4(0, frame + 10, 0, 0);
+            record.UpdateTexture(texture);
+
+            // Rows of other formats are their own size
+            data = record.ResizeTexture(texture, glm::uvec2(3, 2), TextureFormat::R8);
+            *data.RowPtr<uint8_t>(1, 2) = uint8_t(frame + 30);
+            record.UpdateTexture(texture);
+
+            glm::u8vec4 palette[2] = { glm::u8vec4(0), glm::u8vec4(0, frame + 20, 0, 0) };
+            record.SetTexturePalette(texture, palette, 2);
+
+            uint32_t offset;
+            auto pVerts = (GeometryVertex*)spVB->Map(3, sizeof(GeometryVertex), offset);
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                pVerts[i] = GeometryVertex(glm::vec3(float(i + frame)), glm::vec2(0.0f));
+            }
+            spVB->UnMap();
+            auto pIndices = (uint32_t*)spIB->Map(3, sizeof(uint32_t), offset);
+            pIndices[0] = 0;
+            pIndices[1] = 1;
+            pIndices[2] = 2;
+            spIB->UnMap();
+
+            record.BeginGeometry(texture, spVB.get(), spIB.get(), 3);
+            record.DrawTriangles(offset + 1, offset + 2, 3, 3);
+            record.EndGeometry();
+
+            SpriteInstance sprite(glm::vec3(5.0f + frame, 0.0f, 0.0f), 0.0f, glm::vec2(1.0f), glm::vec4(0.0f));
+            record.DrawSprites(texture, &sprite, 1);
+            record.Swap();
+        }
+        record.DestroyTexture(texture);
+    }
+
+    std::string stream(spWriter->GetData().begin(), spWriter->GetData().end());
+    DeviceReplay replay;
+    ASSERT_TRUE(replay.SetData(stream));
+
+    LogDevice replayDevice(100);
+    ReplayStats stats;
+    ASSERT_TRUE(replay.Play(&replayDevice, 1, stats));
+    EXPECT_EQ(stats.frames, 2u);
+
+    // The replay unsets the camera at the end
+    ASSERT_EQ(replayDevice.m_log.back(), "SetCamera 0 0 0");
+    replayDevice.m_log.pop_back();
+    EXPECT_EQ(replayDevice.m_log, spLogDevice->m_log);
+}
+
+TEST(DeviceRecord, RejectsBadStreams)
+{
+    DeviceReplay replay;
+    EXPECT_FALSE(replay.SetData("Not a stream"));
+
+    CommandWriter writer;
+    writer.Command(DeviceCommand::DrawTriangles);
+    writer.Write(uint32_t(0));
+
+    std::string stream(writer.GetData().begin(), writer.GetData().end());
+    ASSERT_TRUE(replay.SetData(stream));
+
+    LogDevice device(0);
+    ReplayStats stats;
+    EXPECT_FALSE(replay.Play(&device, 1, stats));
+}
@@ -0,0 +1,364 @@
+#include "mgfx_core.h"
+#include "deviceReplay.h"
+#include "commandstream.h"
+#include "camera/camera.h"
+#include "geometry/mesh.h"
+
+namespace Mgfx
+{
+
+bool DeviceReplay::Load(const fs::path& path)
+{
+    auto data = FileUtils::ReadFile(path);
+    if (data.empty())
+    {
+        LOG(ERROR) << "Couldn't read command stream: " << path.string();
+        return false;
+    }
+    return SetData(data);
+}
+
+bool DeviceReplay::SetData(const std::string& data)
+{
+    CommandReader reader((const uint8_t*)data.data(), data.size());
+    if (reader.Read<uint32_t>() != CommandWriter::Magic ||
+        reader.Read<uint32_t>() != CommandWriter::Version)
+    {
+        LOG(ERROR) << "Not a command stream, or an old version";
+        return false;
+    }
+    m_data = data;
+    return true;
+}
+
+// Find the map which wrote this offset, latest first
+uint32_t DeviceReplay::MapOffset(const ReplayBuffer* pBuffer, uint32_t offset) const
+{
+    if (pBuffer)
+    {
+        for (auto itr = pBuffer->maps.rbegin(); itr != pBuffer->maps.rend(); ++itr)
+        {
+            if (offset >= itr->x && offset < itr->x + itr->y)
+            {
+                return offset - itr->x + itr->z;
+            }
+        }
+    }
+    return offset;
+}
+
+bool DeviceReplay::Play(IDevice* pDevice, uint32_t loops, ReplayStats& stats)
+{
+    stats = ReplayStats();
+    pDevice->SetDeviceFlags(0);
+
+    std::vector<double> frameTimes;
+    bool ok = true;
+    for (uint32_t loop = 0; loop < std::max(loops, 1u) && ok; loop++)
+    {
+        ok = PlayOnce(pDevice, frameTimes, stats.commands);
+
+        // Everything is rebuilt for the next loop, as it was in the recording
+        pDevice->Flush();
+        for (auto& id : m_mapTextureIDs)
+        {
+            pDevice->DestroyTexture(id.second);
+        }
+        m_mapTextureIDs.clear();
+        m_mapTextureData.clear();
+        m_mapBuffers.clear();
+        m_mapCameras.clear();
+        m_mapMeshes.clear();
+        m_pVB = nullptr;
+        m_pIB = nullptr;
+    }
+    pDevice->SetCamera(nullptr);
+
+    if (!frameTimes.empty())
+    {
+        stats.frames = uint32_t(frameTimes.size());
+        for (auto& time : frameTimes)
+        {
+            stats.totalMs += time;
+        }
+        stats.meanMs = stats.totalMs / frameTimes.size();
+        std::sort(frameTimes.begin(), frameTimes.end());
+        stats.minMs = frameTimes.front();
+        stats.maxMs = frameTimes.back();
+        stats.p99Ms = frameTimes[std::min(frameTimes.size() - 1, size_t(frameTimes.size() * 0.99))];
+    }
+    return ok;
+}
+
+bool DeviceReplay::PlayOnce(IDevice* pDevice, std::vector<double>& frameTimes, uint64_t& commands)
+{
+    CommandReader reader((const uint8_t*)m_data.data(), m_data.size());
+    reader.Read<uint32_t>();
+    reader.Read<uint32_t>();
+
+    auto textureID = [&](uint32_t id)
+    {
+        auto itr = m_mapTextureIDs.find(id);
+        return itr == m_mapTextureIDs.end() ? 0 : itr->second;
+    };
+
+    auto frameStart = std::chrono::high_resolution_clock::now();
+    while (!reader.AtEnd() && !reader.Failed())
+    {
+        auto command = DeviceCommand(reader.Read<uint8_t>());
+        commands++;
+
+        switch (command)
+        {
+        case DeviceCommand::BeginFrame:
+            pDevice->BeginFrame();
+            break;
+        case DeviceCommand::SetDeviceFlags:
+            // Always as fast as possible
+            reader.Read<uint32_t>();
+            break;
+        case DeviceCommand::SetClear:
+        {
+            auto color = reader.Read<glm::vec4>();
+            auto depth = reader.Read<float>();
+            auto flags = reader.Read<uint32_t>();
+            pDevice->SetClear(color, depth, flags);
+        }
+        break;
+        case DeviceCommand::SetCamera:
+        {
+            auto id = reader.Read<uint32_t>();
+            if (id == 0)
+            {
+                pDevice->SetCamera(nullptr);
+                break;
+            }
+
+            auto state = reader.Read<CameraState>();
+            auto& spCamera = m_mapCameras[id];
+            if (!spCamera)
+            {
+                spCamera = std::make_shared<Camera>(state.mode);
+            }
+            spCamera->SetState(state);
+            pDevice->SetCamera(spCamera.get());
+        }
+        break;
+        case DeviceCommand::LoadMesh:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto path = reader.ReadString();
+            auto spMesh = std::make_shared<Mesh>();
+            if (!spMesh->Load(path))
+            {
+                LOG(WARNING) << "Couldn't load mesh: " << path;
+            }
+            m_mapMeshes[id] = spMesh;
+        }
+        break;
+        case DeviceCommand::DrawMesh:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto type = reader.Read<GeometryType>();
+            auto itr = m_mapMeshes.find(id);
+            if (itr != m_mapMeshes.end())
+            {
+                pDevice->DrawMesh(itr->second.get(), type);
+            }
+        }
+        break;
+        case DeviceCommand::CreateTexture:
+            m_mapTextureIDs[reader.Read<uint32_t>()] = pDevice->CreateTexture();
+            break;
+        case DeviceCommand::DestroyTexture:
+        {
+            auto id = reader.Read<uint32_t>();
+            pDevice->DestroyTexture(textureID(id));
+            m_mapTextureIDs.erase(id);
+            m_mapTextureData.erase(id);
+        }
+        break;
+        case DeviceCommand::ResizeTexture:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto size = reader.Read<glm::uvec2>();
+            auto format = reader.Read<TextureFormat>();
+            m_mapTextureData[id] = pDevice->ResizeTexture(textureID(id), size, format);
+        }
+        break;
+        case DeviceCommand::UpdateTexture:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto size = reader.Read<glm::uvec2>();
+            auto itr = m_mapTextureData.find(id);
+            auto rowBytes = size.x * TextureFormatSize(itr != m_mapTextureData.end() ? itr->second.format : TextureFormat::RGBA8);
+            auto pTexels = reader.ReadBytes(size.y * rowBytes);
+            if (pTexels && itr != m_mapTextureData.end() && itr->second.pData)
+            {
+                for (uint32_t y = 0; y < size.y; y++)
+                {
+                    memcpy(itr->second.RowPtr<uint8_t>(y), pTexels + y * rowBytes, rowBytes);
+                }
+                pDevice->UpdateTexture(textureID(id));
+            }
+        }
+        break;
+        case DeviceCommand::SetTexturePalette:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto numColors = reader.Read<uint32_t>();
+            auto pColors = reader.ReadBytes(numColors * sizeof(glm::u8vec4));
+            if (pColors)
+            {
+                pDevice->SetTexturePalette(textureID(id), (const glm::u8vec4*)pColors, numColors);
+            }
+        }
+        break;
+        case DeviceCommand::CreateBuffer:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto size = reader.Read<uint32_t>();
+            auto flags = reader.Read<uint32_t>();
+            m_mapBuffers[id].spBuffer = pDevice->CreateBuffer(size, flags);
+        }
+        break;
+        case DeviceCommand::DestroyBuffer:
+        {
+            auto itr = m_mapBuffers.find(reader.Read<uint32_t>());
+            if (itr != m_mapBuffers.end())
+            {
+                if (m_pVB == &itr->second)
+                {
+                    m_pVB = nullptr;
+                }
+                if (m_pIB == &itr->second)
+                {
+                    m_pIB = nullptr;
+                }
+                m_mapBuffers.erase(itr);
+            }
+        }
+        break;
+        case DeviceCommand::EnsureSize:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto size = reader.Read<uint32_t>();
+            auto itr = m_mapBuffers.find(id);
+            if (itr != m_mapBuffers.end())
+            {
+                itr->second.spBuffer->EnsureSize(size);
+            }
+        }
+        break;
+        case DeviceCommand::MapBuffer:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto num = reader.Read<uint32_t>();
+            auto typeSize = reader.Read<uint32_t>();
+            auto recordedOffset = reader.Read<uint32_t>();
+            auto pData = reader.ReadBytes(num * typeSize);
+            auto itr = m_mapBuffers.find(id);
+            if (pData && itr != m_mapBuffers.end())
+            {
+                auto& buffer = itr->second;
+                uint32_t offset = 0;
+                auto pTarget = buffer.spBuffer->Map(num, typeSize, offset);
+                if (pTarget)
+                {
+                    memcpy(pTarget, pData, num * typeSize);
+                }
+                buffer.spBuffer->UnMap();
+
+                // Older maps over the same range are stale
+                buffer.maps.erase(std::remove_if(buffer.maps.begin(), buffer.maps.end(), [&](const glm::uvec3& map)
+                {
+                    return map.x < recordedOffset + num && recordedOffset < map.x + map.y;
+                }), buffer.maps.end());
+                buffer.maps.push_back(glm::uvec3(recordedOffset, num, offset));
+            }
+        }
+        break;
+        case DeviceCommand::UploadBuffer:
+        {
+            auto itr = m_mapBuffers.find(reader.Read<uint32_t>());
+            if (itr != m_mapBuffers.end())
+            {
+                itr->second.spBuffer->Upload();
+            }
+        }
+        break;
+        case DeviceCommand::BeginGeometry:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto vb = m_mapBuffers.find(reader.Read<uint32_t>());
+            auto ib = m_mapBuffers.find(reader.Read<uint32_t>());
+            auto flags = reader.Read<uint32_t>();
+            m_pVB = vb != m_mapBuffers.end() ? &vb->second : nullptr;
+            m_pIB = ib != m_mapBuffers.end() ? &ib->second : nullptr;
+            pDevice->BeginGeometry(textureID(id), m_pVB ? m_pVB->spBuffer.get() : nullptr, m_pIB ? m_pIB->spBuffer.get() : nullptr, flags);
+        }
+        break;
+        case DeviceCommand::EndGeometry:
+            pDevice->EndGeometry();
+            m_pVB = nullptr;
+            m_pIB = nullptr;
+            break;
+        case DeviceCommand::DrawTriangles:
+        {
+            auto VBOffset = reader.Read<uint32_t>();
+            auto IBOffset = reader.Read<uint32_t>();
+            auto numVertices = reader.Read<uint32_t>();
+            auto numIndices = reader.Read<uint32_t>();
+            pDevice->DrawTriangles(MapOffset(m_pVB, VBOffset), MapOffset(m_pIB, IBOffset), numVertices, numIndices);
+        }
+        break;
+        case DeviceCommand::DrawSprites:
+        {
+            auto id = reader.Read<uint32_t>();
+            auto numSprites = reader.Read<uint32_t>();
+            auto pSprites = reader.ReadBytes(numSprites * sizeof(SpriteInstance));
+            if (pSprites)
+            {
+                // Copied, since the stream may not be aligned
+                std::vector<SpriteInstance> sprites(numSprites);
+                memcpy(sprites.data(), pSprites, numSprites * sizeof(SpriteInstance));
+                pDevice->DrawSprites(textureID(id), sprites.data(), numSprites);
+            }
+        }
+        break;
+        case DeviceCommand::BeginGUI:
+            pDevice->BeginGUI();
+            break;
+        case DeviceCommand::EndGUI:
+            pDevice->EndGUI();
+            break;
+        case DeviceCommand::Flush:
+            pDevice->Flush();
+            break;
+        case DeviceCommand::Swap:
+        {
+            pDevice->Swap();
+
+            auto now = std::chrono::high_resolution_clock::now();
+            frameTimes.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+            frameStart = now;
+
+            // Keep the window responsive
+            SDL_PumpEvents();
+        }
+        break;
+        default:
+            LOG(ERROR) << "Unknown command in stream: " << int(command);
+            return false;
+        }
+    }
+
+    if (reader.Failed())
+    {
+        LOG(ERROR) << "Command stream is truncated";
+        return false;
+    }
+    return true;
+}
+
+} // namespace Mgfx
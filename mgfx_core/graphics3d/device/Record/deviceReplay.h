@@ -0,0 +1,61 @@
+#pragma once
+
+#include "IDevice.h"
+
+namespace Mgfx
+{
+
+class Camera;
+class Mesh;
+
+// Timings of a replay
+struct ReplayStats
+{
+    uint32_t frames = 0;
+    uint64_t commands = 0;
+    double totalMs = 0.0;
+    double meanMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double p99Ms = 0.0;
+};
+
+// Plays a command stream from DeviceRecord into a device, as fast as it will go.
+// Textures, buffers, cameras and meshes are created as the stream asks for them, and IDs are mapped
+// to the ones the device hands out. The refresh sync is always off
+class DeviceReplay
+{
+public:
+    bool Load(const fs::path& path);
+    bool SetData(const std::string& data);
+
+    // Returns false if the stream is broken; the device is left with whatever was played
+    bool Play(IDevice* pDevice, uint32_t loops, ReplayStats& stats);
+
+private:
+    struct ReplayBuffer
+    {
+        std::shared_ptr<IDeviceBuffer> spBuffer;
+
+        // Where the recorded maps landed in this device's buffer, in elements, as (recorded start, count, replayed start).
+        // Draws use offsets from the recording, so they are moved to match
+        std::vector<glm::uvec3> maps;
+    };
+
+    bool PlayOnce(IDevice* pDevice, std::vector<double>& frameTimes, uint64_t& commands);
+    uint32_t MapOffset(const ReplayBuffer* pBuffer, uint32_t offset) const;
+
+private:
+    std::string m_data;
+
+    std::map<uint32_t, uint32_t> m_mapTextureIDs;
+    std::map<uint32_t, ReplayBuffer> m_mapBuffers;
+    std::map<uint32_t, std::shared_ptr<Camera>> m_mapCameras;
+    std::map<uint32_t, std::shared_ptr<Mesh>> m_mapMeshes;
+    std::map<uint32_t, TextureData> m_mapTextureData;
+
+    ReplayBuffer* m_pVB = nullptr;
+    ReplayBuffer* m_pIB = nullptr;
+};
+
+} // namespace Mgfx
@@ -0,0 +1,54 @@
+#include "mgfx_core.h"
+#include "deviceSoft.h"
+#include "bufferSoft.h"
+
+namespace Mgfx
+{
+
+BufferSoft::BufferSoft(DeviceSoft* pDevice, uint32_t size, uint32_t flags)
+    : m_pDevice(pDevice),
+    m_data(size),
+    m_flags(flags)
+{
+}
+
+void BufferSoft::EnsureSize(uint32_t size)
+{
+    if (size > m_data.size())
+    {
+        m_data.resize(size);
+        m_offset = 0;
+    }
+}
+
+void* BufferSoft::Map(uint32_t num, uint32_t typeSize, uint32_t& offset)
+{
+    assert(!m_mapped);
+    if (m_mapped)
+    {
+        return nullptr;
+    }
+    m_mapped = true;
+
+    uint32_t byteSize = num * typeSize;
+    EnsureSize(byteSize);
+
+    // Aligned to the type, so the offset is a whole number of elements
+    uint32_t start = ((m_offset + typeSize - 1) / typeSize) * typeSize;
+    if (start + byteSize > m_data.size())
+    {
+        start = 0;
+    }
+
+    offset = start / typeSize;
+    m_offset = start + byteSize;
+    return m_data.data() + start;
+}
+
+void BufferSoft::UnMap()
+{
+    assert(m_mapped);
+    m_mapped = false;
+}
+
+} // namespace Mgfx
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Mgfx
+{
+
+class DeviceSoft;
+
+// Geometry in system memory, for the software device.
+// Maps the same way as BufferGL, filling up the buffer and then starting again at the front;
+// the device reads the vertices when a draw is made, so nothing is overwritten in flight
+class BufferSoft : public IDeviceBuffer
+{
+public:
+    BufferSoft(DeviceSoft* pDevice, uint32_t size, uint32_t flags);
+
+    virtual void* Map(uint32_t num, uint32_t typeSize, uint32_t& offset) override;
+    virtual void UnMap() override;
+    virtual void EnsureSize(uint32_t size) override;
+    virtual void Upload() override { /* nothing */ }
+    virtual uint32_t GetByteSize() const override { return uint32_t(m_data.size()); }
+    virtual void Bind() const override { /* nothing */ }
+    virtual void UnBind() const override { /* nothing */ }
+
+    const uint8_t* GetData() const { return m_data.data(); }
+
+private:
+    DeviceSoft* m_pDevice = nullptr;
+    std::vector<uint8_t> m_data;
+    uint32_t m_offset = 0;
+    uint32_t m_flags = 0;
+    bool m_mapped = false;
+};
+
+} // namespace Mgfx
@@ -0,0 +1,713 @@
+#include "mgfx_core.h"
+
+#include "device/Soft/deviceSoft.h"
+#include "device/Soft/bufferSoft.h"
+#include "device/Soft/imguisdl_soft.h"
+#include "camera/camera.h"
+#include "geometry/mesh.h"
+#include "ui/imgui_sdl_common.h"
+#include "file/media_manager.h"
+#include "graphics/blockdecode.h"
+#include "gli/gli.hpp"
+#include "profile/profiler.h"
+#include <glm/gtc/packing.hpp>
+
+#include <stb/stb_image.h>
+
+using namespace MCommon;
+
+namespace Mgfx
+{
+
+namespace
+{
+
+// The framebuffer is RGBA bytes in memory
+const uint32_t FramebufferFormat = (SDL_BYTEORDER == SDL_BIG_ENDIAN) ? SDL_PIXELFORMAT_RGBA8888 : SDL_PIXELFORMAT_ABGR8888;
+
+// Per vertex version of StandardShading: sky ambient, and a spot light at the camera.
+// Returns the factor for the diffuse color
+glm::vec3 LightVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec3& cameraPos, const glm::vec3& lightDir)
+{
+    const glm::vec3 SkyDirection(0.0f, 1.0f, 0.0f);
+    const glm::vec3 Gc(0.05f, 0.05f, 0.05f);
+    const glm::vec3 Sc(0.95f, 0.95f, 1.0f);
+    const float Hi = 0.75f;
+    float hemi = (glm::dot(normal, SkyDirection) * 0.5f) + 0.5f;
+    auto illuminance = Hi * glm::mix(Gc, Sc, hemi);
+
+    auto L = glm::normalize(cameraPos - pos);
+    float spotEffect = std::pow(std::max(glm::dot(L, -lightDir), 0.0f), 20.0f) * .45f;
+    float lambertian = std::max(glm::dot(L, normal), 0.0f);
+    return illuminance + glm::vec3(spotEffect * lambertian);
+}
+
+bool GetBlockFormat(gli::format format, BlockFormat& blockFormat)
+{
+    switch (format)
+    {
+    case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+    case gli::FORMAT_RGB_DXT1_SRGB_BLOCK8:
+    case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+    case gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+        blockFormat = BlockFormat::BC1;
+        return true;
+    case gli::FORMAT_RGBA_DXT3_UNORM_BLOCK16:
+    case gli::FORMAT_RGBA_DXT3_SRGB_BLOCK16:
+        blockFormat = BlockFormat::BC2;
+        return true;
+    case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+    case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+        blockFormat = BlockFormat::BC3;
+        return true;
+    case gli::FORMAT_R_ATI1N_UNORM_BLOCK8:
+        blockFormat = BlockFormat::BC4;
+        return true;
+    case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16:
+        blockFormat = BlockFormat::BC5;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+DeviceSoft::DeviceSoft()
+{
+
+}
+
+DeviceSoft::~DeviceSoft()
+{
+
+}
+
+bool DeviceSoft::Init()
+{
+    m_pSDLWindow = SDL_CreateWindow("MGFX - Software", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_RESIZABLE);
+    if (!m_pSDLWindow)
+    {
+        LOG(ERROR) << SDL_GetError();
+        return false;
+    }
+
+    m_spImGuiDraw = std::make_shared<ImGuiSDL_Soft>(this);
+    m_spImGuiDraw->Init(m_pSDLWindow);
+    return true;
+}
+
+std::shared_ptr<IDeviceBuffer> DeviceSoft::CreateBuffer(uint32_t size, uint32_t flags)
+{
+    return std::static_pointer_cast<IDeviceBuffer>(std::make_shared<BufferSoft>(this, size, flags));
+}
+
+// DDS textures are flipped and decoded to RGBA with all their mips, others are loaded with stb and mipped here
+const RasterTexture* DeviceSoft::LoadTexture(const fs::path& path)
+{
+    if (!fs::exists(path))
+    {
+        return nullptr;
+    }
+
+    auto itr = m_mapPathToTexture.find(path);
+    if (itr != m_mapPathToTexture.end())
+    {
+        return itr->second.get();
+    }
+
+    auto spTexture = std::make_shared<RasterTexture>();
+    if (path.extension().string() == ".dds")
+    {
+        gli::texture texture = gli::load(path.string());
+        if (texture.empty())
+        {
+            return nullptr;
+        }
+
+        BlockFormat blockFormat;
+        bool compressed = GetBlockFormat(texture.format(), blockFormat);
+
+        // As the GL device, which flips the v coordinate back in the shader.
+        // gli only flips S3TC, so compressed textures are flipped a level at a time
+        if (compressed)
+        {
+            for (size_t level = 0; level < texture.levels(); level++)
+            {
+                auto extent = texture.extent(level);
+                FlipBlocks(blockFormat, (uint8_t*)texture.data(0, 0, level), extent.x, extent.y);
+            }
+        }
+        else
+        {
+            texture = gli::flip(texture);
+        }
+        bool bgra = texture.format() == gli::FORMAT_BGRA8_UNORM_PACK8;
+        if (!compressed && !bgra &&
+            texture.format() != gli::FORMAT_RGBA8_UNORM_PACK8 &&
+            texture.format() != gli::FORMAT_RGBA8_SRGB_PACK8)
+        {
+            LOG(WARNING) << "Unsupported texture format: " << path.string();
+            return nullptr;
+        }
+
+        spTexture->srgb = gli::is_srgb(texture.format());
+        spTexture->levels.resize(texture.levels());
+        for (size_t level = 0; level < texture.levels(); level++)
+        {
+            auto extent = texture.extent(level);
+            auto& target = spTexture->levels[level];
+            target.size = glm::uvec2(extent.x, extent.y);
+            target.texels.resize(target.size.x * target.size.y);
+
+            auto pSource = (const uint8_t*)texture.data(0, 0, level);
+            if (compressed)
+            {
+                DecodeBlocks(blockFormat, pSource, target.size.x, target.size.y, (uint8_t*)target.texels.data(), target.size.x * sizeof(glm::u8vec4));
+            }
+            else
+            {
+                memcpy(target.texels.data(), pSource, target.texels.size() * sizeof(glm::u8vec4));
+                if (bgra)
+                {
+                    for (auto& texel : target.texels)
+                    {
+                        std::swap(texel.x, texel.z);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        int w;
+        int h;
+        int comp;
+        unsigned char* pImage = stbi_load(path.string().c_str(), &w, &h, &comp, 4);
+        if (pImage == nullptr)
+        {
+            return nullptr;
+        }
+
+        spTexture->Resize(glm::uvec2(w, h));
+        memcpy(spTexture->levels[0].texels.data(), pImage, w * h * sizeof(glm::u8vec4));
+        stbi_image_free(pImage);
+        spTexture->BuildMips();
+    }
+
+    m_mapPathToTexture[path] = spTexture;
+    return spTexture.get();
+}
+
+uint32_t DeviceSoft::CreateTexture()
+{
+    auto id = m_nextTextureID++;
+    m_mapIDToTextureData[id] = std::make_shared<TextureDataSoft>();
+    return id;
+}
+
+void DeviceSoft::DestroyTexture(uint32_t id)
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    // Queued triangles may still sample it
+    m_raster.Flush();
+    m_mapIDToTextureData.erase(itr);
+}
+
+TextureData DeviceSoft::ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format)
+{
+    TextureData ret;
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return ret;
+    }
+
+    itr->second->quadData.resize(size.x * size.y * TextureFormatSize(format));
+    itr->second->RequiredSize = size;
+    itr->second->format = format;
+    ret.pData = itr->second->quadData.data();
+    ret.pitch = size.x * TextureFormatSize(format);
+    ret.format = format;
+    return ret;
+}
+
+namespace
+{
+
+// Float color is clamped and shown as is; the power cancels the gamma on output, as in the GL quad shader
+uint8_t FloatToTexel(float value)
+{
+    return uint8_t(std::pow(glm::clamp(value, 0.0f, 1.0f), 2.2f) * 255.0f + 0.5f);
+}
+
+// The rasterizer samples 8 bit color, so the other formats are converted as they are copied in
+void ConvertTexels(const TextureDataSoft& data, uint32_t x, uint32_t y, uint32_t count, glm::u8vec4* pTarget)
+{
+    auto pSource = data.quadData.data() + (y * data.RequiredSize.x + x) * TextureFormatSize(data.format);
+    switch (data.format)
+    {
+    case TextureFormat::R8:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pTarget[i] = data.palette.empty() ? glm::u8vec4(pSource[i], 0, 0, 255) : data.palette[pSource[i]];
+        }
+        break;
+    case TextureFormat::RG8:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pTarget[i] = glm::u8vec4(pSource[i * 2], pSource[i * 2 + 1], 0, 255);
+        }
+        break;
+    case TextureFormat::RGBA16F:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t halves;
+            memcpy(&halves, pSource + i * sizeof(halves), sizeof(halves));
+            auto color = glm::unpackHalf4x16(halves);
+            pTarget[i] = glm::u8vec4(FloatToTexel(color.r), FloatToTexel(color.g), FloatToTexel(color.b), uint8_t(glm::clamp(color.a, 0.0f, 1.0f) * 255.0f + 0.5f));
+        }
+        break;
+    case TextureFormat::RGBA32F:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            glm::vec4 color;
+            memcpy(&color, pSource + i * sizeof(color), sizeof(color));
+            pTarget[i] = glm::u8vec4(FloatToTexel(color.r), FloatToTexel(color.g), FloatToTexel(color.b), uint8_t(glm::clamp(color.a, 0.0f, 1.0f) * 255.0f + 0.5f));
+        }
+        break;
+    default:
+        memcpy(pTarget, pSource, count * sizeof(glm::u8vec4));
+        break;
+    }
+}
+
+}
+
+void DeviceSoft::UpdateTexture(uint32_t id)
+{
+    PROFILE_SCOPE("DeviceSoft::UpdateTexture");
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    // Draw anything using the old contents first
+    m_raster.Flush();
+
+    auto& spTexture = itr->second;
+    spTexture->texture.Resize(spTexture->RequiredSize);
+    spTexture->textureFormat = spTexture->format;
+
+    auto& level = spTexture->texture.levels[0];
+    for (uint32_t y = 0; y < level.size.y; y++)
+    {
+        ConvertTexels(*spTexture, 0, y, level.size.x, &level.texels[y * level.size.x]);
+    }
+}
+
+void DeviceSoft::UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size)
+{
+    PROFILE_SCOPE("DeviceSoft::UpdateTextureRegion");
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    // A new size or format needs all of it
+    auto& spTexture = itr->second;
+    if (spTexture->texture.levels.empty() ||
+        spTexture->texture.levels[0].size != spTexture->RequiredSize ||
+        spTexture->textureFormat != spTexture->format)
+    {
+        UpdateTexture(id);
+        return;
+    }
+    auto& level = spTexture->texture.levels[0];
+
+    m_raster.Flush();
+
+    auto regionOffset = glm::min(offset, level.size);
+    auto regionSize = glm::min(size, level.size - regionOffset);
+    for (uint32_t y = regionOffset.y; y < regionOffset.y + regionSize.y; y++)
+    {
+        ConvertTexels(*spTexture, regionOffset.x, y, regionSize.x, &level.texels[y * level.size.x + regionOffset.x]);
+    }
+}
+
+// The palette is applied as the texture is converted, so an existing texture is converted again
+void DeviceSoft::SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors)
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return;
+    }
+
+    auto& spTexture = itr->second;
+    spTexture->palette.assign(256, glm::u8vec4(0));
+    std::copy(pColors, pColors + std::min(numColors, uint32_t(spTexture->palette.size())), spTexture->palette.begin());
+
+    if (!spTexture->texture.levels.empty())
+    {
+        UpdateTexture(id);
+    }
+}
+
+const RasterTexture* DeviceSoft::GetRasterTexture(uint32_t id) const
+{
+    auto itr = m_mapIDToTextureData.find(id);
+    if (itr == m_mapIDToTextureData.end())
+    {
+        return nullptr;
+    }
+    return &itr->second->texture;
+}
+
+glm::mat4 DeviceSoft::GeometryProjection() const
+{
+    if (m_pCurrentCamera)
+    {
+        return m_pCurrentCamera->GetProjection(Camera::ProjectionType::GL);
+    }
+    return glm::mat4(1.0f);
+}
+
+RasterState DeviceSoft::GeometryState(uint32_t id, uint32_t flags) const
+{
+    RasterState state;
+    state.pTexture = GetRasterTexture(id);
+    if (flags & GeometryFlags::DistanceField)
+    {
+        state.flags |= RasterFlags::DistanceField;
+    }
+    return state;
+}
+
+void DeviceSoft::BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags)
+{
+    m_geometryTextureID = id;
+    m_geometryFlags = flags;
+    m_pVB = static_cast<BufferSoft*>(pVB);
+    m_pIB = static_cast<BufferSoft*>(pIB);
+}
+
+void DeviceSoft::EndGeometry()
+{
+    m_pVB = nullptr;
+    m_pIB = nullptr;
+}
+
+void DeviceSoft::DrawTriangles(
+    uint32_t VBOffset,
+    uint32_t IBOffset,
+    uint32_t numVertices,
+    uint32_t numIndices)
+{
+    if (!m_pVB || !m_pIB || numIndices == 0)
+    {
+        return;
+    }
+
+    auto pIndices = (const uint32_t*)m_pIB->GetData() + IBOffset;
+    auto pSource = (const GeometryVertex*)m_pVB->GetData() + VBOffset;
+
+    // The indices are relative to the offset; transform as many vertices as they use
+    uint32_t used = std::max(numVertices, *std::max_element(pIndices, pIndices + numIndices) + 1);
+    uint32_t available = m_pVB->GetByteSize() / sizeof(GeometryVertex) - VBOffset;
+    if (used > available)
+    {
+        LOG(ERROR) << "DrawTriangles: indices outside the vertex buffer";
+        return;
+    }
+
+    auto projection = GeometryProjection();
+    m_vertices.resize(used);
+    for (uint32_t i = 0; i < used; i++)
+    {
+        auto& source = pSource[i];
+        m_vertices[i] = RasterVertex(projection * glm::vec4(source.pos, 1.0f), source.tex, source.color);
+    }
+
+    m_raster.DrawTriangles(m_vertices.data(), pIndices, numIndices, GeometryState(m_geometryTextureID, m_geometryFlags));
+}
+
+// The same expansion as Sprite.vertexshader
+void DeviceSoft::DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites)
+{
+    if (numSprites == 0)
+    {
+        return;
+    }
+
+    auto projection = GeometryProjection();
+    m_vertices.resize(numSprites * 4);
+    m_indices.resize(numSprites * 6);
+    for (uint32_t sprite = 0; sprite < numSprites; sprite++)
+    {
+        auto& instance = pSprites[sprite];
+        float angle = glm::radians(instance.angle);
+        auto right = glm::vec2(std::cos(angle), std::sin(angle));
+        auto down = glm::vec2(-right.y, right.x);
+        auto color = glm::vec4(instance.color) / 255.0f;
+
+        // Top left, top right, bottom left, bottom right
+        for (uint32_t vertex = 0; vertex < 4; vertex++)
+        {
+            auto corner = glm::vec2(float(vertex & 1), float(vertex >> 1));
+            auto offset = (corner * 2.0f - 1.0f) * instance.halfSize;
+            auto position = glm::vec2(instance.pos) + (right * offset.x) + (down * offset.y);
+            auto tex = glm::mix(glm::vec2(instance.texRect.x, instance.texRect.y), glm::vec2(instance.texRect.z, instance.texRect.w), corner);
+            m_vertices[sprite * 4 + vertex] = RasterVertex(projection * glm::vec4(position, instance.pos.z, 1.0f), tex, color);
+        }
+
+        uint32_t base = sprite * 4;
+        uint32_t* pIndices = &m_indices[sprite * 6];
+        pIndices[0] = base + 0;
+        pIndices[1] = base + 1;
+        pIndices[2] = base + 2;
+        pIndices[3] = base + 2;
+        pIndices[4] = base + 1;
+        pIndices[5] = base + 3;
+    }
+
+    m_raster.DrawTriangles(m_vertices.data(), m_indices.data(), uint32_t(m_indices.size()), GeometryState(id, 0));
+}
+
+Camera* DeviceSoft::GetCamera() const
+{
+    return m_pCurrentCamera;
+}
+
+void DeviceSoft::SetCamera(Camera* pCamera)
+{
+    m_pCurrentCamera = pCamera;
+}
+
+void DeviceSoft::SetDeviceFlags(uint32_t flags)
+{
+    // There is no refresh to sync to
+    m_deviceFlags = flags;
+}
+
+bool DeviceSoft::BeginFrame()
+{
+    if (m_inFrame)
+    {
+        assert(!"BeginFrame called twice?");
+        return false;
+    }
+
+    m_inFrame = true;
+
+    int w, h;
+    SDL_GetWindowSize(m_pSDLWindow, &w, &h);
+    m_raster.Resize(glm::uvec2(std::max(w, 1), std::max(h, 1)));
+
+    if (m_clearFlags & ClearType::Color)
+    {
+        m_raster.ClearColor(glm::u8vec4(glm::clamp(m_clearColor, 0.0f, 1.0f) * 255.0f + .5f));
+    }
+
+    if (m_clearFlags & ClearType::Depth)
+    {
+        m_raster.ClearDepth(m_clearDepth);
+    }
+
+    return true;
+}
+
+void DeviceSoft::SetClear(const glm::vec4& clearColor, float depth, uint32_t clearFlags)
+{
+    m_clearColor = clearColor;
+    m_clearDepth = depth;
+    m_clearFlags = clearFlags;
+}
+
+std::shared_ptr<SoftMesh> DeviceSoft::BuildDeviceMesh(Mesh* pMesh)
+{
+    auto spDeviceMesh = std::make_shared<SoftMesh>();
+    for (auto& spPart : pMesh->GetMeshParts())
+    {
+        SoftMeshPart part;
+        part.pPart = spPart.get();
+        if (spPart->MaterialID != -1)
+        {
+            auto& mat = pMesh->GetMaterials()[spPart->MaterialID];
+            if (!mat->diffuseTex.empty())
+            {
+                part.pTexture = LoadTexture(MediaManager::Instance().FindAsset(mat->diffuseTex.c_str(), MediaType::Texture, &pMesh->GetRootPath()));
+
+                // The same transparency hack as the GL device, for Sponza
+                if (mat->diffuseTex.find("thorn") != std::string::npos ||
+                    mat->diffuseTex.find("plant") != std::string::npos ||
+                    mat->diffuseTex.find("chain") != std::string::npos)
+                {
+                    part.transparent = true;
+                }
+            }
+        }
+        spDeviceMesh->parts.push_back(part);
+    }
+    return spDeviceMesh;
+}
+
+void DeviceSoft::DrawMesh(Mesh* pMesh, GeometryType type)
+{
+    PROFILE_SCOPE("DeviceSoft::DrawMesh");
+    if (!m_pCurrentCamera)
+    {
+        return;
+    }
+
+    SoftMesh* pDeviceMesh = nullptr;
+    auto itrFound = m_mapDeviceMeshes.find(pMesh);
+    if (itrFound == m_mapDeviceMeshes.end())
+    {
+        auto spDeviceMesh = BuildDeviceMesh(pMesh);
+        m_mapDeviceMeshes[pMesh] = spDeviceMesh;
+        pDeviceMesh = spDeviceMesh.get();
+    }
+    else
+    {
+        pDeviceMesh = itrFound->second.get();
+    }
+
+    auto MVP = m_pCurrentCamera->GetProjection(Camera::ProjectionType::GL) * m_pCurrentCamera->GetLookAt();
+    auto cameraPos = m_pCurrentCamera->GetPosition();
+
+    int x, y;
+    SDL_GetMouseState(&x, &y);
+    auto lightDir = m_pCurrentCamera->GetWorldRay(glm::vec2(x, y)).direction;
+
+    RasterState state;
+    for (auto& part : pDeviceMesh->parts)
+    {
+        // Skip if not the requested type
+        if (part.transparent != (type == GeometryType::Transparent))
+        {
+            continue;
+        }
+
+        auto& meshPart = *part.pPart;
+        auto numVertices = uint32_t(meshPart.Positions.size());
+        m_vertices.resize(numVertices);
+        ParallelFor(numVertices, 4096, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                auto& pos = meshPart.Positions[i];
+                auto normal = i < meshPart.Normals.size() ? glm::normalize(meshPart.Normals[i]) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+                // Flip tex coords the right way up
+                auto uv = i < meshPart.UVs.size() ? meshPart.UVs[i] * glm::vec2(1.0f, -1.0f) : glm::vec2(0.0f);
+                m_vertices[i] = RasterVertex(MVP * glm::vec4(pos, 1.0f), uv, glm::vec4(LightVertex(pos, normal, cameraPos, lightDir), 1.0f));
+            }
+        });
+
+        state.pTexture = part.pTexture;
+        m_raster.DrawTriangles(m_vertices.data(), meshPart.Indices.data(), uint32_t(meshPart.Indices.size()), state);
+    }
+}
+
+void DeviceSoft::Cleanup()
+{
+    m_raster.Flush();
+
+    m_spImGuiDraw->Shutdown();
+    m_spImGuiDraw.reset();
+
+    m_mapDeviceMeshes.clear();
+    m_mapPathToTexture.clear();
+    m_mapIDToTextureData.clear();
+
+    SDL_DestroyWindow(m_pSDLWindow);
+    m_pSDLWindow = nullptr;
+}
+
+void DeviceSoft::BeginGUI()
+{
+    m_spImGuiDraw->NewFrame(m_pSDLWindow);
+}
+
+void DeviceSoft::EndGUI()
+{
+    ImGui::Render();
+    m_spImGuiDraw->RenderDrawLists(ImGui::GetDrawData());
+}
+
+// Handle any interesting SDL events
+void DeviceSoft::ProcessEvent(SDL_Event& event)
+{
+    ImGui_SDL_Common::ProcessEvent(&event);
+}
+
+// Rasterize everything queued
+void DeviceSoft::Flush()
+{
+    m_raster.Flush();
+}
+
+void DeviceSoft::RequestCapture()
+{
+    m_captureRequested = true;
+}
+
+bool DeviceSoft::GetCapture(FrameCapture& capture, bool wait)
+{
+    if (m_captures.empty())
+    {
+        return false;
+    }
+    capture = std::move(m_captures.front());
+    m_captures.pop_front();
+    return true;
+}
+
+// Copy the frame to the window
+void DeviceSoft::Swap()
+{
+    m_inFrame = false;
+    m_raster.Flush();
+
+    if (m_captureRequested)
+    {
+        m_captureRequested = false;
+
+        FrameCapture capture;
+        capture.size = m_raster.GetSize();
+        capture.frame = m_frameCount;
+        capture.pixels = m_raster.GetColor();
+        for (auto& pixel : capture.pixels)
+        {
+            pixel.w = 255;
+        }
+        m_captures.push_back(std::move(capture));
+    }
+    m_frameCount++;
+
+    auto pSurface = SDL_GetWindowSurface(m_pSDLWindow);
+    if (!pSurface)
+    {
+        return;
+    }
+
+    auto size = m_raster.GetSize();
+    int w = std::min(pSurface->w, int(size.x));
+    int h = std::min(pSurface->h, int(size.y));
+    if (w > 0 && h > 0)
+    {
+        SDL_ConvertPixels(w, h, FramebufferFormat, m_raster.GetColor().data(), size.x * sizeof(glm::u8vec4),
+            pSurface->format->format, pSurface->pixels, pSurface->pitch);
+        SDL_UpdateWindowSurface(m_pSDLWindow);
+    }
+}
+
+} // namespace Mgfx
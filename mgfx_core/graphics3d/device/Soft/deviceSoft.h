@@ -0,0 +1,138 @@
+#pragma once
+
+#include "IDevice.h"
+#include "graphics/rasterizer.h"
+#include <deque>
+
+struct SDL_Window;
+union SDL_Event;
+
+namespace Mgfx
+{
+
+class Camera;
+class Mesh;
+class ImGuiSDL_Soft;
+class BufferSoft;
+struct MeshPart;
+
+struct TextureDataSoft
+{
+    glm::uvec2 RequiredSize = glm::uvec2(0);
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<uint8_t> quadData;          // Written by the caller, and converted to the texture on update
+    std::vector<glm::u8vec4> palette;       // For R8; 256 entries, or none
+    TextureFormat textureFormat = TextureFormat::RGBA8;    // What the texture was last converted from
+    MCommon::RasterTexture texture;
+};
+
+struct SoftMeshPart
+{
+    MeshPart* pPart = nullptr;
+    const MCommon::RasterTexture* pTexture = nullptr;
+    bool transparent = false;
+};
+
+struct SoftMesh
+{
+    std::vector<SoftMeshPart> parts;
+};
+
+// A device which renders on the CPU, with MCommon::Rasterizer, into a framebuffer in memory.
+// Needs no GPU, so every renderer can run, be profiled and be tested anywhere.
+// The frame is copied to the window surface on swap, if there is one.
+// It follows the GL device: the same projections, reversed depth, blending and gamma.
+// Meshes are lit per vertex, with the ambient and spot light of the standard shader; no normal maps or specular
+class DeviceSoft : public IDevice
+{
+public:
+    DeviceSoft();
+    ~DeviceSoft();
+    virtual bool Init() override;
+
+    virtual bool BeginFrame() override;
+    virtual void SetDeviceFlags(uint32_t flags) override;
+    virtual void DrawMesh(Mesh* pMesh, GeometryType type) override;
+
+    virtual void SetClear(const glm::vec4& clearColor, float depth, uint32_t clearFlags) override;
+    virtual void SetCamera(Camera* pCamera) override;
+    virtual Camera* GetCamera() const override;
+
+    // 2D Rendering functions
+    uint32_t CreateTexture() override;
+    virtual void DestroyTexture(uint32_t id) override;
+    virtual TextureData ResizeTexture(uint32_t id, const glm::uvec2& size, TextureFormat format = TextureFormat::RGBA8) override;
+    virtual void UpdateTexture(uint32_t id) override;
+    virtual void UpdateTextureRegion(uint32_t id, const glm::uvec2& offset, const glm::uvec2& size) override;
+    virtual void SetTexturePalette(uint32_t id, const glm::u8vec4* pColors, uint32_t numColors) override;
+
+    virtual std::shared_ptr<IDeviceBuffer> CreateBuffer(uint32_t size, uint32_t flags) override;
+
+    virtual void BeginGeometry(uint32_t id, IDeviceBuffer* pVB, IDeviceBuffer* pIB, uint32_t flags = 0) override;
+    virtual void EndGeometry() override;
+    virtual void DrawTriangles(
+        uint32_t VBOffset,
+        uint32_t IBOffset,
+        uint32_t numVertices,
+        uint32_t numIndices) override;
+    virtual void DrawSprites(uint32_t id, const SpriteInstance* pSprites, uint32_t numSprites) override;
+
+    virtual void BeginGUI() override;
+    virtual void EndGUI() override;
+    virtual void Cleanup() override;
+    virtual void ProcessEvent(SDL_Event& event) override;
+    virtual void Flush() override;
+    virtual void Swap() override;
+    virtual void RequestCapture() override;
+    virtual bool GetCapture(FrameCapture& capture, bool wait) override;
+    virtual SDL_Window* GetSDLWindow() const override { return m_pSDLWindow; }
+
+    virtual const char* GetName() const override { return "Software"; }
+
+    MCommon::Rasterizer& GetRasterizer() { return m_raster; }
+    const MCommon::RasterTexture* GetRasterTexture(uint32_t id) const;
+
+private:
+    std::shared_ptr<SoftMesh> BuildDeviceMesh(Mesh* pMesh);
+    const MCommon::RasterTexture* LoadTexture(const fs::path& path);
+
+    // The state for 2D geometry; textured, blended and depth tested, as the quad shader
+    MCommon::RasterState GeometryState(uint32_t id, uint32_t flags) const;
+    glm::mat4 GeometryProjection() const;
+
+private:
+    SDL_Window* m_pSDLWindow = nullptr;
+    std::shared_ptr<ImGuiSDL_Soft> m_spImGuiDraw;
+
+    MCommon::Rasterizer m_raster;
+
+    std::map<Mesh*, std::shared_ptr<SoftMesh>> m_mapDeviceMeshes;
+    std::map<uint32_t, std::shared_ptr<TextureDataSoft>> m_mapIDToTextureData;
+    std::map<fs::path, std::shared_ptr<MCommon::RasterTexture>> m_mapPathToTexture;
+    uint32_t m_nextTextureID = 1;
+
+    // Between BeginGeometry and EndGeometry
+    uint32_t m_geometryTextureID = 0;
+    uint32_t m_geometryFlags = 0;
+    BufferSoft* m_pVB = nullptr;
+    BufferSoft* m_pIB = nullptr;
+
+    // Transformed vertices
+    std::vector<MCommon::RasterVertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+
+    Camera* m_pCurrentCamera = nullptr;
+
+    glm::vec4 m_clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    float m_clearDepth = 0.0f;
+    uint32_t m_clearFlags = ClearType::Depth | ClearType::Color;
+    bool m_inFrame = false;
+    uint32_t m_deviceFlags = DeviceFlags::SyncToRefresh;
+
+    // The framebuffer is in memory, so captures are copied straight away
+    bool m_captureRequested = false;
+    uint64_t m_frameCount = 0;
+    std::deque<FrameCapture> m_captures;
+};
+
+} // Mgfx namespace
@@ -0,0 +1,123 @@
+#include "mgfx_core.h"
+#include "deviceSoft.h"
+#include "imguisdl_soft.h"
+#include "ui/imgui_sdl_common.h"
+
+using namespace MCommon;
+
+namespace Mgfx
+{
+
+ImGuiSDL_Soft::ImGuiSDL_Soft(DeviceSoft* pDevice)
+    : m_pDevice(pDevice)
+{
+}
+
+// Blended, unlit and without depth, clipped to the command rectangles
+void ImGuiSDL_Soft::RenderDrawLists(ImDrawData* draw_data)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    if (io.DisplaySize.x <= 0.0f || io.DisplaySize.y <= 0.0f)
+    {
+        return;
+    }
+
+    RasterState state;
+    state.flags = RasterFlags::Blend;
+
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+
+        // Screen to clip space
+        m_vertices.resize(cmd_list->VtxBuffer.Size);
+        for (int i = 0; i < cmd_list->VtxBuffer.Size; i++)
+        {
+            auto& source = cmd_list->VtxBuffer[i];
+            auto color = glm::vec4(source.col & 0xff, (source.col >> 8) & 0xff, (source.col >> 16) & 0xff, source.col >> 24) / 255.0f;
+            m_vertices[i] = RasterVertex(glm::vec4(source.pos.x / io.DisplaySize.x * 2.0f - 1.0f, 1.0f - source.pos.y / io.DisplaySize.y * 2.0f, 0.0f, 1.0f),
+                glm::vec2(source.uv.x, source.uv.y), color);
+        }
+
+        const ImDrawIdx* pIndex = cmd_list->IdxBuffer.Data;
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            if (pcmd->UserCallback)
+            {
+                pcmd->UserCallback(cmd_list, pcmd);
+            }
+            else
+            {
+                m_indices.assign(pIndex, pIndex + pcmd->ElemCount);
+                state.pTexture = m_pDevice->GetRasterTexture(uint32_t(uintptr_t(pcmd->TextureId)));
+                state.scissor = glm::ivec4(int(pcmd->ClipRect.x), int(pcmd->ClipRect.y), int(pcmd->ClipRect.z), int(pcmd->ClipRect.w));
+                m_pDevice->GetRasterizer().DrawTriangles(m_vertices.data(), m_indices.data(), pcmd->ElemCount, state);
+            }
+            pIndex += pcmd->ElemCount;
+        }
+    }
+}
+
+void ImGuiSDL_Soft::CreateFontsTexture()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    m_fontTexture = m_pDevice->CreateTexture();
+    auto data = m_pDevice->ResizeTexture(m_fontTexture, glm::uvec2(width, height));
+    for (int y = 0; y < height; y++)
+    {
+        memcpy(data.LinePtr(y), pixels + y * width * sizeof(glm::u8vec4), width * sizeof(glm::u8vec4));
+    }
+    m_pDevice->UpdateTexture(m_fontTexture);
+
+    io.Fonts->TexID = (void *)(intptr_t)m_fontTexture;
+}
+
+bool ImGuiSDL_Soft::Init(SDL_Window* window)
+{
+    m_pContext = ImGui::CreateContext();
+    ImGui::SetCurrentContext(m_pContext);
+
+    ImGui_SDL_Common::Init(window);
+
+    return true;
+}
+
+void ImGuiSDL_Soft::Shutdown()
+{
+    ImGui::SetCurrentContext(m_pContext);
+    if (m_fontTexture)
+    {
+        m_pDevice->DestroyTexture(m_fontTexture);
+        ImGui::GetIO().Fonts->TexID = 0;
+        m_fontTexture = 0;
+    }
+    ImGui::DestroyContext(m_pContext);
+
+    m_pContext = nullptr;
+}
+
+void ImGuiSDL_Soft::NewFrame(SDL_Window* window)
+{
+    if (!m_pContext)
+    {
+        return;
+    }
+    ImGui::SetCurrentContext(m_pContext);
+
+    if (!m_fontTexture)
+    {
+        CreateFontsTexture();
+    }
+
+    // The font atlas is global; see the GL binding
+    ImGui::GetIO().Fonts->TexID = (void*)(uintptr_t)m_fontTexture;
+
+    ImGui_SDL_Common::NewFrame(window);
+}
+
+} // namespace Mgfx
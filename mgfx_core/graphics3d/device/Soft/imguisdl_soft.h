@@ -0,0 +1,34 @@
+#pragma once
+// ImGui SDL2 binding for the software device.
+// ImTextureID stores a device texture ID, as with the GL binding
+
+struct SDL_Window;
+
+namespace Mgfx
+{
+
+class DeviceSoft;
+
+class ImGuiSDL_Soft
+{
+public:
+    explicit ImGuiSDL_Soft(DeviceSoft* pDevice);
+
+    bool        Init(SDL_Window* window);
+    void        Shutdown();
+    void        NewFrame(SDL_Window* window);
+
+    void        RenderDrawLists(ImDrawData* draw_data);
+
+private:
+    void        CreateFontsTexture();
+
+private:
+    DeviceSoft* m_pDevice = nullptr;
+    ImGuiContext* m_pContext = nullptr;
+    uint32_t m_fontTexture = 0;
+    std::vector<MCommon::RasterVertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+};
+
+} // namespace Mgfx
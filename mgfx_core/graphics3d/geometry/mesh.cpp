@@ -2,24 +2,80 @@
 #include "mesh.h"
 
 #include "mcommon/schema/model_generated.h"
+#include "threadpool/ThreadPool.hpp"
+#include "profile/profiler.h"
 
 namespace Mgfx
 {
 
+Mesh::~Mesh()
+{
+    if (m_loading.valid())
+    {
+        m_loading.wait();
+    }
+}
+
 bool Mesh::Load(const fs::path& modelPath)
 {
+    std::string error;
+    if (!Read(modelPath, error))
+    {
+        if (!error.empty())
+        {
+            UIManager::Instance().AddMessage(MessageType::Error | MessageType::System, error);
+        }
+        return false;
+    }
+    return true;
+}
+
+void Mesh::LoadAsync(const fs::path& modelPath)
+{
+    m_loading = GetLoaderPool().enqueue([this, modelPath]()
+    {
+        std::string error;
+        Read(modelPath, error);
+        return error;
+    });
+}
+
+// Messages are only shown from the main thread
+bool Mesh::IsLoading()
+{
+    if (!m_loading.valid())
+    {
+        return false;
+    }
+
+    if (!is_future_ready(m_loading))
+    {
+        return true;
+    }
+
+    auto error = m_loading.get();
+    if (!error.empty())
+    {
+        UIManager::Instance().AddMessage(MessageType::Error | MessageType::System, error);
+    }
+    return false;
+}
+
+bool Mesh::Read(const fs::path& modelPath, std::string& error)
+{
+    PROFILE_SCOPE("Mesh::Load");
     if (!fs::exists(modelPath))
     {
         return false;
     }
 
+    m_path = modelPath;
     m_rootPath = modelPath.parent_path();
 
     std::string data = FileUtils::ReadFile(modelPath);
     if (data.empty())
     {
-        UIManager::Instance().AddMessage(MessageType::Error | MessageType::System,
-            "Couldn't load mesh: " + modelPath.string());
+        error = "Couldn't load mesh: " + modelPath.string();
         return false;
     }
 
@@ -42,16 +42,27 @@ struct MeshPart
 class Mesh
 {
 public:
+    ~Mesh();
     bool Load(const fs::path& path);
 
+    // Reads the mesh on a loader thread; it has no parts until IsLoading returns false
+    void LoadAsync(const fs::path& path);
+    bool IsLoading();
+
     const std::vector<std::shared_ptr<MeshPart>>& GetMeshParts() const { return m_meshParts; }
     const std::vector<std::shared_ptr<Material>>& GetMaterials() const { return m_materials; }
 
     const fs::path& GetRootPath() const { return m_rootPath; }
+    const fs::path& GetPath() const { return m_path; }
+private:
+    bool Read(const fs::path& path, std::string& error);
+
 private:
     std::vector<std::shared_ptr<MeshPart>> m_meshParts;
     std::vector<std::shared_ptr<Material>> m_materials;
     fs::path m_rootPath;
+    fs::path m_path;
+    std::future<std::string> m_loading;
 };
 
 } // namespace Mgfx
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "mgfx_core.h"
+#include "renderqueue.h"
+
+namespace Mgfx
+{
+
+namespace
+{
+const uint64_t TransparentBit = uint64_t(1) << 63;
+const uint32_t StateMask = (1 << 15) - 1;
+const uint32_t TextureMask = (1 << 24) - 1;
+const uint32_t DepthMask = (1 << 24) - 1;
+}
+
+// The bits of a positive float increase with its value, so the top of them make a cheap depth key
+// without knowing the range of the scene
+uint32_t RenderQueue::QuantizeDepth(float depth)
+{
+    if (!(depth > 0.0f))
+    {
+        return 0;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return (bits >> 7) & DepthMask;
+}
+
+uint64_t RenderQueue::OpaqueKey(uint32_t state, uint32_t texture, float depth)
+{
+    return (uint64_t(state & StateMask) << 48) |
+        (uint64_t(texture & TextureMask) << 24) |
+        uint64_t(QuantizeDepth(depth));
+}
+
+uint64_t RenderQueue::TransparentKey(float depth)
+{
+    return TransparentBit | uint64_t(DepthMask - QuantizeDepth(depth));
+}
+
+void RenderQueue::Add(uint64_t key, uint32_t index)
+{
+    RenderItem item;
+    item.key = key;
+    item.index = index;
+    m_items.push_back(item);
+}
+
+// Stable, so draws with equal keys keep the order they were added in
+void RenderQueue::Sort()
+{
+    std::stable_sort(m_items.begin(), m_items.end(), [](const RenderItem& lhs, const RenderItem& rhs)
+    {
+        return lhs.key < rhs.key;
+    });
+}
+
+} // namespace Mgfx
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace Mgfx
+{
+
+// A draw, and the key it is sorted by. The index is the caller's, usually into its own list of parts
+struct RenderItem
+{
+    uint64_t key = 0;
+    uint32_t index = 0;
+};
+
+// Collects draws and sorts them by key, so that a device can submit them with the fewest state changes.
+// Opaque keys order by state, then texture, then front to back, so early depth rejects the rest.
+// Transparent keys always follow the opaque ones, and order back to front.
+//  Opaque:      [63] 0 | [62..48] state | [47..24] texture | [23..0] depth
+//  Transparent: [63] 1 | [62..24] 0     | [23..0] inverted depth
+class RenderQueue
+{
+public:
+    static uint64_t OpaqueKey(uint32_t state, uint32_t texture, float depth);
+    static uint64_t TransparentKey(float depth);
+
+    // 24 bits which increase with a positive depth
+    static uint32_t QuantizeDepth(float depth);
+
+    void Clear() { m_items.clear(); }
+    void Add(uint64_t key, uint32_t index);
+    void Sort();
+
+    const std::vector<RenderItem>& GetItems() const { return m_items; }
+    bool IsEmpty() const { return m_items.empty(); }
+
+private:
+    std::vector<RenderItem> m_items;
+};
+
+} // namespace Mgfx
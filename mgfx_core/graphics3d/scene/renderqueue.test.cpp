@@ -0,0 +1,52 @@
+#include "mcommon.h"
+#include <gtest/gtest.h>
+#include "scene/renderqueue.h"
+
+using namespace Mgfx;
+
+TEST(RenderQueue, DepthKeysIncrease)
+{
+    ASSERT_EQ(RenderQueue::QuantizeDepth(0.0f), 0u);
+    ASSERT_EQ(RenderQueue::QuantizeDepth(-5.0f), 0u);
+    ASSERT_LT(RenderQueue::QuantizeDepth(0.5f), RenderQueue::QuantizeDepth(1.0f));
+    ASSERT_LT(RenderQueue::QuantizeDepth(1.0f), RenderQueue::QuantizeDepth(1000.0f));
+    ASSERT_LT(RenderQueue::QuantizeDepth(1000.0f), RenderQueue::QuantizeDepth(100000.0f));
+}
+
+TEST(RenderQueue, SortsOpaqueByStateThenDepth)
+{
+    RenderQueue queue;
+    queue.Add(RenderQueue::OpaqueKey(1, 7, 10.0f), 0);
+    queue.Add(RenderQueue::OpaqueKey(0, 9, 50.0f), 1);
+    queue.Add(RenderQueue::OpaqueKey(1, 7, 2.0f), 2);
+    queue.Add(RenderQueue::OpaqueKey(0, 3, 90.0f), 3);
+    queue.Add(RenderQueue::OpaqueKey(0, 9, 5.0f), 4);
+    queue.Sort();
+
+    std::vector<uint32_t> order;
+    for (auto& item : queue.GetItems())
+    {
+        order.push_back(item.index);
+    }
+    ASSERT_EQ(order, std::vector<uint32_t>({ 3, 4, 1, 2, 0 }));
+}
+
+TEST(RenderQueue, SortsTransparentBackToFrontAfterOpaque)
+{
+    RenderQueue queue;
+    queue.Add(RenderQueue::TransparentKey(1.0f), 0);
+    queue.Add(RenderQueue::OpaqueKey(100, 100, 1000.0f), 1);
+    queue.Add(RenderQueue::TransparentKey(100.0f), 2);
+    queue.Add(RenderQueue::TransparentKey(10.0f), 3);
+    queue.Sort();
+
+    std::vector<uint32_t> order;
+    for (auto& item : queue.GetItems())
+    {
+        order.push_back(item.index);
+    }
+    ASSERT_EQ(order, std::vector<uint32_t>({ 1, 2, 3, 0 }));
+
+    queue.Clear();
+    ASSERT_TRUE(queue.IsEmpty());
+}
@@ -19,11 +19,35 @@ void Scene::Render(IDevice* pDevice)
     }
 
     pDevice->SetClear(GetClearColor());
+
+    // All the opaque geometry first, so that the transparent parts blend over everything behind them.
+    // Meshes still loading in the background are left out until they are ready
+    for (auto& spMesh : m_vecMeshes)
+    {
+        if (!spMesh->IsLoading())
+        {
+            pDevice->DrawMesh(spMesh.get(), GeometryType::Opaque);
+        }
+    }
+    for (auto& spMesh : m_vecMeshes)
+    {
+        if (!spMesh->IsLoading())
+        {
+            pDevice->DrawMesh(spMesh.get(), GeometryType::Transparent);
+        }
+    }
+}
+
+bool Scene::IsLoading() const
+{
     for (auto& spMesh : m_vecMeshes)
     {
-        pDevice->DrawMesh(spMesh.get(), GeometryType::Opaque);
-        pDevice->DrawMesh(spMesh.get(), GeometryType::Transparent);
+        if (spMesh->IsLoading())
+        {
+            return true;
+        }
     }
+    return false;
 }
 
 } //namespace Mgfx;
\ No newline at end of file
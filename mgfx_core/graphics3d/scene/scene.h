@@ -21,6 +21,9 @@ public:
     const std::vector<std::shared_ptr<Camera>>& GetCameras() const { return m_vecCameras; }
     void Render(IDevice* pDevice);
 
+    // True while any mesh is still loading in the background
+    bool IsLoading() const;
+
     void SetCurrentCamera(std::shared_ptr<Camera> spCurrentCamera) { m_spCurrentCamera = spCurrentCamera; }
     const std::shared_ptr<Camera>& GetCurrentCamera() const { return m_spCurrentCamera; }
 
@@ -33,3 +33,20 @@ TEST(Scene, Bounds)
     ASSERT_NO_THROW(spScene->Render(nullptr));
 }
     
+
+TEST(Scene, LoadAsync)
+{
+    auto spScene = std::make_shared<Scene>();
+    auto spMesh = std::make_shared<Mesh>();
+    spScene->AddMesh(spMesh);
+    ASSERT_FALSE(spScene->IsLoading());
+
+    // A missing file fails quietly, and leaves the mesh empty
+    spMesh->LoadAsync("missing.mmesh");
+    while (spScene->IsLoading())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(spMesh->GetMeshParts().empty());
+    ASSERT_NO_THROW(spScene->Render(nullptr));
+}
@@ -1,6 +1,12 @@
 
 LIST(APPEND MGFX_SOURCES
    mgfx_core/graphics3d/device/IDevice.h 
+   mgfx_core/graphics3d/device/Record/commandstream.cpp
+   mgfx_core/graphics3d/device/Record/commandstream.h
+   mgfx_core/graphics3d/device/Record/deviceRecord.cpp
+   mgfx_core/graphics3d/device/Record/deviceRecord.h
+   mgfx_core/graphics3d/device/Record/deviceReplay.cpp
+   mgfx_core/graphics3d/device/Record/deviceReplay.h
    mgfx_core/graphics3d/camera/camera.h
    mgfx_core/graphics3d/camera/camera.cpp
    mgfx_core/graphics3d/geometry/mesh.cpp
@@ -9,6 +15,8 @@ LIST(APPEND MGFX_SOURCES
    mgfx_core/graphics3d/ui/camera_manipulator.cpp
    mgfx_core/graphics3d/scene/scene.h
    mgfx_core/graphics3d/scene/scene.cpp
+   mgfx_core/graphics3d/scene/renderqueue.h
+   mgfx_core/graphics3d/scene/renderqueue.cpp
    mgfx_core
    mgfx_core/mgfx_core.h
    mgfx_core/graphics2d/ui/imgui_sdl_common.cpp
@@ -17,6 +25,8 @@ LIST(APPEND MGFX_SOURCES
    mgfx_core/graphics2d/ui/windowmanager.h
    mgfx_core/graphics2d/ui/window.cpp
    mgfx_core/graphics2d/ui/window.h
+   mgfx_core/graphics2d/text/textbatch.cpp
+   mgfx_core/graphics2d/text/textbatch.h
    mgfx_core/list.cmake
 )
 
@@ -29,6 +39,8 @@ LIST(APPEND MGFX_SOURCES
    mgfx_core/graphics3d/device/GL/geometryGL.h
    mgfx_core/graphics3d/device/GL/bufferGL.cpp
    mgfx_core/graphics3d/device/GL/bufferGL.h
+   mgfx_core/graphics3d/device/GL/textureStreamGL.cpp
+   mgfx_core/graphics3d/device/GL/textureStreamGL.h
    mgfx_core/graphics3d/device/GL/glcorearb.h
    mgfx_core/graphics3d/device/GL/shader.cpp
    mgfx_core/graphics3d/device/GL/shader.h
@@ -92,11 +104,15 @@ LIST(APPEND PLATFORM_LINKLIBS
 )
 ENDIF()
 
-if (PROJECT_DEVICE_NULL)
+if (PROJECT_DEVICE_SOFT)
 
 LIST(APPEND MGFX_SOURCES
-    mgfx_core/graphics3d/device/Null/deviceNull.cpp
-    mgfx_core/graphics3d/device/Null/deviceNull.h
+    mgfx_core/graphics3d/device/Soft/deviceSoft.cpp
+    mgfx_core/graphics3d/device/Soft/deviceSoft.h
+    mgfx_core/graphics3d/device/Soft/bufferSoft.cpp
+    mgfx_core/graphics3d/device/Soft/bufferSoft.h
+    mgfx_core/graphics3d/device/Soft/imguisdl_soft.cpp
+    mgfx_core/graphics3d/device/Soft/imguisdl_soft.h
 )
 
 endif()